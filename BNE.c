@@ -44,13 +44,13 @@ void bne_immd_assm(void) {
 		Checking the value of parameters
 	*/
 
-	// Rt should be 31 or less
+	// Rs should be 31 or less
 	if (PARAM1.value > 31) {
 		state = INVALID_REG;
 		return;
 	}
 
-	// Rs should be 31 or less
+	// Rt should be 31 or less
 	if (PARAM2.value > 31) {
 		state = INVALID_REG;
 		return;
@@ -69,11 +69,11 @@ void bne_immd_assm(void) {
 	// Set the opcode
 	setBits_str(31, "000101");
 
-	// set Rt
-	setBits_num(20, PARAM1.value, 5);
-
 	// set Rs
-	setBits_num(25, PARAM2.value, 5);
+	setBits_num(25, PARAM1.value, 5);
+
+	// set Rt
+	setBits_num(20, PARAM2.value, 5);
 
 	// set offset
 	setBits_num(15, PARAM3.value, 16);
@@ -109,8 +109,8 @@ void bne_immd_bin(void) {
 	setOp("BNE");
 	//setCond_num(cond);
 	//setParam(param_num, param_type, param_value)
-	setParam(1, REGISTER, Rt); // destination
-	setParam(2, REGISTER, Rs); // source register operand
+	setParam(1, REGISTER, Rs); // first register compared
+	setParam(2, REGISTER, Rt); // second register compared
 	setParam(3, IMMEDIATE, offset); // immediate operand
 
 	// tell the system the decoding is done
@@ -43,8 +43,8 @@
  
 	 // Begin encoding: DIV is an R-type instruction
 	 setBits_str(31, "000000");               // Opcode for R-type (bits 31–26)
-	 setBits_num(25, PARAM2.value, 5);        // Rs (PARAM2) — bits 25–21
-	 setBits_num(20, PARAM1.value, 5);        // Rt (PARAM1) — bits 20–16
+	 setBits_num(25, PARAM1.value, 5);        // Rs (PARAM1) — bits 25–21
+	 setBits_num(20, PARAM2.value, 5);        // Rt (PARAM2) — bits 20–16
 	 setBits_num(15, 0, 5);                   // Rd — unused, set to 0
 	 setBits_num(10, 0, 5);                   // Shamt — unused, set to 0
 	 setBits_str(5, "011010");                // Function code for DIV (bits 5–0)
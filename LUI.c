@@ -85,7 +85,7 @@
 	 // Set the operation to "LUI" and its parameters.
 	 setOp("LUI");
 	 setParam(1, REGISTER, Rt);         // Destination register
-	 setParam(3, IMMEDIATE, imm16);     // Immediate value
+	 setParam(2, IMMEDIATE, imm16);     // Immediate value
  
 	 // Mark decoding as complete
 	 state = COMPLETE_DECODE;
@@ -26,12 +26,22 @@ void lw_immd_assm(void) {
 	}
 	
 	// Validate the types of the parameters.
-	if (PARAM1.type != REGISTER || PARAM2.type != REGISTER || PARAM3.type != IMMEDIATE) 
+	if (PARAM1.type != REGISTER || PARAM2.type != IMMEDIATE || PARAM3.type != REGISTER) 
 	{
 		state = INVALID_PARAM;
 		return;
 	}
 
+	// Validate the register numbers and the offset.
+	if (PARAM1.value > 31 || PARAM3.value > 31) {
+		state = INVALID_REG;
+		return;
+	}
+	if (PARAM2.value > 0xFFFF) {
+		state = INVALID_IMMED;
+		return;
+	}
+
 	// Set the opcode bits for "LW" (Load Word).
 	setBits_str(31, "100011");
 
@@ -0,0 +1,408 @@
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_AOT.h"
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: writes the code that leaves the translated program with a status
+	Params: FILE* out - where to write
+			const char* status - the status name
+			uint32_t pc - the pc to report
+			uint32_t pending - instructions counted at block entry that did not retire
+	Return: none
+*/
+static void emitExit(FILE* out, const char* status, uint32_t pc, uint32_t pending) {
+	fprintf(out, "EXIT(%s, 0x%08Xu, %u);\n", status, pc, pending);
+}
+
+/*
+	Purpose: writes the jump for a taken branch
+	Params: FILE* out - where to write
+			uint32_t target - index of the target word, may be out of the text
+			uint32_t target_pc - address of the target
+			uint32_t count - the number of words
+	Return: none
+*/
+static void emitGoto(FILE* out, uint32_t target, uint32_t target_pc, uint32_t count) {
+	if (target < count) {
+		fprintf(out, "goto L_%u;\n", target);
+	}
+	else if (target == count) {
+		fprintf(out, "goto done;\n");
+	}
+	else {
+		fprintf(out, "EXIT(INVALID_PC, 0x%08Xu, 0);\n", target_pc);
+	}
+}
+
+/*
+	Purpose: writes the C for one instruction
+	Params: FILE* out - where to write
+			const Decoded_Instruct* d - the instruction
+			uint32_t index - its word index
+			uint32_t pc - its address
+			uint32_t pending - instructions of the block from this one on
+			uint32_t count - the number of words
+	Return: none
+*/
+static void emitInstruct(FILE* out, const Decoded_Instruct* d, uint32_t index, uint32_t pc, uint32_t pending, uint32_t count) {
+	uint32_t sext = SIGN_EXT16(d->imm);
+
+	// writes to $zero are dropped so r[0] stays zero
+	int rd = d->rd != 0;
+	int rt = d->rt != 0;
+
+	switch (d->op) {
+	case OP_ADD: { if (rd) fprintf(out, "\tr[%u] = r[%u] + r[%u];\n", d->rd, d->rs, d->rt); break; }
+	case OP_SUB: { if (rd) fprintf(out, "\tr[%u] = r[%u] - r[%u];\n", d->rd, d->rs, d->rt); break; }
+	case OP_AND: { if (rd) fprintf(out, "\tr[%u] = r[%u] & r[%u];\n", d->rd, d->rs, d->rt); break; }
+	case OP_OR: { if (rd) fprintf(out, "\tr[%u] = r[%u] | r[%u];\n", d->rd, d->rs, d->rt); break; }
+	case OP_SLT: { if (rd) fprintf(out, "\tr[%u] = (int32_t)r[%u] < (int32_t)r[%u];\n", d->rd, d->rs, d->rt); break; }
+	case OP_ADDI: { if (rt) fprintf(out, "\tr[%u] = r[%u] + 0x%08Xu;\n", d->rt, d->rs, sext); break; }
+	case OP_ANDI: { if (rt) fprintf(out, "\tr[%u] = r[%u] & 0x%04Xu;\n", d->rt, d->rs, d->imm); break; }
+	case OP_ORI: { if (rt) fprintf(out, "\tr[%u] = r[%u] | 0x%04Xu;\n", d->rt, d->rs, d->imm); break; }
+	case OP_SLTI: { if (rt) fprintf(out, "\tr[%u] = (int32_t)r[%u] < (%d);\n", d->rt, d->rs, (int16_t)d->imm); break; }
+	case OP_LUI: { if (rt) fprintf(out, "\tr[%u] = 0x%08Xu;\n", d->rt, (uint32_t)d->imm << 16); break; }
+	case OP_MFHI: { if (rd) fprintf(out, "\tr[%u] = hi;\n", d->rd); break; }
+	case OP_MFLO: { if (rd) fprintf(out, "\tr[%u] = lo;\n", d->rd); break; }
+	case OP_MULT: {
+		fprintf(out, "\tMULT(r[%u], r[%u]);\n", d->rs, d->rt);
+		break;
+	}
+	case OP_DIV: {
+		fprintf(out, "\tDIV(r[%u], r[%u]);\n", d->rs, d->rt);
+		break;
+	}
+	case OP_LW: {
+		fprintf(out, "\ta = r[%u] + 0x%08Xu;\n\tif (a & 3) ", d->rs, sext);
+		emitExit(out, "UNALIGNED_ACCESS", pc, pending);
+		if (rt) {
+			fprintf(out, "\tr[%u] = memRead(&g->mem, a);\n", d->rt);
+		}
+		break;
+	}
+	case OP_SW: {
+		fprintf(out, "\ta = r[%u] + 0x%08Xu;\n\tif (a & 3) ", d->rs, sext);
+		emitExit(out, "UNALIGNED_ACCESS", pc, pending);
+		fprintf(out, "\tif (memWrite(&g->mem, a, r[%u]) == MEM_NO_PAGE) ", d->rt);
+		emitExit(out, "OUT_OF_MEMORY", pc, pending);
+		break;
+	}
+	case OP_BEQ:
+	case OP_BNE: {
+		uint32_t target = index + 1 + sext;
+		fprintf(out, "\tif (r[%u] %s r[%u]) ", d->rs, (d->op == OP_BEQ) ? "==" : "!=", d->rt);
+		emitGoto(out, target, pc + 4 + (sext << 2), count);
+		break;
+	}
+	default: {
+		fprintf(out, "\t");
+		emitExit(out, "UNRECOGNIZED_COMMAND", pc, pending);
+		break;
+	}
+	}
+}
+
+/*
+	Purpose: writes the C translation of a program
+	Params: FILE* out - where to write the source
+			const uint32_t* text - the program words
+			uint32_t count - the number of words
+			const char* name - the program name for the header comment
+	Return: int - 0 for no error
+*/
+int emitProgramC(FILE* out, const uint32_t* text, uint32_t count, const char* name) {
+	Decoded_Instruct* code = malloc((count + 1) * sizeof(Decoded_Instruct));
+	uint8_t* leader = calloc(count + 1, 1);
+
+	if (code == NULL || leader == NULL) {
+		free(code);
+		free(leader);
+		return 1;
+	}
+
+	// finds the block leaders: the entry, branch targets and the words after branches
+	leader[0] = 1;
+	for (uint32_t i = 0; i < count; i++) {
+		decodeWord(text[i], &code[i]);
+
+		if (code[i].op == OP_BEQ || code[i].op == OP_BNE) {
+			uint32_t target = i + 1 + SIGN_EXT16(code[i].imm);
+			if (target < count) {
+				leader[target] = 1;
+			}
+			leader[i + 1] = 1;
+		}
+	}
+
+	fprintf(out, "/* translated by MIPS_translatron --aot from %s, %u words */\n", name, count);
+	fprintf(out, "#include <stdio.h>\n#include <stdint.h>\n#include <stdlib.h>\n#include <time.h>\n");
+	fprintf(out, "#include \"global_data.h\"\n#include \"MIPS_Memory.h\"\n\n");
+
+	// guest state shared with the runner
+	fprintf(out, "typedef struct {\n\tuint32_t pc;\n\tuint32_t reg[32];\n\tuint32_t hi;\n\tuint32_t lo;\n");
+	fprintf(out, "\tunsigned long long retired;\n\tGuest_Memory mem;\n} Guest_State;\n\n");
+
+	fprintf(out, "#define EXIT(s, p, n) do { status = (s); g->pc = (p); retired -= (n); goto out; } while (0)\n");
+	fprintf(out, "#define MULT(x, y) do { int64_t p_ = (int64_t)(int32_t)(x) * (int32_t)(y); "
+		"hi = (uint32_t)((uint64_t)p_ >> 32); lo = (uint32_t)p_; } while (0)\n");
+	fprintf(out, "#define DIV(x, y) do { int32_t n_ = (int32_t)(x), q_ = (int32_t)(y); if (q_ != 0) { "
+		"if (n_ == INT32_MIN && q_ == -1) { lo = (uint32_t)n_; hi = 0; } "
+		"else { lo = (uint32_t)(n_ / q_); hi = (uint32_t)(n_ %% q_); } } } while (0)\n\n");
+
+	fprintf(out, "static unsigned run(Guest_State* g) {\n");
+	fprintf(out, "\tuint32_t r[32];\n\tuint32_t hi = g->hi;\n\tuint32_t lo = g->lo;\n");
+	fprintf(out, "\tuint32_t a;\n\tunsigned long long retired = g->retired;\n\tunsigned status = COMPLETE_RUN;\n");
+	fprintf(out, "\tfor (int i = 0; i < 32; i++) { r[i] = g->reg[i]; }\n\t(void)a;\n\n");
+
+	// one labeled region per block, the retired count is added on entry
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t pc = TEXT_BASE + i * 4;
+
+		if (leader[i]) {
+			uint32_t end = i + 1;
+			while (end < count && !leader[end]) {
+				end++;
+			}
+			fprintf(out, "L_%u: /* 0x%08X */\n\tretired += %u;\n", i, pc, end - i);
+
+			// a fault leaves the rest of the block, from the faulting word on, unretired
+			for (uint32_t j = i; j < end; j++) {
+				emitInstruct(out, &code[j], j, TEXT_BASE + j * 4, end - j, count);
+			}
+			i = end - 1;
+		}
+	}
+
+	fprintf(out, "done:\n\tg->pc = 0x%08Xu;\nout:\n", TEXT_BASE + count * 4);
+	fprintf(out, "\tfor (int i = 0; i < 32; i++) { g->reg[i] = r[i]; }\n");
+	fprintf(out, "\tg->hi = hi;\n\tg->lo = lo;\n\tg->retired = retired;\n\treturn status;\n}\n\n");
+
+	// runner: arguments into $a0-$a3, then the STATE line and the run time
+	fprintf(out, "int main(int argc, char** argv) {\n");
+	fprintf(out, "\tstatic Guest_State g;\n\tstruct timespec t0, t1;\n\n");
+	fprintf(out, "\tmemInit(&g.mem);\n\tg.pc = 0x%08Xu;\n", TEXT_BASE);
+	fprintf(out, "\tg.reg[%d] = 0x%08Xu;\n\tg.reg[%d] = 0x%08Xu;\n", REG_GP, GLOBAL_PTR, REG_SP, STACK_TOP);
+	fprintf(out, "\tfor (int i = 1; i < argc && i <= 4; i++) { g.reg[%d + i - 1] = (uint32_t)strtoll(argv[i], NULL, 0); }\n\n", REG_A0);
+	fprintf(out, "\tclock_gettime(CLOCK_MONOTONIC, &t0);\n\tunsigned status = run(&g);\n");
+	fprintf(out, "\tclock_gettime(CLOCK_MONOTONIC, &t1);\n\n");
+	fprintf(out, "\tprintf(\"%s\", status, g.pc, g.retired, g.hi, g.lo);\n", STATE_HEAD_FMT);
+	fprintf(out, "\tfor (int i = 0; i < 32; i++) { printf(\"%s\", g.reg[i]); }\n", STATE_REG_FMT);
+	fprintf(out, "\tprintf(\"%s\\n\", (unsigned long long)memChecksum(&g.mem));\n", STATE_MEM_FMT);
+	fprintf(out, "\tprintf(\"TIME %%.6f\\n\", (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);\n");
+	fprintf(out, "\treturn status != COMPLETE_RUN;\n}\n");
+
+	free(code);
+	free(leader);
+	return ferror(out) != 0;
+}
+
+/*
+	Purpose: formats the STATE line of a finished machine, the same line translated programs print
+	Params: char* line - STATE_LINE_SIZE bytes to fill
+			Machine* m - the machine to describe
+	Return: none
+*/
+void formatStateLine(char* line, Machine* m) {
+	int n = snprintf(line, STATE_LINE_SIZE, STATE_HEAD_FMT, (unsigned)m->status, m->arch.pc,
+		(unsigned long long)m->retired, m->arch.hi, m->arch.lo);
+
+	for (int i = 0; i < 32; i++) {
+		n += snprintf(line + n, STATE_LINE_SIZE - n, STATE_REG_FMT, m->arch.reg[i]);
+	}
+	snprintf(line + n, STATE_LINE_SIZE - n, STATE_MEM_FMT, (unsigned long long)memChecksum(&m->mem));
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: quotes an argument for the shell, each ' in it closes the quotes, is escaped and reopens them
+	Params: char* out - filled with the quoted argument
+			size_t size - the size of out
+			const char* arg - the argument
+	Return: int - 0 for no error, 1 when the quoted argument does not fit
+*/
+static int shellQuote(char* out, size_t size, const char* arg) {
+	size_t n = 0;
+
+	if (size < 3) {
+		return 1;
+	}
+	out[n++] = '\'';
+	for (; *arg != '\0'; arg++) {
+		// room for the longest escape, the closing quote and the terminator
+		if (n + 6 > size) {
+			return 1;
+		}
+		if (*arg == '\'') {
+			memcpy(out + n, "'\\''", 4);
+			n += 4;
+		}
+		else {
+			out[n++] = *arg;
+		}
+	}
+	out[n++] = '\'';
+	out[n] = '\0';
+	return 0;
+}
+
+/*
+	Purpose: --aot mode, translates a program to C
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> <out.c>
+	Return: int - exit code
+*/
+int aotMain(int argc, char** argv) {
+	if (argc < 2) {
+		error("--aot needs a program file and an output file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* text = loadProgram(argv[0], &count);
+	if (text == NULL) {
+		return 1;
+	}
+
+	FILE* out = fopen(argv[1], "w");
+	if (out == NULL) {
+		perror(argv[1]);
+		free(text);
+		return 1;
+	}
+
+	int failed = emitProgramC(out, text, count, argv[0]);
+	failed |= (fclose(out) != 0);
+
+	free(text);
+	return failed;
+}
+
+/*
+	Purpose: --aot-verify mode, translates, builds and runs a program and compares it with the interpreter
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int aotVerifyMain(int argc, char** argv) {
+	if (argc < 1) {
+		error("--aot-verify needs a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* text = loadProgram(argv[0], &count);
+	if (text == NULL) {
+		return 1;
+	}
+
+	const char* src = getenv(AOT_SRC_ENV) ? getenv(AOT_SRC_ENV) : ".";
+	const char* cc = getenv("CC") ? getenv("CC") : AOT_DEFAULT_CC;
+	char c_path[64];
+	char bin_path[64];
+	char quoted[3][AOT_ARG_SIZE];
+	char cmd[AOT_CMD_SIZE];
+	int failed = 1;
+
+	snprintf(c_path, sizeof(c_path), "/tmp/mips_aot_%d.c", (int)getpid());
+	snprintf(bin_path, sizeof(bin_path), "/tmp/mips_aot_%d", (int)getpid());
+
+	// translates and builds the runner
+	FILE* out = fopen(c_path, "w");
+	if (out == NULL) {
+		perror(c_path);
+		free(text);
+		return 1;
+	}
+	int emit_failed = emitProgramC(out, text, count, argv[0]);
+	emit_failed |= (fclose(out) != 0);
+
+	// every path is quoted, CC is left as it is so it can carry its own flags
+	double start = getTime();
+	if (shellQuote(quoted[0], AOT_ARG_SIZE, src) != 0 || shellQuote(quoted[1], AOT_ARG_SIZE, bin_path) != 0 ||
+		shellQuote(quoted[2], AOT_ARG_SIZE, c_path) != 0 ||
+		snprintf(cmd, sizeof(cmd), "%s -O2 -I%s -o %s %s %s/MIPS_Memory.c", cc, quoted[0], quoted[1], quoted[2],
+			quoted[0]) >= (int)sizeof(cmd)) {
+		error("The build command is too long");
+		goto cleanup;
+	}
+	if (emit_failed || system(cmd) != 0) {
+		error("Building the translated program failed");
+		goto cleanup;
+	}
+	double build = getTime() - start;
+
+	// runs the interpreter on the same inputs
+	Machine m;
+	if (machineInit(&m, text, count) != 0) {
+		goto cleanup;
+	}
+	machineArgs(&m, argc - 1, argv + 1);
+	start = getTime();
+	machineRun(&m);
+	double interp = getTime() - start;
+
+	char expected[STATE_LINE_SIZE];
+	formatStateLine(expected, &m);
+	machineFree(&m);
+
+	// runs the native build and reads back its STATE and TIME lines, the arguments are quoted like the paths
+	size_t n = strlen(quoted[1]);
+	memcpy(cmd, quoted[1], n + 1);
+	for (int i = 1; i < argc && i <= 4; i++) {
+		if (shellQuote(quoted[0], AOT_ARG_SIZE, argv[i]) != 0 || n + 1 + strlen(quoted[0]) >= sizeof(cmd)) {
+			error("The run command is too long");
+			goto cleanup;
+		}
+		cmd[n++] = ' ';
+		strcpy(cmd + n, quoted[0]);
+		n += strlen(quoted[0]);
+	}
+
+	FILE* run = popen(cmd, "r");
+	if (run == NULL) {
+		perror(cmd);
+		goto cleanup;
+	}
+
+	char actual[STATE_LINE_SIZE] = { '\0' };
+	char line[STATE_LINE_SIZE];
+	double native = 0;
+	while (fgets(line, sizeof(line), run) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (startswith(line, "STATE ")) {
+			strcpy(actual, line);
+		}
+		else if (startswith(line, "TIME ")) {
+			native = atof(line + 5);
+		}
+	}
+	pclose(run);
+
+	// the whole lines are compared, both are printed on a mismatch to show what differs
+	if (strcmp(expected, actual) == 0) {
+		puts("Translated program matches the interpreter");
+		failed = 0;
+	}
+	else {
+		error("Translated program does not match the interpreter");
+		printf("Interpreter: %s\nTranslated:  %s\n", expected, actual);
+	}
+	printf("Build: %.3f s\tInterpreter: %.6f s\tTranslated: %.6f s", build, interp, native);
+	if (native > 0) {
+		printf("\tSpeedup: %.1fx", interp / native);
+	}
+	printf("\n");
+
+cleanup:
+	remove(c_path);
+	remove(bin_path);
+	free(text);
+	return failed;
+}
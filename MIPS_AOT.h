@@ -0,0 +1,79 @@
+#ifndef _MIPS_AOT_H_
+#define _MIPS_AOT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "MIPS_Execute.h"
+
+/*
+	Ahead of time translation of a program to C. Every basic block becomes a
+	labeled region of one function working on local copies of the registers,
+	BEQ/BNE become gotos and LW/SW call the paged memory accessors. The output
+	is built with the host compiler against MIPS_Memory.c:
+
+		cc -O2 -I<src> prog.c <src>/MIPS_Memory.c -o prog
+
+	and prints one "STATE" line that --aot-verify compares with the interpreter.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// environment variable naming the directory with MIPS_Memory.c, defaults to "."
+#define AOT_SRC_ENV "MIPS_SRC"
+
+// host compiler used by --aot-verify, overridden by the CC environment variable
+#define AOT_DEFAULT_CC "cc"
+
+// longest shell quoted path or argument, and longest command, --aot-verify runs
+#define AOT_ARG_SIZE 1024
+#define AOT_CMD_SIZE 4096
+
+// STATE line printed by translated programs: status, pc, retired, hi, lo, 32 registers, memory hash
+#define STATE_HEAD_FMT "STATE %u 0x%08X %llu 0x%08X 0x%08X"
+#define STATE_REG_FMT " 0x%08X"
+#define STATE_MEM_FMT " 0x%016llX"
+#define STATE_LINE_SIZE 512
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: writes the C translation of a program
+	Params: FILE* out - where to write the source
+			const uint32_t* text - the program words
+			uint32_t count - the number of words
+			const char* name - the program name for the header comment
+	Return: int - 0 for no error
+*/
+int emitProgramC(FILE* out, const uint32_t* text, uint32_t count, const char* name);
+
+/*
+	Purpose: formats the STATE line of a finished machine, the same line translated programs print
+	Params: char* line - STATE_LINE_SIZE bytes to fill
+			Machine* m - the machine to describe
+	Return: none
+*/
+void formatStateLine(char* line, Machine* m);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --aot mode, translates a program to C
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> <out.c>
+	Return: int - exit code
+*/
+int aotMain(int argc, char** argv);
+
+/*
+	Purpose: --aot-verify mode, translates, builds and runs a program and compares it with the interpreter
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int aotVerifyMain(int argc, char** argv);
+
+#endif
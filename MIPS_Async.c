@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "MIPS_Async.h"
+
+#ifdef MIPS_HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/*----------------------------\
+		   io_uring
+\----------------------------*/
+#ifdef MIPS_HAVE_URING
+/*
+	Purpose: sets up an io_uring and maps its rings
+	Params: Async_IO* io - the queue to set up, depth already set
+	Return: int - 0 for no error
+*/
+static int uringInit(Async_IO* io) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	io->ring_fd = (int)syscall(__NR_io_uring_setup, io->depth, &params);
+	if (io->ring_fd < 0) {
+		return 1;
+	}
+
+	// the submission and completion rings share one mapping on newer kernels
+	io->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	io->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (io->cq_size > io->sq_size) {
+			io->sq_size = io->cq_size;
+		}
+		io->cq_size = io->sq_size;
+	}
+
+	io->sq_ptr = mmap(NULL, io->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd,
+		IORING_OFF_SQ_RING);
+	if (io->sq_ptr == MAP_FAILED) {
+		close(io->ring_fd);
+		return 1;
+	}
+
+	io->cq_ptr = io->sq_ptr;
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+		io->cq_ptr = mmap(NULL, io->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd,
+			IORING_OFF_CQ_RING);
+		if (io->cq_ptr == MAP_FAILED) {
+			munmap(io->sq_ptr, io->sq_size);
+			close(io->ring_fd);
+			return 1;
+		}
+	}
+
+	io->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd,
+		IORING_OFF_SQES);
+	if (io->sqes == MAP_FAILED) {
+		if (io->cq_ptr != io->sq_ptr) {
+			munmap(io->cq_ptr, io->cq_size);
+		}
+		munmap(io->sq_ptr, io->sq_size);
+		close(io->ring_fd);
+		return 1;
+	}
+
+	char* sq = io->sq_ptr;
+	char* cq = io->cq_ptr;
+	io->sq_head = (unsigned*)(sq + params.sq_off.head);
+	io->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	io->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	io->sq_array = (unsigned*)(sq + params.sq_off.array);
+	io->cq_head = (unsigned*)(cq + params.cq_off.head);
+	io->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	io->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	io->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return 0;
+}
+
+/*
+	Purpose: unmaps the rings and closes the io_uring
+	Params: Async_IO* io - the queue to release
+	Return: none
+*/
+static void uringFree(Async_IO* io) {
+	munmap(io->sqes, io->sqes_size);
+	if (io->cq_ptr != io->sq_ptr) {
+		munmap(io->cq_ptr, io->cq_size);
+	}
+	munmap(io->sq_ptr, io->sq_size);
+	close(io->ring_fd);
+}
+
+/*
+	Purpose: puts a request on the submission ring, the kernel sees it at the next enter
+	Params: Async_IO* io - the queue
+			int write - writes when set, reads otherwise
+			int fd - the file
+			void* buf - the data
+			size_t len - the number of bytes
+			uint64_t offset - the file offset
+			uint64_t tag - handed back with the completion
+	Return: none
+*/
+static void uringQueue(Async_IO* io, int write, int fd, void* buf, size_t len, uint64_t offset, uint64_t tag) {
+	unsigned tail = *io->sq_tail;
+	unsigned index = tail & *io->sq_mask;
+	struct io_uring_sqe* sqe = &io->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = (uint32_t)len;
+	sqe->off = offset;
+	sqe->user_data = tag;
+
+	io->sq_array[index] = index;
+	__atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+	Purpose: submits queued requests and optionally waits for a completion
+	Params: Async_IO* io - the queue
+			unsigned wait - how many completions to wait for
+	Return: int - 0 for no error, the errno when the kernel refused
+*/
+static int uringEnter(Async_IO* io, unsigned wait) {
+	while (io->queued > 0 || wait > 0) {
+		int ret = (int)syscall(__NR_io_uring_enter, io->ring_fd, io->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0,
+			NULL, 0);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+				continue;
+			}
+			return errno;
+		}
+		io->queued -= (unsigned)ret;
+		if (io->queued == 0 || wait > 0) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+/*
+	Purpose: takes one completion off the completion ring if there is one
+	Params: Async_IO* io - the queue
+			Aio_Completion* done - filled with the finished request
+	Return: int - 1 if a completion was taken
+*/
+static int uringReap(Async_IO* io, Aio_Completion* done) {
+	unsigned head = *io->cq_head;
+
+	if (head == __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	struct io_uring_cqe* cqe = &io->cqes[head & *io->cq_mask];
+	done->tag = cqe->user_data;
+	done->result = cqe->res;
+	__atomic_store_n(io->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+#endif
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: sets up asynchronous I/O, falling back to pread/pwrite when io_uring is not available
+	Params: Async_IO* io - the queue to set up
+			unsigned depth - most requests in flight, at most AIO_MAX_DEPTH
+	Return: int - 0 for no error
+*/
+int aioInit(Async_IO* io, unsigned depth) {
+	memset(io, 0, sizeof(*io));
+	io->depth = (depth == 0 || depth > AIO_MAX_DEPTH) ? AIO_MAX_DEPTH : depth;
+
+#ifdef MIPS_HAVE_URING
+	if (getenv(AIO_NO_URING_ENV) == NULL && uringInit(io) == 0) {
+		io->use_uring = 1;
+	}
+#endif
+
+	return 0;
+}
+
+/*
+	Purpose: releases the queue, every request must have completed
+	Params: Async_IO* io - the queue to release
+	Return: none
+*/
+void aioFree(Async_IO* io) {
+#ifdef MIPS_HAVE_URING
+	if (io->use_uring) {
+		uringFree(io);
+	}
+#endif
+	io->use_uring = 0;
+}
+
+/*
+	Purpose: queues a read or write at a file offset, the caller keeps fewer than depth requests in flight
+	Params: Async_IO* io - the queue
+			int write - writes when set, reads otherwise
+			int fd - the file
+			void* buf - the data, must stay untouched until the request completes
+			size_t len - the number of bytes
+			uint64_t offset - the file offset
+			uint64_t tag - handed back with the completion
+	Return: none
+*/
+void aioSubmit(Async_IO* io, int write, int fd, void* buf, size_t len, uint64_t offset, uint64_t tag) {
+	io->inflight++;
+
+#ifdef MIPS_HAVE_URING
+	if (io->use_uring) {
+		io->submits++;
+		io->depth_sum += io->inflight;
+		if (io->inflight > io->depth_max) {
+			io->depth_max = io->inflight;
+		}
+		uringQueue(io, write, fd, buf, len, offset, tag);
+		io->tags[io->inflight - 1] = tag;
+		io->queued++;
+		return;
+	}
+#endif
+
+	// the fallback finishes the request now and keeps the completion for aioWait
+	ssize_t result;
+	do {
+		result = write ? pwrite(fd, buf, len, (off_t)offset) : pread(fd, buf, len, (off_t)offset);
+	} while (result < 0 && errno == EINTR);
+
+	Aio_Completion* done = &io->done[(io->done_head + io->done_count++) % AIO_MAX_DEPTH];
+	done->tag = tag;
+	done->result = (result < 0) ? -errno : result;
+}
+
+/*
+	Purpose: starts every queued request without waiting for any
+	Params: Async_IO* io - the queue
+	Return: none
+*/
+void aioFlush(Async_IO* io) {
+#ifdef MIPS_HAVE_URING
+	if (io->use_uring && io->queued > 0 && io->error == 0) {
+		io->error = uringEnter(io, 0);
+	}
+#else
+	(void)io;
+#endif
+}
+
+/*
+	Purpose: starts queued requests and waits for one to finish
+	Params: Async_IO* io - the queue, must have a request in flight
+			Aio_Completion* done - filled with the finished request, failed with the errno if io_uring broke
+	Return: none
+*/
+void aioWait(Async_IO* io, Aio_Completion* done) {
+#ifdef MIPS_HAVE_URING
+	if (io->use_uring) {
+		while (!uringReap(io, done)) {
+			if (io->error == 0) {
+				io->error = uringEnter(io, 1);
+				continue;
+			}
+
+			// nothing more will complete, so the latest request fails with the error
+			done->tag = io->tags[io->inflight - 1];
+			done->result = -io->error;
+			break;
+		}
+
+		// the last tag takes the finished one's place
+		for (unsigned i = 0; i < io->inflight; i++) {
+			if (io->tags[i] == done->tag) {
+				io->tags[i] = io->tags[io->inflight - 1];
+				break;
+			}
+		}
+		io->inflight--;
+		return;
+	}
+#endif
+
+	*done = io->done[io->done_head];
+	io->done_head = (io->done_head + 1) % AIO_MAX_DEPTH;
+	io->done_count--;
+	io->inflight--;
+}
+
+/*
+	Purpose: names the backend in use
+	Params: const Async_IO* io - the queue
+	Return: const char* - "io_uring" or "pread/pwrite"
+*/
+const char* aioBackend(const Async_IO* io) {
+	return io->use_uring ? "io_uring" : "pread/pwrite";
+}
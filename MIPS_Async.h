@@ -0,0 +1,136 @@
+#ifndef _MIPS_ASYNC_H_
+#define _MIPS_ASYNC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+	Asynchronous positioned file I/O. On Linux with <linux/io_uring.h>
+	requests go through an io_uring set up with raw system calls: queued
+	requests are submitted together by aioFlush()/aioWait() and run while
+	the caller keeps working. Anywhere else, or when the kernel refuses
+	io_uring or MIPS_NO_URING is set, each request is done right away with
+	pread()/pwrite() and its completion is handed back by the next
+	aioWait(), so callers are written the same way for both.
+*/
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MIPS_HAVE_URING 1
+#endif
+#endif
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// most requests one Async_IO keeps in flight
+#define AIO_MAX_DEPTH 64
+
+// set in the environment to force the pread/pwrite backend
+#define AIO_NO_URING_ENV "MIPS_NO_URING"
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a finished request, result is the byte count or a negative errno
+typedef struct {
+	uint64_t tag;
+	int64_t result;
+} Aio_Completion;
+
+typedef struct Async_IO {
+	int use_uring;
+	unsigned depth;
+	unsigned inflight;
+	unsigned queued;
+
+	// how deep the io_uring queue was each time a request went in
+	uint64_t submits;
+	uint64_t depth_sum;
+	unsigned depth_max;
+
+	// completions of the pread/pwrite backend, waiting for aioWait
+	Aio_Completion done[AIO_MAX_DEPTH];
+	unsigned done_head;
+	unsigned done_count;
+
+#ifdef MIPS_HAVE_URING
+	// the kernel's rings, mapped at setup
+	int ring_fd;
+	void* sq_ptr;
+	void* cq_ptr;
+	size_t sq_size;
+	size_t cq_size;
+	struct io_uring_sqe* sqes;
+	size_t sqes_size;
+	unsigned* sq_head;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_cqe* cqes;
+
+	// tags of the requests in flight, handed back failed once the ring breaks
+	uint64_t tags[AIO_MAX_DEPTH];
+	// errno of an io_uring_enter that failed for good, 0 while the ring works
+	int error;
+#endif
+} Async_IO;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: sets up asynchronous I/O, falling back to pread/pwrite when io_uring is not available
+	Params: Async_IO* io - the queue to set up
+			unsigned depth - most requests in flight, at most AIO_MAX_DEPTH
+	Return: int - 0 for no error
+*/
+int aioInit(Async_IO* io, unsigned depth);
+
+/*
+	Purpose: releases the queue, every request must have completed
+	Params: Async_IO* io - the queue to release
+	Return: none
+*/
+void aioFree(Async_IO* io);
+
+/*
+	Purpose: queues a read or write at a file offset, the caller keeps fewer than depth requests in flight
+	Params: Async_IO* io - the queue
+			int write - writes when set, reads otherwise
+			int fd - the file
+			void* buf - the data, must stay untouched until the request completes
+			size_t len - the number of bytes
+			uint64_t offset - the file offset
+			uint64_t tag - handed back with the completion
+	Return: none
+*/
+void aioSubmit(Async_IO* io, int write, int fd, void* buf, size_t len, uint64_t offset, uint64_t tag);
+
+/*
+	Purpose: starts every queued request without waiting for any
+	Params: Async_IO* io - the queue
+	Return: none
+*/
+void aioFlush(Async_IO* io);
+
+/*
+	Purpose: starts queued requests and waits for one to finish
+	Params: Async_IO* io - the queue, must have a request in flight
+			Aio_Completion* done - filled with the finished request
+	Return: none
+*/
+void aioWait(Async_IO* io, Aio_Completion* done);
+
+/*
+	Purpose: names the backend in use
+	Params: const Async_IO* io - the queue
+	Return: const char* - "io_uring" or "pread/pwrite"
+*/
+const char* aioBackend(const Async_IO* io);
+
+#endif
@@ -0,0 +1,479 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Batch.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Pipe.h"
+#include "MIPS_Util.h"
+
+// completions for writes carry this bit, reads carry only their slot
+#define TAG_WRITE (1ull << 32)
+
+// a block read ahead of translation
+typedef struct {
+	char* data;
+	uint64_t offset;
+	size_t want;
+	size_t len;
+	int ready;
+} Read_Slot;
+
+// an output block being filled or written
+typedef struct {
+	char* data;
+	uint64_t offset;
+	size_t len;
+	size_t done;
+	int busy;
+} Write_Slot;
+
+// one file being translated
+typedef struct {
+	Async_IO* io;
+	int in_fd;
+	int out_fd;
+	uint64_t in_size;
+	uint64_t read_offset;
+	uint64_t out_offset;
+	Read_Slot reads[BATCH_READS];
+	Write_Slot writes[BATCH_WRITES];
+	int current;
+
+	// a line split across two blocks is put back together here
+	char* carry;
+	size_t carry_len;
+	size_t carry_size;
+
+	// set when the output is a flash image rather than one line per line
+	const char* in_path;
+	Flash_Encoder flash;
+	int use_flash;
+
+	uint64_t lines;
+	int failed;
+} Batch_File;
+
+/*----------------------------\
+		   Requests
+\----------------------------*/
+/*
+	Purpose: starts the read of the next block into a slot, if any of the file is left
+	Params: Batch_File* f - the file
+			int slot - the read slot to fill
+	Return: none
+*/
+static void submitRead(Batch_File* f, int slot) {
+	Read_Slot* r = &f->reads[slot];
+	uint64_t left = f->in_size - f->read_offset;
+
+	r->ready = 0;
+	r->offset = f->read_offset;
+	r->want = (left < BATCH_BLOCK_SIZE) ? (size_t)left : BATCH_BLOCK_SIZE;
+	r->len = 0;
+	if (r->want == 0) {
+		return;
+	}
+
+	f->read_offset += r->want;
+	aioSubmit(f->io, 0, f->in_fd, r->data, r->want, r->offset, (uint64_t)slot);
+}
+
+/*
+	Purpose: starts writing the block being filled at the end of the output
+	Params: Batch_File* f - the file
+	Return: none
+*/
+static void submitWrite(Batch_File* f) {
+	Write_Slot* w = &f->writes[f->current];
+	if (w->len == 0) {
+		return;
+	}
+
+	w->offset = f->out_offset;
+	w->done = 0;
+	w->busy = 1;
+	f->out_offset += w->len;
+	aioSubmit(f->io, 1, f->out_fd, w->data, w->len, w->offset, TAG_WRITE | (uint64_t)f->current);
+}
+
+/*
+	Purpose: handles a finished request, finishing short reads and writes
+	Params: Batch_File* f - the file
+			const Aio_Completion* c - the finished request
+	Return: none
+*/
+static void completeRequest(Batch_File* f, const Aio_Completion* c) {
+	if (c->tag & TAG_WRITE) {
+		Write_Slot* w = &f->writes[c->tag & 0xFFFF];
+
+		if (c->result <= 0) {
+			// a write that took no bytes would be queued again forever, it has no errno to show
+			if (c->result == 0) {
+				error("write: short write, no bytes were written");
+			}
+			else {
+				errno = (int)-c->result;
+				perror("write");
+			}
+			f->failed = 1;
+			w->busy = 0;
+			return;
+		}
+
+		// a short write queues the rest from the same buffer
+		w->done += (size_t)c->result;
+		if (w->done < w->len) {
+			aioSubmit(f->io, 1, f->out_fd, w->data + w->done, w->len - w->done, w->offset + w->done, c->tag);
+			aioFlush(f->io);
+			return;
+		}
+		w->busy = 0;
+		return;
+	}
+
+	Read_Slot* r = &f->reads[c->tag];
+	if (c->result < 0) {
+		errno = (int)-c->result;
+		perror("read");
+		f->failed = 1;
+		r->ready = 1;
+		return;
+	}
+	r->len = (size_t)c->result;
+
+	// short reads are rare on regular files, the rest is read in place
+	while (r->len < r->want) {
+		ssize_t got = pread(f->in_fd, r->data + r->len, r->want - r->len, (off_t)(r->offset + r->len));
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			break;
+		}
+		r->len += (size_t)got;
+	}
+	r->ready = 1;
+}
+
+/*
+	Purpose: waits for one request and handles it
+	Params: Batch_File* f - the file
+	Return: none
+*/
+static void waitRequest(Batch_File* f) {
+	Aio_Completion c;
+	aioWait(f->io, &c);
+	completeRequest(f, &c);
+}
+
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: translates a line into the output block, sending the block off when it fills
+	Params: Batch_File* f - the file
+			char* line - the line, with a byte after it that can be overwritten
+			size_t len - the length of the line
+	Return: none
+*/
+static void emitLine(Batch_File* f, char* line, size_t len) {
+	Write_Slot* w = &f->writes[f->current];
+
+	if (BATCH_BLOCK_SIZE - w->len < PIPE_LINE_MAX) {
+		submitWrite(f);
+		aioFlush(f->io);
+
+		// the next block to fill is the oldest, waits until its write is done
+		f->current = (f->current + 1) % BATCH_WRITES;
+		w = &f->writes[f->current];
+		while (w->busy) {
+			waitRequest(f);
+		}
+		w->len = 0;
+	}
+
+	f->lines++;
+	if (!f->use_flash) {
+		w->len += translateLine(line, len, w->data + w->len);
+		return;
+	}
+
+	// a flash image only takes words, anything that is not one stops the file
+	if (f->failed) {
+		return;
+	}
+	Line_Record rec;
+	uint32_t word;
+	parseLine(line, len, &rec);
+	if (rec.kind == LINE_BLANK) {
+		return;
+	}
+	uint16_t status = recordWord(&rec, &word);
+	if (status != NO_ERROR) {
+		printf("%s:%llu: ", f->in_path, (unsigned long long)f->lines);
+		printf("ERROR: %s\n", errorMessage(status));
+		f->failed = 1;
+		return;
+	}
+	w->len += flashPutWord(&f->flash, word, w->data + w->len);
+}
+
+/*
+	Purpose: adds text to the split line buffer
+	Params: Batch_File* f - the file
+			const char* text - the text to add
+			size_t len - its length
+	Return: int - 0 for no error
+*/
+static int carryAppend(Batch_File* f, const char* text, size_t len) {
+	if (f->carry_len + len + 1 > f->carry_size) {
+		size_t size = (f->carry_size == 0) ? 256 : f->carry_size;
+		while (size < f->carry_len + len + 1) {
+			size *= 2;
+		}
+
+		char* grown = realloc(f->carry, size);
+		if (grown == NULL) {
+			return 1;
+		}
+		f->carry = grown;
+		f->carry_size = size;
+	}
+
+	memcpy(f->carry + f->carry_len, text, len);
+	f->carry_len += len;
+	return 0;
+}
+
+/*
+	Purpose: translates every line of a block, keeping a trailing partial line for the next one
+	Params: Batch_File* f - the file
+			Read_Slot* r - the block
+	Return: none
+*/
+static void translateBlock(Batch_File* f, Read_Slot* r) {
+	char* line = r->data;
+	char* end = r->data + r->len;
+
+	// finishes the line the last block ended in the middle of
+	if (f->carry_len > 0) {
+		char* newline = memchr(line, '\n', r->len);
+		if (newline == NULL) {
+			f->failed |= carryAppend(f, line, r->len);
+			return;
+		}
+
+		f->failed |= carryAppend(f, line, (size_t)(newline - line));
+		if (!f->failed) {
+			emitLine(f, f->carry, f->carry_len);
+		}
+		f->carry_len = 0;
+		line = newline + 1;
+	}
+
+	// lines inside the block are translated where they lie
+	char* newline;
+	while ((newline = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+		emitLine(f, line, (size_t)(newline - line));
+		line = newline + 1;
+	}
+
+	if (line < end) {
+		f->failed |= carryAppend(f, line, (size_t)(end - line));
+	}
+}
+
+/*
+	Purpose: translates one file into another, one output line per input line or one flash image for the file
+	Params: const char* in_path - the file to translate
+			const char* out_path - the file to write, replaced if it exists
+			const Flash_Encoder* flash - a started encoder to write a flash image with, NULL for text
+			Async_IO* io - the queue to use, idle on entry and on return
+			Batch_Stats* stats - added to with what this file moved
+	Return: int - 0 for no error
+*/
+int translateFile(const char* in_path, const char* out_path, const Flash_Encoder* flash, Async_IO* io,
+	Batch_Stats* stats) {
+	Batch_File f;
+	memset(&f, 0, sizeof(f));
+	f.io = io;
+	f.in_path = in_path;
+	if (flash != NULL) {
+		f.flash = *flash;
+		f.use_flash = 1;
+	}
+
+	double start = getTime();
+
+	f.in_fd = open(in_path, O_RDONLY);
+	if (f.in_fd < 0) {
+		perror(in_path);
+		return 1;
+	}
+	f.out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (f.out_fd < 0) {
+		perror(out_path);
+		close(f.in_fd);
+		return 1;
+	}
+
+	struct stat info;
+	if (fstat(f.in_fd, &info) != 0) {
+		perror(in_path);
+		f.failed = 1;
+	}
+	else {
+		f.in_size = (uint64_t)info.st_size;
+	}
+
+	// a trailing partial line always goes through carry, so blocks need no spare byte
+	for (int i = 0; i < BATCH_READS && !f.failed; i++) {
+		f.reads[i].data = malloc(BATCH_BLOCK_SIZE);
+		f.failed = (f.reads[i].data == NULL);
+	}
+	for (int i = 0; i < BATCH_WRITES && !f.failed; i++) {
+		f.writes[i].data = malloc(BATCH_BLOCK_SIZE);
+		f.failed = (f.writes[i].data == NULL);
+	}
+
+	if (!f.failed) {
+		uint64_t blocks = (f.in_size + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+
+		// fills the read ahead before translating anything
+		for (int i = 0; i < BATCH_READS; i++) {
+			submitRead(&f, i);
+		}
+		aioFlush(io);
+
+		for (uint64_t b = 0; b < blocks && !f.failed; b++) {
+			Read_Slot* r = &f.reads[b % BATCH_READS];
+			while (!r->ready) {
+				waitRequest(&f);
+			}
+			if (f.failed) {
+				break;
+			}
+
+			translateBlock(&f, r);
+
+			// the slot is free again, it reads the block BATCH_READS ahead
+			submitRead(&f, (int)(b % BATCH_READS));
+			aioFlush(io);
+		}
+
+		// the file may end without a line ending
+		if (f.carry_len > 0 && !f.failed) {
+			emitLine(&f, f.carry, f.carry_len);
+		}
+
+		// emitLine always leaves PIPE_LINE_MAX bytes for the last records
+		if (f.use_flash && !f.failed) {
+			Write_Slot* w = &f.writes[f.current];
+			w->len += flashFinish(&f.flash, w->data + w->len);
+		}
+		submitWrite(&f);
+	}
+
+	// every request has to finish before its buffer is freed
+	while (io->inflight > 0) {
+		waitRequest(&f);
+	}
+
+	stats->bytes_in += f.in_size;
+	stats->bytes_out += f.out_offset;
+	stats->lines += f.lines;
+	stats->time += getTime() - start;
+
+	for (int i = 0; i < BATCH_READS; i++) {
+		free(f.reads[i].data);
+	}
+	for (int i = 0; i < BATCH_WRITES; i++) {
+		free(f.writes[i].data);
+	}
+	free(f.carry);
+	close(f.in_fd);
+	if (close(f.out_fd) != 0) {
+		perror(out_path);
+		f.failed = 1;
+	}
+
+	return f.failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --batch mode, translates a file with asynchronous reads and writes then reports throughput
+	Params: int argc - number of arguments after the mode
+			char** argv - [-f ihex|srec|raw] [-EB|-EL] [-a addr] <in> <out>
+	Return: int - exit code
+*/
+int batchMain(int argc, char** argv) {
+	// with -f the words are written as a flash image from -a, big endian unless -EL
+	Flash_Format format = FLASH_RAW;
+	int use_flash = 0;
+	int big = 1;
+	uint32_t base = TEXT_BASE;
+	while (argc > 0 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-EB") == 0 || strcmp(argv[0], "-EL") == 0) {
+			big = (strcmp(argv[0], "-EB") == 0);
+			argc--;
+			argv++;
+			continue;
+		}
+		if (argc < 2) {
+			break;
+		}
+		if (strcmp(argv[0], "-f") == 0) {
+			if (flashFormatByName(argv[1], &format) != 0) {
+				printf("ERROR: Unknown format %s\n", argv[1]);
+				return 1;
+			}
+			use_flash = 1;
+		}
+		else if (strcmp(argv[0], "-a") == 0) {
+			base = (uint32_t)strtoul(argv[1], NULL, 0);
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 1;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2) {
+		error("--batch needs an input and an output file");
+		return 1;
+	}
+
+	Flash_Encoder flash;
+	flashEncoderInit(&flash, format, base, big);
+
+	Async_IO io;
+	aioInit(&io, BATCH_READS + BATCH_WRITES);
+
+	Batch_Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	int failed = translateFile(argv[0], argv[1], use_flash ? &flash : NULL, &io, &stats);
+
+	// the pread/pwrite backend finishes each request as it goes in, so it has no queue to measure
+	if (io.use_uring) {
+		printf("Backend: %s\tQueue depth: avg %.2f, max %u of %u\n", aioBackend(&io),
+			io.submits ? (double)io.depth_sum / io.submits : 0.0, io.depth_max, io.depth);
+	}
+	else {
+		printf("Backend: %s\tQueue depth: n/a\n", aioBackend(&io));
+	}
+	printf("Lines: %llu\tIn: %llu bytes\tOut: %llu bytes\tTime: %.6f s\n", (unsigned long long)stats.lines,
+		(unsigned long long)stats.bytes_in, (unsigned long long)stats.bytes_out, stats.time);
+	printf("Read: %.1f MB/s\tWrite: %.1f MB/s\n", stats.time > 0 ? stats.bytes_in / stats.time / 1e6 : 0.0,
+		stats.time > 0 ? stats.bytes_out / stats.time / 1e6 : 0.0);
+
+	aioFree(&io);
+	return failed;
+}
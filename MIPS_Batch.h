@@ -0,0 +1,69 @@
+#ifndef _MIPS_BATCH_H_
+#define _MIPS_BATCH_H_
+
+#include <stdint.h>
+#include "MIPS_Async.h"
+#include "MIPS_Flash.h"
+
+/*
+	File to file translation with the --pipe rules, driven by asynchronous
+	I/O. Several large reads stay in flight ahead of the block being
+	translated, and every full output block is written asynchronously
+	while translation carries on into the next one.
+
+	With -f the assembled words go out as an Intel HEX, S-record or raw
+	image instead, through the same write blocks.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// bytes per read and per write
+#define BATCH_BLOCK_SIZE (1u << 20)
+
+// reads kept in flight ahead of translation
+#define BATCH_READS 4
+
+// output blocks, one being filled and the rest being written
+#define BATCH_WRITES 4
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what a translation moved and how long it took
+typedef struct {
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t lines;
+	double time;
+} Batch_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: translates one file into another, one output line per input line or one flash image for the file
+	Params: const char* in_path - the file to translate
+			const char* out_path - the file to write, replaced if it exists
+			const Flash_Encoder* flash - a started encoder to write a flash image with, NULL for text
+			Async_IO* io - the queue to use, idle on entry and on return
+			Batch_Stats* stats - added to with what this file moved
+	Return: int - 0 for no error
+*/
+int translateFile(const char* in_path, const char* out_path, const Flash_Encoder* flash, Async_IO* io,
+	Batch_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --batch mode, translates a file with asynchronous reads and writes then reports throughput
+	Params: int argc - number of arguments after the mode
+			char** argv - [-f ihex|srec|raw] [-EB|-EL] [-a addr] <in> <out>
+	Return: int - exit code
+*/
+int batchMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,546 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Cache.h"
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		   Reading
+\----------------------------*/
+/*
+	Purpose: checks a mapped cache file, so every entry it holds can be read without further checks
+	Params: const uint8_t* map - the mapping
+			size_t size - its size
+	Return: int - 1 if the file can be used
+*/
+static int cacheValid(const uint8_t* map, size_t size) {
+	const Cache_Header* h = (const Cache_Header*)map;
+	if (size < sizeof(Cache_Header) || memcmp(h->magic, CACHE_MAGIC, 4) != 0 || h->version != CACHE_VERSION ||
+		h->file_size != size || h->table_offset < sizeof(Cache_Header) || h->table_offset > size ||
+		(h->table_offset & 7) != 0 || h->live_bytes > h->table_offset - sizeof(Cache_Header) ||
+		h->entry_count > (size - h->table_offset) / sizeof(Cache_Entry)) {
+		return 0;
+	}
+
+	const Cache_Entry* entries = (const Cache_Entry*)(map + h->table_offset);
+	for (uint64_t e = 0; e < h->entry_count; e++) {
+		const Cache_Entry* entry = &entries[e];
+		if (entry->words_offset > h->table_offset || entry->word_bytes > h->table_offset - entry->words_offset ||
+			entry->text_offset > h->table_offset || entry->text_size > h->table_offset - entry->text_offset ||
+			(e > 0 && entries[e - 1].key >= entry->key)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+	Purpose: maps a cache file and opens it for the pages to add, a missing or broken one acts as empty
+	Params: Page_Cache* cache - the cache to fill
+			const char* path - the cache file
+	Return: int - 0 for no error
+*/
+int cacheOpen(Page_Cache* cache, const char* path) {
+	memset(cache, 0, sizeof(*cache));
+	cache->lock_fd = -1;
+
+	size_t len = strlen(path);
+	cache->path = malloc(len + 1);
+	cache->tmp_path = malloc(len + 6);
+	if (cache->path == NULL || cache->tmp_path == NULL) {
+		error("Out of memory");
+		cacheClose(cache, 0);
+		return 1;
+	}
+	memcpy(cache->path, path, len + 1);
+
+	// waits for any other run on the cache to finish before reading it
+	snprintf(cache->tmp_path, len + 6, "%s.lock", path);
+	cache->lock_fd = open(cache->tmp_path, O_RDWR | O_CREAT, 0644);
+	if (cache->lock_fd < 0) {
+		perror(cache->tmp_path);
+		cacheClose(cache, 0);
+		return 1;
+	}
+	while (flock(cache->lock_fd, LOCK_EX) != 0) {
+		if (errno != EINTR) {
+			perror(cache->tmp_path);
+			cacheClose(cache, 0);
+			return 1;
+		}
+	}
+	snprintf(cache->tmp_path, len + 6, "%s.tmp", path);
+
+	// whatever is wrong with the old cache, a fresh one is written over it
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+		void* map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED && cacheValid(map, (size_t)info.st_size)) {
+			const Cache_Header* h = map;
+			cache->map = map;
+			cache->size = (size_t)info.st_size;
+			cache->entries = (const Cache_Entry*)(cache->map + h->table_offset);
+			cache->entry_count = h->entry_count;
+		}
+		else if (map != MAP_FAILED) {
+			munmap(map, (size_t)info.st_size);
+		}
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	cache->used = calloc(cache->entry_count + 1, 1);
+	if (cache->used == NULL) {
+		error("Out of memory");
+		cacheClose(cache, 0);
+		return 1;
+	}
+
+	// pages are appended to the old file until more of it is dead than alive
+	const Cache_Header* h = (const Cache_Header*)cache->map;
+	cache->rewrite = (h == NULL || h->table_offset - sizeof(Cache_Header) - h->live_bytes > h->live_bytes);
+	if (cache->rewrite) {
+		Cache_Header header;
+		memset(&header, 0, sizeof(header));
+		cache->file = fopen(cache->tmp_path, "wb");
+		if (cache->file == NULL || fwrite(&header, sizeof(header), 1, cache->file) != 1) {
+			perror(cache->tmp_path);
+			cacheClose(cache, 0);
+			return 1;
+		}
+		cache->at = sizeof(header);
+	}
+	else {
+		cache->file = fopen(path, "r+b");
+		if (cache->file == NULL || fseek(cache->file, 0, SEEK_END) != 0) {
+			perror(path);
+			cacheClose(cache, 0);
+			return 1;
+		}
+		cache->at = cache->size;
+	}
+	return 0;
+}
+
+/*
+	Purpose: finds the entry of the old cache with a key
+	Params: const Page_Cache* cache - the cache
+			uint64_t key - the key
+	Return: uint64_t - the entry's index, entry_count if there is none
+*/
+static uint64_t findEntry(const Page_Cache* cache, uint64_t key) {
+	uint64_t low = 0;
+	uint64_t high = cache->entry_count;
+	while (low < high) {
+		uint64_t mid = low + (high - low) / 2;
+		if (cache->entries[mid].key < key) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return (low < cache->entry_count && cache->entries[low].key == key) ? low : cache->entry_count;
+}
+
+/*
+	Purpose: finds the text of a page, marking it used so it is kept
+	Params: Page_Cache* cache - the cache
+			uint64_t key - the page's key
+			const uint8_t* words - the page's words, as the image holds them
+			uint32_t word_bytes - the size of the words
+			uint32_t* text_size - filled with the size of the text
+	Return: const char* - the text, inside the mapping, NULL on a miss
+*/
+const char* cacheFind(Page_Cache* cache, uint64_t key, const uint8_t* words, uint32_t word_bytes,
+	uint32_t* text_size) {
+	uint64_t e = findEntry(cache, key);
+	if (e == cache->entry_count) {
+		return NULL;
+	}
+
+	// the key covers everything, the words are compared so a collision is a miss and not wrong text
+	const Cache_Entry* entry = &cache->entries[e];
+	if (entry->word_bytes != word_bytes || memcmp(cache->map + entry->words_offset, words, word_bytes) != 0) {
+		return NULL;
+	}
+	cache->used[e] = 1;
+	*text_size = entry->text_size;
+	return (const char*)cache->map + entry->text_offset;
+}
+
+
+/*----------------------------\
+		   Writing
+\----------------------------*/
+/*
+	Purpose: adds a page that missed
+	Params: Page_Cache* cache - the cache
+			uint64_t key - the page's key
+			const uint8_t* words - the page's words
+			uint32_t word_bytes - the size of the words
+			const char* text - the page's text
+			uint32_t text_size - the size of the text
+	Return: int - 0 for no error
+*/
+int cacheAdd(Page_Cache* cache, uint64_t key, const uint8_t* words, uint32_t word_bytes, const char* text,
+	uint32_t text_size) {
+	if (cache->failed) {
+		return 1;
+	}
+
+	if (cache->added_count == cache->added_size) {
+		uint64_t grown_size = cache->added_size ? cache->added_size * 2 : 1024;
+		Cache_Entry* grown = realloc(cache->added, grown_size * sizeof(Cache_Entry));
+		if (grown == NULL) {
+			error("Out of memory");
+			cache->failed = 1;
+			return 1;
+		}
+		cache->added = grown;
+		cache->added_size = grown_size;
+	}
+
+	Cache_Entry* entry = &cache->added[cache->added_count++];
+	entry->key = key;
+	entry->words_offset = cache->at;
+	entry->word_bytes = word_bytes;
+	entry->text_offset = cache->at + word_bytes;
+	entry->text_size = text_size;
+
+	if (fwrite(words, 1, word_bytes, cache->file) != word_bytes ||
+		fwrite(text, 1, text_size, cache->file) != text_size) {
+		perror(cache->rewrite ? cache->tmp_path : cache->path);
+		cache->failed = 1;
+		return 1;
+	}
+	cache->at += (uint64_t)word_bytes + text_size;
+	return 0;
+}
+
+/*
+	Purpose: orders entries by key
+	Params: const void* a - the first entry
+			const void* b - the second entry
+	Return: int - <0, 0 or >0 as a is before, at or after b
+*/
+static int compareEntries(const void* a, const void* b) {
+	uint64_t x = ((const Cache_Entry*)a)->key;
+	uint64_t y = ((const Cache_Entry*)b)->key;
+	return (x > y) - (x < y);
+}
+
+/*
+	Purpose: writes the table of the pages kept, the old ones used and the ones added, then the header
+	Params: Page_Cache* cache - the cache, with the added entries sorted and unique
+	Return: int - 0 for no error
+*/
+static int writeTable(Page_Cache* cache) {
+	uint64_t used_count = 0;
+	for (uint64_t e = 0; e < cache->entry_count; e++) {
+		used_count += cache->used[e];
+	}
+	Cache_Entry* table = malloc((used_count + cache->added_count + 1) * sizeof(Cache_Entry));
+	if (table == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+
+	// both runs are sorted by key, so they merge into a sorted table
+	uint64_t count = 0;
+	uint64_t live = 0;
+	uint64_t a = 0;
+	int failed = 0;
+	for (uint64_t e = 0; e <= cache->entry_count && !failed; e++) {
+		while (a < cache->added_count && (e == cache->entry_count || cache->added[a].key < cache->entries[e].key)) {
+			table[count++] = cache->added[a++];
+		}
+		if (e == cache->entry_count || !cache->used[e]) {
+			continue;
+		}
+
+		// a fresh file gets a copy of every old page used, the old file already holds them
+		table[count] = cache->entries[e];
+		if (cache->rewrite) {
+			const Cache_Entry* old = &cache->entries[e];
+			table[count].words_offset = cache->at;
+			table[count].text_offset = cache->at + old->word_bytes;
+			failed |= (fwrite(cache->map + old->words_offset, 1, old->word_bytes, cache->file) != old->word_bytes);
+			failed |= (fwrite(cache->map + old->text_offset, 1, old->text_size, cache->file) != old->text_size);
+			cache->at += (uint64_t)old->word_bytes + old->text_size;
+		}
+		count++;
+	}
+	for (uint64_t e = 0; e < count; e++) {
+		live += (uint64_t)table[e].word_bytes + table[e].text_size;
+	}
+
+	static const uint8_t pad[8] = { 0 };
+	uint32_t pad_size = (uint32_t)((8 - (cache->at & 7)) & 7);
+	Cache_Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.entry_count = count;
+	header.table_offset = cache->at + pad_size;
+	header.live_bytes = live;
+	header.file_size = header.table_offset + count * sizeof(Cache_Entry);
+
+	// the header goes last, until it does the file still reads as the old cache
+	failed |= (fwrite(pad, 1, pad_size, cache->file) != pad_size);
+	failed |= (fwrite(table, sizeof(Cache_Entry), count, cache->file) != count);
+	failed |= (fflush(cache->file) != 0);
+	failed |= (fseek(cache->file, 0, SEEK_SET) != 0);
+	failed |= (fwrite(&header, sizeof(header), 1, cache->file) != 1);
+	free(table);
+	return failed;
+}
+
+/*
+	Purpose: writes the table of the pages used and added, or leaves the cache as it was
+	Params: Page_Cache* cache - the cache
+			int keep - 1 to keep the pages of this run
+	Return: int - 0 for no error
+*/
+int cacheClose(Page_Cache* cache, int keep) {
+	int failed = cache->failed;
+	keep &= !failed && cache->file != NULL;
+
+	if (keep) {
+		// an added page with the key of an old one replaces it, which only a collision can cause
+		qsort(cache->added, cache->added_count, sizeof(Cache_Entry), compareEntries);
+		uint64_t kept = 0;
+		for (uint64_t a = 0; a < cache->added_count; a++) {
+			if (kept == 0 || cache->added[kept - 1].key != cache->added[a].key) {
+				cache->added[kept++] = cache->added[a];
+			}
+			uint64_t e = findEntry(cache, cache->added[a].key);
+			if (e < cache->entry_count) {
+				cache->used[e] = 0;
+			}
+		}
+		cache->added_count = kept;
+
+		// with nothing added and every old page used, the table would come out the same
+		uint64_t used_count = 0;
+		for (uint64_t e = 0; e < cache->entry_count; e++) {
+			used_count += cache->used[e];
+		}
+		if (cache->rewrite || kept > 0 || used_count < cache->entry_count) {
+			failed |= writeTable(cache);
+		}
+	}
+	if (cache->file != NULL) {
+		failed |= (fclose(cache->file) != 0);
+	}
+	const char* written = cache->rewrite ? cache->tmp_path : cache->path;
+	if (keep && failed && written != NULL) {
+		perror(written);
+	}
+
+	// a fresh file replaces the old one, pages appended to the old one are cut off again if anything failed
+	if (cache->rewrite && cache->tmp_path != NULL) {
+		if (keep && !failed && rename(cache->tmp_path, cache->path) != 0) {
+			perror(cache->path);
+			failed = 1;
+		}
+		if (!keep || failed) {
+			remove(cache->tmp_path);
+		}
+	}
+	else if (cache->file != NULL && (!keep || failed)) {
+		failed |= (truncate(cache->path, (off_t)cache->size) != 0);
+	}
+
+	if (cache->map != NULL) {
+		munmap((void*)cache->map, cache->size);
+	}
+
+	// the next run may go once the file is complete
+	if (cache->lock_fd >= 0) {
+		close(cache->lock_fd);
+	}
+	free(cache->used);
+	free(cache->added);
+	free(cache->path);
+	free(cache->tmp_path);
+	memset(cache, 0, sizeof(*cache));
+	return keep ? failed : 0;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: makes a program of random instructions, mostly ones that decode
+	Params: uint8_t* text - filled with the words, big endian
+			uint32_t count - the number of words
+			uint64_t* state - the random state
+	Return: none
+*/
+static void benchProgram(uint8_t* text, uint32_t count, uint64_t* state) {
+	for (uint32_t i = 0; i < count; i++) {
+		*state ^= *state << 13;
+		*state ^= *state >> 7;
+		*state ^= *state << 17;
+
+		// a random op with random fields, the encoding of a decoded word keeps it decodable
+		Decoded_Instruct d = { (uint8_t)(1 + (*state >> 40) % (OP_COUNT - 1)), (uint8_t)((*state >> 8) & 31),
+			(uint8_t)((*state >> 16) & 31), (uint8_t)((*state >> 24) & 31), (uint16_t)(*state >> 48) };
+		uint32_t word = encodeWord(&d);
+		text[(size_t)i * 4] = (uint8_t)(word >> 24);
+		text[(size_t)i * 4 + 1] = (uint8_t)(word >> 16);
+		text[(size_t)i * 4 + 2] = (uint8_t)(word >> 8);
+		text[(size_t)i * 4 + 3] = (uint8_t)word;
+	}
+}
+
+/*
+	Purpose: checks two files hold the same bytes
+	Params: FILE* a - the first file
+			FILE* b - the second file
+	Return: int - 1 if they do
+*/
+static int sameFiles(FILE* a, FILE* b) {
+	static char chunk_a[1 << 16];
+	static char chunk_b[1 << 16];
+	rewind(a);
+	rewind(b);
+
+	while (1) {
+		size_t got_a = fread(chunk_a, 1, sizeof(chunk_a), a);
+		size_t got_b = fread(chunk_b, 1, sizeof(chunk_b), b);
+		if (got_a != got_b || memcmp(chunk_a, chunk_b, got_a) != 0) {
+			return 0;
+		}
+		if (got_a == 0) {
+			return 1;
+		}
+	}
+}
+
+/*
+	Purpose: disassembles an image into a fresh temporary file and prints a row of the table
+	Params: Elf_Image* image - the image
+			const char* cache_path - the cache, NULL for none
+			const char* name - the row's name
+			double base_time - the time of the run without a cache, 0 for this to be it
+			FILE** out - filled with the file holding the text, to close
+	Return: double - the time taken, below 0 on error
+*/
+static double benchRun(Elf_Image* image, const char* cache_path, const char* name, double base_time, FILE** out) {
+	*out = tmpfile();
+	if (*out == NULL) {
+		perror("tmpfile");
+		return -1;
+	}
+
+	Disasm_Stats stats;
+	if (imageDisasm(image, *out, 0, cache_path, &stats) != 0) {
+		fclose(*out);
+		*out = NULL;
+		return -1;
+	}
+
+	double speedup = (base_time > 0 && stats.time > 0) ? base_time / stats.time : 1.0;
+	printf("%-16s %8u %8u %7.1f%% %10.1f %12.6f %8.1fx\n", name, stats.pages, stats.hits,
+		stats.pages > 0 ? 100.0 * stats.hits / stats.pages : 0.0, stats.bytes_out / 1e6, stats.time, speedup);
+	return stats.time;
+}
+
+/*
+	Purpose: --bench-cache mode, times disassembly with no cache, a cold cache and a cache from an image a few pages away
+	Params: int argc - number of arguments after the mode
+			char** argv - <cache> [words [changed pages per 1000]]
+	Return: int - exit code
+*/
+int benchCacheMain(int argc, char** argv) {
+	if (argc < 1) {
+		error("--bench-cache needs a cache file");
+		return 1;
+	}
+	const char* cache_path = argv[0];
+	uint32_t count = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : CACHE_BENCH_WORDS;
+	uint32_t changed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : CACHE_BENCH_CHANGED;
+	if (count == 0 || count > (1u << 28) || changed > 1000) {
+		error("--bench-cache needs 1 to 268435456 words and 0 to 1000 changed pages per 1000");
+		return 1;
+	}
+
+	uint8_t* text = malloc((size_t)count * 4);
+	if (text == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	uint64_t state = 0x2545F4914F6CDD1Dull;
+	benchProgram(text, count, &state);
+
+	// the image is the words alone, as a raw file opens
+	Elf_Image image;
+	memset(&image, 0, sizeof(image));
+	image.big = 1;
+	image.text = text;
+	image.text_addr = TEXT_BASE;
+	image.text_size = count * 4;
+
+	remove(cache_path);
+	printf("%-16s %8s %8s %8s %10s %12s %9s\n", "Run", "Pages", "Hits", "Rate", "Out (MB)", "Time (s)", "Speedup");
+	FILE* plain = NULL;
+	FILE* cold = NULL;
+	FILE* warm = NULL;
+	FILE* same = NULL;
+	double base = benchRun(&image, NULL, "no cache", 0, &plain);
+	int failed = (base < 0 || benchRun(&image, cache_path, "cold cache", base, &cold) < 0);
+
+	// the next build, with one word changed in the given share of pages
+	uint32_t pages = (count + CACHE_PAGE_WORDS - 1) / CACHE_PAGE_WORDS;
+	uint32_t to_change = (uint32_t)((uint64_t)pages * changed / 1000);
+	for (uint32_t n = 0; n < to_change; n++) {
+		uint32_t page = (uint32_t)(((uint64_t)n * pages) / to_change);
+		uint32_t i = page * CACHE_PAGE_WORDS + (n * 37) % CACHE_PAGE_WORDS;
+		if (i < count) {
+			text[(size_t)i * 4 + 3] ^= 0x01;
+		}
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "%.1f%% changed", changed / 10.0);
+	if (!failed) {
+		fclose(plain);
+		plain = NULL;
+		base = benchRun(&image, NULL, "no cache", 0, &plain);
+		failed = (base < 0 || benchRun(&image, cache_path, name, base, &warm) < 0 ||
+			benchRun(&image, cache_path, "unchanged", base, &same) < 0);
+	}
+
+	// the cached text has to be exactly what disassembling from scratch makes
+	if (!failed && (!sameFiles(plain, warm) || !sameFiles(plain, same))) {
+		error("Text from the cache does not match disassembly from scratch");
+		failed = 1;
+	}
+	if (!failed) {
+		struct stat info;
+		if (stat(cache_path, &info) == 0) {
+			printf("\nCache: %.1f MB for %.1f MB of .text\n", info.st_size / 1e6, image.text_size / 1e6);
+		}
+	}
+
+	FILE* files[4] = { plain, cold, warm, same };
+	for (int f = 0; f < 4; f++) {
+		if (files[f] != NULL) {
+			fclose(files[f]);
+		}
+	}
+	free(text);
+	return failed;
+}
@@ -0,0 +1,148 @@
+#ifndef _MIPS_CACHE_H_
+#define _MIPS_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+	An on-disk cache of disassembly text, one entry per 4 KB page of .text.
+	Each entry is found by a 64 bit key, the xxHash64 of the page's words
+	chained with everything else its text depends on: the address, byte
+	order, the symbols in effect over the page and, with -l, the loop depth
+	of every word. The words themselves are kept too and compared before an
+	entry is used, so a key collision can only cost a miss.
+
+	The file is a header, the words and text of each page, then a table of
+	entries sorted by key. It is mapped, a hit copies the text straight
+	from the mapping, and only the pages that missed are written, appended
+	after the old table with a new table after them. Entries the image did
+	not use are dropped from the table. Once the bytes no table entry
+	points at outweigh the rest, the next run writes a fresh file with only
+	the pages it used and renames it over the old one. Keys depend on the
+	host byte order.
+
+	A run holds an exclusive flock on <cache>.lock from open to close, so
+	runs sharing a cache take turns and each one maps what the last left.
+	The lock file is never replaced, unlike the cache itself.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// the first bytes of a cache file
+#define CACHE_MAGIC "MDC1"
+
+// bumped whenever the layout or the disassembly text changes
+#define CACHE_VERSION 1
+
+// words per page, 4 KB
+#define CACHE_PAGE_WORDS 1024
+
+// words --bench-cache disassembles by default
+#define CACHE_BENCH_WORDS (1u << 20)
+
+// pages in a thousand --bench-cache changes by default
+#define CACHE_BENCH_CHANGED 10
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// the start of a cache file
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint64_t entry_count;
+	uint64_t table_offset;
+	uint64_t live_bytes;
+	uint64_t file_size;
+} Cache_Header;
+
+// one page, offsets are from the start of the file
+typedef struct {
+	uint64_t key;
+	uint64_t words_offset;
+	uint64_t text_offset;
+	uint32_t word_bytes;
+	uint32_t text_size;
+} Cache_Entry;
+
+// a mapped cache and the pages a run used and added
+typedef struct {
+	const uint8_t* map;
+	size_t size;
+	const Cache_Entry* entries;
+	uint64_t entry_count;
+	uint8_t* used;
+
+	// rewrite is set when the new pages go to a fresh file at tmp_path instead of after the old table
+	char* path;
+	char* tmp_path;
+	int lock_fd;
+	int rewrite;
+	FILE* file;
+	uint64_t at;
+	Cache_Entry* added;
+	uint64_t added_count;
+	uint64_t added_size;
+	int failed;
+} Page_Cache;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: maps a cache file and opens it for the pages to add, a missing or broken one acts as empty
+	Params: Page_Cache* cache - the cache to fill
+			const char* path - the cache file
+	Return: int - 0 for no error
+*/
+int cacheOpen(Page_Cache* cache, const char* path);
+
+/*
+	Purpose: finds the text of a page, marking it used so it is kept
+	Params: Page_Cache* cache - the cache
+			uint64_t key - the page's key
+			const uint8_t* words - the page's words, as the image holds them
+			uint32_t word_bytes - the size of the words
+			uint32_t* text_size - filled with the size of the text
+	Return: const char* - the text, inside the mapping, NULL on a miss
+*/
+const char* cacheFind(Page_Cache* cache, uint64_t key, const uint8_t* words, uint32_t word_bytes,
+	uint32_t* text_size);
+
+/*
+	Purpose: adds a page that missed
+	Params: Page_Cache* cache - the cache
+			uint64_t key - the page's key
+			const uint8_t* words - the page's words
+			uint32_t word_bytes - the size of the words
+			const char* text - the page's text
+			uint32_t text_size - the size of the text
+	Return: int - 0 for no error
+*/
+int cacheAdd(Page_Cache* cache, uint64_t key, const uint8_t* words, uint32_t word_bytes, const char* text,
+	uint32_t text_size);
+
+/*
+	Purpose: writes the table of the pages used and added, or leaves the cache as it was
+	Params: Page_Cache* cache - the cache
+			int keep - 1 to keep the pages of this run
+	Return: int - 0 for no error
+*/
+int cacheClose(Page_Cache* cache, int keep);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --bench-cache mode, times disassembly with no cache, a cold cache and a cache from an image a few pages away
+	Params: int argc - number of arguments after the mode
+			char** argv - <cache> [words [changed pages per 1000]]
+	Return: int - exit code
+*/
+int benchCacheMain(int argc, char** argv);
+
+#endif
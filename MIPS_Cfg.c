@@ -0,0 +1,494 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Image.h"
+#include "MIPS_Util.h"
+
+// bytes of block listing collected before each write
+#define CFG_OUT_SIZE (1u << 20)
+
+// longest line of the block listing
+#define CFG_LINE_MAX 96
+
+// one chunk of words and what the phases found in it
+typedef struct {
+	uint32_t begin;
+	uint32_t end;
+
+	// leaders that fall in another chunk, marked by the merge
+	uint32_t* far;
+	uint32_t far_count;
+	uint32_t far_size;
+
+	uint32_t branches;
+	uint32_t exits;
+	uint32_t leaders;
+	uint32_t first_block;
+	uint32_t edges;
+	uint32_t first_edge;
+	int failed;
+} Cfg_Chunk;
+
+// a build in progress, shared by its threads
+typedef struct Cfg_Build {
+	Cfg* cfg;
+	Cfg_Chunk* chunks;
+	uint32_t chunk_count;
+	int threads;
+
+	// the phase the workers run
+	void (*job)(struct Cfg_Build*, Cfg_Chunk*);
+} Cfg_Build;
+
+/*----------------------------\
+		   Threads
+\----------------------------*/
+/*
+	Purpose: runs the current phase on one chunk
+	Params: void* ctx - the Cfg_Build
+			int worker - unused, each chunk keeps its own results
+			uint32_t index - the chunk
+	Return: none
+*/
+static void cfgChunk(void* ctx, int worker, uint32_t index) {
+	Cfg_Build* b = ctx;
+	(void)worker;
+	b->job(b, &b->chunks[index]);
+}
+
+/*
+	Purpose: runs one phase over every chunk, the calling thread is one of the workers
+	Params: Cfg_Build* b - the build
+			void (*job)(Cfg_Build*, Cfg_Chunk*) - the work for one chunk
+	Return: double - the time the phase took
+*/
+static double runPhase(Cfg_Build* b, void (*job)(Cfg_Build*, Cfg_Chunk*)) {
+	double start = getTime();
+
+	b->job = job;
+	runChunks(b->chunk_count, b->threads, cfgChunk, b);
+	return getTime() - start;
+}
+
+
+/*----------------------------\
+		   Leaders
+\----------------------------*/
+/*
+	Purpose: counts the leaders before a word
+	Params: const Cfg* cfg - the graph, ranks filled
+			uint32_t index - the word's index
+	Return: uint32_t - the number of leaders before it, the block number when it is a leader
+*/
+static inline uint32_t leaderRank(const Cfg* cfg, uint32_t index) {
+	uint64_t below = cfg->leaders[index >> 6] & ((1ull << (index & 63)) - 1);
+	return cfg->ranks[index >> 6] + (uint32_t)__builtin_popcountll(below);
+}
+
+/*
+	Purpose: marks a leader, in the bitmap when the chunk owns the word and in the far list otherwise
+	Params: Cfg* cfg - the graph
+			Cfg_Chunk* c - the chunk that found it
+			uint32_t index - the leader's index
+	Return: none
+*/
+static inline void markLeader(Cfg* cfg, Cfg_Chunk* c, uint32_t index) {
+	if (index >= c->begin && index < c->end) {
+		cfg->leaders[index >> 6] |= 1ull << (index & 63);
+		return;
+	}
+
+	if (c->far_count == c->far_size) {
+		uint32_t size = (c->far_size == 0) ? 256 : c->far_size * 2;
+		uint32_t* grown = realloc(c->far, size * sizeof(uint32_t));
+		if (grown == NULL) {
+			c->failed = 1;
+			return;
+		}
+		c->far = grown;
+		c->far_size = size;
+	}
+	c->far[c->far_count++] = index;
+}
+
+/*
+	Purpose: gets the branch target of a word, if it is a branch
+	Params: uint32_t word - the word
+			uint32_t index - its index
+			int64_t* target - filled with the target's index, which may be outside the image
+	Return: Op_Type - OP_BEQ or OP_BNE for a branch, OP_INVALID for anything else
+*/
+static inline Op_Type branchTarget(uint32_t word, uint32_t index, int64_t* target) {
+	// both branches are told by their opcode alone, the table confirms it
+	uint32_t opcode = WORD_OPCODE(word);
+	if (opcode != 0x04 && opcode != 0x05) {
+		return OP_INVALID;
+	}
+	Op_Type op = wordOp(word);
+	if (op != OP_BEQ && op != OP_BNE) {
+		return OP_INVALID;
+	}
+
+	*target = (int64_t)index + 1 + (int16_t)WORD_IMM(word);
+	return op;
+}
+
+/*
+	Purpose: mark phase, marks the targets of a chunk's branches and the words after them
+	Params: Cfg_Build* b - the build
+			Cfg_Chunk* c - the chunk
+	Return: none
+*/
+static void markChunk(Cfg_Build* b, Cfg_Chunk* c) {
+	Cfg* cfg = b->cfg;
+	const uint32_t* words = cfg->words;
+
+	for (uint32_t i = c->begin; i < c->end; i++) {
+		int64_t target;
+		if (branchTarget(words[i], i, &target) == OP_INVALID) {
+			continue;
+		}
+
+		c->branches++;
+		if (i + 1 < cfg->word_count) {
+			markLeader(cfg, c, i + 1);
+		}
+		if (target >= 0 && target < cfg->word_count) {
+			markLeader(cfg, c, (uint32_t)target);
+		}
+		else {
+			c->exits++;
+		}
+	}
+}
+
+/*
+	Purpose: count phase, counts the leaders of each group of 64 words into ranks
+	Params: Cfg_Build* b - the build
+			Cfg_Chunk* c - the chunk
+	Return: none
+*/
+static void countChunk(Cfg_Build* b, Cfg_Chunk* c) {
+	Cfg* cfg = b->cfg;
+	uint32_t total = 0;
+
+	for (uint32_t g = c->begin >> 6; g < (c->end + 63) >> 6; g++) {
+		cfg->ranks[g] = (uint32_t)__builtin_popcountll(cfg->leaders[g]);
+		total += cfg->ranks[g];
+	}
+	c->leaders = total;
+}
+
+/*
+	Purpose: blocks phase, turns the counts into ranks and writes where each block starts
+	Params: Cfg_Build* b - the build
+			Cfg_Chunk* c - the chunk, first_block set
+	Return: none
+*/
+static void blockChunk(Cfg_Build* b, Cfg_Chunk* c) {
+	Cfg* cfg = b->cfg;
+	uint32_t block = c->first_block;
+
+	for (uint32_t g = c->begin >> 6; g < (c->end + 63) >> 6; g++) {
+		cfg->ranks[g] = block;
+		for (uint64_t bits = cfg->leaders[g]; bits != 0; bits &= bits - 1) {
+			cfg->block_start[block++] = (g << 6) + (uint32_t)__builtin_ctzll(bits);
+		}
+	}
+}
+
+
+/*----------------------------\
+		   Edges
+\----------------------------*/
+/*
+	Purpose: finds the first words of a block's successors, BEQ of a register with itself always branches and BNE never does
+	Params: const Cfg* cfg - the graph, blocks written
+			uint32_t block - the block
+			uint32_t* out - 2 entries to fill with word indexes
+	Return: uint32_t - the number of successors
+*/
+static uint32_t successors(const Cfg* cfg, uint32_t block, uint32_t* out) {
+	uint32_t last = cfg->block_start[block + 1] - 1;
+	uint32_t word = cfg->words[last];
+	int has_next = (last + 1 < cfg->word_count);
+	uint32_t n = 0;
+
+	int64_t target;
+	Op_Type op = branchTarget(word, last, &target);
+	if (op == OP_INVALID) {
+		if (has_next) {
+			out[n++] = last + 1;
+		}
+		return n;
+	}
+
+	int same = (WORD_RS(word) == WORD_RT(word));
+	if (!(op == OP_BNE && same) && target >= 0 && target < cfg->word_count) {
+		out[n++] = (uint32_t)target;
+	}
+	if (!(op == OP_BEQ && same) && has_next && !(n == 1 && out[0] == last + 1)) {
+		out[n++] = last + 1;
+	}
+	return n;
+}
+
+/*
+	Purpose: edge count phase, counts the successors of the blocks that start in a chunk
+	Params: Cfg_Build* b - the build
+			Cfg_Chunk* c - the chunk
+	Return: none
+*/
+static void countEdgesChunk(Cfg_Build* b, Cfg_Chunk* c) {
+	uint32_t out[2];
+	uint32_t total = 0;
+
+	for (uint32_t block = c->first_block; block < c->first_block + c->leaders; block++) {
+		total += successors(b->cfg, block, out);
+	}
+	c->edges = total;
+}
+
+/*
+	Purpose: edge phase, writes the CSR rows of the blocks that start in a chunk
+	Params: Cfg_Build* b - the build
+			Cfg_Chunk* c - the chunk, first_edge set
+	Return: none
+*/
+static void edgeChunk(Cfg_Build* b, Cfg_Chunk* c) {
+	Cfg* cfg = b->cfg;
+	uint32_t edge = c->first_edge;
+
+	// the word after a block is always the next block, only branch targets need their rank
+	for (uint32_t block = c->first_block; block < c->first_block + c->leaders; block++) {
+		uint32_t out[2];
+		uint32_t n = successors(cfg, block, out);
+		uint32_t next = cfg->block_start[block + 1];
+
+		cfg->edge_start[block] = edge;
+		for (uint32_t i = 0; i < n; i++) {
+			cfg->edges[edge++] = (out[i] == next) ? block + 1 : leaderRank(cfg, out[i]);
+		}
+	}
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: builds the control flow graph of a run of words
+	Params: Cfg* cfg - the graph to fill
+			const uint32_t* words - host order words, kept by the graph
+			uint32_t count - how many
+			uint32_t base - address of the first word
+			int threads - the number of threads, 0 for one per core
+			Cfg_Stats* stats - filled with the phase times and counts
+	Return: int - 0 for no error
+*/
+int cfgBuild(Cfg* cfg, const uint32_t* words, uint32_t count, uint32_t base, int threads, Cfg_Stats* stats) {
+	memset(cfg, 0, sizeof(*cfg));
+	memset(stats, 0, sizeof(*stats));
+	if (count == 0) {
+		error("No words to build a graph of");
+		return 1;
+	}
+
+	double start = getTime();
+	cfg->words = words;
+	cfg->base = base;
+	cfg->word_count = count;
+
+	Cfg_Build b;
+	memset(&b, 0, sizeof(b));
+	b.cfg = cfg;
+	b.chunk_count = (uint32_t)(((uint64_t)count + CFG_CHUNK_WORDS - 1) / CFG_CHUNK_WORDS);
+	b.threads = chunkThreads(b.chunk_count, threads);
+
+	uint32_t groups = (uint32_t)(((uint64_t)count + 63) / 64);
+	b.chunks = calloc(b.chunk_count, sizeof(Cfg_Chunk));
+	cfg->leaders = calloc(groups, sizeof(uint64_t));
+	cfg->ranks = malloc(groups * sizeof(uint32_t));
+	if (b.chunks == NULL || cfg->leaders == NULL || cfg->ranks == NULL) {
+		error("Out of memory");
+		free(b.chunks);
+		cfgFree(cfg);
+		return 1;
+	}
+	for (uint32_t i = 0; i < b.chunk_count; i++) {
+		b.chunks[i].begin = i * CFG_CHUNK_WORDS;
+		b.chunks[i].end = (count - b.chunks[i].begin < CFG_CHUNK_WORDS) ? count : b.chunks[i].begin + CFG_CHUNK_WORDS;
+	}
+
+	stats->mark_time = runPhase(&b, markChunk);
+
+	// the leaders found across chunk lines, marked by one thread so no bit is raced for
+	double phase = getTime();
+	int failed = 0;
+	cfg->leaders[0] |= 1;
+	for (uint32_t i = 0; i < b.chunk_count; i++) {
+		Cfg_Chunk* c = &b.chunks[i];
+		for (uint32_t j = 0; j < c->far_count; j++) {
+			cfg->leaders[c->far[j] >> 6] |= 1ull << (c->far[j] & 63);
+		}
+		failed |= c->failed;
+		stats->branches += c->branches;
+		stats->exits += c->exits;
+		free(c->far);
+		c->far = NULL;
+	}
+	stats->merge_time = getTime() - phase;
+
+	stats->count_time = runPhase(&b, countChunk);
+	for (uint32_t i = 0; i < b.chunk_count; i++) {
+		b.chunks[i].first_block = cfg->block_count;
+		cfg->block_count += b.chunks[i].leaders;
+	}
+
+	cfg->block_start = malloc(((size_t)cfg->block_count + 1) * sizeof(uint32_t));
+	cfg->edge_start = malloc(((size_t)cfg->block_count + 1) * sizeof(uint32_t));
+	if (failed || cfg->block_start == NULL || cfg->edge_start == NULL) {
+		error("Out of memory");
+		free(b.chunks);
+		cfgFree(cfg);
+		return 1;
+	}
+	stats->block_time = runPhase(&b, blockChunk);
+	cfg->block_start[cfg->block_count] = count;
+
+	phase = getTime();
+	runPhase(&b, countEdgesChunk);
+	for (uint32_t i = 0; i < b.chunk_count; i++) {
+		b.chunks[i].first_edge = cfg->edge_count;
+		cfg->edge_count += b.chunks[i].edges;
+	}
+	cfg->edges = malloc(((size_t)cfg->edge_count + 1) * sizeof(uint32_t));
+	if (cfg->edges == NULL) {
+		error("Out of memory");
+		free(b.chunks);
+		cfgFree(cfg);
+		return 1;
+	}
+	runPhase(&b, edgeChunk);
+	cfg->edge_start[cfg->block_count] = cfg->edge_count;
+	stats->edge_time = getTime() - phase;
+
+	free(b.chunks);
+	stats->time = getTime() - start;
+	return 0;
+}
+
+/*
+	Purpose: releases a graph
+	Params: Cfg* cfg - the graph
+	Return: none
+*/
+void cfgFree(Cfg* cfg) {
+	free(cfg->leaders);
+	free(cfg->ranks);
+	free(cfg->block_start);
+	free(cfg->edge_start);
+	free(cfg->edges);
+	memset(cfg, 0, sizeof(*cfg));
+}
+
+/*
+	Purpose: finds the block a word is in
+	Params: const Cfg* cfg - the graph
+			uint32_t index - the word's index
+	Return: uint32_t - the block number
+*/
+uint32_t cfgBlockOf(const Cfg* cfg, uint32_t index) {
+	// the leaders up to and including the word, less one
+	uint64_t upto = cfg->leaders[index >> 6] & (~0ull >> (63 - (index & 63)));
+	return cfg->ranks[index >> 6] + (uint32_t)__builtin_popcountll(upto) - 1;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --cfg mode, builds the graph of an image's .text, reports it and optionally lists the blocks
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int cfgMain(int argc, char** argv) {
+	int threads = 0;
+	int big = 1;
+	uint32_t raw_base = TEXT_BASE;
+
+	imageOptions(&argc, &argv, &raw_base, &big, &threads);
+	if (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 1;
+	}
+	if (argc < 1) {
+		error("--cfg needs an ELF, Intel HEX, S-record or raw file");
+		return 1;
+	}
+
+	Elf_Image image;
+	if (imageOpenAny(&image, argv[0], raw_base, big) != 0) {
+		return 1;
+	}
+
+	uint32_t count;
+	const uint32_t* words = imageText(&image, &count);
+	if (words == NULL) {
+		error("Out of memory");
+		imageClose(&image);
+		return 1;
+	}
+
+	Cfg cfg;
+	Cfg_Stats stats;
+	if (cfgBuild(&cfg, words, count, image.text_addr, threads, &stats) != 0) {
+		imageClose(&image);
+		return 1;
+	}
+
+	// the listing is one line per block with the addresses of its successors
+	int failed = 0;
+	if (argc > 1) {
+		FILE* out = (strcmp(argv[1], "-") == 0) ? stdout : fopen(argv[1], "w");
+		char* buffer = malloc(CFG_OUT_SIZE);
+		if (out == NULL || buffer == NULL) {
+			perror(argv[1]);
+			failed = 1;
+		}
+		else {
+			size_t used = 0;
+			for (uint32_t blk = 0; blk < cfg.block_count && !failed; blk++) {
+				if (CFG_OUT_SIZE - used < CFG_LINE_MAX) {
+					failed = (fwrite(buffer, 1, used, out) != used);
+					used = 0;
+				}
+				uint32_t first = cfg.base + cfg.block_start[blk] * 4;
+				uint32_t last = cfg.base + (cfg.block_start[blk + 1] - 1) * 4;
+				used += (size_t)sprintf(buffer + used, "%08X..%08X ->", first, last);
+				for (uint32_t e = cfg.edge_start[blk]; e < cfg.edge_start[blk + 1]; e++) {
+					used += (size_t)sprintf(buffer + used, " %08X", cfg.base + cfg.block_start[cfg.edges[e]] * 4);
+				}
+				buffer[used++] = '\n';
+			}
+			failed |= (fwrite(buffer, 1, used, out) != used);
+		}
+		if (out != NULL && out != stdout) {
+			failed |= (fclose(out) != 0);
+		}
+		free(buffer);
+	}
+
+	fprintf(stderr, "Words: %u\tBranches: %u\tBlocks: %u\tEdges: %u\tExits: %u\n", count, stats.branches,
+		cfg.block_count, cfg.edge_count, stats.exits);
+	fprintf(stderr, "Mark: %.6f s\tMerge: %.6f s\tCount: %.6f s\tBlocks: %.6f s\tEdges: %.6f s\n", stats.mark_time,
+		stats.merge_time, stats.count_time, stats.block_time, stats.edge_time);
+	fprintf(stderr, "Build: %.6f s\t%.1f M words/s\n", stats.time, stats.time > 0 ? count / stats.time / 1e6 : 0.0);
+
+	cfgFree(&cfg);
+	imageClose(&image);
+	return failed;
+}
@@ -0,0 +1,111 @@
+#ifndef _MIPS_CFG_H_
+#define _MIPS_CFG_H_
+
+#include <stdint.h>
+
+/*
+	Control flow graph of a flat run of instruction words. A block starts
+	at word 0, at every BEQ/BNE target inside the image and after every
+	branch. Leaders are marked in a bitmap, one bit per word, so a block's
+	number is the count of leaders before it.
+
+	The build runs over fixed chunks of words on a pool of threads:
+
+		mark     each chunk marks the leaders it finds in its own part of
+		         the bitmap and keeps the ones that fall outside it
+		merge    the kept leaders are marked, one thread
+		count    each chunk counts its leaders per 64 words, and a prefix
+		         sum turns the counts into block numbers
+		blocks   each chunk writes the start of its blocks
+		edges    each chunk counts, then after a prefix sum writes, the
+		         successors of its blocks
+
+	Blocks and edges are compact arrays in CSR form. The successors of
+	block b are edges[edge_start[b]] up to edges[edge_start[b + 1]].
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// words per chunk, a multiple of 64 so no two chunks share a bitmap word
+#define CFG_CHUNK_WORDS (1u << 18)
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what a build found and how long each phase took
+typedef struct {
+	double mark_time;
+	double merge_time;
+	double count_time;
+	double block_time;
+	double edge_time;
+	double time;
+	uint32_t branches;
+	uint32_t exits;
+} Cfg_Stats;
+
+// a built graph
+typedef struct {
+	const uint32_t* words;
+	uint32_t base;
+	uint32_t word_count;
+
+	// one bit per word, and the leaders before each group of 64 words
+	uint64_t* leaders;
+	uint32_t* ranks;
+
+	// block_count + 1 entries, the last is word_count
+	uint32_t block_count;
+	uint32_t* block_start;
+
+	// CSR successors
+	uint32_t edge_count;
+	uint32_t* edge_start;
+	uint32_t* edges;
+} Cfg;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: builds the control flow graph of a run of words
+	Params: Cfg* cfg - the graph to fill
+			const uint32_t* words - host order words, kept by the graph
+			uint32_t count - how many
+			uint32_t base - address of the first word
+			int threads - the number of threads, 0 for one per core
+			Cfg_Stats* stats - filled with the phase times and counts
+	Return: int - 0 for no error
+*/
+int cfgBuild(Cfg* cfg, const uint32_t* words, uint32_t count, uint32_t base, int threads, Cfg_Stats* stats);
+
+/*
+	Purpose: releases a graph
+	Params: Cfg* cfg - the graph
+	Return: none
+*/
+void cfgFree(Cfg* cfg);
+
+/*
+	Purpose: finds the block a word is in
+	Params: const Cfg* cfg - the graph
+			uint32_t index - the word's index
+	Return: uint32_t - the block number
+*/
+uint32_t cfgBlockOf(const Cfg* cfg, uint32_t index);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --cfg mode, builds the graph of an image's .text, reports it and optionally lists the blocks
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int cfgMain(int argc, char** argv);
+
+#endif
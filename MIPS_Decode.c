@@ -0,0 +1,330 @@
+#include "MIPS_Decode.h"
+
+/*----------------------------\
+		  Op Tables
+\----------------------------*/
+// primary opcode to op, opcode 0 is resolved through funct_table
+static const uint8_t opcode_table[64] = {
+	[0x08] = OP_ADDI,
+	[0x0C] = OP_ANDI,
+	[0x0D] = OP_ORI,
+	[0x0F] = OP_LUI,
+	[0x23] = OP_LW,
+	[0x04] = OP_BEQ,
+	[0x05] = OP_BNE,
+	[0x0A] = OP_SLTI,
+	[0x2B] = OP_SW
+};
+
+// funct field to op for opcode 0
+static const uint8_t funct_table[64] = {
+	[0x20] = OP_ADD,
+	[0x22] = OP_SUB,
+	[0x18] = OP_MULT,
+	[0x1A] = OP_DIV,
+	[0x10] = OP_MFHI,
+	[0x12] = OP_MFLO,
+	[0x24] = OP_AND,
+	[0x25] = OP_OR,
+	[0x2A] = OP_SLT
+};
+
+// opcode bits for each op, the funct bits for R-type ops
+static const uint8_t op_bits[OP_COUNT] = {
+	[OP_ADD] = 0x20,
+	[OP_ADDI] = 0x08,
+	[OP_AND] = 0x24,
+	[OP_ANDI] = 0x0C,
+	[OP_BEQ] = 0x04,
+	[OP_BNE] = 0x05,
+	[OP_DIV] = 0x1A,
+	[OP_LUI] = 0x0F,
+	[OP_LW] = 0x23,
+	[OP_MFHI] = 0x10,
+	[OP_MFLO] = 0x12,
+	[OP_MULT] = 0x18,
+	[OP_OR] = 0x25,
+	[OP_ORI] = 0x0D,
+	[OP_SLT] = 0x2A,
+	[OP_SLTI] = 0x0A,
+	[OP_SUB] = 0x22,
+	[OP_SW] = 0x2B
+};
+
+// bits of each op's word that no field reads, a well formed word has them clear
+static const uint32_t unused_bits[OP_COUNT] = {
+	[OP_ADD] = 0x000007C0,
+	[OP_AND] = 0x000007C0,
+	[OP_DIV] = 0x0000FFC0,
+	[OP_LUI] = 0x03E00000,
+	[OP_MFHI] = 0x03FF07C0,
+	[OP_MFLO] = 0x03FF07C0,
+	[OP_MULT] = 0x0000FFC0,
+	[OP_OR] = 0x000007C0,
+	[OP_SLT] = 0x000007C0,
+	[OP_SUB] = 0x000007C0
+};
+
+static const char* op_names[OP_COUNT] = {
+	"???", "ADD", "ADDI", "AND", "ANDI", "BEQ", "BNE", "DIV", "LUI", "LW",
+	"MFHI", "MFLO", "MULT", "OR", "ORI", "SLT", "SLTI", "SUB", "SW"
+};
+
+static const char* reg_names[32] = {
+	"$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+	"$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+	"$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+	"$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+};
+
+
+/*----------------------------\
+		   Decoding
+\----------------------------*/
+/*
+	Purpose: classifies a word through the opcode/funct tables without extracting operands
+	Params: uint32_t word - the instruction word
+	Return: Op_Type - the decoded op, OP_INVALID if the word is not recognized
+*/
+Op_Type wordOp(uint32_t word) {
+	uint32_t opcode = WORD_OPCODE(word);
+
+	// R-type instructions are picked out by their funct field
+	if (opcode == 0) {
+		return (Op_Type)funct_table[WORD_FUNCT(word)];
+	}
+
+	return (Op_Type)opcode_table[opcode];
+}
+
+/*
+	Purpose: decodes a word through the opcode/funct tables, accepts exactly what decode() accepts
+	Params: uint32_t word - the instruction word
+			Decoded_Instruct* out - the decoded fields to fill
+	Return: Op_Type - the decoded op, OP_INVALID if the word is not recognized
+*/
+Op_Type decodeWord(uint32_t word, Decoded_Instruct* out) {
+	Op_Type op = wordOp(word);
+
+	out->op = (uint8_t)op;
+	out->rs = (uint8_t)WORD_RS(word);
+	out->rt = (uint8_t)WORD_RT(word);
+	out->rd = (uint8_t)WORD_RD(word);
+	out->imm = (uint16_t)WORD_IMM(word);
+
+	return op;
+}
+
+/*
+	Purpose: gets the bits of an op's word that no field reads, decode() ignores them
+	Params: Op_Type op - the op
+	Return: uint32_t - the bits, the shamt of R-type ops and any register field the op does not have
+*/
+uint32_t opUnusedBits(Op_Type op) {
+	if ((unsigned)op >= OP_COUNT) {
+		return 0;
+	}
+	return unused_bits[op];
+}
+
+/*
+	Purpose: encodes a decoded instruction back into a word, unused fields are zero
+	Params: const Decoded_Instruct* d - the instruction to encode
+	Return: uint32_t - the instruction word
+*/
+uint32_t encodeWord(const Decoded_Instruct* d) {
+	uint32_t word = 0;
+
+	switch (d->op) {
+	// rd, rs, rt
+	case OP_ADD:
+	case OP_SUB:
+	case OP_AND:
+	case OP_OR:
+	case OP_SLT: {
+		word = ((uint32_t)d->rs << 21) | ((uint32_t)d->rt << 16) | ((uint32_t)d->rd << 11) | op_bits[d->op];
+		break;
+	}
+	// rs, rt only
+	case OP_MULT:
+	case OP_DIV: {
+		word = ((uint32_t)d->rs << 21) | ((uint32_t)d->rt << 16) | op_bits[d->op];
+		break;
+	}
+	// rd only
+	case OP_MFHI:
+	case OP_MFLO: {
+		word = ((uint32_t)d->rd << 11) | op_bits[d->op];
+		break;
+	}
+	// rt and immediate
+	case OP_LUI: {
+		word = ((uint32_t)op_bits[d->op] << 26) | ((uint32_t)d->rt << 16) | d->imm;
+		break;
+	}
+	// rs, rt and immediate
+	case OP_ADDI:
+	case OP_ANDI:
+	case OP_ORI:
+	case OP_SLTI:
+	case OP_BEQ:
+	case OP_BNE:
+	case OP_LW:
+	case OP_SW: {
+		word = ((uint32_t)op_bits[d->op] << 26) | ((uint32_t)d->rs << 21) | ((uint32_t)d->rt << 16) | d->imm;
+		break;
+	}
+	default: {
+		break;
+	}
+	}
+
+	return word;
+}
+
+
+/*----------------------------\
+		   Names
+\----------------------------*/
+/*
+	Purpose: gets the mnemonic for an op
+	Params: Op_Type op - the op to name
+	Return: const char* - the mnemonic, "???" for OP_INVALID
+*/
+const char* opName(Op_Type op) {
+	if ((unsigned)op >= OP_COUNT) {
+		return op_names[OP_INVALID];
+	}
+	return op_names[op];
+}
+
+/*
+	Purpose: gets the conventional name for a register number
+	Params: uint32_t reg - the register number, 0-31
+	Return: const char* - the name including the $ prefix
+*/
+const char* regName(uint32_t reg) {
+	return reg_names[reg & 0x1F];
+}
+
+/*
+	Purpose: copies a string to the end of formatted text
+	Params: char* out - where to copy
+			const char* text - the string to copy
+	Return: char* - the end of the copied text
+*/
+static char* appendText(char* out, const char* text) {
+	while (*text != '\0') {
+		*out++ = *text++;
+	}
+	return out;
+}
+
+/*
+	Purpose: writes an immediate the way printParam does, as #0x with no leading zeros
+	Params: char* out - where to write
+			uint32_t value - the immediate
+	Return: char* - the end of the written text
+*/
+static char* appendImmd(char* out, uint32_t value) {
+	static const char digits[] = "0123456789ABCDEF";
+	int shift = 28;
+
+	out = appendText(out, "#0x");
+	while (shift > 0 && (value >> shift) == 0) {
+		shift -= 4;
+	}
+	for (; shift >= 0; shift -= 4) {
+		*out++ = digits[(value >> shift) & 0xF];
+	}
+	return out;
+}
+
+/*
+	Purpose: writes the assembly text of a decoded instruction, in the syntax the menus print and accept
+	Params: char* out - ASSM_TEXT_SIZE bytes to fill, always terminated
+			const Decoded_Instruct* d - the instruction to format
+	Return: int - the length of the text
+*/
+int formatAssm(char* out, const Decoded_Instruct* d) {
+	char* end = appendText(out, opName(d->op));
+	*end++ = ' ';
+
+	// operand order follows the _bin functions
+	switch (d->op) {
+	// rd, rs, rt
+	case OP_ADD:
+	case OP_SUB:
+	case OP_AND:
+	case OP_OR:
+	case OP_SLT: {
+		end = appendText(end, regName(d->rd));
+		end = appendText(end, ", ");
+		end = appendText(end, regName(d->rs));
+		end = appendText(end, ", ");
+		end = appendText(end, regName(d->rt));
+		break;
+	}
+	// rs, rt
+	case OP_MULT:
+	case OP_DIV: {
+		end = appendText(end, regName(d->rs));
+		end = appendText(end, ", ");
+		end = appendText(end, regName(d->rt));
+		break;
+	}
+	// rd
+	case OP_MFHI:
+	case OP_MFLO: {
+		end = appendText(end, regName(d->rd));
+		break;
+	}
+	// rt, immediate
+	case OP_LUI: {
+		end = appendText(end, regName(d->rt));
+		end = appendText(end, ", ");
+		end = appendImmd(end, d->imm);
+		break;
+	}
+	// rt, immediate(rs)
+	case OP_LW: {
+		end = appendText(end, regName(d->rt));
+		end = appendText(end, ", ");
+		end = appendImmd(end, d->imm);
+		*end++ = '(';
+		end = appendText(end, regName(d->rs));
+		*end++ = ')';
+		break;
+	}
+	// rs, rt, immediate
+	case OP_BEQ:
+	case OP_BNE: {
+		end = appendText(end, regName(d->rs));
+		end = appendText(end, ", ");
+		end = appendText(end, regName(d->rt));
+		end = appendText(end, ", ");
+		end = appendImmd(end, d->imm);
+		break;
+	}
+	// rt, rs, immediate
+	case OP_ADDI:
+	case OP_ANDI:
+	case OP_ORI:
+	case OP_SLTI:
+	case OP_SW: {
+		end = appendText(end, regName(d->rt));
+		end = appendText(end, ", ");
+		end = appendText(end, regName(d->rs));
+		end = appendText(end, ", ");
+		end = appendImmd(end, d->imm);
+		break;
+	}
+	default: {
+		end--;
+		break;
+	}
+	}
+
+	*end = '\0';
+	return (int)(end - out);
+}
@@ -0,0 +1,122 @@
+#ifndef _MIPS_DECODE_H_
+#define _MIPS_DECODE_H_
+
+#include <stdint.h>
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// field extraction for a raw 32 bit instruction word
+#define WORD_OPCODE(w) (((w) >> 26) & 0x3F)
+#define WORD_RS(w) (((w) >> 21) & 0x1F)
+#define WORD_RT(w) (((w) >> 16) & 0x1F)
+#define WORD_RD(w) (((w) >> 11) & 0x1F)
+#define WORD_SHAMT(w) (((w) >> 6) & 0x1F)
+#define WORD_FUNCT(w) ((w) & 0x3F)
+#define WORD_IMM(w) ((w) & 0xFFFF)
+
+// sign extends a 16 bit immediate
+#define SIGN_EXT16(x) ((uint32_t)(int32_t)(int16_t)(uint16_t)(x))
+
+// longest text formatAssm writes, including the terminator
+#define ASSM_TEXT_SIZE 32
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// every instruction the translator knows, OP_INVALID marks an undecodable word
+typedef enum Op_Type {
+	OP_INVALID,
+	OP_ADD,
+	OP_ADDI,
+	OP_AND,
+	OP_ANDI,
+	OP_BEQ,
+	OP_BNE,
+	OP_DIV,
+	OP_LUI,
+	OP_LW,
+	OP_MFHI,
+	OP_MFLO,
+	OP_MULT,
+	OP_OR,
+	OP_ORI,
+	OP_SLT,
+	OP_SLTI,
+	OP_SUB,
+	OP_SW,
+	OP_COUNT
+} Op_Type;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// compact decoded form of one instruction word, fields keep their encoded meaning
+typedef struct {
+	uint8_t op;
+	uint8_t rs;
+	uint8_t rt;
+	uint8_t rd;
+	uint16_t imm;
+} Decoded_Instruct;
+
+
+/*----------------------------\
+		   Decoding
+\----------------------------*/
+/*
+	Purpose: decodes a word through the opcode/funct tables, accepts exactly what decode() accepts
+	Params: uint32_t word - the instruction word
+			Decoded_Instruct* out - the decoded fields to fill
+	Return: Op_Type - the decoded op, OP_INVALID if the word is not recognized
+*/
+Op_Type decodeWord(uint32_t word, Decoded_Instruct* out);
+
+/*
+	Purpose: classifies a word through the opcode/funct tables without extracting operands
+	Params: uint32_t word - the instruction word
+	Return: Op_Type - the decoded op, OP_INVALID if the word is not recognized
+*/
+Op_Type wordOp(uint32_t word);
+
+/*
+	Purpose: gets the bits of an op's word that no field reads, decode() ignores them
+	Params: Op_Type op - the op
+	Return: uint32_t - the bits, the shamt of R-type ops and any register field the op does not have
+*/
+uint32_t opUnusedBits(Op_Type op);
+
+/*
+	Purpose: encodes a decoded instruction back into a word, unused fields are zero
+	Params: const Decoded_Instruct* d - the instruction to encode
+	Return: uint32_t - the instruction word
+*/
+uint32_t encodeWord(const Decoded_Instruct* d);
+
+
+/*----------------------------\
+		   Names
+\----------------------------*/
+/*
+	Purpose: gets the mnemonic for an op
+	Params: Op_Type op - the op to name
+	Return: const char* - the mnemonic, "???" for OP_INVALID
+*/
+const char* opName(Op_Type op);
+
+/*
+	Purpose: gets the conventional name for a register number
+	Params: uint32_t reg - the register number, 0-31
+	Return: const char* - the name including the $ prefix
+*/
+const char* regName(uint32_t reg);
+
+/*
+	Purpose: writes the assembly text of a decoded instruction, in the syntax the menus print and accept
+	Params: char* out - ASSM_TEXT_SIZE bytes to fill, always terminated
+			const Decoded_Instruct* d - the instruction to format
+	Return: int - the length of the text
+*/
+int formatAssm(char* out, const Decoded_Instruct* d);
+
+#endif
@@ -0,0 +1,645 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Diff.h"
+#include "MIPS_Util.h"
+
+// the rolling hash multiplier, odd so no word's bits are lost
+#define DIFF_BASE 0x9E3779B97F4A7C15ull
+
+// width of one side of a printed line
+#define DIFF_SIDE_WIDTH 46
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a sampled window, where it is and how often it came up in each image
+typedef struct {
+	uint64_t key;
+	uint32_t old_pos;
+	uint32_t new_pos;
+	uint32_t old_count;
+	uint32_t new_count;
+} Anchor_Slot;
+
+// a window found once in each image
+typedef struct {
+	uint32_t old_pos;
+	uint32_t new_pos;
+} Anchor;
+
+
+/*----------------------------\
+		   Scanning
+\----------------------------*/
+/*
+	Purpose: counts the equal words at the start of two runs
+	Params: const uint32_t* a - the first run
+			const uint32_t* b - the second run
+			uint32_t limit - the most words to compare
+	Return: uint32_t - how many words are equal before the first that differs
+*/
+static uint32_t equalRun(const uint32_t* a, const uint32_t* b, uint32_t limit) {
+	uint32_t i = 0;
+	for (; i + DIFF_STEP_WORDS <= limit; i += DIFF_STEP_WORDS) {
+		Word_Vec a0, a1, a2, a3, b0, b1, b2, b3;
+		memcpy(&a0, a + i, 16);
+		memcpy(&a1, a + i + 4, 16);
+		memcpy(&a2, a + i + 8, 16);
+		memcpy(&a3, a + i + 12, 16);
+		memcpy(&b0, b + i, 16);
+		memcpy(&b1, b + i + 4, 16);
+		memcpy(&b2, b + i + 8, 16);
+		memcpy(&b3, b + i + 12, 16);
+
+		Word_Vec ne = (Word_Vec)(a0 != b0) | (Word_Vec)(a1 != b1) | (Word_Vec)(a2 != b2) | (Word_Vec)(a3 != b3);
+		if ((ne[0] | ne[1] | ne[2] | ne[3]) != 0) {
+			break;
+		}
+	}
+
+	while (i < limit && a[i] == b[i]) {
+		i++;
+	}
+	return i;
+}
+
+/*
+	Purpose: counts the equal words at the end of two runs
+	Params: const uint32_t* a_end - one past the last word of the first run
+			const uint32_t* b_end - one past the last word of the second run
+			uint32_t limit - the most words to compare
+	Return: uint32_t - how many words are equal after the last that differs
+*/
+static uint32_t equalRunBack(const uint32_t* a_end, const uint32_t* b_end, uint32_t limit) {
+	uint32_t i = 0;
+	for (; i + DIFF_STEP_WORDS <= limit; i += DIFF_STEP_WORDS) {
+		const uint32_t* a = a_end - i - DIFF_STEP_WORDS;
+		const uint32_t* b = b_end - i - DIFF_STEP_WORDS;
+		Word_Vec a0, a1, a2, a3, b0, b1, b2, b3;
+		memcpy(&a0, a, 16);
+		memcpy(&a1, a + 4, 16);
+		memcpy(&a2, a + 8, 16);
+		memcpy(&a3, a + 12, 16);
+		memcpy(&b0, b, 16);
+		memcpy(&b1, b + 4, 16);
+		memcpy(&b2, b + 8, 16);
+		memcpy(&b3, b + 12, 16);
+
+		Word_Vec ne = (Word_Vec)(a0 != b0) | (Word_Vec)(a1 != b1) | (Word_Vec)(a2 != b2) | (Word_Vec)(a3 != b3);
+		if ((ne[0] | ne[1] | ne[2] | ne[3]) != 0) {
+			break;
+		}
+	}
+
+	while (i < limit && a_end[-1 - (int64_t)i] == b_end[-1 - (int64_t)i]) {
+		i++;
+	}
+	return i;
+}
+
+
+/*----------------------------\
+		   Anchors
+\----------------------------*/
+/*
+	Purpose: spreads the bits of a window hash, so its low bits can pick the sample and the slot
+	Params: uint64_t h - the rolling hash
+	Return: uint64_t - the mixed hash
+*/
+static inline uint64_t mixHash(uint64_t h) {
+	h ^= h >> 31;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 29;
+	return h;
+}
+
+/*
+	Purpose: hashes every window of a run, counting the sampled ones in the table
+	Params: const uint32_t* words - the words
+			uint32_t start - the first word of the run
+			uint32_t end - one past its last word
+			Anchor_Slot* slots - the table
+			uint64_t mask - the table size less one
+			int is_new - 0 to count windows of the old run, 1 of the new
+	Return: none
+*/
+static void hashWindows(const uint32_t* words, uint32_t start, uint32_t end, Anchor_Slot* slots, uint64_t mask,
+	int is_new) {
+	if (end - start < DIFF_WINDOW) {
+		return;
+	}
+
+	// the weight of the word leaving the window
+	uint64_t top = 1;
+	for (int k = 1; k < DIFF_WINDOW; k++) {
+		top *= DIFF_BASE;
+	}
+
+	// a full table only keeps the windows already in it, the rest are not anchors
+	uint64_t room = (mask + 1) / 4 * 3;
+	uint64_t h = 0;
+	for (uint32_t k = 0; k < DIFF_WINDOW; k++) {
+		h = h * DIFF_BASE + words[start + k];
+	}
+	for (uint32_t p = start;; p++) {
+		uint64_t key = mixHash(h);
+		if ((key & (DIFF_SAMPLE - 1)) == 0) {
+			uint64_t s = (key >> 32) & mask;
+			while (slots[s].old_count != 0 && slots[s].key != key) {
+				s = (s + 1) & mask;
+			}
+
+			Anchor_Slot* slot = &slots[s];
+			if (!is_new && slot->old_count == 0 && room > 0) {
+				slot->key = key;
+				slot->old_pos = p;
+				slot->old_count = 1;
+				room--;
+			}
+			else if (!is_new && slot->old_count != 0) {
+				slot->old_count += (slot->old_count < 2);
+			}
+			else if (is_new && slot->old_count != 0) {
+				slot->new_pos = p;
+				slot->new_count += (slot->new_count < 2);
+			}
+		}
+
+		if (p + DIFF_WINDOW >= end) {
+			break;
+		}
+		h = (h - words[p] * top) * DIFF_BASE + words[p + DIFF_WINDOW];
+	}
+}
+
+/*
+	Purpose: orders anchors by their place in the old run
+	Params: const void* a - the first anchor
+			const void* b - the second anchor
+	Return: int - <0, 0 or >0 as a is before, at or after b
+*/
+static int compareAnchors(const void* a, const void* b) {
+	uint32_t x = ((const Anchor*)a)->old_pos;
+	uint32_t y = ((const Anchor*)b)->old_pos;
+	return (x > y) - (x < y);
+}
+
+/*
+	Purpose: finds the windows that occur once in each run, and keeps the longest chain in order in both
+	Params: const uint32_t* old_words - the old words
+			uint32_t old_start - the first old word to look at
+			uint32_t old_end - one past the last
+			const uint32_t* new_words - the new words
+			uint32_t new_start - the first new word to look at
+			uint32_t new_end - one past the last
+			Anchor** anchors - filled with the chain, to free
+			uint32_t* anchor_count - filled with its length
+	Return: int - 0 for no error
+*/
+static int findAnchors(const uint32_t* old_words, uint32_t old_start, uint32_t old_end, const uint32_t* new_words,
+	uint32_t new_start, uint32_t new_end, Anchor** anchors, uint32_t* anchor_count) {
+	*anchors = NULL;
+	*anchor_count = 0;
+
+	// room for twice the windows the old run is expected to sample
+	uint64_t size = 64;
+	while (size < (uint64_t)(old_end - old_start) / DIFF_SAMPLE * 2) {
+		size *= 2;
+	}
+	Anchor_Slot* slots = calloc(size, sizeof(Anchor_Slot));
+	if (slots == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	hashWindows(old_words, old_start, old_end, slots, size - 1, 0);
+	hashWindows(new_words, new_start, new_end, slots, size - 1, 1);
+
+	uint32_t count = 0;
+	for (uint64_t s = 0; s < size; s++) {
+		count += (slots[s].old_count == 1 && slots[s].new_count == 1);
+	}
+	Anchor* found = malloc(((size_t)count + 1) * sizeof(Anchor));
+	uint32_t* tails = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	uint32_t* prev = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (found == NULL || tails == NULL || prev == NULL) {
+		error("Out of memory");
+		free(slots);
+		free(found);
+		free(tails);
+		free(prev);
+		return 1;
+	}
+
+	// equal hashes are checked word for word, a collision is not an anchor
+	count = 0;
+	for (uint64_t s = 0; s < size; s++) {
+		const Anchor_Slot* slot = &slots[s];
+		if (slot->old_count == 1 && slot->new_count == 1 &&
+			memcmp(old_words + slot->old_pos, new_words + slot->new_pos, DIFF_WINDOW * sizeof(uint32_t)) == 0) {
+			found[count].old_pos = slot->old_pos;
+			found[count].new_pos = slot->new_pos;
+			count++;
+		}
+	}
+	free(slots);
+	qsort(found, count, sizeof(Anchor), compareAnchors);
+
+	// patience sorting, tails[k] ends the best chain of k + 1 anchors found so far
+	uint32_t length = 0;
+	for (uint32_t a = 0; a < count; a++) {
+		uint32_t low = 0;
+		uint32_t high = length;
+		while (low < high) {
+			uint32_t mid = (low + high) / 2;
+			if (found[tails[mid]].new_pos < found[a].new_pos) {
+				low = mid + 1;
+			}
+			else {
+				high = mid;
+			}
+		}
+		prev[a] = (low > 0) ? tails[low - 1] : UINT32_MAX;
+		tails[low] = a;
+		length += (low == length);
+	}
+
+	// the chain is read back from its end into the front of tails
+	uint32_t at = (length > 0) ? tails[length - 1] : UINT32_MAX;
+	for (uint32_t k = length; k-- > 0;) {
+		tails[k] = at;
+		at = prev[at];
+	}
+	for (uint32_t k = 0; k < length; k++) {
+		found[k] = found[tails[k]];
+	}
+
+	free(tails);
+	free(prev);
+	*anchors = found;
+	*anchor_count = length;
+	return 0;
+}
+
+
+/*----------------------------\
+		   Diffing
+\----------------------------*/
+/*
+	Purpose: adds a change to a growing list
+	Params: Diff_Change** changes - the list
+			uint32_t* count - its length
+			uint32_t* size - its room
+			Diff_Change change - the change
+	Return: int - 0 for no error
+*/
+static int pushChange(Diff_Change** changes, uint32_t* count, uint32_t* size, Diff_Change change) {
+	if (*count == *size) {
+		uint32_t grown_size = *size ? *size * 2 : 64;
+		Diff_Change* grown = realloc(*changes, (size_t)grown_size * sizeof(Diff_Change));
+		if (grown == NULL) {
+			error("Out of memory");
+			return 1;
+		}
+		*changes = grown;
+		*size = grown_size;
+	}
+	(*changes)[(*count)++] = change;
+	return 0;
+}
+
+/*
+	Purpose: finds the changes between two runs of words
+	Params: const uint32_t* old_words - the old words
+			uint32_t old_count - how many
+			const uint32_t* new_words - the new words
+			uint32_t new_count - how many
+			Diff_Change** changes - filled with the changes in order, to free
+			uint32_t* change_count - filled with the number of changes
+			Diff_Stats* stats - filled with the common start and end, anchors and times
+	Return: int - 0 for no error
+*/
+int diffWords(const uint32_t* old_words, uint32_t old_count, const uint32_t* new_words, uint32_t new_count,
+	Diff_Change** changes, uint32_t* change_count, Diff_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	double start = getTime();
+	*changes = NULL;
+	*change_count = 0;
+
+	uint32_t shorter = (old_count < new_count) ? old_count : new_count;
+	stats->prefix = equalRun(old_words, new_words, shorter);
+	stats->suffix = equalRunBack(old_words + old_count, new_words + new_count, shorter - stats->prefix);
+	stats->scan_time = getTime() - start;
+
+	uint32_t old_end = old_count - stats->suffix;
+	uint32_t new_end = new_count - stats->suffix;
+	if (stats->prefix == old_end && stats->prefix == new_end) {
+		stats->time = stats->scan_time;
+		return 0;
+	}
+
+	double align_start = getTime();
+	Anchor* anchors;
+	uint32_t anchor_count;
+	if (findAnchors(old_words, stats->prefix, old_end, new_words, stats->prefix, new_end, &anchors,
+		&anchor_count) != 0) {
+		return 1;
+	}
+	stats->anchors = anchor_count;
+
+	// every anchor is grown both ways, what lies between the grown anchors changed
+	uint32_t size = 0;
+	uint32_t old_at = stats->prefix;
+	uint32_t new_at = stats->prefix;
+	int failed = 0;
+	for (uint32_t a = 0; a <= anchor_count && !failed; a++) {
+		uint32_t old_pos = (a < anchor_count) ? anchors[a].old_pos : old_end;
+		uint32_t new_pos = (a < anchor_count) ? anchors[a].new_pos : new_end;
+		if (old_pos < old_at || new_pos < new_at) {
+			continue;
+		}
+
+		uint32_t back = 0;
+		while (old_pos - back > old_at && new_pos - back > new_at &&
+			old_words[old_pos - back - 1] == new_words[new_pos - back - 1]) {
+			back++;
+		}
+		if (old_pos - back > old_at || new_pos - back > new_at) {
+			Diff_Change change = { old_at, old_pos - back, new_at, new_pos - back };
+			failed = pushChange(changes, change_count, &size, change);
+		}
+
+		uint32_t room = (old_end - old_pos < new_end - new_pos) ? old_end - old_pos : new_end - new_pos;
+		uint32_t run = equalRun(old_words + old_pos, new_words + new_pos, room);
+		old_at = old_pos + run;
+		new_at = new_pos + run;
+	}
+	free(anchors);
+
+	for (uint32_t c = 0; c < *change_count; c++) {
+		const Diff_Change* change = &(*changes)[c];
+		uint32_t old_len = change->old_end - change->old_start;
+		uint32_t new_len = change->new_end - change->new_start;
+		uint32_t both = (old_len < new_len) ? old_len : new_len;
+		stats->changed += both;
+		stats->removed += old_len - both;
+		stats->added += new_len - both;
+	}
+	stats->changes = *change_count;
+	stats->align_time = getTime() - align_start;
+	stats->time = getTime() - start;
+	return failed;
+}
+
+
+/*----------------------------\
+		   Printing
+\----------------------------*/
+/*
+	Purpose: formats one side of a line, the address, word and its assembly
+	Params: char* out - DIFF_SIDE_WIDTH + 1 bytes to fill
+			const Elf_Image* image - the image the word is in, NULL for an empty side
+			const uint32_t* words - the image's host order words
+			uint32_t index - the word
+	Return: none
+*/
+static void formatSide(char* out, const Elf_Image* image, const uint32_t* words, uint32_t index) {
+	if (image == NULL) {
+		snprintf(out, DIFF_SIDE_WIDTH + 1, "%*s", DIFF_SIDE_WIDTH, "");
+		return;
+	}
+
+	Decoded_Instruct d;
+	char text[ASSM_TEXT_SIZE] = ".word";
+	if (decodeWord(words[index], &d) != OP_INVALID) {
+		formatAssm(text, &d);
+	}
+	snprintf(out, DIFF_SIDE_WIDTH + 1, "%08X  %08X  %-*.*s", image->text_addr + index * 4, words[index],
+		DIFF_SIDE_WIDTH - 20, DIFF_SIDE_WIDTH - 20, text);
+}
+
+/*
+	Purpose: prints one line of a hunk
+	Params: const Elf_Image* old_image - the old image, NULL for no old word
+			const uint32_t* old_words - its words
+			uint32_t old_index - the old word
+			char mark - ' ', '|', '<' or '>'
+			const Elf_Image* new_image - the new image, NULL for no new word
+			const uint32_t* new_words - its words
+			uint32_t new_index - the new word
+	Return: none
+*/
+static void printLine(const Elf_Image* old_image, const uint32_t* old_words, uint32_t old_index, char mark,
+	const Elf_Image* new_image, const uint32_t* new_words, uint32_t new_index) {
+	char left[DIFF_SIDE_WIDTH + 1];
+	char right[DIFF_SIDE_WIDTH + 1];
+	formatSide(left, old_image, old_words, old_index);
+	formatSide(right, new_image, new_words, new_index);
+
+	// trailing blanks of the right side are dropped
+	size_t len = strlen(right);
+	while (len > 0 && right[len - 1] == ' ') {
+		right[--len] = '\0';
+	}
+	printf("%s %c %s\n", left, mark, right);
+}
+
+/*
+	Purpose: finds how far a change grows to cover whole blocks on both sides
+	Params: const Cfg* old_cfg - the old image's graph
+			const Cfg* new_cfg - the new image's graph
+			const Diff_Change* change - the change
+			uint32_t* back - filled with the words to take before it
+			uint32_t* forward - filled with the words to take after it
+	Return: none
+*/
+static void blockReach(const Cfg* old_cfg, const Cfg* new_cfg, const Diff_Change* change, uint32_t* back,
+	uint32_t* forward) {
+	*back = 0;
+	*forward = 0;
+
+	// a side with no words in the change does not widen it
+	if (change->old_end > change->old_start) {
+		uint32_t first = cfgBlockOf(old_cfg, change->old_start);
+		uint32_t last = cfgBlockOf(old_cfg, change->old_end - 1);
+		*back = change->old_start - old_cfg->block_start[first];
+		*forward = old_cfg->block_start[last + 1] - change->old_end;
+	}
+	if (change->new_end > change->new_start) {
+		uint32_t first = cfgBlockOf(new_cfg, change->new_start);
+		uint32_t last = cfgBlockOf(new_cfg, change->new_end - 1);
+		uint32_t new_back = change->new_start - new_cfg->block_start[first];
+		uint32_t new_forward = new_cfg->block_start[last + 1] - change->new_end;
+		*back = (new_back > *back) ? new_back : *back;
+		*forward = (new_forward > *forward) ? new_forward : *forward;
+	}
+}
+
+/*
+	Purpose: prints the changes grown to whole blocks, merging those that meet into one hunk
+	Params: const Elf_Image* old_image - the old image
+			const uint32_t* old_words - its host order words
+			const Cfg* old_cfg - its graph
+			const Elf_Image* new_image - the new image
+			const uint32_t* new_words - its host order words
+			const Cfg* new_cfg - its graph
+			const Diff_Change* changes - the changes
+			uint32_t change_count - how many
+	Return: uint32_t - the number of hunks printed
+*/
+static uint32_t printHunks(const Elf_Image* old_image, const uint32_t* old_words, const Cfg* old_cfg,
+	const Elf_Image* new_image, const uint32_t* new_words, const Cfg* new_cfg, const Diff_Change* changes,
+	uint32_t change_count) {
+	uint32_t hunks = 0;
+	uint32_t c = 0;
+	while (c < change_count) {
+		// the equal words between changes are shared, so a hunk only ever takes as many as are there
+		uint32_t back;
+		uint32_t forward;
+		blockReach(old_cfg, new_cfg, &changes[c], &back, &forward);
+		uint32_t before = changes[c].old_start - ((c > 0) ? changes[c - 1].old_end : 0);
+		back = (back < before) ? back : before;
+
+		uint32_t first = c;
+		uint32_t last = c;
+		while (1) {
+			uint32_t after = ((last + 1 < change_count) ? changes[last + 1].old_start : old_cfg->word_count) -
+				changes[last].old_end;
+			if (forward < after || last + 1 == change_count) {
+				forward = (forward < after) ? forward : after;
+				break;
+			}
+
+			// the next change is within reach, it joins this hunk and its own reach counts from its end
+			last++;
+			uint32_t next_back;
+			blockReach(old_cfg, new_cfg, &changes[last], &next_back, &forward);
+		}
+
+		uint32_t old_from = changes[first].old_start - back;
+		uint32_t new_from = changes[first].new_start - back;
+		uint32_t old_to = changes[last].old_end + forward;
+		uint32_t new_to = changes[last].new_end + forward;
+		uint32_t old_blocks = 0;
+		uint32_t new_blocks = 0;
+		if (old_to > old_from) {
+			old_blocks = cfgBlockOf(old_cfg, old_to - 1) - cfgBlockOf(old_cfg, old_from) + 1;
+		}
+		if (new_to > new_from) {
+			new_blocks = cfgBlockOf(new_cfg, new_to - 1) - cfgBlockOf(new_cfg, new_from) + 1;
+		}
+		printf("@@ -0x%08X,%u +0x%08X,%u @@ %u -> %u blocks\n", old_image->text_addr + old_from * 4,
+			old_to - old_from, new_image->text_addr + new_from * 4, new_to - new_from, old_blocks, new_blocks);
+
+		// the equal words before each change, then the change itself
+		uint32_t old_at = old_from;
+		uint32_t new_at = new_from;
+		for (uint32_t k = first; k <= last; k++) {
+			const Diff_Change* change = &changes[k];
+			for (; old_at < change->old_start; old_at++, new_at++) {
+				printLine(old_image, old_words, old_at, ' ', new_image, new_words, new_at);
+			}
+			while (old_at < change->old_end || new_at < change->new_end) {
+				int has_old = (old_at < change->old_end);
+				int has_new = (new_at < change->new_end);
+				char mark = (has_old && has_new) ? '|' : has_old ? '<' : '>';
+				printLine(has_old ? old_image : NULL, old_words, old_at, mark, has_new ? new_image : NULL, new_words,
+					new_at);
+				old_at += has_old;
+				new_at += has_new;
+			}
+		}
+		for (; old_at < old_to; old_at++, new_at++) {
+			printLine(old_image, old_words, old_at, ' ', new_image, new_words, new_at);
+		}
+
+		hunks++;
+		c = last + 1;
+	}
+	return hunks;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --diff mode, prints the changed basic blocks of two images side by side
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <old> <new>
+	Return: int - exit code, 0 when the images are the same and 1 when they differ
+*/
+int diffMain(int argc, char** argv) {
+	int big = 1;
+	uint32_t raw_base = TEXT_BASE;
+	imageOptions(&argc, &argv, &raw_base, &big, NULL);
+	if (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 2;
+	}
+	if (argc < 2) {
+		error("--diff needs an old and a new image");
+		return 2;
+	}
+
+	Elf_Image images[2];
+	const uint32_t* words[2];
+	uint32_t counts[2];
+	for (int side = 0; side < 2; side++) {
+		const char* path = argv[side];
+		Elf_Image* image = &images[side];
+		int opened = imageOpenAny(image, path, raw_base, big);
+		words[side] = (opened == 0) ? imageText(image, &counts[side]) : NULL;
+		if (opened == 0 && words[side] == NULL) {
+			error("Out of memory");
+			imageClose(image);
+		}
+		if (words[side] == NULL) {
+			if (side == 1) {
+				imageClose(&images[0]);
+			}
+			return 2;
+		}
+	}
+
+	Diff_Change* changes;
+	uint32_t change_count;
+	Diff_Stats stats;
+	int failed = diffWords(words[0], counts[0], words[1], counts[1], &changes, &change_count, &stats);
+
+	// the graphs are only needed to print changes, equal images never build them
+	Cfg cfgs[2];
+	Cfg_Stats cfg_stats;
+	int built = 0;
+	for (int side = 0; side < 2 && !failed && change_count > 0; side++) {
+		failed = cfgBuild(&cfgs[side], words[side], counts[side], images[side].text_addr, 0, &cfg_stats);
+		built += !failed;
+	}
+	if (!failed && change_count > 0) {
+		printf("--- %s\n+++ %s\n", argv[0], argv[1]);
+		stats.hunks = printHunks(&images[0], words[0], &cfgs[0], &images[1], words[1], &cfgs[1], changes,
+			change_count);
+	}
+	fflush(stdout);
+	for (int side = 0; side < built; side++) {
+		cfgFree(&cfgs[side]);
+	}
+	double wall = stats.time;
+
+	fprintf(stderr, "Old: %u words\tNew: %u words\tSame start: %u\tSame end: %u\tAnchors: %u\n", counts[0],
+		counts[1], stats.prefix, stats.suffix, stats.anchors);
+	fprintf(stderr, "Hunks: %u\tChanged: %u\tRemoved: %u\tAdded: %u\n", stats.hunks, stats.changed, stats.removed,
+		stats.added);
+	fprintf(stderr, "Scan: %.6f s\tAlign: %.6f s\tTime: %.6f s\t%.1f MB/s\n", stats.scan_time, stats.align_time, wall,
+		wall > 0 ? (counts[0] + counts[1]) * 4.0 / wall / 1e6 : 0.0);
+
+	free(changes);
+	imageClose(&images[0]);
+	imageClose(&images[1]);
+	if (failed) {
+		return 2;
+	}
+	return (change_count > 0) ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#ifndef _MIPS_DIFF_H_
+#define _MIPS_DIFF_H_
+
+#include <stdint.h>
+
+/*
+	Word level diff of the .text of two images. The words both images
+	start and end with are skipped by comparing 16 at a time with vector
+	equality. What is left is aligned through anchors: windows of
+	DIFF_WINDOW words are hashed with a rolling hash, about one window in
+	DIFF_SAMPLE is kept, and the windows that occur exactly once in each
+	image are paired. The longest run of pairs that is in order in both
+	images is kept, so code that moved by an insertion still lines up, and
+	each anchor is grown both ways while the words stay equal. The words
+	between the grown anchors are the changes. The whole alignment is
+	O(n log n) in the words past the common start and end.
+
+	Each change is then widened to the basic blocks it touches in either
+	image, taking the equal words around it as context, and printed side
+	by side, old on the left, with | for a changed word, < for one only in
+	the old image and > for one only in the new.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// words in an anchor window
+#define DIFF_WINDOW 8
+
+// one window in this many is kept as a possible anchor, a power of two
+#define DIFF_SAMPLE 16
+
+// words compared per step, four vectors of four
+#define DIFF_STEP_WORDS 16
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a change, the words old_start up to old_end were replaced by new_start up to new_end
+typedef struct {
+	uint32_t old_start;
+	uint32_t old_end;
+	uint32_t new_start;
+	uint32_t new_end;
+} Diff_Change;
+
+// what a diff found
+typedef struct {
+	uint32_t prefix;
+	uint32_t suffix;
+	uint32_t anchors;
+	uint32_t changes;
+	uint32_t hunks;
+	uint32_t changed;
+	uint32_t removed;
+	uint32_t added;
+	double scan_time;
+	double align_time;
+	double time;
+} Diff_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: finds the changes between two runs of words
+	Params: const uint32_t* old_words - the old words
+			uint32_t old_count - how many
+			const uint32_t* new_words - the new words
+			uint32_t new_count - how many
+			Diff_Change** changes - filled with the changes in order, to free
+			uint32_t* change_count - filled with the number of changes
+			Diff_Stats* stats - filled with the common start and end, anchors and times
+	Return: int - 0 for no error
+*/
+int diffWords(const uint32_t* old_words, uint32_t old_count, const uint32_t* new_words, uint32_t new_count,
+	Diff_Change** changes, uint32_t* change_count, Diff_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --diff mode, prints the changed basic blocks of two images side by side
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <old> <new>
+	Return: int - exit code, 0 when the images are the same and 1 when they differ
+*/
+int diffMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,718 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Dom.h"
+#include "MIPS_Util.h"
+
+// bytes of listing collected before each write
+#define DOM_OUT_SIZE (1u << 20)
+
+// longest line of the listing
+#define DOM_LINE_MAX 96
+
+// deepest nest the structured benchmark opens
+#define DOM_BENCH_DEPTH 24
+
+// words the benchmark fills blocks with and branches on, ADDI $t0, $t0, 1 and $t0/$t1 compares
+#define DOM_BENCH_FILL 0x21080001u
+#define DOM_BENCH_BEQ(off) (0x11090000u | ((uint32_t)(off) & 0xFFFF))
+#define DOM_BENCH_BNE(off) (0x15090000u | ((uint32_t)(off) & 0xFFFF))
+
+/*----------------------------\
+		   Setup
+\----------------------------*/
+/*
+	Purpose: orders the blocks in postorder from block 0, then from any block not reached yet
+	Params: Dom* dom - the result, order and position allocated
+			uint8_t* root - filled with 1 at the postorder place of each search root
+	Return: int - 0 for no error
+*/
+static int postorder(Dom* dom, uint8_t* root) {
+	const Cfg* cfg = dom->cfg;
+	uint32_t count = cfg->block_count;
+
+	// the stack holds a block and the next of its edges to follow
+	uint32_t* stack = malloc(((size_t)count + 1) * 2 * sizeof(uint32_t));
+	uint8_t* seen = calloc((size_t)count + 1, 1);
+	if (stack == NULL || seen == NULL) {
+		free(stack);
+		free(seen);
+		return 1;
+	}
+
+	uint32_t placed = 0;
+	for (uint32_t start = 0; start < count; start++) {
+		if (seen[start]) {
+			continue;
+		}
+
+		seen[start] = 1;
+		stack[0] = start;
+		stack[1] = cfg->edge_start[start];
+		uint32_t depth = 1;
+		while (depth > 0) {
+			uint32_t* top = &stack[(depth - 1) * 2];
+			if (top[1] < cfg->edge_start[top[0] + 1]) {
+				uint32_t next = cfg->edges[top[1]++];
+				if (!seen[next]) {
+					seen[next] = 1;
+					stack[depth * 2] = next;
+					stack[depth * 2 + 1] = cfg->edge_start[next];
+					depth++;
+				}
+				continue;
+			}
+
+			dom->position[top[0]] = placed;
+			dom->order[placed++] = top[0];
+			depth--;
+		}
+		root[placed - 1] = 1;
+	}
+
+	free(stack);
+	free(seen);
+	return 0;
+}
+
+/*
+	Purpose: builds the predecessor lists by transposing the successor lists
+	Params: Dom* dom - the result
+	Return: int - 0 for no error
+*/
+static int predecessors(Dom* dom) {
+	const Cfg* cfg = dom->cfg;
+	uint32_t count = cfg->block_count;
+
+	dom->pred_start = calloc((size_t)count + 1, sizeof(uint32_t));
+	dom->preds = malloc(((size_t)cfg->edge_count + 1) * sizeof(uint32_t));
+	uint32_t* fill = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (dom->pred_start == NULL || dom->preds == NULL || fill == NULL) {
+		free(fill);
+		return 1;
+	}
+
+	for (uint32_t e = 0; e < cfg->edge_count; e++) {
+		dom->pred_start[cfg->edges[e] + 1]++;
+	}
+	for (uint32_t b = 0; b < count; b++) {
+		dom->pred_start[b + 1] += dom->pred_start[b];
+	}
+
+	memcpy(fill, dom->pred_start, (size_t)count * sizeof(uint32_t));
+	for (uint32_t b = 0; b < count; b++) {
+		for (uint32_t e = cfg->edge_start[b]; e < cfg->edge_start[b + 1]; e++) {
+			dom->preds[fill[cfg->edges[e]]++] = b;
+		}
+	}
+
+	free(fill);
+	return 0;
+}
+
+
+/*----------------------------\
+		   Dominators
+\----------------------------*/
+/*
+	Purpose: finds the nearest common dominator of two blocks, both named by postorder place
+	Params: const uint32_t* ipo - the immediate dominator of each place so far
+			uint32_t a - the first place
+			uint32_t b - the second place
+	Return: uint32_t - the place of the common dominator
+*/
+static inline uint32_t intersect(const uint32_t* ipo, uint32_t a, uint32_t b) {
+	// dominators are always later in postorder, so the finger further behind moves up
+	while (a != b) {
+		while (a < b) {
+			a = ipo[a];
+		}
+		while (b < a) {
+			b = ipo[b];
+		}
+	}
+	return a;
+}
+
+/*
+	Purpose: computes the immediate dominator of every postorder place, the virtual root is place count
+	Params: const Dom* dom - the result, order, position and predecessors filled
+			const uint8_t* root - 1 at the place of each search root
+			uint32_t* ipo - count + 1 places to fill
+	Return: uint32_t - the number of passes
+*/
+static uint32_t solveDominators(const Dom* dom, const uint8_t* root, uint32_t* ipo) {
+	uint32_t count = dom->cfg->block_count;
+
+	for (uint32_t p = 0; p < count; p++) {
+		ipo[p] = root[p] ? count : DOM_NONE;
+	}
+	ipo[count] = count;
+
+	// reverse postorder, so the tree parent of every block is seen before it
+	uint32_t passes = 0;
+	int changed = 1;
+	while (changed) {
+		changed = 0;
+		passes++;
+		for (uint32_t p = count; p-- > 0;) {
+			if (root[p]) {
+				continue;
+			}
+
+			uint32_t b = dom->order[p];
+			uint32_t best = DOM_NONE;
+			for (uint32_t e = dom->pred_start[b]; e < dom->pred_start[b + 1]; e++) {
+				uint32_t q = dom->position[dom->preds[e]];
+				if (ipo[q] == DOM_NONE) {
+					continue;
+				}
+				best = (best == DOM_NONE) ? q : intersect(ipo, q, best);
+			}
+
+			if (ipo[p] != best) {
+				ipo[p] = best;
+				changed = 1;
+			}
+		}
+	}
+
+	return passes;
+}
+
+/*
+	Purpose: numbers the dominator tree depth first so each block gets the interval of the blocks it dominates
+	Params: Dom* dom - the result, enter and leave allocated
+			const uint32_t* ipo - the immediate dominator of each postorder place
+	Return: int - 0 for no error
+*/
+static int treeIntervals(Dom* dom, const uint32_t* ipo) {
+	uint32_t count = dom->cfg->block_count;
+
+	// CSR children of each place, the virtual root included
+	uint32_t* child_start = calloc((size_t)count + 2, sizeof(uint32_t));
+	uint32_t* children = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	uint32_t* stack = malloc(((size_t)count + 1) * 2 * sizeof(uint32_t));
+	if (child_start == NULL || children == NULL || stack == NULL) {
+		free(child_start);
+		free(children);
+		free(stack);
+		return 1;
+	}
+
+	for (uint32_t p = 0; p < count; p++) {
+		child_start[ipo[p] + 1]++;
+	}
+	for (uint32_t p = 0; p <= count; p++) {
+		child_start[p + 1] += child_start[p];
+	}
+	for (uint32_t p = 0; p < count; p++) {
+		children[child_start[ipo[p]]++] = p;
+	}
+	// the fill moved each start to the next one's, so shift them back
+	memmove(child_start + 1, child_start, ((size_t)count + 1) * sizeof(uint32_t));
+	child_start[0] = 0;
+
+	uint32_t clock = 0;
+	uint32_t depth = 1;
+	stack[0] = count;
+	stack[1] = child_start[count];
+	while (depth > 0) {
+		uint32_t* top = &stack[(depth - 1) * 2];
+		if (top[1] < child_start[top[0] + 1]) {
+			uint32_t next = children[top[1]++];
+			dom->enter[dom->order[next]] = clock++;
+			stack[depth * 2] = next;
+			stack[depth * 2 + 1] = child_start[next];
+			depth++;
+			continue;
+		}
+
+		if (top[0] != count) {
+			dom->leave[dom->order[top[0]]] = clock++;
+		}
+		depth--;
+	}
+
+	free(child_start);
+	free(children);
+	free(stack);
+	return 0;
+}
+
+
+/*----------------------------\
+		   Loops
+\----------------------------*/
+/*
+	Purpose: finds the outermost loop found so far around a header, shortening the path on the way
+	Params: uint32_t* link - each header's enclosing header, itself when it has none yet
+			uint32_t header - the header to start at
+	Return: uint32_t - the outermost header
+*/
+static uint32_t outermost(uint32_t* link, uint32_t header) {
+	uint32_t top = header;
+	while (link[top] != top) {
+		top = link[top];
+	}
+	while (link[header] != top) {
+		uint32_t next = link[header];
+		link[header] = top;
+		header = next;
+	}
+	return top;
+}
+
+/*
+	Purpose: finds every natural loop, its nesting and each block's innermost loop
+	Params: Dom* dom - the result, the tree filled and the loop arrays allocated
+			Dom_Stats* stats - filled with the back and irreducible edge counts
+	Return: int - 0 for no error
+*/
+static int findLoops(Dom* dom, Dom_Stats* stats) {
+	const Cfg* cfg = dom->cfg;
+	uint32_t count = cfg->block_count;
+
+	// a latch edge can be pushed twice, once as a latch and once when its loop is nested, the rest once
+	uint32_t* link = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	uint32_t* work = malloc(((size_t)cfg->edge_count * 2 + 1) * sizeof(uint32_t));
+	if (link == NULL || work == NULL) {
+		free(link);
+		free(work);
+		return 1;
+	}
+
+	for (uint32_t b = 0; b < count; b++) {
+		dom->loop_header[b] = DOM_NONE;
+		dom->loop_parent[b] = DOM_NONE;
+		dom->loop_size[b] = 0;
+	}
+
+	// retreating edges go to a block no earlier in postorder, back edges are the ones to a dominator
+	for (uint32_t b = 0; b < count; b++) {
+		for (uint32_t e = cfg->edge_start[b]; e < cfg->edge_start[b + 1]; e++) {
+			uint32_t h = cfg->edges[e];
+			if (dom->position[h] >= dom->position[b] && !domDominates(dom, h, b)) {
+				stats->irreducible++;
+			}
+		}
+	}
+
+	// an inner header is dominated by the outer one, so it is earlier in postorder
+	for (uint32_t p = 0; p < count; p++) {
+		uint32_t h = dom->order[p];
+		uint32_t used = 0;
+		for (uint32_t e = dom->pred_start[h]; e < dom->pred_start[h + 1]; e++) {
+			if (domDominates(dom, h, dom->preds[e])) {
+				work[used++] = dom->preds[e];
+			}
+		}
+		if (used == 0) {
+			continue;
+		}
+
+		stats->back_edges += used;
+		dom->loop_count++;
+		dom->loop_header[h] = h;
+		link[h] = h;
+
+		while (used > 0) {
+			uint32_t x = work[--used];
+			uint32_t y = h;
+			if (dom->loop_header[x] == DOM_NONE) {
+				dom->loop_header[x] = h;
+				y = x;
+			}
+			else {
+				// a block of an inner loop stands for the whole of it
+				y = outermost(link, dom->loop_header[x]);
+				if (y == h) {
+					continue;
+				}
+				link[y] = h;
+				dom->loop_parent[y] = h;
+			}
+
+			for (uint32_t e = dom->pred_start[y]; e < dom->pred_start[y + 1]; e++) {
+				work[used++] = dom->preds[e];
+			}
+		}
+	}
+
+	// depths outer first, then sizes inner first so nested loops count in their parents
+	dom->max_depth = 0;
+	for (uint32_t p = count; p-- > 0;) {
+		uint32_t h = dom->order[p];
+		if (dom->loop_header[h] != h) {
+			continue;
+		}
+		uint32_t parent = dom->loop_parent[h];
+		dom->loop_depth[h] = (parent == DOM_NONE) ? 1 : dom->loop_depth[parent] + 1;
+		if (dom->loop_depth[h] > dom->max_depth) {
+			dom->max_depth = dom->loop_depth[h];
+		}
+	}
+	for (uint32_t b = 0; b < count; b++) {
+		uint32_t h = dom->loop_header[b];
+		if (h == DOM_NONE) {
+			dom->loop_depth[b] = 0;
+			continue;
+		}
+		if (h != b) {
+			dom->loop_depth[b] = dom->loop_depth[h];
+		}
+		dom->loop_size[h]++;
+	}
+	for (uint32_t p = 0; p < count; p++) {
+		uint32_t h = dom->order[p];
+		if (dom->loop_header[h] == h && dom->loop_parent[h] != DOM_NONE) {
+			dom->loop_size[dom->loop_parent[h]] += dom->loop_size[h];
+		}
+	}
+
+	free(link);
+	free(work);
+	return 0;
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: builds the dominator tree and the loops of a graph
+	Params: Dom* dom - the result to fill
+			const Cfg* cfg - the graph, kept by the result
+			Dom_Stats* stats - filled with the step times and counts
+	Return: int - 0 for no error
+*/
+int domBuild(Dom* dom, const Cfg* cfg, Dom_Stats* stats) {
+	memset(dom, 0, sizeof(*dom));
+	memset(stats, 0, sizeof(*stats));
+	dom->cfg = cfg;
+
+	uint32_t count = cfg->block_count;
+	size_t bytes = ((size_t)count + 1) * sizeof(uint32_t);
+	double begin = getTime();
+	double start = begin;
+
+	uint8_t* root = calloc((size_t)count + 1, 1);
+	uint32_t* ipo = malloc(bytes + sizeof(uint32_t));
+	dom->order = malloc(bytes);
+	dom->position = malloc(bytes);
+	dom->idom = malloc(bytes);
+	dom->enter = malloc(bytes);
+	dom->leave = malloc(bytes);
+	dom->loop_header = malloc(bytes);
+	dom->loop_parent = malloc(bytes);
+	dom->loop_depth = malloc(bytes);
+	dom->loop_size = malloc(bytes);
+	if (root == NULL || ipo == NULL || dom->order == NULL || dom->position == NULL || dom->idom == NULL ||
+		dom->enter == NULL || dom->leave == NULL || dom->loop_header == NULL || dom->loop_parent == NULL ||
+		dom->loop_depth == NULL || dom->loop_size == NULL || predecessors(dom) != 0 || postorder(dom, root) != 0) {
+		error("Out of memory");
+		free(root);
+		free(ipo);
+		domFree(dom);
+		return 1;
+	}
+	for (uint32_t p = 0; p < count; p++) {
+		stats->roots += root[p];
+	}
+	stats->order_time = getTime() - start;
+
+	start = getTime();
+	stats->passes = solveDominators(dom, root, ipo);
+	for (uint32_t p = 0; p < count; p++) {
+		dom->idom[dom->order[p]] = (ipo[p] == count) ? DOM_NONE : dom->order[ipo[p]];
+	}
+	stats->dom_time = getTime() - start;
+
+	start = getTime();
+	int failed = treeIntervals(dom, ipo);
+	stats->tree_time = getTime() - start;
+	free(root);
+	free(ipo);
+
+	start = getTime();
+	failed = failed || findLoops(dom, stats);
+	stats->loop_time = getTime() - start;
+	if (failed) {
+		error("Out of memory");
+		domFree(dom);
+		return 1;
+	}
+
+	stats->time = getTime() - begin;
+	return 0;
+}
+
+/*
+	Purpose: releases a result
+	Params: Dom* dom - the result
+	Return: none
+*/
+void domFree(Dom* dom) {
+	free(dom->order);
+	free(dom->position);
+	free(dom->pred_start);
+	free(dom->preds);
+	free(dom->idom);
+	free(dom->enter);
+	free(dom->leave);
+	free(dom->loop_header);
+	free(dom->loop_parent);
+	free(dom->loop_depth);
+	free(dom->loop_size);
+	memset(dom, 0, sizeof(*dom));
+}
+
+/*
+	Purpose: checks whether one block dominates another, every block dominates itself
+	Params: const Dom* dom - the result
+			uint32_t a - the block that may dominate
+			uint32_t b - the block that may be dominated
+	Return: int - 1 if a dominates b
+*/
+int domDominates(const Dom* dom, uint32_t a, uint32_t b) {
+	return dom->enter[a] <= dom->enter[b] && dom->leave[b] <= dom->leave[a];
+}
+
+/*
+	Purpose: gets how many loops a block is in
+	Params: const Dom* dom - the result
+			uint32_t block - the block
+	Return: uint32_t - the loop depth, 0 outside every loop
+*/
+uint32_t domLoopDepth(const Dom* dom, uint32_t block) {
+	return dom->loop_depth[block];
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --loops mode, finds the loops of an image's .text, reports them and optionally lists them
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int domMain(int argc, char** argv) {
+	int threads = 0;
+	int big = 1;
+	uint32_t raw_base = TEXT_BASE;
+
+	imageOptions(&argc, &argv, &raw_base, &big, &threads);
+	if (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 1;
+	}
+	if (argc < 1) {
+		error("--loops needs an ELF, Intel HEX, S-record or raw file");
+		return 1;
+	}
+
+	Elf_Image image;
+	if (imageOpenAny(&image, argv[0], raw_base, big) != 0) {
+		return 1;
+	}
+
+	uint32_t count;
+	const uint32_t* words = imageText(&image, &count);
+	Cfg cfg;
+	Cfg_Stats cfg_stats;
+	if (words == NULL || cfgBuild(&cfg, words, count, image.text_addr, threads, &cfg_stats) != 0) {
+		imageClose(&image);
+		return 1;
+	}
+
+	Dom dom;
+	Dom_Stats stats;
+	if (domBuild(&dom, &cfg, &stats) != 0) {
+		cfgFree(&cfg);
+		imageClose(&image);
+		return 1;
+	}
+
+	// the listing is one line per loop in header address order
+	int failed = 0;
+	if (argc > 1) {
+		FILE* out = (strcmp(argv[1], "-") == 0) ? stdout : fopen(argv[1], "w");
+		char* buffer = malloc(DOM_OUT_SIZE);
+		if (out == NULL || buffer == NULL) {
+			perror(argv[1]);
+			failed = 1;
+		}
+		else {
+			size_t used = 0;
+			for (uint32_t blk = 0; blk < cfg.block_count && !failed; blk++) {
+				if (dom.loop_header[blk] != blk) {
+					continue;
+				}
+				if (DOM_OUT_SIZE - used < DOM_LINE_MAX) {
+					failed = (fwrite(buffer, 1, used, out) != used);
+					used = 0;
+				}
+				used += (size_t)sprintf(buffer + used, "%08X  depth %u  blocks %u", cfg.base + cfg.block_start[blk] * 4,
+					dom.loop_depth[blk], dom.loop_size[blk]);
+				if (dom.loop_parent[blk] != DOM_NONE) {
+					used += (size_t)sprintf(buffer + used, "  in %08X", cfg.base + cfg.block_start[dom.loop_parent[blk]] * 4);
+				}
+				buffer[used++] = '\n';
+			}
+			failed |= (fwrite(buffer, 1, used, out) != used);
+		}
+		if (out != NULL && out != stdout) {
+			failed |= (fclose(out) != 0);
+		}
+		free(buffer);
+	}
+
+	fprintf(stderr, "Words: %u\tBlocks: %u\tEdges: %u\tRoots: %u\n", count, cfg.block_count, cfg.edge_count, stats.roots);
+	fprintf(stderr, "Loops: %u\tBack edges: %u\tIrreducible edges: %u\tMax depth: %u\n", dom.loop_count,
+		stats.back_edges, stats.irreducible, dom.max_depth);
+	fprintf(stderr, "CFG: %.6f s\tOrder: %.6f s\tDominators: %.6f s (%u passes)\tTree: %.6f s\tLoops: %.6f s\n",
+		cfg_stats.time, stats.order_time, stats.dom_time, stats.passes, stats.tree_time, stats.loop_time);
+
+	domFree(&dom);
+	cfgFree(&cfg);
+	imageClose(&image);
+	return failed;
+}
+
+/*
+	Purpose: fills words with nested loops and forward branches, the shape compiled code has
+	Params: uint32_t* words - the words to fill
+			uint32_t count - how many
+			uint32_t seed - the xorshift32 state to start from
+	Return: none
+*/
+static void benchStructured(uint32_t* words, uint32_t count, uint32_t seed) {
+	uint32_t open[DOM_BENCH_DEPTH];
+	uint32_t depth = 0;
+	uint32_t quiet = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		uint32_t pick = seed & 15;
+		int64_t left = (int64_t)count - i;
+		words[i] = DOM_BENCH_FILL;
+
+		// the words an if skips open and close nothing, so no branch enters a loop from the side
+		if (quiet > 0) {
+			quiet--;
+			continue;
+		}
+
+		// a loop closes by chance, when its branch would go out of range, or to leave room at the end
+		if (depth > 0 && (pick < 4 || i - open[depth - 1] > 30000 || left <= depth)) {
+			depth--;
+			words[i] = DOM_BENCH_BNE((int32_t)open[depth] - (int32_t)i - 1);
+		}
+		else if (pick < 6 && depth < DOM_BENCH_DEPTH && left > depth + 2) {
+			open[depth++] = i;
+		}
+		else if (pick < 9 && left > depth + 10) {
+			// an if, skipping 1 to 8 words
+			quiet = 1 + ((seed >> 8) & 7);
+			words[i] = DOM_BENCH_BEQ(quiet);
+		}
+	}
+}
+
+/*
+	Purpose: fills words with branches to random nearby targets, which makes many irreducible regions
+	Params: uint32_t* words - the words to fill
+			uint32_t count - how many
+			uint32_t seed - the xorshift32 state to start from
+	Return: none
+*/
+static void benchRandom(uint32_t* words, uint32_t count, uint32_t seed) {
+	for (uint32_t i = 0; i < count; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		int32_t offset = (int32_t)((seed >> 8) & 2047) - 1024;
+		switch (seed & 7) {
+		case 0: { words[i] = DOM_BENCH_BEQ(offset); break; }
+		case 1: { words[i] = DOM_BENCH_BNE(offset); break; }
+		default: { words[i] = DOM_BENCH_FILL; break; }
+		}
+	}
+}
+
+/*
+	Purpose: --bench-dom mode, times dominators and loops on synthetic structured and random graphs
+	Params: int argc - number of arguments after the mode
+			char** argv - [blocks]
+	Return: int - exit code
+*/
+int benchDomMain(int argc, char** argv) {
+	uint32_t blocks = (argc > 0) ? (uint32_t)strtoul(argv[0], NULL, 0) : DOM_BENCH_BLOCKS;
+	if (blocks == 0 || blocks > (1u << 28)) {
+		error("--bench-dom needs a block count from 1 to 268435456");
+		return 1;
+	}
+
+	// both shapes average about one branch and two blocks every four words
+	uint32_t count = blocks * 2;
+	uint32_t* words = malloc((size_t)count * sizeof(uint32_t));
+	if (words == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+
+	static const char* names[2] = { "structured", "random" };
+	printf("%-12s %10s %10s %9s %6s %7s %12s %12s %12s %10s\n", "Graph", "Blocks", "Edges", "Loops", "Depth", "Passes",
+		"CFG (s)", "Dom (s)", "Loops (s)", "M blocks/s");
+	for (int shape = 0; shape < 2; shape++) {
+		if (shape == 0) {
+			benchStructured(words, count, 0x2545F491);
+		}
+		else {
+			benchRandom(words, count, 0x2545F491);
+		}
+
+		Cfg cfg;
+		Cfg_Stats cfg_stats;
+		if (cfgBuild(&cfg, words, count, TEXT_BASE, 0, &cfg_stats) != 0) {
+			free(words);
+			return 1;
+		}
+
+		// the best of three builds
+		Dom dom;
+		Dom_Stats stats;
+		Dom_Stats best;
+		for (int rep = 0; rep < 3; rep++) {
+			if (domBuild(&dom, &cfg, &stats) != 0) {
+				cfgFree(&cfg);
+				free(words);
+				return 1;
+			}
+			if (rep == 0 || stats.time < best.time) {
+				best = stats;
+			}
+			if (rep < 2) {
+				domFree(&dom);
+			}
+		}
+
+		printf("%-12s %10u %10u %9u %6u %7u %12.6f %12.6f %12.6f %10.1f\n", names[shape], cfg.block_count,
+			cfg.edge_count, dom.loop_count, dom.max_depth, best.passes, cfg_stats.time,
+			best.order_time + best.dom_time + best.tree_time, best.loop_time,
+			best.time > 0 ? cfg.block_count / best.time / 1e6 : 0.0);
+
+		domFree(&dom);
+		cfgFree(&cfg);
+	}
+
+	free(words);
+	return 0;
+}
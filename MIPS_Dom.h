@@ -0,0 +1,135 @@
+#ifndef _MIPS_DOM_H_
+#define _MIPS_DOM_H_
+
+#include <stdint.h>
+#include "MIPS_Cfg.h"
+
+/*
+	Dominator tree and natural loops of a control flow graph.
+
+	Blocks are numbered in postorder by a depth first search from block 0,
+	then from each block not reached yet in address order. Every search
+	root hangs off a virtual root, so blocks block 0 cannot reach still get
+	a dominator tree. Immediate dominators come from the iterative
+	Cooper-Harvey-Kennedy method over those numbers, and a walk of the tree
+	gives each block an enter/leave interval so a dominance check is two
+	compares.
+
+	An edge whose target dominates its source is a back edge and the target
+	is a loop header. All back edges into one header make one natural loop.
+	Headers are visited inner first, and each walks its body backwards from
+	its latches. A block already in an inner loop stands for that whole
+	loop, found through a union-find over headers, which becomes a child of
+	the current one. Retreating edges whose target does not dominate the
+	source make irreducible regions and are only counted.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// no block, the dominator of a search root and the loop of a block in none
+#define DOM_NONE 0xFFFFFFFFu
+
+// blocks --bench-dom builds by default
+#define DOM_BENCH_BLOCKS (4u << 20)
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what a build found and how long each step took
+typedef struct {
+	double order_time;
+	double dom_time;
+	double tree_time;
+	double loop_time;
+	double time;
+	uint32_t passes;
+	uint32_t roots;
+	uint32_t back_edges;
+	uint32_t irreducible;
+} Dom_Stats;
+
+// the dominator tree and loops of a graph
+typedef struct {
+	const Cfg* cfg;
+
+	// blocks in postorder, and each block's place in it
+	uint32_t* order;
+	uint32_t* position;
+
+	// CSR predecessors
+	uint32_t* pred_start;
+	uint32_t* preds;
+
+	// per block, the immediate dominator and the block's interval in the tree
+	uint32_t* idom;
+	uint32_t* enter;
+	uint32_t* leave;
+
+	// per block, the innermost loop header, and for headers the loop around it
+	uint32_t* loop_header;
+	uint32_t* loop_parent;
+	uint32_t* loop_depth;
+	uint32_t* loop_size;
+	uint32_t loop_count;
+	uint32_t max_depth;
+} Dom;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: builds the dominator tree and the loops of a graph
+	Params: Dom* dom - the result to fill
+			const Cfg* cfg - the graph, kept by the result
+			Dom_Stats* stats - filled with the step times and counts
+	Return: int - 0 for no error
+*/
+int domBuild(Dom* dom, const Cfg* cfg, Dom_Stats* stats);
+
+/*
+	Purpose: releases a result
+	Params: Dom* dom - the result
+	Return: none
+*/
+void domFree(Dom* dom);
+
+/*
+	Purpose: checks whether one block dominates another, every block dominates itself
+	Params: const Dom* dom - the result
+			uint32_t a - the block that may dominate
+			uint32_t b - the block that may be dominated
+	Return: int - 1 if a dominates b
+*/
+int domDominates(const Dom* dom, uint32_t a, uint32_t b);
+
+/*
+	Purpose: gets how many loops a block is in
+	Params: const Dom* dom - the result
+			uint32_t block - the block
+	Return: uint32_t - the loop depth, 0 outside every loop
+*/
+uint32_t domLoopDepth(const Dom* dom, uint32_t block);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --loops mode, finds the loops of an image's .text, reports them and optionally lists them
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int domMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-dom mode, times dominators and loops on synthetic structured and random graphs
+	Params: int argc - number of arguments after the mode
+			char** argv - [blocks]
+	Return: int - exit code
+*/
+int benchDomMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,256 @@
+#include <string.h>
+#include "MIPS_Elf.h"
+
+/*----------------------------\
+		   Bytes
+\----------------------------*/
+/*
+	Purpose: stores a 16 bit value in the given byte order
+	Params: uint8_t* p - where to store it
+			uint16_t value - the value
+			int big - big endian when set
+	Return: none
+*/
+void elfPut16(uint8_t* p, uint16_t value, int big) {
+	if (big) {
+		p[0] = (uint8_t)(value >> 8);
+		p[1] = (uint8_t)value;
+	}
+	else {
+		p[0] = (uint8_t)value;
+		p[1] = (uint8_t)(value >> 8);
+	}
+}
+
+/*
+	Purpose: stores a 32 bit value in the given byte order
+	Params: uint8_t* p - where to store it
+			uint32_t value - the value
+			int big - big endian when set
+	Return: none
+*/
+void elfPut32(uint8_t* p, uint32_t value, int big) {
+	if (big) {
+		p[0] = (uint8_t)(value >> 24);
+		p[1] = (uint8_t)(value >> 16);
+		p[2] = (uint8_t)(value >> 8);
+		p[3] = (uint8_t)value;
+	}
+	else {
+		p[0] = (uint8_t)value;
+		p[1] = (uint8_t)(value >> 8);
+		p[2] = (uint8_t)(value >> 16);
+		p[3] = (uint8_t)(value >> 24);
+	}
+}
+
+/*
+	Purpose: reads a 16 bit value in the given byte order
+	Params: const uint8_t* p - where to read it
+			int big - big endian when set
+	Return: uint16_t - the value
+*/
+uint16_t elfGet16(const uint8_t* p, int big) {
+	return big ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)((p[1] << 8) | p[0]);
+}
+
+/*
+	Purpose: reads a 32 bit value in the given byte order
+	Params: const uint8_t* p - where to read it
+			int big - big endian when set
+	Return: uint32_t - the value
+*/
+uint32_t elfGet32(const uint8_t* p, int big) {
+	if (big) {
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+	return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+
+/*----------------------------\
+		   Packing
+\----------------------------*/
+/*
+	Purpose: packs a file header, filling e_ident for a 32 bit file of the given byte order
+	Params: uint8_t* out - ELF32_EHDR_SIZE bytes
+			const Elf_Header* h - the header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackHeader(uint8_t* out, const Elf_Header* h, int big) {
+	memset(out, 0, ELF32_EHDR_SIZE);
+	out[0] = 0x7F;
+	out[1] = 'E';
+	out[2] = 'L';
+	out[3] = 'F';
+	out[4] = ELF_CLASS32;
+	out[5] = big ? ELF_DATA_MSB : ELF_DATA_LSB;
+	out[6] = ELF_VERSION;
+
+	elfPut16(out + 16, h->type, big);
+	elfPut16(out + 18, h->machine, big);
+	elfPut32(out + 20, ELF_VERSION, big);
+	elfPut32(out + 24, h->entry, big);
+	elfPut32(out + 28, h->phoff, big);
+	elfPut32(out + 32, h->shoff, big);
+	elfPut32(out + 36, h->flags, big);
+	elfPut16(out + 40, ELF32_EHDR_SIZE, big);
+	elfPut16(out + 42, h->phnum ? ELF32_PHDR_SIZE : 0, big);
+	elfPut16(out + 44, h->phnum, big);
+	elfPut16(out + 46, ELF32_SHDR_SIZE, big);
+	elfPut16(out + 48, h->shnum, big);
+	elfPut16(out + 50, h->shstrndx, big);
+}
+
+/*
+	Purpose: packs a program header
+	Params: uint8_t* out - ELF32_PHDR_SIZE bytes
+			const Elf_Segment* s - the program header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSegment(uint8_t* out, const Elf_Segment* s, int big) {
+	// physical addresses are the same as virtual ones
+	elfPut32(out + 0, s->type, big);
+	elfPut32(out + 4, s->offset, big);
+	elfPut32(out + 8, s->vaddr, big);
+	elfPut32(out + 12, s->vaddr, big);
+	elfPut32(out + 16, s->filesz, big);
+	elfPut32(out + 20, s->memsz, big);
+	elfPut32(out + 24, s->flags, big);
+	elfPut32(out + 28, s->align, big);
+}
+
+/*
+	Purpose: packs a section header
+	Params: uint8_t* out - ELF32_SHDR_SIZE bytes
+			const Elf_Section* s - the section header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSection(uint8_t* out, const Elf_Section* s, int big) {
+	elfPut32(out + 0, s->name, big);
+	elfPut32(out + 4, s->type, big);
+	elfPut32(out + 8, s->flags, big);
+	elfPut32(out + 12, s->addr, big);
+	elfPut32(out + 16, s->offset, big);
+	elfPut32(out + 20, s->size, big);
+	elfPut32(out + 24, s->link, big);
+	elfPut32(out + 28, s->info, big);
+	elfPut32(out + 32, s->align, big);
+	elfPut32(out + 36, s->entsize, big);
+}
+
+/*
+	Purpose: packs a symbol table entry
+	Params: uint8_t* out - ELF32_SYM_SIZE bytes
+			const Elf_Symbol* s - the symbol
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSymbol(uint8_t* out, const Elf_Symbol* s, int big) {
+	elfPut32(out + 0, s->name, big);
+	elfPut32(out + 4, s->value, big);
+	elfPut32(out + 8, s->size, big);
+	out[12] = s->info;
+	out[13] = s->other;
+	elfPut16(out + 14, s->shndx, big);
+}
+
+/*
+	Purpose: packs a relocation
+	Params: uint8_t* out - ELF32_REL_SIZE bytes
+			const Elf_Rel* r - the relocation
+			int big - big endian when set
+	Return: none
+*/
+void elfPackRel(uint8_t* out, const Elf_Rel* r, int big) {
+	elfPut32(out + 0, r->offset, big);
+	elfPut32(out + 4, r->info, big);
+}
+
+
+/*----------------------------\
+		   Unpacking
+\----------------------------*/
+/*
+	Purpose: checks and unpacks a 32 bit MIPS file header, finding its byte order from e_ident
+	Params: const uint8_t* in - ELF32_EHDR_SIZE bytes
+			Elf_Header* h - the header to fill
+			int* big - set for a big endian file
+	Return: int - 0 for a 32 bit MIPS ELF file
+*/
+int elfUnpackHeader(const uint8_t* in, Elf_Header* h, int* big) {
+	if (in[0] != 0x7F || in[1] != 'E' || in[2] != 'L' || in[3] != 'F' || in[4] != ELF_CLASS32) {
+		return 1;
+	}
+	if (in[5] != ELF_DATA_LSB && in[5] != ELF_DATA_MSB) {
+		return 1;
+	}
+	*big = (in[5] == ELF_DATA_MSB);
+
+	h->type = elfGet16(in + 16, *big);
+	h->machine = elfGet16(in + 18, *big);
+	h->entry = elfGet32(in + 24, *big);
+	h->phoff = elfGet32(in + 28, *big);
+	h->shoff = elfGet32(in + 32, *big);
+	h->flags = elfGet32(in + 36, *big);
+	h->phnum = elfGet16(in + 44, *big);
+	h->shnum = elfGet16(in + 48, *big);
+	h->shstrndx = elfGet16(in + 50, *big);
+
+	// the sizes are fixed for ELF32, anything else is not a file this reader understands
+	if (h->machine != ELF_EM_MIPS || (h->shnum > 0 && elfGet16(in + 46, *big) != ELF32_SHDR_SIZE)) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+	Purpose: unpacks a section header
+	Params: const uint8_t* in - ELF32_SHDR_SIZE bytes
+			Elf_Section* s - the section header to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackSection(const uint8_t* in, Elf_Section* s, int big) {
+	s->name = elfGet32(in + 0, big);
+	s->type = elfGet32(in + 4, big);
+	s->flags = elfGet32(in + 8, big);
+	s->addr = elfGet32(in + 12, big);
+	s->offset = elfGet32(in + 16, big);
+	s->size = elfGet32(in + 20, big);
+	s->link = elfGet32(in + 24, big);
+	s->info = elfGet32(in + 28, big);
+	s->align = elfGet32(in + 32, big);
+	s->entsize = elfGet32(in + 36, big);
+}
+
+/*
+	Purpose: unpacks a symbol table entry
+	Params: const uint8_t* in - ELF32_SYM_SIZE bytes
+			Elf_Symbol* s - the symbol to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackSymbol(const uint8_t* in, Elf_Symbol* s, int big) {
+	s->name = elfGet32(in + 0, big);
+	s->value = elfGet32(in + 4, big);
+	s->size = elfGet32(in + 8, big);
+	s->info = in[12];
+	s->other = in[13];
+	s->shndx = elfGet16(in + 14, big);
+}
+
+/*
+	Purpose: unpacks a relocation
+	Params: const uint8_t* in - ELF32_REL_SIZE bytes
+			Elf_Rel* r - the relocation to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackRel(const uint8_t* in, Elf_Rel* r, int big) {
+	r->offset = elfGet32(in + 0, big);
+	r->info = elfGet32(in + 4, big);
+}
@@ -0,0 +1,259 @@
+#ifndef _MIPS_ELF_H_
+#define _MIPS_ELF_H_
+
+#include <stdint.h>
+
+/*
+	The parts of ELF32 the object writer and loader need, kept here
+	instead of <elf.h> so the layout does not depend on the host.
+	Structures are held in host form and packed into file bytes in either
+	byte order, so a big endian object is handled the same way on any host.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// sizes of the structures as they are laid out in a file
+#define ELF32_EHDR_SIZE 52
+#define ELF32_PHDR_SIZE 32
+#define ELF32_SHDR_SIZE 40
+#define ELF32_SYM_SIZE 16
+#define ELF32_REL_SIZE 8
+
+// e_ident
+#define ELF_CLASS32 1
+#define ELF_DATA_LSB 1
+#define ELF_DATA_MSB 2
+#define ELF_VERSION 1
+
+// e_type and e_machine
+#define ELF_ET_REL 1
+#define ELF_ET_EXEC 2
+#define ELF_EM_MIPS 8
+
+// e_flags, plain MIPS I code with no reordering by later tools
+#define ELF_EF_MIPS_NOREORDER 0x00000001u
+#define ELF_EF_MIPS_ABI_O32 0x00001000u
+
+// section types and flags
+#define ELF_SHT_NULL 0
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_STRTAB 3
+#define ELF_SHT_NOBITS 8
+#define ELF_SHT_REL 9
+#define ELF_SHF_WRITE 0x1u
+#define ELF_SHF_ALLOC 0x2u
+#define ELF_SHF_EXECINSTR 0x4u
+#define ELF_SHF_INFO_LINK 0x40u
+
+// symbol binding, type and special sections
+#define ELF_STB_LOCAL 0
+#define ELF_STB_GLOBAL 1
+#define ELF_STT_NOTYPE 0
+#define ELF_STT_SECTION 3
+#define ELF_SHN_UNDEF 0
+#define ELF_ST_INFO(bind, type) ((uint8_t)(((bind) << 4) | ((type) & 0xF)))
+#define ELF_ST_BIND(info) ((info) >> 4)
+
+// MIPS relocation types, all REL with the addend kept in the field
+#define ELF_R_MIPS_NONE 0
+#define ELF_R_MIPS_32 2
+#define ELF_R_MIPS_HI16 5
+#define ELF_R_MIPS_LO16 6
+#define ELF_R_MIPS_PC16 10
+#define ELF_R_INFO(sym, type) (((uint32_t)(sym) << 8) | ((type) & 0xFF))
+#define ELF_R_SYM(info) ((info) >> 8)
+#define ELF_R_TYPE(info) ((info) & 0xFF)
+
+// program headers
+#define ELF_PT_LOAD 1
+#define ELF_PF_X 0x1u
+#define ELF_PF_W 0x2u
+#define ELF_PF_R 0x4u
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// file header, e_ident is filled from the byte order when packed
+typedef struct {
+	uint16_t type;
+	uint16_t machine;
+	uint32_t entry;
+	uint32_t phoff;
+	uint32_t shoff;
+	uint32_t flags;
+	uint16_t phnum;
+	uint16_t shnum;
+	uint16_t shstrndx;
+} Elf_Header;
+
+// program header
+typedef struct {
+	uint32_t type;
+	uint32_t offset;
+	uint32_t vaddr;
+	uint32_t filesz;
+	uint32_t memsz;
+	uint32_t flags;
+	uint32_t align;
+} Elf_Segment;
+
+// section header
+typedef struct {
+	uint32_t name;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t addr;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t link;
+	uint32_t info;
+	uint32_t align;
+	uint32_t entsize;
+} Elf_Section;
+
+// symbol table entry
+typedef struct {
+	uint32_t name;
+	uint32_t value;
+	uint32_t size;
+	uint8_t info;
+	uint8_t other;
+	uint16_t shndx;
+} Elf_Symbol;
+
+// relocation without an addend
+typedef struct {
+	uint32_t offset;
+	uint32_t info;
+} Elf_Rel;
+
+
+/*----------------------------\
+		   Bytes
+\----------------------------*/
+/*
+	Purpose: stores a 16 bit value in the given byte order
+	Params: uint8_t* p - where to store it
+			uint16_t value - the value
+			int big - big endian when set
+	Return: none
+*/
+void elfPut16(uint8_t* p, uint16_t value, int big);
+
+/*
+	Purpose: stores a 32 bit value in the given byte order
+	Params: uint8_t* p - where to store it
+			uint32_t value - the value
+			int big - big endian when set
+	Return: none
+*/
+void elfPut32(uint8_t* p, uint32_t value, int big);
+
+/*
+	Purpose: reads a 16 bit value in the given byte order
+	Params: const uint8_t* p - where to read it
+			int big - big endian when set
+	Return: uint16_t - the value
+*/
+uint16_t elfGet16(const uint8_t* p, int big);
+
+/*
+	Purpose: reads a 32 bit value in the given byte order
+	Params: const uint8_t* p - where to read it
+			int big - big endian when set
+	Return: uint32_t - the value
+*/
+uint32_t elfGet32(const uint8_t* p, int big);
+
+
+/*----------------------------\
+		   Packing
+\----------------------------*/
+/*
+	Purpose: packs a file header, filling e_ident for a 32 bit file of the given byte order
+	Params: uint8_t* out - ELF32_EHDR_SIZE bytes
+			const Elf_Header* h - the header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackHeader(uint8_t* out, const Elf_Header* h, int big);
+
+/*
+	Purpose: packs a program header
+	Params: uint8_t* out - ELF32_PHDR_SIZE bytes
+			const Elf_Segment* s - the program header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSegment(uint8_t* out, const Elf_Segment* s, int big);
+
+/*
+	Purpose: packs a section header
+	Params: uint8_t* out - ELF32_SHDR_SIZE bytes
+			const Elf_Section* s - the section header
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSection(uint8_t* out, const Elf_Section* s, int big);
+
+/*
+	Purpose: packs a symbol table entry
+	Params: uint8_t* out - ELF32_SYM_SIZE bytes
+			const Elf_Symbol* s - the symbol
+			int big - big endian when set
+	Return: none
+*/
+void elfPackSymbol(uint8_t* out, const Elf_Symbol* s, int big);
+
+/*
+	Purpose: packs a relocation
+	Params: uint8_t* out - ELF32_REL_SIZE bytes
+			const Elf_Rel* r - the relocation
+			int big - big endian when set
+	Return: none
+*/
+void elfPackRel(uint8_t* out, const Elf_Rel* r, int big);
+
+
+/*----------------------------\
+		   Unpacking
+\----------------------------*/
+/*
+	Purpose: checks and unpacks a 32 bit MIPS file header, finding its byte order from e_ident
+	Params: const uint8_t* in - ELF32_EHDR_SIZE bytes
+			Elf_Header* h - the header to fill
+			int* big - set for a big endian file
+	Return: int - 0 for a 32 bit MIPS ELF file
+*/
+int elfUnpackHeader(const uint8_t* in, Elf_Header* h, int* big);
+
+/*
+	Purpose: unpacks a section header
+	Params: const uint8_t* in - ELF32_SHDR_SIZE bytes
+			Elf_Section* s - the section header to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackSection(const uint8_t* in, Elf_Section* s, int big);
+
+/*
+	Purpose: unpacks a symbol table entry
+	Params: const uint8_t* in - ELF32_SYM_SIZE bytes
+			Elf_Symbol* s - the symbol to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackSymbol(const uint8_t* in, Elf_Symbol* s, int big);
+
+/*
+	Purpose: unpacks a relocation
+	Params: const uint8_t* in - ELF32_REL_SIZE bytes
+			Elf_Rel* r - the relocation to fill
+			int big - big endian when set
+	Return: none
+*/
+void elfUnpackRel(const uint8_t* in, Elf_Rel* r, int big);
+
+#endif
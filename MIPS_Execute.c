@@ -0,0 +1,1092 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Trace.h"
+#include "MIPS_Util.h"
+
+// line length accepted by the program loader
+#define LINE_SIZE 256
+
+// runs per configuration in the benchmarks, the fastest is kept
+#define BENCH_REPS 5
+
+// options given in front of the program name
+typedef struct {
+	uint64_t budget;
+	Mem_Watch watches[MEM_MAX_WATCHES];
+	uint32_t watch_count;
+} Run_Options;
+
+/*----------------------------\
+		   Loading
+\----------------------------*/
+/*
+	Purpose: assembles a program file, one instruction per line, ';' starts a comment
+	Params: const char* path - the file to assemble
+			uint32_t* count - filled with the number of words
+	Return: uint32_t* - the malloc'd program words, NULL on error
+*/
+uint32_t* loadProgram(const char* path, uint32_t* count) {
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		perror(path);
+		return NULL;
+	}
+
+	uint32_t size = 64;
+	uint32_t* words = malloc(size * sizeof(uint32_t));
+	char line[LINE_SIZE];
+	int line_num = 0;
+
+	*count = 0;
+
+	while (words != NULL && fgets(line, LINE_SIZE, file) != NULL) {
+		line_num++;
+
+		// strips comments and the line ending
+		line[strcspn(line, ";\r\n")] = '\0';
+
+		// skips leading whitespace and blank lines
+		char* text = line;
+		while (*text == ' ' || *text == '\t') { text++; }
+		if (*text == '\0') {
+			continue;
+		}
+
+		// tries to parse and encode the instruction
+		parseAssem(text);
+		if (state == NO_ERROR) {
+			encode();
+		}
+
+		if (state != COMPLETE_ENCODE) {
+			printf("%s:%d: ", path, line_num);
+			printResult();
+			free(words);
+			words = NULL;
+			break;
+		}
+
+		// grows the word list as needed
+		if (*count == size) {
+			size *= 2;
+			uint32_t* grown = realloc(words, size * sizeof(uint32_t));
+			if (grown == NULL) {
+				free(words);
+				words = NULL;
+				break;
+			}
+			words = grown;
+		}
+
+		words[(*count)++] = instruct;
+	}
+
+	fclose(file);
+	return words;
+}
+
+/*
+	Purpose: writes program words back out as source loadProgram reads, one instruction per line
+	Params: const char* path - the file to write
+			const uint32_t* words - the program words
+			uint32_t count - the number of words
+	Return: int - 0 for no error
+*/
+int saveProgram(const char* path, const uint32_t* words, uint32_t count) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		Decoded_Instruct d;
+		char text[ASSM_TEXT_SIZE];
+		decodeWord(words[i], &d);
+		formatAssm(text, &d);
+		fprintf(file, "%s\n", text);
+	}
+
+	int failed = (ferror(file) != 0);
+	failed |= (fclose(file) != 0);
+	if (failed) {
+		perror(path);
+	}
+	return failed;
+}
+
+/*
+	Purpose: sets up a machine to run the given program from its first word
+	Params: Machine* m - the machine to set up
+			const uint32_t* text - the program words, must outlive the machine
+			uint32_t count - the number of words
+	Return: int - 0 for no error
+*/
+int machineInit(Machine* m, const uint32_t* text, uint32_t count) {
+	memset(m, 0, sizeof(*m));
+	memInit(&m->mem);
+
+	m->text_base = TEXT_BASE;
+	m->text_words = count;
+	m->text = text;
+	m->status = NO_ERROR;
+	m->fuse = 1;
+	m->use_blocks = 1;
+	m->budget = UINT64_MAX;
+
+	// predecodes the whole program once, blocks are built as they are reached
+	m->code = malloc((count + 1) * sizeof(Decoded_Instruct));
+	m->blocks = calloc(count + 1, sizeof(Exec_Block*));
+	if (m->code == NULL || m->blocks == NULL) {
+		error("Out of memory");
+		free(m->code);
+		free(m->blocks);
+		m->code = NULL;
+		m->blocks = NULL;
+		return 1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		decodeWord(text[i], &m->code[i]);
+	}
+
+	// starting registers
+	m->arch.pc = m->text_base;
+	m->arch.reg[REG_GP] = GLOBAL_PTR;
+	m->arch.reg[REG_SP] = STACK_TOP;
+
+	return 0;
+}
+
+/*
+	Purpose: releases everything held by a machine
+	Params: Machine* m - the machine to release
+	Return: none
+*/
+void machineFree(Machine* m) {
+	memFree(&m->mem);
+
+	if (m->blocks != NULL) {
+		for (uint32_t i = 0; i < m->text_words; i++) {
+			free(m->blocks[i]);
+		}
+	}
+	free(m->blocks);
+	m->blocks = NULL;
+
+	free(m->code);
+	m->code = NULL;
+}
+
+/*
+	Purpose: reads up to four integer arguments into $a0-$a3
+	Params: Machine* m - the machine to set up
+			int argc - number of arguments
+			char** argv - the arguments
+	Return: none
+*/
+void machineArgs(Machine* m, int argc, char** argv) {
+	for (int i = 0; i < argc && i < 4; i++) {
+		m->arch.reg[REG_A0 + i] = (uint32_t)strtoll(argv[i], NULL, 0);
+	}
+}
+
+
+/*----------------------------\
+		   Execution
+\----------------------------*/
+/*
+	Purpose: the interpreter loop, tracing is a constant so each caller gets its own copy
+	Params: Machine* m - the machine to run
+			const int tracing - records every retired instruction when set
+	Return: uint16_t - the final status
+*/
+static inline uint16_t execLoop(Machine* m, const int tracing) {
+	Arch_State* a = &m->arch;
+	uint32_t* reg = a->reg;
+	const Decoded_Instruct* code = m->code;
+	const uint32_t base = m->text_base;
+	const uint32_t words = m->text_words;
+	uint64_t budget = m->budget;
+	uint16_t status = NO_ERROR;
+
+	while (status == NO_ERROR) {
+		uint32_t index = (a->pc - base) >> 2;
+
+		// running off the end of the text is a normal exit
+		if (index >= words || (a->pc & 3) != 0) {
+			status = (a->pc == base + words * 4) ? COMPLETE_RUN : INVALID_PC;
+			break;
+		}
+		if (budget == 0) {
+			status = BUDGET_EXHAUSTED;
+			break;
+		}
+
+		const Decoded_Instruct* d = &code[index];
+		uint32_t next = a->pc + 4;
+
+		switch (d->op) {
+		case OP_ADD: { reg[d->rd] = reg[d->rs] + reg[d->rt]; break; }
+		case OP_SUB: { reg[d->rd] = reg[d->rs] - reg[d->rt]; break; }
+		case OP_AND: { reg[d->rd] = reg[d->rs] & reg[d->rt]; break; }
+		case OP_OR: { reg[d->rd] = reg[d->rs] | reg[d->rt]; break; }
+		case OP_SLT: { reg[d->rd] = (int32_t)reg[d->rs] < (int32_t)reg[d->rt]; break; }
+		case OP_ADDI: { reg[d->rt] = reg[d->rs] + SIGN_EXT16(d->imm); break; }
+		case OP_ANDI: { reg[d->rt] = reg[d->rs] & d->imm; break; }
+		case OP_ORI: { reg[d->rt] = reg[d->rs] | d->imm; break; }
+		case OP_SLTI: { reg[d->rt] = (int32_t)reg[d->rs] < (int32_t)SIGN_EXT16(d->imm); break; }
+		case OP_LUI: { reg[d->rt] = (uint32_t)d->imm << 16; break; }
+		case OP_MFHI: { reg[d->rd] = a->hi; break; }
+		case OP_MFLO: { reg[d->rd] = a->lo; break; }
+		case OP_MULT: {
+			int64_t product = (int64_t)(int32_t)reg[d->rs] * (int32_t)reg[d->rt];
+			a->hi = (uint32_t)((uint64_t)product >> 32);
+			a->lo = (uint32_t)product;
+			break;
+		}
+		case OP_DIV: {
+			int32_t n = (int32_t)reg[d->rs];
+			int32_t q = (int32_t)reg[d->rt];
+
+			// the result of a divide by zero is unpredictable, HI/LO are left alone
+			if (q == 0) {
+				break;
+			}
+			if (n == INT32_MIN && q == -1) {
+				a->lo = (uint32_t)n;
+				a->hi = 0;
+				break;
+			}
+			a->lo = (uint32_t)(n / q);
+			a->hi = (uint32_t)(n % q);
+			break;
+		}
+		case OP_LW: {
+			uint32_t addr = reg[d->rs] + SIGN_EXT16(d->imm);
+			if ((addr & 3) != 0) {
+				status = UNALIGNED_ACCESS;
+				continue;
+			}
+			// watched pages are never in the fast table, a hit still retires the load
+			uint32_t* page = memPage(&m->mem, addr);
+			if (page != NULL) {
+				reg[d->rt] = page[MEM_WORD_INDEX(addr)];
+			}
+			else if (memReadSlow(&m->mem, addr, &reg[d->rt])) {
+				status = WATCHPOINT_HIT;
+			}
+			break;
+		}
+		case OP_SW: {
+			uint32_t addr = reg[d->rs] + SIGN_EXT16(d->imm);
+			if ((addr & 3) != 0) {
+				status = UNALIGNED_ACCESS;
+				continue;
+			}
+			uint32_t* page = memPage(&m->mem, addr);
+			if (page != NULL) {
+				page[MEM_WORD_INDEX(addr)] = reg[d->rt];
+			}
+			else {
+				// a store that cannot be kept stops the run rather than being lost
+				int slow = memWriteSlow(&m->mem, addr, reg[d->rt]);
+				if (slow == MEM_NO_PAGE) {
+					status = OUT_OF_MEMORY;
+					continue;
+				}
+				if (slow == MEM_WATCH_HIT) {
+					status = WATCHPOINT_HIT;
+				}
+			}
+			break;
+		}
+		case OP_BEQ: {
+			if (reg[d->rs] == reg[d->rt]) {
+				next += SIGN_EXT16(d->imm) << 2;
+			}
+			break;
+		}
+		case OP_BNE: {
+			if (reg[d->rs] != reg[d->rt]) {
+				next += SIGN_EXT16(d->imm) << 2;
+			}
+			break;
+		}
+		default: {
+			status = UNRECOGNIZED_COMMAND;
+			continue;
+		}
+		}
+
+		// $zero always reads as zero, whatever was written
+		reg[0] = 0;
+		a->pc = next;
+		m->retired++;
+		budget--;
+
+		if (tracing) {
+			traceRecord(m->trace, d, a);
+		}
+	}
+
+	m->budget = budget;
+	return status;
+}
+
+/*
+	Purpose: checks if two decoded words form one of the fused pairs
+	Params: const Decoded_Instruct* first - the earlier word
+			const Decoded_Instruct* second - the word after it
+	Return: int - the fused op, 0 if the pair does not fuse
+*/
+static int fusedOp(const Decoded_Instruct* first, const Decoded_Instruct* second) {
+	// LUI+ORI building a 32 bit constant
+	if (first->op == OP_LUI && second->op == OP_ORI && second->rs == first->rt && first->rt != 0) {
+		return XOP_LUI_ORI;
+	}
+
+	// MULT then reading the low half
+	if (first->op == OP_MULT && second->op == OP_MFLO) {
+		return XOP_MULT_MFLO;
+	}
+
+	// compare then branch
+	if (first->op == OP_SLT && second->op == OP_BNE) {
+		return XOP_SLT_BNE;
+	}
+
+	return 0;
+}
+
+/*
+	Purpose: builds the cached block starting at a word, fusing pairs when enabled
+	Params: Machine* m - the machine to build for
+			uint32_t start - the entry word index
+	Return: Exec_Block* - the new block, NULL if out of memory
+*/
+static Exec_Block* buildBlock(Machine* m, uint32_t start) {
+	// the block runs up to and including the first branch or invalid word
+	uint32_t end = start;
+	while (end < m->text_words && end - start < BLOCK_MAX_WORDS) {
+		uint8_t op = m->code[end++].op;
+		if (op == OP_BEQ || op == OP_BNE || op == OP_INVALID) {
+			break;
+		}
+	}
+
+	Exec_Block* b = calloc(1, sizeof(Exec_Block) + (end - start) * sizeof(Exec_Instruct));
+	if (b == NULL) {
+		return NULL;
+	}
+	b->start = start;
+	b->words = end - start;
+
+	for (uint32_t i = start; i < end; i++) {
+		const Decoded_Instruct* d = &m->code[i];
+		Exec_Instruct* e = &b->ops[b->count++];
+		uint32_t pc = m->text_base + i * 4;
+		int fused = (m->fuse && i + 1 < end) ? fusedOp(d, &m->code[i + 1]) : 0;
+
+		e->op = d->op;
+		e->rd = d->rd;
+		e->rs = d->rs;
+		e->rt = d->rt;
+		e->offset = (uint16_t)(i - start);
+
+		// immediates are extended the way each op uses them
+		switch (d->op) {
+		case OP_ANDI:
+		case OP_ORI: { e->imm = d->imm; break; }
+		case OP_LUI: { e->imm = (uint32_t)d->imm << 16; break; }
+		case OP_BEQ:
+		case OP_BNE: { e->imm = pc + 4 + (SIGN_EXT16(d->imm) << 2); break; }
+		default: { e->imm = SIGN_EXT16(d->imm); break; }
+		}
+
+		if (fused) {
+			const Decoded_Instruct* d2 = &m->code[++i];
+
+			e->op = (uint8_t)fused;
+			b->fused[fused - OP_COUNT]++;
+
+			switch (fused) {
+			case XOP_LUI_ORI: {
+				// rt gets the upper half, rt2 the whole constant
+				e->rt2 = d2->rt;
+				e->imm = ((uint32_t)d->imm << 16) | d2->imm;
+				break;
+			}
+			case XOP_MULT_MFLO: {
+				e->rd = d2->rd;
+				break;
+			}
+			case XOP_SLT_BNE: {
+				e->rs2 = d2->rs;
+				e->rt2 = d2->rt;
+				e->imm = pc + 8 + (SIGN_EXT16(d2->imm) << 2);
+				break;
+			}
+			}
+		}
+	}
+
+	m->blocks[start] = b;
+	return b;
+}
+
+/*
+	Purpose: the block cache loop, one dispatch per cached op and one lookup per block
+	Params: Machine* m - the machine to run
+	Return: uint16_t - the final status
+*/
+static uint16_t blockLoop(Machine* m) {
+	Arch_State* a = &m->arch;
+	uint32_t* reg = a->reg;
+	const uint32_t base = m->text_base;
+	const uint32_t words = m->text_words;
+
+	while (1) {
+		uint32_t index = (a->pc - base) >> 2;
+
+		// running off the end of the text is a normal exit
+		if (index >= words || (a->pc & 3) != 0) {
+			return (a->pc == base + words * 4) ? COMPLETE_RUN : INVALID_PC;
+		}
+
+		Exec_Block* b = m->blocks[index];
+		if (b == NULL) {
+			b = buildBlock(m, index);
+			if (b == NULL) {
+				return OUT_OF_MEMORY;
+			}
+		}
+
+		// one check per block, the last partial block is stepped a word at a time
+		if (b->words > m->budget) {
+			return execLoop(m, 0);
+		}
+		b->runs++;
+
+		const Exec_Instruct* e = b->ops;
+		const Exec_Instruct* end = e + b->count;
+		uint32_t next = base + (b->start + b->words) * 4;
+		uint16_t fault = NO_ERROR;
+
+		for (; e < end; e++) {
+			switch (e->op) {
+			case OP_ADD: { reg[e->rd] = reg[e->rs] + reg[e->rt]; break; }
+			case OP_SUB: { reg[e->rd] = reg[e->rs] - reg[e->rt]; break; }
+			case OP_AND: { reg[e->rd] = reg[e->rs] & reg[e->rt]; break; }
+			case OP_OR: { reg[e->rd] = reg[e->rs] | reg[e->rt]; break; }
+			case OP_SLT: { reg[e->rd] = (int32_t)reg[e->rs] < (int32_t)reg[e->rt]; break; }
+			case OP_ADDI: { reg[e->rt] = reg[e->rs] + e->imm; break; }
+			case OP_ANDI: { reg[e->rt] = reg[e->rs] & e->imm; break; }
+			case OP_ORI: { reg[e->rt] = reg[e->rs] | e->imm; break; }
+			case OP_SLTI: { reg[e->rt] = (int32_t)reg[e->rs] < (int32_t)e->imm; break; }
+			case OP_LUI: { reg[e->rt] = e->imm; break; }
+			case OP_MFHI: { reg[e->rd] = a->hi; break; }
+			case OP_MFLO: { reg[e->rd] = a->lo; break; }
+			case OP_MULT: {
+				int64_t product = (int64_t)(int32_t)reg[e->rs] * (int32_t)reg[e->rt];
+				a->hi = (uint32_t)((uint64_t)product >> 32);
+				a->lo = (uint32_t)product;
+				break;
+			}
+			case OP_DIV: {
+				int32_t n = (int32_t)reg[e->rs];
+				int32_t q = (int32_t)reg[e->rt];
+
+				// the result of a divide by zero is unpredictable, HI/LO are left alone
+				if (q == 0) {
+					break;
+				}
+				if (n == INT32_MIN && q == -1) {
+					a->lo = (uint32_t)n;
+					a->hi = 0;
+					break;
+				}
+				a->lo = (uint32_t)(n / q);
+				a->hi = (uint32_t)(n % q);
+				break;
+			}
+			case OP_LW: {
+				uint32_t addr = reg[e->rs] + e->imm;
+				if ((addr & 3) != 0) {
+					fault = UNALIGNED_ACCESS;
+					break;
+				}
+				// watched pages are never in the fast table, a hit still retires the load
+				uint32_t* page = memPage(&m->mem, addr);
+				if (page != NULL) {
+					reg[e->rt] = page[MEM_WORD_INDEX(addr)];
+				}
+				else if (memReadSlow(&m->mem, addr, &reg[e->rt])) {
+					fault = WATCHPOINT_HIT;
+				}
+				break;
+			}
+			case OP_SW: {
+				uint32_t addr = reg[e->rs] + e->imm;
+				if ((addr & 3) != 0) {
+					fault = UNALIGNED_ACCESS;
+					break;
+				}
+				uint32_t* page = memPage(&m->mem, addr);
+				if (page != NULL) {
+					page[MEM_WORD_INDEX(addr)] = reg[e->rt];
+				}
+				else {
+					int slow = memWriteSlow(&m->mem, addr, reg[e->rt]);
+					fault = (slow == MEM_NO_PAGE) ? OUT_OF_MEMORY : (slow == MEM_WATCH_HIT) ? WATCHPOINT_HIT : NO_ERROR;
+				}
+				break;
+			}
+			case OP_BEQ: {
+				if (reg[e->rs] == reg[e->rt]) {
+					next = e->imm;
+				}
+				break;
+			}
+			case OP_BNE: {
+				if (reg[e->rs] != reg[e->rt]) {
+					next = e->imm;
+				}
+				break;
+			}
+			case XOP_LUI_ORI: {
+				reg[e->rt] = e->imm & 0xFFFF0000;
+				reg[0] = 0;
+				reg[e->rt2] = e->imm;
+				break;
+			}
+			case XOP_MULT_MFLO: {
+				int64_t product = (int64_t)(int32_t)reg[e->rs] * (int32_t)reg[e->rt];
+				a->hi = (uint32_t)((uint64_t)product >> 32);
+				a->lo = (uint32_t)product;
+				reg[e->rd] = a->lo;
+				break;
+			}
+			case XOP_SLT_BNE: {
+				reg[e->rd] = (int32_t)reg[e->rs] < (int32_t)reg[e->rt];
+				reg[0] = 0;
+				if (reg[e->rs2] != reg[e->rt2]) {
+					next = e->imm;
+				}
+				break;
+			}
+			default: {
+				fault = UNRECOGNIZED_COMMAND;
+				break;
+			}
+			}
+
+			// a faulting op stops the block with only the words before it retired, a watchpoint after its access
+			if (fault != NO_ERROR) {
+				uint32_t done = e->offset + (fault == WATCHPOINT_HIT);
+				reg[0] = 0;
+				a->pc = base + (b->start + done) * 4;
+				m->retired += done;
+				m->budget -= done;
+				return fault;
+			}
+
+			// $zero always reads as zero, whatever was written
+			reg[0] = 0;
+		}
+
+		a->pc = next;
+		m->retired += b->words;
+		m->budget -= b->words;
+	}
+}
+
+/*
+	Purpose: runs the program until it leaves the end of its text or faults
+	Params: Machine* m - the machine to run
+	Return: uint16_t - the final status, COMPLETE_RUN when the program finished
+*/
+uint16_t machineRun(Machine* m) {
+	// traced runs step one word at a time so every instruction gets a record
+	if (m->trace != NULL) {
+		m->status = execLoop(m, 1);
+	}
+	else if (!m->use_blocks) {
+		m->status = execLoop(m, 0);
+	}
+	else {
+		m->status = blockLoop(m);
+	}
+	return m->status;
+}
+
+/*
+	Purpose: runs a program to the end from fresh state, the machine is freed if it cannot be set up
+	Params: Machine* m - the machine to set up and run
+			const uint32_t* words - the program words
+			uint32_t count - how many
+			int argc - number of program arguments
+			char** argv - the program arguments
+	Return: int - 0 for no error
+*/
+int runProgram(Machine* m, const uint32_t* words, uint32_t count, int argc, char** argv) {
+	if (machineInit(m, words, count) != 0) {
+		machineFree(m);
+		return 1;
+	}
+	machineArgs(m, argc, argv);
+	machineRun(m);
+	return 0;
+}
+
+/*
+	Purpose: totals the block cache counters of a finished run
+	Params: const Machine* m - the machine that ran
+			Exec_Stats* stats - the totals to fill
+	Return: none
+*/
+void machineStats(const Machine* m, Exec_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+
+	// the per block counts are static, multiplying by the runs gives the dynamic counts
+	for (uint32_t i = 0; i < m->text_words; i++) {
+		const Exec_Block* b = m->blocks[i];
+		if (b == NULL) {
+			continue;
+		}
+
+		stats->blocks++;
+		stats->dispatches += b->runs * b->count;
+		for (int k = 0; k < FUSED_KINDS; k++) {
+			stats->fused_pairs[k] += b->runs * b->fused[k];
+			stats->fused_instructions += 2 * b->runs * b->fused[k];
+		}
+	}
+}
+
+
+/*----------------------------\
+		   Printing
+\----------------------------*/
+/*
+	Purpose: prints the program counter, HI/LO and every register
+	Params: const Arch_State* arch - the state to print
+			uint64_t retired - the number of instructions retired
+	Return: none
+*/
+void printArchState(const Arch_State* arch, uint64_t retired) {
+	printf("PC: 0x%08X\tRetired: %llu\n", arch->pc, (unsigned long long)retired);
+	printf("HI: 0x%08X\tLO: 0x%08X\n", arch->hi, arch->lo);
+
+	// four registers per line
+	for (int i = 0; i < 32; i++) {
+		printf("%-5s = 0x%08X", regName(i), arch->reg[i]);
+		printf((i % 4 == 3) ? "\n" : "\t");
+	}
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: reads the --budget and --watch options in front of the program name
+	Params: int argc - number of arguments
+			char** argv - the arguments
+			Run_Options* opts - the options to fill
+	Return: int - the number of arguments used, -1 on error
+*/
+static int parseRunOptions(int argc, char** argv, Run_Options* opts) {
+	int used = 0;
+
+	memset(opts, 0, sizeof(*opts));
+	opts->budget = UINT64_MAX;
+
+	while (used + 1 < argc && startswith(argv[used], "--")) {
+		const char* option = argv[used];
+		const char* value = argv[used + 1];
+		char* end;
+
+		if (strcmp(option, "--budget") == 0) {
+			opts->budget = strtoull(value, &end, 0);
+			if (*end != '\0') {
+				error("--budget needs a number of instructions");
+				return -1;
+			}
+		}
+		else if (strcmp(option, "--watch") == 0) {
+			if (opts->watch_count == MEM_MAX_WATCHES) {
+				error("Too many watchpoints");
+				return -1;
+			}
+
+			// addr[:r|w|rw], both kinds when no suffix is given
+			Mem_Watch* w = &opts->watches[opts->watch_count++];
+			w->addr = (uint32_t)strtoul(value, &end, 0);
+			w->kind = WATCH_READ | WATCH_WRITE;
+			if (strcmp(end, ":r") == 0) {
+				w->kind = WATCH_READ;
+			}
+			else if (strcmp(end, ":w") == 0) {
+				w->kind = WATCH_WRITE;
+			}
+			else if (*end != '\0' && strcmp(end, ":rw") != 0) {
+				error("--watch needs an address followed by :r, :w or :rw");
+				return -1;
+			}
+			if ((w->addr & 3) != 0) {
+				error("Watchpoints must be word aligned");
+				return -1;
+			}
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", option);
+			return -1;
+		}
+
+		used += 2;
+	}
+
+	return used;
+}
+
+/*
+	Purpose: sets the budget and watchpoints of a freshly set up machine
+	Params: Machine* m - the machine to set up
+			const Run_Options* opts - the options to apply
+	Return: none
+*/
+static void applyRunOptions(Machine* m, const Run_Options* opts) {
+	m->budget = opts->budget;
+	for (uint32_t i = 0; i < opts->watch_count; i++) {
+		memWatch(&m->mem, opts->watches[i].addr, opts->watches[i].kind);
+	}
+}
+
+/*
+	Purpose: places a linked ELF image in a freshly set up machine, its .text address, entry point and .data
+	Params: Machine* m - the machine, set up with the image's .text
+			const Elf_Image* image - the image
+	Return: int - 0 for no error
+*/
+static int placeImage(Machine* m, const Elf_Image* image) {
+	// a relocatable object has no addresses yet and runs where a program would
+	if (image->header.type != ELF_ET_EXEC) {
+		return 0;
+	}
+
+	m->text_base = image->text_addr;
+	m->arch.pc = image->text_addr;
+	if (image->header.entry >= image->text_addr && image->header.entry - image->text_addr < image->text_size) {
+		m->arch.pc = image->header.entry;
+	}
+
+	for (uint32_t i = 0; i < image->data_size; i += 4) {
+		if (memWriteSlow(&m->mem, image->data_addr + i, elfGet32(image->data + i, image->big)) == MEM_NO_PAGE) {
+			error("Out of memory");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+	Purpose: --run mode, assembles or maps and executes a program then prints the final state
+	Params: int argc - number of arguments after the mode
+			char** argv - [--budget N] [--watch addr[:r|w|rw]]... <prog.s|prog.elf> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int runMain(int argc, char** argv) {
+	Run_Options opts;
+	int used = parseRunOptions(argc, argv, &opts);
+	if (used < 0) {
+		return 1;
+	}
+	argc -= used;
+	argv += used;
+
+	if (argc < 1) {
+		error("--run needs a program file");
+		return 1;
+	}
+
+	// ELF files run from their mapping, anything else is assembled
+	Elf_Image image;
+	int is_elf = imageIsElf(argv[0]);
+	uint32_t* loaded = NULL;
+	const uint32_t* text;
+	uint32_t count;
+	if (is_elf) {
+		if (imageOpen(&image, argv[0]) != 0) {
+			return 1;
+		}
+		text = imageText(&image, &count);
+	}
+	else {
+		text = loaded = loadProgram(argv[0], &count);
+	}
+	if (text == NULL) {
+		if (is_elf) {
+			imageClose(&image);
+		}
+		return 1;
+	}
+
+	Machine m;
+	if (machineInit(&m, text, count) != 0 || (is_elf && placeImage(&m, &image) != 0)) {
+		machineFree(&m);
+		if (is_elf) {
+			imageClose(&image);
+		}
+		free(loaded);
+		return 1;
+	}
+	machineArgs(&m, argc - 1, argv + 1);
+	applyRunOptions(&m, &opts);
+
+	// runs the program and reports how it ended
+	state = machineRun(&m);
+	printResult();
+	if (m.status == WATCHPOINT_HIT) {
+		printf("Watchpoint: %s MEM[0x%08X] = 0x%08X\n", (m.mem.hit.kind == WATCH_READ) ? "read" : "write",
+			m.mem.hit.addr, m.mem.hit_value);
+	}
+	printArchState(&m.arch, m.retired);
+
+	// stopping on the budget or a watchpoint was asked for, so it is not a failure
+	int failed = (m.status != COMPLETE_RUN && m.status != BUDGET_EXHAUSTED && m.status != WATCHPOINT_HIT);
+	machineFree(&m);
+	if (is_elf) {
+		imageClose(&image);
+	}
+	free(loaded);
+	return failed;
+}
+
+/*
+	Purpose: runs one engine configuration a few times and keeps the fastest run
+	Params: const uint32_t* text - the program words
+			uint32_t count - the number of words
+			int argc - number of program arguments
+			char** argv - the program arguments
+			int use_blocks - runs the block cache when set
+			int fuse - fuses pairs when set
+			const Run_Options* opts - the budget and watchpoints, NULL for none
+			Machine* m - left holding the last run for its state and counters
+	Return: double - the fastest run time in seconds, -1 when the machine could not be set up
+*/
+static double benchRun(const uint32_t* text, uint32_t count, int argc, char** argv, int use_blocks, int fuse,
+	const Run_Options* opts, Machine* m) {
+	double best = 0;
+
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		if (rep > 0) {
+			machineFree(m);
+		}
+		if (machineInit(m, text, count) != 0) {
+			return -1;
+		}
+		machineArgs(m, argc, argv);
+		m->use_blocks = use_blocks;
+		m->fuse = fuse;
+		if (opts != NULL) {
+			applyRunOptions(m, opts);
+		}
+
+		double start = getTime();
+		machineRun(m);
+		double time = getTime() - start;
+
+		if (rep == 0 || time < best) {
+			best = time;
+		}
+	}
+
+	return best;
+}
+
+/*
+	Purpose: --bench-fusion mode, compares dispatch counts and run times with and without fusion
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int benchFusionMain(int argc, char** argv) {
+	if (argc < 1) {
+		error("--bench-fusion needs a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* text = loadProgram(argv[0], &count);
+	if (text == NULL) {
+		return 1;
+	}
+
+	static const char* names[3] = { "per word", "blocks", "blocks + fusion" };
+	static const char* fused_names[FUSED_KINDS] = { "LUI+ORI", "MULT+MFLO", "SLT+BNE" };
+	Machine runs[3];
+	double times[3];
+	Exec_Stats stats[3];
+
+	for (int i = 0; i < 3; i++) {
+		times[i] = benchRun(text, count, argc - 1, argv + 1, i > 0, i > 1, NULL, &runs[i]);
+		if (times[i] < 0) {
+			for (int j = 0; j <= i; j++) {
+				machineFree(&runs[j]);
+			}
+			free(text);
+			return 1;
+		}
+		machineStats(&runs[i], &stats[i]);
+	}
+
+	// the per word loop has no blocks, every retired word is a dispatch
+	stats[0].dispatches = runs[0].retired;
+
+	state = runs[2].status;
+	printResult();
+	printf("Retired: %llu\n\n", (unsigned long long)runs[2].retired);
+	printf("%-16s %14s %12s %10s\n", "Engine", "Dispatches", "Time (s)", "ns/instr");
+	for (int i = 0; i < 3; i++) {
+		printf("%-16s %14llu %12.6f %10.3f\n", names[i], (unsigned long long)stats[i].dispatches, times[i],
+			runs[i].retired ? times[i] * 1e9 / runs[i].retired : 0.0);
+	}
+
+	printf("\nFused pairs:");
+	for (int k = 0; k < FUSED_KINDS; k++) {
+		printf("  %s %llu", fused_names[k], (unsigned long long)stats[2].fused_pairs[k]);
+	}
+	printf("\nFused instructions: %llu of %llu", (unsigned long long)stats[2].fused_instructions,
+		(unsigned long long)runs[2].retired);
+	if (runs[2].retired > 0) {
+		printf(" (%.1f%%)", 100.0 * stats[2].fused_instructions / runs[2].retired);
+	}
+	printf("\nDispatch reduction: %.1f%%\tSpeedup over per word: %.2fx\n",
+		stats[0].dispatches ? 100.0 * (1.0 - (double)stats[2].dispatches / stats[0].dispatches) : 0.0,
+		times[2] > 0 ? times[0] / times[2] : 0.0);
+
+	// every configuration has to end in the same state
+	int failed = 0;
+	for (int i = 1; i < 3; i++) {
+		if (memcmp(&runs[i].arch, &runs[0].arch, sizeof(Arch_State)) != 0 || runs[i].retired != runs[0].retired ||
+			runs[i].status != runs[0].status || memChecksum(&runs[i].mem) != memChecksum(&runs[0].mem)) {
+			printf("ERROR: %s ended in a different state than per word\n", names[i]);
+			failed = 1;
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		machineFree(&runs[i]);
+	}
+	free(text);
+	return failed;
+}
+
+/*
+	Purpose: --bench-watch mode, times a program with and without a budget and watchpoints
+	Params: int argc - number of arguments after the mode
+			char** argv - [--watch addr[:r|w|rw]]... <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int benchWatchMain(int argc, char** argv) {
+	Run_Options given;
+	int used = parseRunOptions(argc, argv, &given);
+	if (used < 0) {
+		return 1;
+	}
+	argc -= used;
+	argv += used;
+
+	if (argc < 1) {
+		error("--bench-watch needs a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* text = loadProgram(argv[0], &count);
+	if (text == NULL) {
+		return 1;
+	}
+
+	// a budget that never runs out, a watch on a page nothing touches and one on the $gp page
+	static const char* names[4] = { "plain", "budget", "watch, cold page", "watch, $gp page" };
+	Run_Options opts[4];
+	for (int i = 0; i < 4; i++) {
+		memset(&opts[i], 0, sizeof(Run_Options));
+		opts[i].budget = UINT64_MAX;
+	}
+	opts[1].budget = UINT64_MAX / 2;
+	opts[2].watches[0].addr = 0xFFFFFFFC;
+	opts[2].watches[0].kind = WATCH_READ | WATCH_WRITE;
+	opts[2].watch_count = 1;
+	opts[3].watches[0].addr = GLOBAL_PTR + MEM_PAGE_SIZE - 4;
+	opts[3].watches[0].kind = WATCH_READ | WATCH_WRITE;
+	opts[3].watch_count = 1;
+
+	// watchpoints given on the command line replace the $gp page one
+	if (given.watch_count > 0) {
+		names[3] = "watch, given";
+		opts[3] = given;
+		opts[3].budget = UINT64_MAX;
+	}
+
+	// the configurations take turns so drift in the host clock hits them all alike
+	Machine runs[4];
+	double times[4];
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		for (int i = 0; i < 4; i++) {
+			if (rep > 0) {
+				machineFree(&runs[i]);
+			}
+			if (machineInit(&runs[i], text, count) != 0) {
+				// the first pass has only set up the runs up to this one
+				for (int j = 0; j < ((rep == 0) ? i + 1 : 4); j++) {
+					machineFree(&runs[j]);
+				}
+				free(text);
+				return 1;
+			}
+			machineArgs(&runs[i], argc - 1, argv + 1);
+			applyRunOptions(&runs[i], &opts[i]);
+
+			double start = getTime();
+			machineRun(&runs[i]);
+			double time = getTime() - start;
+
+			if (rep == 0 || time < times[i]) {
+				times[i] = time;
+			}
+		}
+	}
+
+	state = runs[0].status;
+	printResult();
+	printf("Retired: %llu\n\n", (unsigned long long)runs[0].retired);
+	printf("%-18s %12s %10s %10s %10s\n", "Configuration", "Time (s)", "ns/instr", "vs plain", "Pages");
+	for (int i = 0; i < 4; i++) {
+		printf("%-18s %12.6f %10.3f %9.1f%% %10u\n", names[i], times[i],
+			runs[i].retired ? times[i] * 1e9 / runs[i].retired : 0.0,
+			times[0] > 0 ? 100.0 * (times[i] - times[0]) / times[0] : 0.0, runs[i].mem.pages_mapped);
+	}
+
+	// a watchpoint that triggers ends the run early, so only runs that finished are compared
+	int failed = 0;
+	for (int i = 1; i < 4; i++) {
+		if (runs[i].status == WATCHPOINT_HIT) {
+			printf("NOTE: %s stopped on a watchpoint after %llu instructions\n", names[i],
+				(unsigned long long)runs[i].retired);
+		}
+		else if (memcmp(&runs[i].arch, &runs[0].arch, sizeof(Arch_State)) != 0 || runs[i].retired != runs[0].retired ||
+			runs[i].status != runs[0].status || memChecksum(&runs[i].mem) != memChecksum(&runs[0].mem)) {
+			printf("ERROR: %s ended in a different state than plain\n", names[i]);
+			failed = 1;
+		}
+	}
+
+	for (int i = 0; i < 4; i++) {
+		machineFree(&runs[i]);
+	}
+	free(text);
+	return failed;
+}
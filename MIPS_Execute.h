@@ -0,0 +1,222 @@
+#ifndef _MIPS_EXECUTE_H_
+#define _MIPS_EXECUTE_H_
+
+#include <stdint.h>
+#include "MIPS_Decode.h"
+#include "MIPS_Memory.h"
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// guest memory layout, matches the usual SPIM/MARS defaults
+#define TEXT_BASE 0x00400000
+#define DATA_BASE 0x10010000
+#define GLOBAL_PTR 0x10008000
+#define STACK_TOP 0x7FFFEFFC
+
+// register numbers with a fixed role
+#define REG_A0 4
+#define REG_GP 28
+#define REG_SP 29
+
+// longest straight line run kept in one cached block
+#define BLOCK_MAX_WORDS 4096
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// superinstructions, numbered after the plain ops they are built from
+typedef enum Fused_Op {
+	XOP_LUI_ORI = OP_COUNT,
+	XOP_MULT_MFLO,
+	XOP_SLT_BNE,
+	XOP_COUNT
+} Fused_Op;
+
+#define FUSED_KINDS (XOP_COUNT - OP_COUNT)
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// everything a program can observe apart from memory
+typedef struct Arch_State {
+	uint32_t pc;
+	uint32_t reg[32];
+	uint32_t hi;
+	uint32_t lo;
+} Arch_State;
+
+// one dispatch of the block engine, immediates are pre-extended and branch targets absolute
+typedef struct {
+	uint8_t op;
+	uint8_t rd;
+	uint8_t rs;
+	uint8_t rt;
+	uint8_t rs2;
+	uint8_t rt2;
+	uint16_t offset;
+	uint32_t imm;
+} Exec_Instruct;
+
+// a straight line run of the program ending at a branch, built on first entry
+typedef struct Exec_Block {
+	uint32_t start;
+	uint32_t words;
+	uint32_t count;
+	uint32_t fused[FUSED_KINDS];
+	uint64_t runs;
+	Exec_Instruct ops[];
+} Exec_Block;
+
+struct Trace_Writer;
+
+// a loaded program and the state of its run
+typedef struct Machine {
+	Arch_State arch;
+	uint64_t retired;
+	uint16_t status;
+	Guest_Memory mem;
+
+	// program text, kept apart from data memory
+	uint32_t text_base;
+	uint32_t text_words;
+	const uint32_t* text;
+	Decoded_Instruct* code;
+
+	// block cache indexed by entry word, fusion can be turned off for comparison
+	Exec_Block** blocks;
+	int fuse;
+	int use_blocks;
+
+	// instructions left before the run stops, taken off once per block
+	uint64_t budget;
+
+	// set to record every retired instruction
+	struct Trace_Writer* trace;
+} Machine;
+
+// what the block cache did over a run
+typedef struct {
+	uint64_t blocks;
+	uint64_t dispatches;
+	uint64_t fused_pairs[FUSED_KINDS];
+	uint64_t fused_instructions;
+} Exec_Stats;
+
+
+/*----------------------------\
+		   Loading
+\----------------------------*/
+/*
+	Purpose: assembles a program file, one instruction per line, ';' starts a comment
+	Params: const char* path - the file to assemble
+			uint32_t* count - filled with the number of words
+	Return: uint32_t* - the malloc'd program words, NULL on error
+*/
+uint32_t* loadProgram(const char* path, uint32_t* count);
+
+/*
+	Purpose: writes program words back out as source loadProgram reads, one instruction per line
+	Params: const char* path - the file to write
+			const uint32_t* words - the program words
+			uint32_t count - the number of words
+	Return: int - 0 for no error
+*/
+int saveProgram(const char* path, const uint32_t* words, uint32_t count);
+
+/*
+	Purpose: sets up a machine to run the given program from its first word
+	Params: Machine* m - the machine to set up
+			const uint32_t* text - the program words, must outlive the machine
+			uint32_t count - the number of words
+	Return: int - 0 for no error
+*/
+int machineInit(Machine* m, const uint32_t* text, uint32_t count);
+
+/*
+	Purpose: releases everything held by a machine
+	Params: Machine* m - the machine to release
+	Return: none
+*/
+void machineFree(Machine* m);
+
+/*
+	Purpose: reads up to four integer arguments into $a0-$a3
+	Params: Machine* m - the machine to set up
+			int argc - number of arguments
+			char** argv - the arguments
+	Return: none
+*/
+void machineArgs(Machine* m, int argc, char** argv);
+
+
+/*----------------------------\
+		   Execution
+\----------------------------*/
+/*
+	Purpose: runs the program until it leaves the end of its text, faults, runs out of budget or hits a watchpoint
+	Params: Machine* m - the machine to run, a stopped run can be resumed by calling again
+	Return: uint16_t - the final status, COMPLETE_RUN when the program finished
+*/
+uint16_t machineRun(Machine* m);
+
+/*
+	Purpose: runs a program to the end from fresh state, the machine is freed if it cannot be set up
+	Params: Machine* m - the machine to set up and run
+			const uint32_t* words - the program words
+			uint32_t count - how many
+			int argc - number of program arguments
+			char** argv - the program arguments
+	Return: int - 0 for no error
+*/
+int runProgram(Machine* m, const uint32_t* words, uint32_t count, int argc, char** argv);
+
+/*
+	Purpose: totals the block cache counters of a finished run
+	Params: const Machine* m - the machine that ran
+			Exec_Stats* stats - the totals to fill
+	Return: none
+*/
+void machineStats(const Machine* m, Exec_Stats* stats);
+
+
+/*----------------------------\
+		   Printing
+\----------------------------*/
+/*
+	Purpose: prints the program counter, HI/LO and every register
+	Params: const Arch_State* arch - the state to print
+			uint64_t retired - the number of instructions retired
+	Return: none
+*/
+void printArchState(const Arch_State* arch, uint64_t retired);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --run mode, assembles or maps and executes a program then prints the final state
+	Params: int argc - number of arguments after the mode
+			char** argv - [--budget N] [--watch addr[:r|w|rw]]... <prog.s|prog.elf> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int runMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-watch mode, times a program with and without a budget and watchpoints
+	Params: int argc - number of arguments after the mode
+			char** argv - [--watch addr[:r|w|rw]]... <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int benchWatchMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-fusion mode, compares dispatch counts and run times with and without fusion
+	Params: int argc - number of arguments after the mode
+			char** argv - <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int benchFusionMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,806 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Flash.h"
+#include "MIPS_Image.h"
+#include "MIPS_Util.h"
+
+// bytes handed to the encoder at a time by --convert, and the output collected before each write
+#define CONVERT_CHUNK (64u << 10)
+#define CONVERT_OUT_SIZE (1u << 20)
+
+// first buffer for a decoded image, and the widest range of addresses one may cover
+#define LOAD_START_SIZE (1u << 20)
+#define LOAD_MAX_SPAN (1u << 30)
+
+// every byte as two hex digits, byte b is at hex_pairs[2 * b]
+#define HEX_ROW(hi) hi "0" hi "1" hi "2" hi "3" hi "4" hi "5" hi "6" hi "7" \
+	hi "8" hi "9" hi "A" hi "B" hi "C" hi "D" hi "E" hi "F"
+static const char hex_pairs[] = HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3") HEX_ROW("4") HEX_ROW("5")
+	HEX_ROW("6") HEX_ROW("7") HEX_ROW("8") HEX_ROW("9") HEX_ROW("A") HEX_ROW("B") HEX_ROW("C") HEX_ROW("D")
+	HEX_ROW("E") HEX_ROW("F");
+
+// value of a hex digit plus one, 0 for anything that is not one
+static const uint8_t hex_values[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16
+};
+
+/*----------------------------\
+		   Formats
+\----------------------------*/
+/*
+	Purpose: picks the format from a file's first character, ':' for Intel HEX and S<digit> for S-records
+	Params: const uint8_t* data - the start of the file
+			size_t size - its length
+	Return: Flash_Format - the format, FLASH_RAW for anything else
+*/
+Flash_Format flashDetect(const uint8_t* data, size_t size) {
+	if (size >= 11 && data[0] == ':' && hex_values[data[1]] != 0) {
+		return FLASH_IHEX;
+	}
+	if (size >= 10 && data[0] == 'S' && data[1] >= '0' && data[1] <= '9' && hex_values[data[2]] != 0) {
+		return FLASH_SREC;
+	}
+	return FLASH_RAW;
+}
+
+/*
+	Purpose: picks the format from a name, ihex/hex, srec/s19/s28/s37/mot or raw/bin
+	Params: const char* name - a format name or a path to take the extension of
+			Flash_Format* format - filled with the format
+	Return: int - 0 if the name was recognized
+*/
+int flashFormatByName(const char* name, Flash_Format* format) {
+	static const struct {
+		const char* name;
+		Flash_Format format;
+	} names[] = {
+		{ "ihex", FLASH_IHEX }, { "hex", FLASH_IHEX },
+		{ "srec", FLASH_SREC }, { "s19", FLASH_SREC }, { "s28", FLASH_SREC }, { "s37", FLASH_SREC },
+		{ "mot", FLASH_SREC },
+		{ "raw", FLASH_RAW }, { "bin", FLASH_RAW }
+	};
+
+	const char* dot = strrchr(name, '.');
+	const char* ext = (dot != NULL) ? dot + 1 : name;
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strcasecmp(ext, names[i].name) == 0) {
+			*format = names[i].format;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+	Purpose: gets the message for a status
+	Params: Flash_Status status - the status
+	Return: const char* - the message
+*/
+const char* flashMessage(Flash_Status status) {
+	switch (status) {
+	case FLASH_OK:
+		return "No error";
+	case FLASH_BAD_RECORD:
+		return "Malformed record";
+	case FLASH_BAD_CHECKSUM:
+		return "Record checksum does not match";
+	case FLASH_BAD_TYPE:
+		return "Unknown record type";
+	case FLASH_NO_DATA:
+	default:
+		return "Image holds no data";
+	}
+}
+
+
+/*----------------------------\
+		   Encoding
+\----------------------------*/
+/*
+	Purpose: writes a byte as two hex digits
+	Params: char* out - where to write
+			uint32_t b - the byte
+	Return: char* - just past what was written
+*/
+static inline char* putByte(char* out, uint32_t b) {
+	memcpy(out, hex_pairs + 2 * (b & 0xFF), 2);
+	return out + 2;
+}
+
+/*
+	Purpose: sums the bytes of a record's data eight at a time, in 16 bit lanes that cannot overflow for 255 bytes
+	Params: const uint8_t* p - the data
+			size_t len - how many bytes, at most 255
+	Return: uint32_t - the sum
+*/
+static uint32_t blockSum(const uint8_t* p, size_t len) {
+	const uint64_t low_bytes = 0x00FF00FF00FF00FFull;
+	uint64_t lanes = 0;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t x;
+		memcpy(&x, p + i, 8);
+		lanes += (x & low_bytes) + ((x >> 8) & low_bytes);
+	}
+	lanes = (lanes & 0x0000FFFF0000FFFFull) + ((lanes >> 16) & 0x0000FFFF0000FFFFull);
+
+	uint32_t sum = (uint32_t)lanes + (uint32_t)(lanes >> 32);
+	for (; i < len; i++) {
+		sum += p[i];
+	}
+	return sum;
+}
+
+/*
+	Purpose: writes one data record, and before it an Intel HEX extended address record if the upper half changed
+	Params: Flash_Encoder* e - the encoder
+			uint32_t addr - address of the first byte
+			const uint8_t* data - the bytes
+			uint32_t n - how many, at most FLASH_RECORD_BYTES
+			char* out - where to write
+	Return: char* - just past what was written
+*/
+static char* putRecord(Flash_Encoder* e, uint32_t addr, const uint8_t* data, uint32_t n, char* out) {
+	uint32_t sum = blockSum(data, n);
+
+	if (e->format == FLASH_IHEX) {
+		uint32_t upper = addr >> 16;
+		if (upper != e->upper) {
+			memcpy(out, ":02000004", 9);
+			out = putByte(out + 9, upper >> 8);
+			out = putByte(out, upper);
+			out = putByte(out, 0u - (2 + 4 + (upper >> 8) + upper));
+			*out++ = '\n';
+			e->upper = upper;
+			e->records++;
+		}
+
+		*out++ = ':';
+		out = putByte(out, n);
+		out = putByte(out, addr >> 8);
+		out = putByte(out, addr);
+		out = putByte(out, 0);
+		sum += n + ((addr >> 8) & 0xFF) + (addr & 0xFF);
+	}
+	else {
+		uint32_t count = n + 5;
+		*out++ = 'S';
+		*out++ = '3';
+		out = putByte(out, count);
+		out = putByte(out, addr >> 24);
+		out = putByte(out, addr >> 16);
+		out = putByte(out, addr >> 8);
+		out = putByte(out, addr);
+		sum += count + (addr >> 24) + ((addr >> 16) & 0xFF) + ((addr >> 8) & 0xFF) + (addr & 0xFF);
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		out = putByte(out, data[i]);
+	}
+	out = putByte(out, (e->format == FLASH_IHEX) ? 0u - sum : ~sum);
+	*out++ = '\n';
+	e->records++;
+	return out;
+}
+
+/*
+	Purpose: gets how many bytes a record starting at an address may hold
+	Params: const Flash_Encoder* e - the encoder
+			uint32_t start - address of the record's first byte
+	Return: uint32_t - the most bytes
+*/
+static uint32_t recordRoom(const Flash_Encoder* e, uint32_t start) {
+	// an Intel HEX record cannot run into the next 64 KB
+	uint32_t to_boundary = 0x10000 - (start & 0xFFFF);
+	if (e->format == FLASH_IHEX && to_boundary < FLASH_RECORD_BYTES) {
+		return to_boundary;
+	}
+	return FLASH_RECORD_BYTES;
+}
+
+/*
+	Purpose: starts an encoder
+	Params: Flash_Encoder* e - the encoder
+			Flash_Format format - the format to write
+			uint32_t base - address of the first byte, also the start address
+			int big - words are stored big endian when set
+	Return: none
+*/
+void flashEncoderInit(Flash_Encoder* e, Flash_Format format, uint32_t base, int big) {
+	memset(e, 0, sizeof(*e));
+	e->format = format;
+	e->big = big;
+	e->entry = base;
+	e->addr = base;
+}
+
+/*
+	Purpose: adds a block of bytes at the next address
+	Params: Flash_Encoder* e - the encoder
+			const uint8_t* bytes - the bytes
+			size_t len - how many
+			char* out - FLASH_BLOCK_MAX(len) bytes for the records it finishes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashEncodeBlock(Flash_Encoder* e, const uint8_t* bytes, size_t len, char* out) {
+	if (e->format == FLASH_RAW) {
+		memcpy(out, bytes, len);
+		e->addr += (uint32_t)len;
+		return len;
+	}
+
+	char* p = out;
+	if (!e->started && e->format == FLASH_SREC) {
+		memcpy(p, "S0030000FC\n", 11);
+		p += 11;
+		e->records++;
+	}
+	e->started = 1;
+
+	while (len > 0) {
+		uint32_t start = e->addr - e->pending_len;
+		uint32_t room = recordRoom(e, start);
+		uint32_t n = room - e->pending_len;
+		if (n > len) {
+			n = (uint32_t)len;
+		}
+
+		// whole records come straight from the block, only the ends go through pending
+		if (e->pending_len == 0 && n == room) {
+			p = putRecord(e, start, bytes, n, p);
+		}
+		else {
+			memcpy(e->pending + e->pending_len, bytes, n);
+			e->pending_len += n;
+			if (e->pending_len == room) {
+				p = putRecord(e, start, e->pending, room, p);
+				e->pending_len = 0;
+			}
+		}
+
+		e->addr += n;
+		bytes += n;
+		len -= n;
+	}
+	return (size_t)(p - out);
+}
+
+/*
+	Purpose: adds one word at the next address
+	Params: Flash_Encoder* e - the encoder
+			uint32_t word - the word, stored in the encoder's byte order
+			char* out - FLASH_LINE_MAX bytes for the records it finishes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashPutWord(Flash_Encoder* e, uint32_t word, char* out) {
+	uint8_t bytes[4];
+	if (e->big) {
+		bytes[0] = (uint8_t)(word >> 24);
+		bytes[1] = (uint8_t)(word >> 16);
+		bytes[2] = (uint8_t)(word >> 8);
+		bytes[3] = (uint8_t)word;
+	}
+	else {
+		bytes[0] = (uint8_t)word;
+		bytes[1] = (uint8_t)(word >> 8);
+		bytes[2] = (uint8_t)(word >> 16);
+		bytes[3] = (uint8_t)(word >> 24);
+	}
+	return flashEncodeBlock(e, bytes, 4, out);
+}
+
+/*
+	Purpose: writes the last partial record and the end of file record
+	Params: Flash_Encoder* e - the encoder
+			char* out - FLASH_LINE_MAX bytes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashFinish(Flash_Encoder* e, char* out) {
+	if (e->format == FLASH_RAW) {
+		return 0;
+	}
+
+	// an empty block still writes the S0 header
+	char* p = out + flashEncodeBlock(e, NULL, 0, out);
+	if (e->pending_len > 0) {
+		p = putRecord(e, e->addr - e->pending_len, e->pending, e->pending_len, p);
+		e->pending_len = 0;
+	}
+
+	if (e->format == FLASH_IHEX) {
+		memcpy(p, ":00000001FF\n", 12);
+		p += 12;
+	}
+	else {
+		uint32_t entry = e->entry;
+		memcpy(p, "S705", 4);
+		p = putByte(p + 4, entry >> 24);
+		p = putByte(p, entry >> 16);
+		p = putByte(p, entry >> 8);
+		p = putByte(p, entry);
+		p = putByte(p, ~(5u + (entry >> 24) + ((entry >> 16) & 0xFF) + ((entry >> 8) & 0xFF) + (entry & 0xFF)));
+		*p++ = '\n';
+	}
+	e->records++;
+	return (size_t)(p - out);
+}
+
+
+/*----------------------------\
+		   Decoding
+\----------------------------*/
+/*
+	Purpose: turns hex digit pairs into bytes
+	Params: const char* text - the digits
+			size_t count - the number of bytes
+			uint8_t* out - the bytes to fill
+	Return: int - 0 if every digit was hex
+*/
+static int hexBytes(const char* text, size_t count, uint8_t* out) {
+	uint32_t bad = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t hi = hex_values[(uint8_t)text[2 * i]];
+		uint32_t lo = hex_values[(uint8_t)text[2 * i + 1]];
+		bad |= (hi == 0) | (lo == 0);
+		out[i] = (uint8_t)(((hi - 1) << 4) | ((lo - 1) & 0xF));
+	}
+	return bad != 0;
+}
+
+/*
+	Purpose: starts a decoder
+	Params: Flash_Decoder* d - the decoder
+			Flash_Format format - FLASH_IHEX or FLASH_SREC
+	Return: none
+*/
+void flashDecoderInit(Flash_Decoder* d, Flash_Format format) {
+	memset(d, 0, sizeof(*d));
+	d->format = format;
+}
+
+/*
+	Purpose: decodes one record, surrounding whitespace allowed
+	Params: Flash_Decoder* d - the decoder
+			const char* line - the record
+			size_t len - its length
+			uint32_t* addr - filled with the address of the data
+			uint8_t* data - 255 bytes to fill with the data
+			uint32_t* count - filled with the number of data bytes, 0 for other records
+	Return: Flash_Status - FLASH_OK for a good record
+*/
+Flash_Status flashDecodeLine(Flash_Decoder* d, const char* line, size_t len, uint32_t* addr, uint8_t* data,
+	uint32_t* count) {
+	uint8_t rec[262];
+
+	*count = 0;
+	while (len > 0 && (*line == ' ' || *line == '\t')) {
+		line++;
+		len--;
+	}
+	while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t' || line[len - 1] == '\r')) {
+		len--;
+	}
+	if (len == 0) {
+		return FLASH_OK;
+	}
+
+	if (d->format == FLASH_IHEX) {
+		// :LL AAAA TT data CC, every byte including the checksum sums to 0
+		if (line[0] != ':' || len < 11 || (len - 1) % 2 != 0 || (len - 1) / 2 > sizeof(rec)) {
+			return FLASH_BAD_RECORD;
+		}
+		size_t bytes = (len - 1) / 2;
+		if (hexBytes(line + 1, bytes, rec) != 0 || bytes != (size_t)rec[0] + 5) {
+			return FLASH_BAD_RECORD;
+		}
+		if ((blockSum(rec, bytes) & 0xFF) != 0) {
+			return FLASH_BAD_CHECKSUM;
+		}
+
+		uint32_t n = rec[0];
+		uint32_t value = (n >= 2) ? ((uint32_t)rec[4] << 8) | rec[5] : 0;
+		d->records++;
+		switch (rec[3]) {
+		case 0x00:
+			*addr = d->upper + (((uint32_t)rec[1] << 8) | rec[2]);
+			memcpy(data, rec + 4, n);
+			*count = n;
+			return FLASH_OK;
+		case 0x01:
+			d->done = 1;
+			return FLASH_OK;
+		case 0x02:
+			d->upper = value << 4;
+			return (n == 2) ? FLASH_OK : FLASH_BAD_RECORD;
+		case 0x04:
+			d->upper = value << 16;
+			return (n == 2) ? FLASH_OK : FLASH_BAD_RECORD;
+		case 0x03:
+		case 0x05:
+			if (n != 4) {
+				return FLASH_BAD_RECORD;
+			}
+			d->entry = (rec[3] == 0x03) ? (value << 4) + (((uint32_t)rec[6] << 8) | rec[7]) :
+				(value << 16) | ((uint32_t)rec[6] << 8) | rec[7];
+			d->has_entry = 1;
+			return FLASH_OK;
+		default:
+			return FLASH_BAD_TYPE;
+		}
+	}
+
+	// S<type> CC address data SS, the count byte covers the address, data and checksum
+	if (line[0] != 'S' || len < 10 || len % 2 != 0 || (len - 2) / 2 > sizeof(rec)) {
+		return FLASH_BAD_RECORD;
+	}
+	size_t bytes = (len - 2) / 2;
+	if (hexBytes(line + 2, bytes, rec) != 0 || bytes != (size_t)rec[0] + 1) {
+		return FLASH_BAD_RECORD;
+	}
+	if ((blockSum(rec, bytes) & 0xFF) != 0xFF) {
+		return FLASH_BAD_CHECKSUM;
+	}
+
+	static const uint8_t addr_bytes[10] = { 2, 2, 3, 4, 0, 2, 3, 4, 3, 2 };
+	int type = line[1] - '0';
+	if (type < 0 || type > 9 || addr_bytes[type] == 0) {
+		return FLASH_BAD_TYPE;
+	}
+	uint32_t width = addr_bytes[type];
+	if (rec[0] < width + 1) {
+		return FLASH_BAD_RECORD;
+	}
+
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < width; i++) {
+		value = (value << 8) | rec[1 + i];
+	}
+	d->records++;
+	if (type >= 1 && type <= 3) {
+		*addr = value;
+		*count = rec[0] - width - 1;
+		memcpy(data, rec + 1 + width, *count);
+	}
+	else if (type >= 7) {
+		d->entry = value;
+		d->has_entry = 1;
+		d->done = 1;
+	}
+	return FLASH_OK;
+}
+
+/*
+	Purpose: puts decoded bytes in place, growing the image at either end and zero filling any gap
+	Params: Flash_Image* image - the image being decoded
+			size_t* capacity - the size of image->owned
+			uint32_t addr - address of the bytes
+			const uint8_t* data - the bytes
+			uint32_t count - how many
+	Return: int - 0 for no error
+*/
+static int placeBytes(Flash_Image* image, size_t* capacity, uint32_t addr, const uint8_t* data, uint32_t count) {
+	if (image->owned == NULL) {
+		image->owned = malloc(LOAD_START_SIZE);
+		if (image->owned == NULL) {
+			return 1;
+		}
+		*capacity = LOAD_START_SIZE;
+		image->base = addr;
+		image->size = 0;
+	}
+
+	// the low end is only moved when a record comes before everything so far
+	uint64_t shift = (addr < image->base) ? image->base - addr : 0;
+	uint64_t start = (uint64_t)addr + shift - image->base;
+	uint64_t end = start + count;
+	uint64_t need = (end > image->size + shift) ? end : image->size + shift;
+	if (need > LOAD_MAX_SPAN) {
+		return 1;
+	}
+
+	if (need > *capacity) {
+		size_t size = *capacity;
+		while (size < need) {
+			size *= 2;
+		}
+		uint8_t* grown = realloc(image->owned, size);
+		if (grown == NULL) {
+			return 1;
+		}
+		image->owned = grown;
+		*capacity = size;
+	}
+	if (shift > 0) {
+		memmove(image->owned + shift, image->owned, image->size);
+		memset(image->owned, 0, shift);
+		image->base = addr;
+		image->size += (uint32_t)shift;
+	}
+	if (start > image->size) {
+		memset(image->owned + image->size, 0, start - image->size);
+	}
+
+	memcpy(image->owned + start, data, count);
+	if (end > image->size) {
+		image->size = (uint32_t)end;
+	}
+	return 0;
+}
+
+/*
+	Purpose: loads a whole image, decoding Intel HEX and S-records and mapping raw files
+	Params: const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			Flash_Image* image - the image to fill
+	Return: int - 0 for no error
+*/
+int flashLoad(const char* path, uint32_t raw_base, Flash_Image* image) {
+	memset(image, 0, sizeof(*image));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		printf("%s: ", path);
+		printf("ERROR: %s\n", flashMessage(FLASH_NO_DATA));
+		close(fd);
+		return 1;
+	}
+
+	image->file_size = (uint64_t)info.st_size;
+	image->map_size = (size_t)info.st_size;
+	void* map = mmap(NULL, image->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return 1;
+	}
+	image->map = map;
+	image->format = flashDetect(image->map, image->map_size);
+
+	// a raw image is the mapping itself
+	if (image->format == FLASH_RAW) {
+		uint64_t room = (uint64_t)UINT32_MAX + 1 - raw_base;
+		image->bytes = image->map;
+		image->base = raw_base;
+		image->size = (uint32_t)((image->map_size < room) ? image->map_size : room);
+		madvise(map, image->map_size, MADV_SEQUENTIAL);
+		return 0;
+	}
+
+	madvise(map, image->map_size, MADV_SEQUENTIAL);
+	Flash_Decoder d;
+	flashDecoderInit(&d, image->format);
+
+	const char* text = (const char*)image->map;
+	const char* end = text + image->map_size;
+	size_t capacity = 0;
+	uint64_t line_number = 0;
+	uint8_t data[256];
+	int failed = 0;
+
+	while (text < end && !d.done && !failed) {
+		const char* newline = memchr(text, '\n', (size_t)(end - text));
+		const char* line_end = (newline != NULL) ? newline : end;
+		line_number++;
+
+		uint32_t addr;
+		uint32_t count;
+		Flash_Status status = flashDecodeLine(&d, text, (size_t)(line_end - text), &addr, data, &count);
+		if (status != FLASH_OK) {
+			printf("%s:%llu: ", path, (unsigned long long)line_number);
+			printf("ERROR: %s\n", flashMessage(status));
+			failed = 1;
+		}
+		else if (count > 0 && placeBytes(image, &capacity, addr, data, count) != 0) {
+			printf("%s:%llu: ", path, (unsigned long long)line_number);
+			error("Image spans too much memory");
+			failed = 1;
+		}
+		text = line_end + 1;
+	}
+
+	// the decoded copy is all that is kept
+	munmap(map, image->map_size);
+	image->map = NULL;
+	image->map_size = 0;
+
+	if (!failed && image->owned == NULL) {
+		printf("%s: ", path);
+		printf("ERROR: %s\n", flashMessage(FLASH_NO_DATA));
+		failed = 1;
+	}
+	if (failed) {
+		flashFree(image);
+		return 1;
+	}
+
+	image->bytes = image->owned;
+	image->entry = d.entry;
+	image->has_entry = d.has_entry;
+	return 0;
+}
+
+/*
+	Purpose: releases an image
+	Params: Flash_Image* image - the image
+	Return: none
+*/
+void flashFree(Flash_Image* image) {
+	if (image->map != NULL) {
+		munmap((void*)image->map, image->map_size);
+	}
+	free(image->owned);
+	memset(image, 0, sizeof(*image));
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: writes a whole buffer, retrying short writes
+	Params: int fd - the file
+			const void* data - the bytes
+			size_t len - how many
+	Return: int - 0 for no error
+*/
+static int writeAll(int fd, const void* data, size_t len) {
+	const uint8_t* p = data;
+
+	while (len > 0) {
+		ssize_t wrote = write(fd, p, len);
+		if (wrote < 0 && errno == EINTR) {
+			continue;
+		}
+		if (wrote <= 0) {
+			return 1;
+		}
+		p += wrote;
+		len -= (size_t)wrote;
+	}
+	return 0;
+}
+
+/*
+	Purpose: --convert mode, converts between ELF, Intel HEX, S-records and raw binary, then reports throughput
+	Params: int argc - number of arguments after the mode
+			char** argv - [-f ihex|srec|raw] [-a addr] <in> <out>
+	Return: int - exit code
+*/
+int convertMain(int argc, char** argv) {
+	Flash_Format format = FLASH_RAW;
+	int have_format = 0;
+	uint32_t raw_base = TEXT_BASE;
+
+	while (argc > 1 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-f") == 0) {
+			if (flashFormatByName(argv[1], &format) != 0) {
+				printf("ERROR: Unknown format %s\n", argv[1]);
+				return 1;
+			}
+			have_format = 1;
+		}
+		else if (strcmp(argv[0], "-a") == 0) {
+			raw_base = (uint32_t)strtoul(argv[1], NULL, 0);
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 1;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2) {
+		error("--convert needs an input and an output file");
+		return 1;
+	}
+	if (!have_format && flashFormatByName(argv[1], &format) != 0) {
+		format = FLASH_RAW;
+	}
+
+	double start = getTime();
+
+	// an ELF file gives its .text, anything else is loaded as a flash image
+	Elf_Image elf;
+	Flash_Image flash;
+	const uint8_t* bytes;
+	uint32_t base;
+	uint32_t size;
+	uint32_t entry;
+	uint64_t bytes_in;
+	int is_elf = imageIsElf(argv[0]);
+	if (is_elf) {
+		if (imageOpen(&elf, argv[0]) != 0) {
+			return 1;
+		}
+		bytes = elf.text;
+		base = elf.text_addr;
+		size = elf.text_size;
+		entry = elf.header.entry;
+		bytes_in = elf.size;
+	}
+	else {
+		if (flashLoad(argv[0], raw_base, &flash) != 0) {
+			return 1;
+		}
+		bytes = flash.bytes;
+		base = flash.base;
+		size = flash.size;
+		entry = flash.has_entry ? flash.entry : flash.base;
+		bytes_in = flash.file_size;
+	}
+
+	int failed = 0;
+	uint64_t bytes_out = 0;
+	Flash_Encoder e;
+	flashEncoderInit(&e, format, base, 1);
+	e.entry = entry;
+
+	int fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	char* buffer = (format != FLASH_RAW) ? malloc(CONVERT_OUT_SIZE) : NULL;
+	if (fd < 0) {
+		perror(argv[1]);
+		failed = 1;
+	}
+	else if (format == FLASH_RAW) {
+		// raw output is the image itself, written without a copy
+		failed = writeAll(fd, bytes, size);
+		bytes_out = size;
+	}
+	else if (buffer == NULL) {
+		error("Out of memory");
+		failed = 1;
+	}
+	else {
+		size_t used = 0;
+		for (uint32_t offset = 0; offset < size && !failed; offset += CONVERT_CHUNK) {
+			uint32_t n = (size - offset < CONVERT_CHUNK) ? size - offset : CONVERT_CHUNK;
+			if (CONVERT_OUT_SIZE - used < FLASH_BLOCK_MAX(CONVERT_CHUNK)) {
+				failed = writeAll(fd, buffer, used);
+				bytes_out += used;
+				used = 0;
+			}
+			used += flashEncodeBlock(&e, bytes + offset, n, buffer + used);
+		}
+		used += flashFinish(&e, buffer + used);
+		failed |= writeAll(fd, buffer, used);
+		bytes_out += used;
+	}
+	if (fd >= 0 && close(fd) != 0) {
+		failed = 1;
+	}
+	if (failed && fd >= 0) {
+		perror(argv[1]);
+		unlink(argv[1]);
+	}
+	double wall = getTime() - start;
+
+	static const char* format_names[] = { "raw", "ihex", "srec" };
+	printf("In: %s, %llu bytes\tOut: %s, %llu bytes\tData: %u bytes at 0x%08X\tRecords: %llu\n",
+		is_elf ? "elf" : format_names[flash.format], (unsigned long long)bytes_in, format_names[format],
+		(unsigned long long)bytes_out, size, base, (unsigned long long)e.records);
+	printf("Time: %.6f s\t%.1f MB/s\n", wall, wall > 0 ? (bytes_in + bytes_out) / wall / 1e6 : 0.0);
+
+	free(buffer);
+	if (is_elf) {
+		imageClose(&elf);
+	}
+	else {
+		flashFree(&flash);
+	}
+	return failed;
+}
@@ -0,0 +1,216 @@
+#ifndef _MIPS_FLASH_H_
+#define _MIPS_FLASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Flash image formats: Intel HEX, Motorola S-records and raw binary.
+
+	The encoder is streaming. Bytes go in a word or a block at a time and
+	come out as finished records. Intel HEX gets a type 04 record whenever
+	the upper half of the address changes, and S-records are S3 with 32
+	bit addresses between an S0 header and an S7 start address. Record
+	checksums are summed a machine word at a time and bytes are turned
+	into hex through a 256 entry table of digit pairs.
+
+	The decoder takes one record line at a time and checks its checksum.
+	flashLoad runs it over a mapped file and lays the data out from the
+	lowest address, with any gaps zero filled. A raw file is used straight
+	from the mapping.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// data bytes per record
+#define FLASH_RECORD_BYTES 32
+
+// most text one encoder call makes for a word, or flashFinish makes
+#define FLASH_LINE_MAX 112
+
+// most text flashEncodeBlock makes for len bytes
+#define FLASH_BLOCK_MAX(len) ((((len) / 16) + 4) * FLASH_LINE_MAX)
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+typedef enum Flash_Format {
+	FLASH_RAW,
+	FLASH_IHEX,
+	FLASH_SREC
+} Flash_Format;
+
+typedef enum Flash_Status {
+	FLASH_OK,
+	FLASH_BAD_RECORD,
+	FLASH_BAD_CHECKSUM,
+	FLASH_BAD_TYPE,
+	FLASH_NO_DATA
+} Flash_Status;
+
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a streaming writer, the bytes not yet in a record wait in pending
+typedef struct {
+	Flash_Format format;
+	int big;
+	uint32_t entry;
+	uint32_t addr;
+	uint32_t upper;
+	uint8_t pending[FLASH_RECORD_BYTES];
+	uint32_t pending_len;
+	uint64_t records;
+	int started;
+} Flash_Encoder;
+
+// a streaming reader, keeps the address base records build on
+typedef struct {
+	Flash_Format format;
+	uint32_t upper;
+	uint32_t entry;
+	int has_entry;
+	int done;
+	uint64_t records;
+} Flash_Decoder;
+
+// a whole image laid out from its lowest address
+typedef struct {
+	Flash_Format format;
+	const uint8_t* bytes;
+	uint32_t base;
+	uint32_t size;
+	uint32_t entry;
+	int has_entry;
+
+	// the file's size and mapping, and the decoded copy when the format is not raw
+	uint64_t file_size;
+	const uint8_t* map;
+	size_t map_size;
+	uint8_t* owned;
+} Flash_Image;
+
+
+/*----------------------------\
+		   Formats
+\----------------------------*/
+/*
+	Purpose: picks the format from a file's first character, ':' for Intel HEX and S<digit> for S-records
+	Params: const uint8_t* data - the start of the file
+			size_t size - its length
+	Return: Flash_Format - the format, FLASH_RAW for anything else
+*/
+Flash_Format flashDetect(const uint8_t* data, size_t size);
+
+/*
+	Purpose: picks the format from a name, ihex/hex, srec/s19/s28/s37/mot or raw/bin
+	Params: const char* name - a format name or a path to take the extension of
+			Flash_Format* format - filled with the format
+	Return: int - 0 if the name was recognized
+*/
+int flashFormatByName(const char* name, Flash_Format* format);
+
+/*
+	Purpose: gets the message for a status
+	Params: Flash_Status status - the status
+	Return: const char* - the message
+*/
+const char* flashMessage(Flash_Status status);
+
+
+/*----------------------------\
+		   Encoding
+\----------------------------*/
+/*
+	Purpose: starts an encoder
+	Params: Flash_Encoder* e - the encoder
+			Flash_Format format - the format to write
+			uint32_t base - address of the first byte, also the start address
+			int big - words are stored big endian when set
+	Return: none
+*/
+void flashEncoderInit(Flash_Encoder* e, Flash_Format format, uint32_t base, int big);
+
+/*
+	Purpose: adds one word at the next address
+	Params: Flash_Encoder* e - the encoder
+			uint32_t word - the word, stored in the encoder's byte order
+			char* out - FLASH_LINE_MAX bytes for the records it finishes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashPutWord(Flash_Encoder* e, uint32_t word, char* out);
+
+/*
+	Purpose: adds a block of bytes at the next address
+	Params: Flash_Encoder* e - the encoder
+			const uint8_t* bytes - the bytes
+			size_t len - how many
+			char* out - FLASH_BLOCK_MAX(len) bytes for the records it finishes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashEncodeBlock(Flash_Encoder* e, const uint8_t* bytes, size_t len, char* out);
+
+/*
+	Purpose: writes the last partial record and the end of file record
+	Params: Flash_Encoder* e - the encoder
+			char* out - FLASH_LINE_MAX bytes
+	Return: size_t - the number of bytes written to out
+*/
+size_t flashFinish(Flash_Encoder* e, char* out);
+
+
+/*----------------------------\
+		   Decoding
+\----------------------------*/
+/*
+	Purpose: starts a decoder
+	Params: Flash_Decoder* d - the decoder
+			Flash_Format format - FLASH_IHEX or FLASH_SREC
+	Return: none
+*/
+void flashDecoderInit(Flash_Decoder* d, Flash_Format format);
+
+/*
+	Purpose: decodes one record, surrounding whitespace allowed
+	Params: Flash_Decoder* d - the decoder
+			const char* line - the record
+			size_t len - its length
+			uint32_t* addr - filled with the address of the data
+			uint8_t* data - 255 bytes to fill with the data
+			uint32_t* count - filled with the number of data bytes, 0 for other records
+	Return: Flash_Status - FLASH_OK for a good record
+*/
+Flash_Status flashDecodeLine(Flash_Decoder* d, const char* line, size_t len, uint32_t* addr, uint8_t* data,
+	uint32_t* count);
+
+/*
+	Purpose: loads a whole image, decoding Intel HEX and S-records and mapping raw files
+	Params: const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			Flash_Image* image - the image to fill
+	Return: int - 0 for no error
+*/
+int flashLoad(const char* path, uint32_t raw_base, Flash_Image* image);
+
+/*
+	Purpose: releases an image
+	Params: Flash_Image* image - the image
+	Return: none
+*/
+void flashFree(Flash_Image* image);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --convert mode, converts between ELF, Intel HEX, S-records and raw binary, then reports throughput
+	Params: int argc - number of arguments after the mode
+			char** argv - [-f ihex|srec|raw] [-a addr] <in> <out>
+	Return: int - exit code
+*/
+int convertMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,536 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Grep.h"
+#include "MIPS_Util.h"
+
+// longest listing line, the path is cut to fit
+#define GREP_LINE_MAX 160
+
+static const uint32_t field_shift[3] = { 21, 16, 11 };
+
+/*----------------------------\
+		   Compiling
+\----------------------------*/
+/*
+	Purpose: finds the fields an op has
+	Params: uint32_t op - the op
+			int* dest - filled with the field it writes, -1 for none
+			int* base - filled with its base register field, -1 for none
+	Return: uint32_t - one bit per GREP_FIELD_ it has
+*/
+uint32_t grepOpFields(uint32_t op, int* dest, int* base) {
+	const uint32_t rs = 1u << GREP_FIELD_RS;
+	const uint32_t rt = 1u << GREP_FIELD_RT;
+	const uint32_t rd = 1u << GREP_FIELD_RD;
+	const uint32_t imm = 1u << GREP_FIELD_IMM;
+	*dest = -1;
+	*base = -1;
+
+	switch (op) {
+	case OP_ADD:
+	case OP_SUB:
+	case OP_AND:
+	case OP_OR:
+	case OP_SLT: { *dest = GREP_FIELD_RD; return rs | rt | rd; }
+	case OP_MULT:
+	case OP_DIV: { return rs | rt; }
+	case OP_MFHI:
+	case OP_MFLO: { *dest = GREP_FIELD_RD; return rd; }
+	case OP_LUI: { *dest = GREP_FIELD_RT; return rt | imm; }
+	case OP_ADDI:
+	case OP_ANDI:
+	case OP_ORI:
+	case OP_SLTI: { *dest = GREP_FIELD_RT; return rs | rt | imm; }
+	case OP_LW: { *dest = GREP_FIELD_RT; *base = GREP_FIELD_RS; return rs | rt | imm; }
+	case OP_SW: { *base = GREP_FIELD_RS; return rs | rt | imm; }
+	case OP_BEQ:
+	case OP_BNE: { return rs | rt | imm; }
+	default: { return 0; }
+	}
+}
+
+/*
+	Purpose: reads a register, by name or as $ and a number
+	Params: const char* text - the register
+	Return: int - the register number, -1 if it is not one
+*/
+static int parseReg(const char* text) {
+	for (uint32_t r = 0; r < 32; r++) {
+		if (strcasecmp(text, regName(r)) == 0) {
+			return (int)r;
+		}
+	}
+
+	char* end;
+	long num = (text[0] == '$') ? strtol(text + 1, &end, 10) : -1;
+	return (num >= 0 && num < 32 && end != text + 1 && *end == '\0') ? (int)num : -1;
+}
+
+/*
+	Purpose: applies one constraint to the term for an op
+	Params: Grep_Term* t - the term, op and immediate range set
+			int field - the FIELD_ constrained, already resolved to rs/rt/rd/imm
+			const char* cmp - the comparison
+			int64_t value - the register or immediate
+	Return: int - 0 if the op can still match
+*/
+static int constrain(Grep_Term* t, int field, const char* cmp, int64_t value) {
+	if (field != GREP_FIELD_IMM) {
+		uint32_t field_mask = 0x1Fu << field_shift[field];
+		if (strcmp(cmp, "!=") == 0) {
+			t->reg_ne[field] |= 1u << value;
+			return 0;
+		}
+		if ((t->mask & field_mask) && ((t->value & field_mask) >> field_shift[field]) != (uint32_t)value) {
+			return 1;
+		}
+		t->mask |= field_mask;
+		t->value |= (uint32_t)value << field_shift[field];
+		return 0;
+	}
+
+	if (strcmp(cmp, "=") == 0) {
+		t->imm_lo = (value > t->imm_lo) ? (int32_t)value : t->imm_lo;
+		t->imm_hi = (value < t->imm_hi) ? (int32_t)value : t->imm_hi;
+	}
+	else if (strcmp(cmp, "!=") == 0) {
+		t->imm_ne[t->imm_ne_count++] = (int32_t)value;
+	}
+	else if (strcmp(cmp, "<") == 0 && value - 1 < t->imm_hi) {
+		t->imm_hi = (int32_t)(value - 1);
+	}
+	else if (strcmp(cmp, "<=") == 0 && value < t->imm_hi) {
+		t->imm_hi = (int32_t)value;
+	}
+	else if (strcmp(cmp, ">") == 0 && value + 1 > t->imm_lo) {
+		t->imm_lo = (int32_t)(value + 1);
+	}
+	else if (strcmp(cmp, ">=") == 0 && value > t->imm_lo) {
+		t->imm_lo = (int32_t)value;
+	}
+	return t->imm_lo > t->imm_hi;
+}
+
+/*
+	Purpose: compiles a pattern into the terms of a query
+	Params: Grep_Query* q - the query to add to
+			const char* text - the pattern
+	Return: int - 0 for no error
+*/
+int grepCompile(Grep_Query* q, const char* text) {
+	if (q->pattern_count == GREP_MAX_PATTERNS) {
+		error("Too many patterns");
+		return 1;
+	}
+
+	// splits the pattern into words on spaces and commas
+	char copy[256];
+	char* words[GREP_MAX_WORDS];
+	int word_count = 0;
+	if (strlen(text) >= sizeof(copy)) {
+		printf("ERROR: Pattern longer than %zu characters\n", sizeof(copy) - 1);
+		return 1;
+	}
+	strcpy(copy, text);
+	for (char* tok = strtok(copy, " \t,"); tok != NULL; tok = strtok(NULL, " \t,")) {
+		if (word_count == GREP_MAX_WORDS) {
+			printf("ERROR: Pattern has more than %d words\n", GREP_MAX_WORDS);
+			return 1;
+		}
+		words[word_count++] = tok;
+	}
+	if (word_count == 0) {
+		error("Empty pattern");
+		return 1;
+	}
+
+	// each constraint is a field name, a comparison and a value
+	int fields[GREP_MAX_WORDS];
+	char cmps[GREP_MAX_WORDS][3];
+	int64_t values[GREP_MAX_WORDS];
+	int imm_ne_count = 0;
+	for (int w = 1; w < word_count; w++) {
+		char* tok = words[w];
+		size_t name_len = strcspn(tok, "=!<>");
+		size_t cmp_len = strspn(tok + name_len, "=!<>");
+		char* value = tok + name_len + cmp_len;
+		if (name_len == 0 || cmp_len == 0 || cmp_len > 2 || *value == '\0') {
+			printf("ERROR: Bad constraint %s\n", tok);
+			return 1;
+		}
+		memcpy(cmps[w], tok + name_len, cmp_len);
+		cmps[w][cmp_len] = '\0';
+		tok[name_len] = '\0';
+
+		static const char* names[6] = { "rs", "rt", "rd", "imm", "dest", "base" };
+		fields[w] = -1;
+		for (int f = 0; f < 6; f++) {
+			if (strcasecmp(tok, names[f]) == 0) {
+				fields[w] = f;
+			}
+		}
+
+		int is_cmp = (strcmp(cmps[w], "=") == 0 || strcmp(cmps[w], "!=") == 0 || strcmp(cmps[w], "<") == 0 ||
+			strcmp(cmps[w], "<=") == 0 || strcmp(cmps[w], ">") == 0 || strcmp(cmps[w], ">=") == 0);
+		if (fields[w] < 0 || !is_cmp) {
+			printf("ERROR: Bad constraint %s%s%s\n", tok, cmps[w], value);
+			return 1;
+		}
+
+		if (fields[w] == GREP_FIELD_IMM) {
+			if (strcmp(cmps[w], "!=") == 0 && ++imm_ne_count > GREP_MAX_IMM_NE) {
+				printf("ERROR: Pattern has more than %d imm!= constraints\n", GREP_MAX_IMM_NE);
+				return 1;
+			}
+
+			char* end;
+			values[w] = strtoll(value, &end, 0);
+			if (*end != '\0') {
+				printf("ERROR: Bad immediate %s\n", value);
+				return 1;
+			}
+
+			// far outside 16 bits is as good as just outside, and keeps the bounds in an int32_t
+			values[w] = (values[w] < -0x20000) ? -0x20000 : (values[w] > 0x20000) ? 0x20000 : values[w];
+		}
+		else {
+			values[w] = parseReg(value);
+			if (values[w] < 0 || (strcmp(cmps[w], "=") != 0 && strcmp(cmps[w], "!=") != 0)) {
+				printf("ERROR: Bad register constraint %s%s%s\n", tok, cmps[w], value);
+				return 1;
+			}
+		}
+	}
+
+	int any = (strcmp(words[0], "*") == 0);
+	int found = 0;
+	for (int op = OP_INVALID + 1; op < OP_COUNT; op++) {
+		if (!any && strcasecmp(words[0], opName((Op_Type)op)) != 0) {
+			continue;
+		}
+		found = 1;
+
+		// the op's fixed bits, the opcode and for R-type ops the funct
+		Decoded_Instruct d = { (uint8_t)op, 0, 0, 0, 0 };
+		uint32_t bits = encodeWord(&d);
+		Grep_Term t;
+		memset(&t, 0, sizeof(t));
+		t.mask = (WORD_OPCODE(bits) == 0) ? 0xFC00003Fu : 0xFC000000u;
+		t.value = bits & t.mask;
+		t.op = (uint8_t)op;
+		t.pattern = (uint8_t)q->pattern_count;
+		t.imm_signed = (op == OP_ADDI || op == OP_SLTI || op == OP_LW || op == OP_SW || op == OP_BEQ || op == OP_BNE);
+		t.imm_lo = t.imm_signed ? INT16_MIN : 0;
+		t.imm_hi = t.imm_signed ? INT16_MAX : UINT16_MAX;
+
+		int dest;
+		int base;
+		uint32_t has = grepOpFields((uint32_t)op, &dest, &base);
+		int impossible = 0;
+		for (int w = 1; w < word_count && !impossible; w++) {
+			int field = (fields[w] == GREP_FIELD_DEST) ? dest : (fields[w] == GREP_FIELD_BASE) ? base : fields[w];
+			impossible = (field < 0 || !(has & (1u << field)) || constrain(&t, field, cmps[w], values[w]));
+		}
+		if (impossible) {
+			continue;
+		}
+
+		// the immediate goes in the mask when the range pins it or its sign
+		if (t.imm_lo == t.imm_hi) {
+			t.mask |= 0xFFFF;
+			t.value |= (uint32_t)t.imm_lo & 0xFFFF;
+		}
+		else if (t.imm_signed && t.imm_hi < 0) {
+			t.mask |= 0x8000;
+			t.value |= 0x8000;
+		}
+		else if (t.imm_signed && t.imm_lo >= 0) {
+			t.mask |= 0x8000;
+		}
+
+		if (q->term_count == GREP_MAX_TERMS) {
+			error("Too many patterns");
+			return 1;
+		}
+		q->terms[q->term_count++] = t;
+	}
+
+	if (!found) {
+		printf("ERROR: Unknown mnemonic %s\n", words[0]);
+		return 1;
+	}
+	q->patterns[q->pattern_count++] = text;
+	return 0;
+}
+
+/*
+	Purpose: sets the byte order the scan terms are in
+	Params: Grep_Query* q - the query
+			int big - 1 for big endian words
+	Return: none
+*/
+void grepByteOrder(Grep_Query* q, int big) {
+	int host_big = hostIsBig();
+
+	// (w & m) == v holds exactly when it does with all three byte swapped
+	for (uint32_t i = 0; i < q->term_count; i++) {
+		Grep_Term* t = &q->terms[i];
+		t->scan_mask = (big == host_big) ? t->mask : __builtin_bswap32(t->mask);
+		t->scan_value = (big == host_big) ? t->value : __builtin_bswap32(t->value);
+	}
+}
+
+/*
+	Purpose: checks the parts of a term its mask could not, the immediate range and the != registers
+	Params: const Grep_Term* t - the term
+			uint32_t rs - the word's rs field
+			uint32_t rt - the word's rt field
+			uint32_t rd - the word's rd field
+			uint32_t imm - the word's immediate field
+	Return: int - 1 if they pass
+*/
+int grepTermRest(const Grep_Term* t, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t imm) {
+	int32_t value = t->imm_signed ? (int16_t)imm : (int32_t)imm;
+	for (uint32_t i = 0; i < t->imm_ne_count; i++) {
+		if (value == t->imm_ne[i]) {
+			return 0;
+		}
+	}
+	return (value >= t->imm_lo && value <= t->imm_hi) && !((t->reg_ne[GREP_FIELD_RS] >> rs) & 1) &&
+		!((t->reg_ne[GREP_FIELD_RT] >> rt) & 1) && !((t->reg_ne[GREP_FIELD_RD] >> rd) & 1);
+}
+
+/*
+	Purpose: finds which patterns a host order word matches
+	Params: const Grep_Query* q - the query
+			uint32_t word - the word
+	Return: uint32_t - one bit per pattern
+*/
+uint32_t grepMatch(const Grep_Query* q, uint32_t word) {
+	uint32_t matched = 0;
+
+	for (uint32_t i = 0; i < q->term_count; i++) {
+		const Grep_Term* t = &q->terms[i];
+		if ((word & t->mask) != t->value) {
+			continue;
+		}
+
+		if (grepTermRest(t, WORD_RS(word), WORD_RT(word), WORD_RD(word), WORD_IMM(word))) {
+			matched |= 1u << t->pattern;
+		}
+	}
+
+	return matched;
+}
+
+
+/*----------------------------\
+		   Scanning
+\----------------------------*/
+/*
+	Purpose: finds the next run of 16 words where some term hits
+	Params: const Grep_Query* q - the query, byte order set
+			const uint8_t* text - the words in file byte order
+			uint32_t from - the word to start at
+			uint32_t count - the number of words
+	Return: uint32_t - the first word of the run, or the first word past the last whole run
+*/
+static uint32_t scanHits(const Grep_Query* q, const uint8_t* text, uint32_t from, uint32_t count) {
+	uint32_t i = from;
+	for (; i + GREP_STEP_WORDS <= count; i += GREP_STEP_WORDS) {
+		Word_Vec a, b, c, d;
+		memcpy(&a, text + (size_t)i * 4, 16);
+		memcpy(&b, text + (size_t)i * 4 + 16, 16);
+		memcpy(&c, text + (size_t)i * 4 + 32, 16);
+		memcpy(&d, text + (size_t)i * 4 + 48, 16);
+
+		Word_Vec hit = { 0, 0, 0, 0 };
+		for (uint32_t k = 0; k < q->term_count; k++) {
+			Word_Vec m = { q->terms[k].scan_mask, q->terms[k].scan_mask, q->terms[k].scan_mask, q->terms[k].scan_mask };
+			Word_Vec v = { q->terms[k].scan_value, q->terms[k].scan_value, q->terms[k].scan_value,
+				q->terms[k].scan_value };
+			hit |= (Word_Vec)((a & m) == v) | (Word_Vec)((b & m) == v) | (Word_Vec)((c & m) == v) |
+				(Word_Vec)((d & m) == v);
+		}
+
+		if ((hit[0] | hit[1] | hit[2] | hit[3]) != 0) {
+			return i;
+		}
+	}
+	return i;
+}
+
+/*
+	Purpose: counts the words of a .text each pattern matches
+	Params: Grep_Query* q - the query, its byte order is set to the text's
+			const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			uint64_t* counts - each pattern's total to add to
+	Return: none
+*/
+void grepCount(Grep_Query* q, const uint8_t* text, uint32_t count, int big, uint64_t* counts) {
+	grepByteOrder(q, big);
+
+	uint32_t i = 0;
+	while (i < count) {
+		uint32_t run = scanHits(q, text, i, count);
+		uint32_t end = (run + GREP_STEP_WORDS < count) ? run + GREP_STEP_WORDS : count;
+		for (i = run; i < end; i++) {
+			uint32_t matched = grepMatch(q, elfGet32(text + (size_t)i * 4, big));
+			while (matched != 0) {
+				counts[__builtin_ctz(matched)]++;
+				matched &= matched - 1;
+			}
+		}
+	}
+}
+
+/*
+	Purpose: searches one file, listing the hits into a buffer written as it fills
+	Params: const Grep_Query* q - the query
+			const char* path - the file
+			uint32_t raw_base - the address raw images start at
+			int raw_big - the byte order of raw images
+			int count_only - counts without listing
+			uint64_t* counts - each pattern's total to add to
+			uint64_t* bytes - the bytes scanned to add to
+	Return: int - 0 for no error
+*/
+static int grepFile(Grep_Query* q, const char* path, uint32_t raw_base, int raw_big, int count_only,
+	uint64_t* counts, uint64_t* bytes) {
+	Elf_Image image;
+	if (imageOpenAny(&image, path, raw_base, raw_big) != 0) {
+		return 1;
+	}
+
+	char* buffer = count_only ? NULL : malloc(IMAGE_OUT_SIZE);
+	if (!count_only && buffer == NULL) {
+		error("Out of memory");
+		imageClose(&image);
+		return 1;
+	}
+
+	grepByteOrder(q, image.big);
+	uint32_t count = image.text_size / 4;
+	size_t used = 0;
+	int failed = 0;
+
+	// the vector scan skips runs with no hit, the runs it stops at and the tail are checked word by word
+	uint32_t i = 0;
+	while (i < count && !failed) {
+		uint32_t run = scanHits(q, image.text, i, count);
+		uint32_t end = (run + GREP_STEP_WORDS < count) ? run + GREP_STEP_WORDS : count;
+		for (i = run; i < end; i++) {
+			uint32_t word = elfGet32(image.text + (size_t)i * 4, image.big);
+			uint32_t matched = grepMatch(q, word);
+			if (matched == 0) {
+				continue;
+			}
+
+			for (uint32_t p = 0; p < q->pattern_count; p++) {
+				counts[p] += (matched >> p) & 1;
+			}
+			if (count_only) {
+				continue;
+			}
+
+			if (IMAGE_OUT_SIZE - used < GREP_LINE_MAX + 4 * GREP_MAX_PATTERNS) {
+				failed = (fwrite(buffer, 1, used, stdout) != used);
+				used = 0;
+			}
+			Decoded_Instruct d;
+			char text[ASSM_TEXT_SIZE];
+			decodeWord(word, &d);
+			formatAssm(text, &d);
+			used += (size_t)snprintf(buffer + used, GREP_LINE_MAX, "%.64s:%08X:  %08X  %-28s", path,
+				image.text_addr + i * 4, word, text);
+			if (q->pattern_count > 1) {
+				for (uint32_t p = 0; p < q->pattern_count; p++) {
+					if ((matched >> p) & 1) {
+						used += (size_t)sprintf(buffer + used, " #%u", p + 1);
+					}
+				}
+			}
+			buffer[used++] = '\n';
+		}
+	}
+	if (!count_only) {
+		failed |= (fwrite(buffer, 1, used, stdout) != used);
+	}
+
+	*bytes += image.text_size;
+	free(buffer);
+	imageClose(&image);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --grep mode, lists or counts the instructions matching any pattern in each file
+	Params: int argc - number of arguments after the mode
+			char** argv - [-c] [-EB|-EL] [-a addr] -e pattern [-e pattern]... <file>...
+	Return: int - exit code, 1 when nothing matched
+*/
+int grepMain(int argc, char** argv) {
+	static Grep_Query q;
+	int big = 1;
+	int count_only = 0;
+	uint32_t raw_base = TEXT_BASE;
+	memset(&q, 0, sizeof(q));
+
+	while (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		if (imageOptions(&argc, &argv, &raw_base, &big, NULL) > 0) {
+			continue;
+		}
+		if (strcmp(argv[0], "-c") == 0) {
+			count_only = 1;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[0], "-e") == 0 && argc > 1) {
+			if (grepCompile(&q, argv[1]) != 0) {
+				return 2;
+			}
+			argc -= 2;
+			argv += 2;
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 2;
+		}
+	}
+	if (q.pattern_count == 0 || argc < 1) {
+		error("--grep needs at least one -e pattern and a file");
+		return 2;
+	}
+
+	fflush(stdout);
+	uint64_t counts[GREP_MAX_PATTERNS] = { 0 };
+	uint64_t bytes = 0;
+	int failed = 0;
+	double start = getTime();
+	for (int f = 0; f < argc; f++) {
+		failed |= grepFile(&q, argv[f], raw_base, big, count_only, counts, &bytes);
+	}
+	fflush(stdout);
+	double wall = getTime() - start;
+
+	uint64_t total = 0;
+	for (uint32_t p = 0; p < q.pattern_count; p++) {
+		fprintf(stderr, "#%u %-32s %llu\n", p + 1, q.patterns[p], (unsigned long long)counts[p]);
+		total += counts[p];
+	}
+	fprintf(stderr, "Files: %d\tTerms: %u\tScanned: %.1f MB\tTime: %.6f s\t%.1f MB/s\n", argc, q.term_count,
+		bytes / 1e6, wall, wall > 0 ? bytes / wall / 1e6 : 0.0);
+
+	if (failed) {
+		return 2;
+	}
+	return (total == 0) ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+#ifndef _MIPS_GREP_H_
+#define _MIPS_GREP_H_
+
+#include <stdint.h>
+
+/*
+	Instruction search over the raw words of images. A pattern is a
+	mnemonic, or * for any, then constraints on the fields:
+
+		rs rt rd    a register, = or !=, by name ($sp) or number ($29)
+		dest        the register the instruction writes, rd or rt
+		base        the base register of LW/SW
+		imm         the immediate, =, !=, <, <=, > or >=, sign extended
+		            for ADDI/SLTI/LW/SW/BEQ/BNE and zero extended otherwise
+
+	so "SW base=$sp", "* dest=$sp" and "BEQ imm<0" find stores off the
+	stack pointer, writes to it and backward branches.
+
+	Each pattern becomes one term per op it can match, a mask and value
+	over the 32 bit word that fixes the opcode, the funct of R-type ops,
+	any register given with = and the parts of the immediate that can be
+	fixed (all of it for =, the sign bit for < 0 and >= 0). The terms are
+	swapped into the file's byte order, so the mapped .text is scanned as
+	it is, 16 words at a time with vector and/compare. Only words some
+	term hits are read, decoded and checked against the rest of their
+	pattern.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// most patterns one search takes
+#define GREP_MAX_PATTERNS 32
+
+// most terms all the patterns compile to
+#define GREP_MAX_TERMS 512
+
+// words scanned per step, four vectors of four
+#define GREP_STEP_WORDS 16
+
+// most words one pattern has, the mnemonic and its constraints
+#define GREP_MAX_WORDS 16
+
+// most imm!= constraints one pattern has
+#define GREP_MAX_IMM_NE 4
+
+// the register fields in the order reg_ne keeps them, then the immediate
+#define GREP_FIELD_RS 0
+#define GREP_FIELD_RT 1
+#define GREP_FIELD_RD 2
+#define GREP_FIELD_IMM 3
+#define GREP_FIELD_DEST 4
+#define GREP_FIELD_BASE 5
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// one op a pattern matches, with what the mask could not check
+typedef struct {
+	uint32_t mask;
+	uint32_t value;
+	uint32_t scan_mask;
+	uint32_t scan_value;
+	uint8_t op;
+	uint8_t pattern;
+	uint8_t imm_signed;
+	uint8_t imm_ne_count;
+	uint32_t reg_ne[3];
+	int32_t imm_lo;
+	int32_t imm_hi;
+	int32_t imm_ne[GREP_MAX_IMM_NE];
+} Grep_Term;
+
+// compiled patterns
+typedef struct {
+	Grep_Term terms[GREP_MAX_TERMS];
+	uint32_t term_count;
+	uint32_t pattern_count;
+	const char* patterns[GREP_MAX_PATTERNS];
+} Grep_Query;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: finds the fields an op has
+	Params: uint32_t op - the op
+			int* dest - filled with the field it writes, -1 for none
+			int* base - filled with its base register field, -1 for none
+	Return: uint32_t - one bit per GREP_FIELD_ it has
+*/
+uint32_t grepOpFields(uint32_t op, int* dest, int* base);
+
+/*
+	Purpose: compiles a pattern into the terms of a query
+	Params: Grep_Query* q - the query to add to
+			const char* text - the pattern
+	Return: int - 0 for no error
+*/
+int grepCompile(Grep_Query* q, const char* text);
+
+/*
+	Purpose: sets the byte order the scan terms are in
+	Params: Grep_Query* q - the query
+			int big - 1 for big endian words
+	Return: none
+*/
+void grepByteOrder(Grep_Query* q, int big);
+
+/*
+	Purpose: checks the parts of a term its mask could not, the immediate range and the != registers
+	Params: const Grep_Term* t - the term
+			uint32_t rs - the word's rs field
+			uint32_t rt - the word's rt field
+			uint32_t rd - the word's rd field
+			uint32_t imm - the word's immediate field
+	Return: int - 1 if they pass
+*/
+int grepTermRest(const Grep_Term* t, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t imm);
+
+/*
+	Purpose: finds which patterns a host order word matches
+	Params: const Grep_Query* q - the query
+			uint32_t word - the word
+	Return: uint32_t - one bit per pattern
+*/
+uint32_t grepMatch(const Grep_Query* q, uint32_t word);
+
+/*
+	Purpose: counts the words of a .text each pattern matches
+	Params: Grep_Query* q - the query, its byte order is set to the text's
+			const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			uint64_t* counts - each pattern's total to add to
+	Return: none
+*/
+void grepCount(Grep_Query* q, const uint8_t* text, uint32_t count, int big, uint64_t* counts);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --grep mode, lists or counts the instructions matching any pattern in each file
+	Params: int argc - number of arguments after the mode
+			char** argv - [-c] [-EB|-EL] [-a addr] -e pattern [-e pattern]... <file>...
+	Return: int - exit code, 1 when nothing matched
+*/
+int grepMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,702 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Dom.h"
+#include "MIPS_Cache.h"
+#include "MIPS_Util.h"
+
+// column the comment with the address, word and symbol starts at, a tab counts as 8
+#define COMMENT_COLUMN 40
+
+// longest disassembly line, the symbol name is cut to fit
+#define LINE_MAX 192
+
+/*----------------------------\
+		   Loading
+\----------------------------*/
+/*
+	Purpose: checks whether a file starts with the ELF magic number
+	Params: const char* path - the file to check
+	Return: int - 1 if it does
+*/
+int imageIsElf(const char* path) {
+	unsigned char magic[4] = { 0 };
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	size_t got = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+	return got == sizeof(magic) && magic[0] == 0x7F && magic[1] == 'E' && magic[2] == 'L' && magic[3] == 'F';
+}
+
+/*
+	Purpose: orders symbols by address, globals first at the same address
+	Params: const void* a - the first Image_Symbol
+			const void* b - the second Image_Symbol
+	Return: int - less than, equal to or greater than 0
+*/
+static int compareSymbols(const void* a, const void* b) {
+	const Image_Symbol* x = a;
+	const Image_Symbol* y = b;
+
+	if (x->addr != y->addr) {
+		return (x->addr < y->addr) ? -1 : 1;
+	}
+	return (int)y->global - (int)x->global;
+}
+
+/*
+	Purpose: reads a section header, checking that its contents lie inside the file
+	Params: const Elf_Image* image - the image
+			uint32_t index - the section number
+			Elf_Section* s - the section header to fill
+	Return: int - 0 for no error
+*/
+static int readSection(const Elf_Image* image, uint32_t index, Elf_Section* s) {
+	if (index >= image->header.shnum) {
+		return 1;
+	}
+	elfUnpackSection(image->map + image->header.shoff + (size_t)index * ELF32_SHDR_SIZE, s, image->big);
+
+	if (s->type != ELF_SHT_NOBITS && (uint64_t)s->offset + s->size > image->size) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+	Purpose: loads the defined .text symbols and sorts them by address
+	Params: Elf_Image* image - the image
+			uint32_t text_index - the section number of .text
+	Return: int - 0 for no error
+*/
+static int loadSymbols(Elf_Image* image, uint32_t text_index) {
+	for (uint32_t i = 1; i < image->header.shnum; i++) {
+		Elf_Section symtab;
+		Elf_Section strtab;
+		if (readSection(image, i, &symtab) != 0) {
+			return 1;
+		}
+		if (symtab.type != ELF_SHT_SYMTAB) {
+			continue;
+		}
+
+		// names must end inside their table
+		if (readSection(image, symtab.link, &strtab) != 0 || strtab.size == 0 ||
+			image->map[strtab.offset + strtab.size - 1] != '\0') {
+			return 1;
+		}
+
+		uint32_t count = symtab.size / ELF32_SYM_SIZE;
+		image->syms = malloc((count + 1) * sizeof(Image_Symbol));
+		if (image->syms == NULL) {
+			return 1;
+		}
+
+		for (uint32_t j = 1; j < count; j++) {
+			Elf_Symbol sym;
+			elfUnpackSymbol(image->map + symtab.offset + (size_t)j * ELF32_SYM_SIZE, &sym, image->big);
+			if (sym.shndx != text_index || sym.name >= strtab.size || (sym.info & 0xF) == ELF_STT_SECTION) {
+				continue;
+			}
+
+			Image_Symbol* entry = &image->syms[image->sym_count++];
+			entry->addr = sym.value;
+			entry->global = (ELF_ST_BIND(sym.info) != ELF_STB_LOCAL);
+			entry->name = (const char*)image->map + strtab.offset + sym.name;
+		}
+
+		qsort(image->syms, image->sym_count, sizeof(Image_Symbol), compareSymbols);
+		return 0;
+	}
+
+	return 0;
+}
+
+/*
+	Purpose: maps an ELF32 MIPS file and finds its .text, .data and .text symbols
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file to map
+	Return: int - 0 for no error
+*/
+int imageOpen(Elf_Image* image, const char* path) {
+	memset(image, 0, sizeof(*image));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		perror(path);
+		close(fd);
+		return 1;
+	}
+	if (info.st_size < ELF32_EHDR_SIZE) {
+		printf("ERROR: %s is not an ELF32 MIPS file\n", path);
+		close(fd);
+		return 1;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	image->size = (size_t)info.st_size;
+	void* map = mmap(NULL, image->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return 1;
+	}
+	image->map = map;
+
+	if (elfUnpackHeader(image->map, &image->header, &image->big) != 0 ||
+		(uint64_t)image->header.shoff + (uint64_t)image->header.shnum * ELF32_SHDR_SIZE > image->size) {
+		printf("ERROR: %s is not an ELF32 MIPS file\n", path);
+		imageClose(image);
+		return 1;
+	}
+
+	// sections are named through the section name table
+	Elf_Section names;
+	if (readSection(image, image->header.shstrndx, &names) != 0) {
+		printf("ERROR: %s has no section names\n", path);
+		imageClose(image);
+		return 1;
+	}
+
+	uint32_t text_index = 0;
+	for (uint32_t i = 1; i < image->header.shnum; i++) {
+		Elf_Section s;
+		if (readSection(image, i, &s) != 0) {
+			printf("ERROR: %s has a section past the end of the file\n", path);
+			imageClose(image);
+			return 1;
+		}
+		if (s.name >= names.size) {
+			continue;
+		}
+
+		// the whole name and its terminator must fit in the table, a cut off ".te" is not ".text"
+		const char* name = (const char*)image->map + names.offset + s.name;
+		size_t room = names.size - s.name;
+		int is_text = room >= sizeof(".text") && memcmp(name, ".text", sizeof(".text")) == 0;
+		int is_data = room >= sizeof(".data") && memcmp(name, ".data", sizeof(".data")) == 0;
+
+		// .text and .data are read straight from the file, so they must have their bytes in it
+		if ((is_text || is_data) && s.type != ELF_SHT_PROGBITS) {
+			printf("ERROR: %s has a %s section with no contents in the file\n", path, is_text ? ".text" : ".data");
+			imageClose(image);
+			return 1;
+		}
+
+		if (is_text && text_index == 0) {
+			text_index = i;
+			image->text = image->map + s.offset;
+			image->text_addr = s.addr;
+			image->text_size = s.size & ~3u;
+		}
+		else if (is_data && image->data == NULL) {
+			image->data = image->map + s.offset;
+			image->data_addr = s.addr;
+			image->data_size = s.size & ~3u;
+		}
+	}
+
+	if (text_index == 0) {
+		printf("ERROR: %s has no .text section\n", path);
+		imageClose(image);
+		return 1;
+	}
+	if (loadSymbols(image, text_index) != 0) {
+		printf("ERROR: %s has a broken symbol table\n", path);
+		imageClose(image);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+	Purpose: opens an Intel HEX, S-record or raw image as .text
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			int big - the byte order of the words
+	Return: int - 0 for no error
+*/
+int imageOpenFlash(Elf_Image* image, const char* path, uint32_t raw_base, int big) {
+	memset(image, 0, sizeof(*image));
+	if (flashLoad(path, raw_base, &image->flash) != 0) {
+		return 1;
+	}
+
+	// the flash image owns the bytes, map stays NULL so only flashFree releases them
+	image->big = big;
+	image->text = image->flash.bytes;
+	image->text_addr = image->flash.base;
+	image->text_size = image->flash.size & ~3u;
+	image->header.type = ELF_ET_EXEC;
+	image->header.machine = ELF_EM_MIPS;
+	image->header.entry = image->flash.has_entry ? image->flash.entry : image->flash.base;
+	return 0;
+}
+
+/*
+	Purpose: opens an ELF file, or anything else as an Intel HEX, S-record or raw image
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			int big - the byte order of the words when the file is not ELF
+	Return: int - 0 for no error
+*/
+int imageOpenAny(Elf_Image* image, const char* path, uint32_t raw_base, int big) {
+	return imageIsElf(path) ? imageOpen(image, path) : imageOpenFlash(image, path, raw_base, big);
+}
+
+/*
+	Purpose: takes the -EB, -EL, -a and -j options from the front of the arguments, stopping at any other
+	Params: int* argc - the argument count, reduced past the options
+			char*** argv - the arguments, moved past the options
+			uint32_t* raw_base - set by -a
+			int* big - set by -EB and -EL
+			int* threads - set by -j, NULL when the mode has no -j
+	Return: int - the number of options taken, 0 when the first argument is not one
+*/
+int imageOptions(int* argc, char*** argv, uint32_t* raw_base, int* big, int* threads) {
+	int taken = 0;
+	while (*argc > 0) {
+		char* opt = (*argv)[0];
+		if (strcmp(opt, "-EB") == 0 || strcmp(opt, "-EL") == 0) {
+			*big = (strcmp(opt, "-EB") == 0);
+			(*argc)--;
+			(*argv)++;
+		}
+		else if (strcmp(opt, "-a") == 0 && *argc > 1) {
+			*raw_base = (uint32_t)strtoul((*argv)[1], NULL, 0);
+			*argc -= 2;
+			*argv += 2;
+		}
+		else if (strcmp(opt, "-j") == 0 && *argc > 1 && threads != NULL) {
+			*threads = atoi((*argv)[1]);
+			*argc -= 2;
+			*argv += 2;
+		}
+		else {
+			break;
+		}
+		taken++;
+	}
+	return taken;
+}
+
+/*
+	Purpose: unmaps the file and releases the symbols and any swapped copy
+	Params: Elf_Image* image - the image to release
+	Return: none
+*/
+void imageClose(Elf_Image* image) {
+	if (image->map != NULL) {
+		munmap((void*)image->map, image->size);
+	}
+	flashFree(&image->flash);
+	free(image->syms);
+	free(image->swapped);
+	memset(image, 0, sizeof(*image));
+}
+
+/*
+	Purpose: gets .text as host order words, the mapping itself when the byte order allows
+	Params: Elf_Image* image - the image
+			uint32_t* count - filled with the number of words
+	Return: const uint32_t* - the words, valid until imageClose, NULL if out of memory
+*/
+const uint32_t* imageText(Elf_Image* image, uint32_t* count) {
+	int host_big = hostIsBig();
+
+	*count = image->text_size / 4;
+	if (image->swapped != NULL) {
+		return image->swapped;
+	}
+	if (image->big == host_big && ((uintptr_t)image->text & 3) == 0) {
+		return (const uint32_t*)image->text;
+	}
+
+	image->swapped = malloc((*count + 1) * sizeof(uint32_t));
+	if (image->swapped == NULL) {
+		return NULL;
+	}
+	for (uint32_t i = 0; i < *count; i++) {
+		image->swapped[i] = elfGet32(image->text + (size_t)i * 4, image->big);
+	}
+	return image->swapped;
+}
+
+/*
+	Purpose: finds the symbol an address falls in, the last one at or below it
+	Params: const Elf_Image* image - the image
+			uint32_t addr - the address
+	Return: const Image_Symbol* - the symbol, NULL if the address is before every symbol
+*/
+const Image_Symbol* imageSymbolAt(const Elf_Image* image, uint32_t addr) {
+	uint32_t low = 0;
+	uint32_t high = image->sym_count;
+
+	// finds the first symbol past the address
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (image->syms[mid].addr <= addr) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	if (low == 0) {
+		return NULL;
+	}
+
+	// the first of several symbols at the same address is the preferred one
+	const Image_Symbol* sym = &image->syms[low - 1];
+	while (sym > image->syms && sym[-1].addr == sym->addr) {
+		sym--;
+	}
+	return sym;
+}
+
+
+/*----------------------------\
+		  Disassembly
+\----------------------------*/
+/*
+	Purpose: writes a word as 8 uppercase hex digits
+	Params: char* out - where to write
+			uint32_t value - the word
+	Return: char* - the end of the written text
+*/
+static char* appendHex8(char* out, uint32_t value) {
+	static const char hex_digits[] = "0123456789ABCDEF";
+	for (int shift = 28; shift >= 0; shift -= 4) {
+		*out++ = hex_digits[(value >> shift) & 0xF];
+	}
+	return out;
+}
+
+/*
+	Purpose: formats one line of disassembly that --elf reads back, with a label line first when a symbol starts there
+	Params: char* out - LINE_MAX * 2 bytes to fill
+			uint32_t addr - the word's address
+			uint32_t word - the word
+			const Image_Symbol* sym - the symbol the address is in, NULL for none
+			const char* note - more text for the comment, NULL for none
+	Return: size_t - the number of bytes written
+*/
+static size_t formatLine(char* out, uint32_t addr, uint32_t word, const Image_Symbol* sym, const char* note) {
+	char* start = out;
+	size_t name_len = (sym != NULL) ? strnlen(sym->name, LINE_MAX / 2) : 0;
+
+	// a label line where each symbol starts, in the syntax the object assembler reads
+	if (sym != NULL && sym->addr == addr) {
+		*out++ = '\n';
+		memcpy(out, sym->name, name_len);
+		out += name_len;
+		*out++ = ':';
+		*out++ = '\n';
+	}
+
+	// the assembly, or the word itself when it does not decode
+	char* line = out;
+	*out++ = '\t';
+	Decoded_Instruct d;
+	if (decodeWord(word, &d) != OP_INVALID) {
+		out += formatAssm(out, &d);
+	}
+	else {
+		memcpy(out, ".word 0x", 8);
+		out = appendHex8(out + 8, word);
+	}
+
+	// the address, word, symbol and offset go in a comment, so the text still assembles
+	while (out - line + 7 < COMMENT_COLUMN) {
+		*out++ = ' ';
+	}
+	*out++ = ';';
+	*out++ = ' ';
+	out = appendHex8(out, addr);
+	*out++ = ' ';
+	*out++ = ' ';
+	out = appendHex8(out, word);
+	if (sym != NULL || note != NULL) {
+		*out++ = ' ';
+		*out++ = ' ';
+	}
+	if (sym != NULL) {
+		memcpy(out, sym->name, name_len);
+		out += name_len;
+		if (addr != sym->addr) {
+			memcpy(out, "+0x", 3);
+			out += 3;
+
+			// the offset without leading zeros
+			char hex[8];
+			appendHex8(hex, addr - sym->addr);
+			int skip = 0;
+			while (skip < 7 && hex[skip] == '0') {
+				skip++;
+			}
+			memcpy(out, hex + skip, 8 - skip);
+			out += 8 - skip;
+		}
+	}
+	if (note != NULL) {
+		if (sym != NULL) {
+			*out++ = ',';
+			*out++ = ' ';
+		}
+		size_t note_len = strlen(note);
+		memcpy(out, note, note_len);
+		out += note_len;
+	}
+	*out++ = '\n';
+
+	return (size_t)(out - start);
+}
+
+
+/*
+	Purpose: disassembles the .text of an image, copying the text of pages a cache already holds
+	Params: Elf_Image* image - the image
+			FILE* out - where the text goes
+			int loops - 1 to mark the lines in loops with their depth
+			const char* cache_path - the page cache to use and then replace, NULL for none
+			Disasm_Stats* stats - filled with what was done
+	Return: int - 0 for no error
+*/
+int imageDisasm(Elf_Image* image, FILE* out, int loops, const char* cache_path, Disasm_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	double start = getTime();
+	uint32_t count = image->text_size / 4;
+
+	Page_Cache cache;
+	if (cache_path != NULL && cacheOpen(&cache, cache_path) != 0) {
+		return 1;
+	}
+	char* buffer = malloc(IMAGE_OUT_SIZE);
+	if (buffer == NULL) {
+		error("Out of memory");
+		if (cache_path != NULL) {
+			cacheClose(&cache, 0);
+		}
+		return 1;
+	}
+	size_t used = 0;
+	int failed = 0;
+
+	// with -l each line in a loop is marked with its depth, found from the graph of the whole .text
+	Cfg cfg;
+	Cfg_Stats cfg_stats;
+	Dom dom;
+	Dom_Stats dom_stats;
+	const uint32_t* words = loops ? imageText(image, &count) : NULL;
+	if (loops && words == NULL) {
+		error("Out of memory");
+		loops = 0;
+		failed = 1;
+	}
+	else if (loops && cfgBuild(&cfg, words, count, image->text_addr, 0, &cfg_stats) != 0) {
+		loops = 0;
+		failed = 1;
+	}
+	else if (loops && domBuild(&dom, &cfg, &dom_stats) != 0) {
+		cfgFree(&cfg);
+		loops = 0;
+		failed = 1;
+	}
+	uint32_t block = 0;
+	char note[32];
+
+	// what each word of a page is marked with, found before the page is looked up
+	const Image_Symbol* page_sym[CACHE_PAGE_WORDS];
+	uint32_t page_note[CACHE_PAGE_WORDS];
+
+	// words are read straight from the mapping in the file's byte order
+	const Image_Symbol* sym = (image->sym_count > 0) ? imageSymbolAt(image, image->text_addr) : NULL;
+	const Image_Symbol* next = (sym != NULL) ? sym + 1 : image->syms;
+	for (uint32_t first = 0; first < count && !failed; first += CACHE_PAGE_WORDS) {
+		uint32_t size = (count - first < CACHE_PAGE_WORDS) ? count - first : CACHE_PAGE_WORDS;
+		const uint8_t* page = image->text + (size_t)first * 4;
+		uint32_t page_addr = image->text_addr + first * 4;
+
+		// the key is the words chained with the address, byte order, symbols and loop marks
+		uint64_t seed = ((uint64_t)page_addr << 32) | (uint64_t)(image->big << 1) | (uint64_t)loops;
+		uint64_t key = hash64(page, (size_t)size * 4, seed);
+		for (uint32_t j = 0; j < size; j++) {
+			uint32_t i = first + j;
+			uint32_t addr = image->text_addr + i * 4;
+
+			// the next symbol is only searched for once the address reaches it
+			if (next < image->syms + image->sym_count && next->addr <= addr) {
+				sym = imageSymbolAt(image, addr);
+				next = sym + 1;
+				while (next < image->syms + image->sym_count && next->addr <= addr) {
+					next++;
+				}
+			}
+			if (sym != NULL && (j == 0 || sym != page_sym[j - 1])) {
+				key = hash64(sym->name, strnlen(sym->name, LINE_MAX / 2), key ^ (((uint64_t)j << 32) | sym->addr));
+			}
+			page_sym[j] = sym;
+
+			page_note[j] = 0;
+			if (loops) {
+				while (cfg.block_start[block + 1] <= i) {
+					block++;
+				}
+				int header = (dom.loop_header[block] == block && cfg.block_start[block] == i);
+				page_note[j] = (dom.loop_depth[block] << 1) | (uint32_t)header;
+			}
+		}
+		if (loops) {
+			key = hash64(page_note, (size_t)size * sizeof(uint32_t), key);
+		}
+
+		// a whole page of text always fits after a flush
+		if (IMAGE_OUT_SIZE - used < (size_t)CACHE_PAGE_WORDS * LINE_MAX * 2) {
+			failed = (fwrite(buffer, 1, used, out) != used);
+			stats->bytes_out += used;
+			used = 0;
+		}
+
+		uint32_t text_size = 0;
+		const char* text = (cache_path != NULL) ? cacheFind(&cache, key, page, size * 4, &text_size) : NULL;
+		if (text != NULL && text_size <= (size_t)CACHE_PAGE_WORDS * LINE_MAX * 2) {
+			memcpy(buffer + used, text, text_size);
+			stats->hits++;
+		}
+		else {
+			size_t page_start = used;
+			for (uint32_t j = 0; j < size; j++) {
+				const char* comment = NULL;
+				if (page_note[j] > 1) {
+					snprintf(note, sizeof(note), (page_note[j] & 1) ? "loop depth %u header" : "loop depth %u",
+						page_note[j] >> 1);
+					comment = note;
+				}
+				used += formatLine(buffer + used, page_addr + j * 4, elfGet32(page + (size_t)j * 4, image->big),
+					page_sym[j], comment);
+			}
+			text_size = (uint32_t)(used - page_start);
+			used = page_start;
+			if (cache_path != NULL) {
+				failed |= cacheAdd(&cache, key, page, size * 4, buffer + used, text_size);
+			}
+		}
+		used += text_size;
+		stats->pages++;
+	}
+	failed |= (fwrite(buffer, 1, used, out) != used);
+	stats->bytes_out += used;
+	fflush(out);
+
+	if (loops) {
+		stats->loop_count = dom.loop_count;
+		stats->max_depth = dom.max_depth;
+		stats->cfg_time = cfg_stats.time;
+		stats->loop_time = dom_stats.time;
+		domFree(&dom);
+		cfgFree(&cfg);
+	}
+	if (cache_path != NULL) {
+		failed |= cacheClose(&cache, !failed);
+	}
+	free(buffer);
+
+	stats->words = count;
+	stats->time = getTime() - start;
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --disasm mode, disassembles the .text of an ELF file with each line marked by its symbol
+	Params: int argc - number of arguments after the mode
+			char** argv - [-l] [-c cache] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int disasmMain(int argc, char** argv) {
+	int big = 1;
+	int loops = 0;
+	const char* cache_path = NULL;
+	uint32_t raw_base = TEXT_BASE;
+	while (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		if (imageOptions(&argc, &argv, &raw_base, &big, NULL) > 0) {
+			continue;
+		}
+		if (strcmp(argv[0], "-l") == 0) {
+			loops = 1;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[0], "-c") == 0 && argc > 1) {
+			cache_path = argv[1];
+			argc -= 2;
+			argv += 2;
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 1;
+		}
+	}
+	if (argc < 1) {
+		error("--disasm needs an ELF, Intel HEX, S-record or raw file");
+		return 1;
+	}
+
+	Elf_Image image;
+	if (imageOpenAny(&image, argv[0], raw_base, big) != 0) {
+		return 1;
+	}
+
+	FILE* out = stdout;
+	if (argc > 1 && strcmp(argv[1], "-") != 0) {
+		out = fopen(argv[1], "w");
+		if (out == NULL) {
+			perror(argv[1]);
+			imageClose(&image);
+			return 1;
+		}
+	}
+
+	Disasm_Stats stats;
+	int failed = imageDisasm(&image, out, loops, cache_path, &stats);
+	if (out != stdout) {
+		failed |= (fclose(out) != 0);
+	}
+
+	fprintf(stderr, "%s: %s endian, %u words of .text at 0x%08X, %u symbols\n", argv[0], image.big ? "big" : "little",
+		stats.words, image.text_addr, image.sym_count);
+	fprintf(stderr, "Out: %llu bytes\tTime: %.6f s\t%.1f M words/s\n", (unsigned long long)stats.bytes_out,
+		stats.time, stats.time > 0 ? stats.words / stats.time / 1e6 : 0.0);
+	if (loops) {
+		fprintf(stderr, "Loops: %u\tMax depth: %u\tCFG: %.6f s\tLoops: %.6f s\n", stats.loop_count, stats.max_depth,
+			stats.cfg_time, stats.loop_time);
+	}
+	if (cache_path != NULL) {
+		fprintf(stderr, "Cache: %u of %u pages hit (%.1f%%)\n", stats.hits, stats.pages,
+			stats.pages > 0 ? 100.0 * stats.hits / stats.pages : 0.0);
+	}
+
+	imageClose(&image);
+	return failed;
+}
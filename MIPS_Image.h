@@ -0,0 +1,176 @@
+#ifndef _MIPS_IMAGE_H_
+#define _MIPS_IMAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "MIPS_Elf.h"
+#include "MIPS_Flash.h"
+
+/*
+	An ELF32 MIPS file mapped read only. .text and .data are found through
+	the section headers and point straight into the mapping. When the
+	file's byte order matches the host, the execution engine gets a pointer
+	to the words in the mapping. Otherwise it gets a swapped copy. The
+	defined .text symbols from .symtab are sorted by address, so finding
+	the function that contains an address is a binary search.
+
+	Intel HEX, S-record and raw images open as a .text with no symbols, so
+	--disasm takes them too. With -l it also marks each line in a loop with
+	the loop depth, and the first line of each loop as its header. With -c
+	the text of each 4 KB page is kept in a cache file and copied from it
+	the next time the page comes up unchanged.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// bytes of disassembly collected before each write
+#define IMAGE_OUT_SIZE (1u << 20)
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a .text symbol, the name points into the mapping
+typedef struct {
+	uint32_t addr;
+	uint8_t global;
+	const char* name;
+} Image_Symbol;
+
+// a mapped ELF file and what was found in it
+typedef struct {
+	const uint8_t* map;
+	size_t size;
+	int big;
+	Elf_Header header;
+
+	// section contents in file byte order, inside the mapping
+	const uint8_t* text;
+	uint32_t text_addr;
+	uint32_t text_size;
+	const uint8_t* data;
+	uint32_t data_addr;
+	uint32_t data_size;
+
+	// .text symbols sorted by address
+	Image_Symbol* syms;
+	uint32_t sym_count;
+
+	// host order copy of .text, only made when the mapping cannot be used as is
+	uint32_t* swapped;
+
+	// the image .text is in when it was not opened from an ELF file
+	Flash_Image flash;
+} Elf_Image;
+
+// what disassembling an image took
+typedef struct {
+	uint32_t words;
+	uint32_t pages;
+	uint32_t hits;
+	uint64_t bytes_out;
+	uint32_t loop_count;
+	uint32_t max_depth;
+	double cfg_time;
+	double loop_time;
+	double time;
+} Disasm_Stats;
+
+
+/*----------------------------\
+		   Loading
+\----------------------------*/
+/*
+	Purpose: checks whether a file starts with the ELF magic number
+	Params: const char* path - the file to check
+	Return: int - 1 if it does
+*/
+int imageIsElf(const char* path);
+
+/*
+	Purpose: maps an ELF32 MIPS file and finds its .text, .data and .text symbols
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file to map
+	Return: int - 0 for no error
+*/
+int imageOpen(Elf_Image* image, const char* path);
+
+/*
+	Purpose: opens an Intel HEX, S-record or raw image as .text
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			int big - the byte order of the words
+	Return: int - 0 for no error
+*/
+int imageOpenFlash(Elf_Image* image, const char* path, uint32_t raw_base, int big);
+
+/*
+	Purpose: opens an ELF file, or anything else as an Intel HEX, S-record or raw image
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file
+			uint32_t raw_base - the address a raw file starts at
+			int big - the byte order of the words when the file is not ELF
+	Return: int - 0 for no error
+*/
+int imageOpenAny(Elf_Image* image, const char* path, uint32_t raw_base, int big);
+
+/*
+	Purpose: takes the -EB, -EL, -a and -j options from the front of the arguments, stopping at any other
+	Params: int* argc - the argument count, reduced past the options
+			char*** argv - the arguments, moved past the options
+			uint32_t* raw_base - set by -a
+			int* big - set by -EB and -EL
+			int* threads - set by -j, NULL when the mode has no -j
+	Return: int - the number of options taken, 0 when the first argument is not one
+*/
+int imageOptions(int* argc, char*** argv, uint32_t* raw_base, int* big, int* threads);
+
+/*
+	Purpose: unmaps the file and releases the symbols and any swapped copy
+	Params: Elf_Image* image - the image to release
+	Return: none
+*/
+void imageClose(Elf_Image* image);
+
+/*
+	Purpose: gets .text as host order words, the mapping itself when the byte order allows
+	Params: Elf_Image* image - the image
+			uint32_t* count - filled with the number of words
+	Return: const uint32_t* - the words, valid until imageClose, NULL if out of memory
+*/
+const uint32_t* imageText(Elf_Image* image, uint32_t* count);
+
+/*
+	Purpose: finds the symbol an address falls in, the last one at or below it
+	Params: const Elf_Image* image - the image
+			uint32_t addr - the address
+	Return: const Image_Symbol* - the symbol, NULL if the address is before every symbol
+*/
+const Image_Symbol* imageSymbolAt(const Elf_Image* image, uint32_t addr);
+
+/*
+	Purpose: disassembles the .text of an image, copying the text of pages a cache already holds
+	Params: Elf_Image* image - the image
+			FILE* out - where the text goes
+			int loops - 1 to mark the lines in loops with their depth
+			const char* cache_path - the page cache to use and then replace, NULL for none
+			Disasm_Stats* stats - filled with what was done
+	Return: int - 0 for no error
+*/
+int imageDisasm(Elf_Image* image, FILE* out, int loops, const char* cache_path, Disasm_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --disasm mode, disassembles the .text of an ELF file with each line marked by its symbol
+	Params: int argc - number of arguments after the mode
+			char** argv - [-l] [-c cache] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int disasmMain(int argc, char** argv);
+
+#endif
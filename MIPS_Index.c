@@ -0,0 +1,693 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Grep.h"
+#include "MIPS_Index.h"
+#include "MIPS_Util.h"
+
+// one posting list per op, then one per register in each of rs, rt and rd
+#define INDEX_LIST_COUNT (OP_COUNT + 3 * 32)
+#define INDEX_REG_LIST(field, reg) (OP_COUNT + (field) * 32 + (reg))
+
+// written in host order, so an index from a host of the other byte order reads back swapped
+#define INDEX_BYTE_ORDER 0x01020304u
+
+// longest listing line, the path is cut to fit
+#define INDEX_LINE_MAX 160
+
+static const uint32_t field_shift[3] = { 21, 16, 11 };
+
+/*----------------------------\
+		   Building
+\----------------------------*/
+/*
+	Purpose: lays out the arrays of an index file, each on an 8 byte boundary
+	Params: Index_Header* header - the header, word and posting counts set, offsets filled
+	Return: none
+*/
+static void layoutIndex(Index_Header* header) {
+	uint64_t count = header->word_count;
+	uint64_t sizes[INDEX_SECTION_COUNT] = {
+		count * 4, count, count, count, count, count * 2,
+		((uint64_t)header->list_count + 1) * 8, header->posting_count * 4
+	};
+
+	uint64_t at = (sizeof(Index_Header) + 7) & ~7ull;
+	for (int s = 0; s < INDEX_SECTION_COUNT; s++) {
+		header->offsets[s] = at;
+		at = (at + sizes[s] + 7) & ~7ull;
+	}
+	header->file_size = at;
+}
+
+/*
+	Purpose: builds the index of a .text and writes it to a file
+	Params: const char* path - the index file to write
+			const char* source - the file the words came from, recorded to catch a stale index
+			const uint32_t* words - the words, host order
+			uint32_t count - the number of words
+			uint32_t text_addr - the address of the first word
+			Index_Stats* stats - filled with the sizes and times
+	Return: int - 0 for no error
+*/
+int indexWrite(const char* path, const char* source, const uint32_t* words, uint32_t count, uint32_t text_addr,
+	Index_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	double start = getTime();
+
+	// the fields each op posts its registers under
+	uint32_t has[OP_COUNT];
+	for (uint32_t op = 0; op < OP_COUNT; op++) {
+		int dest;
+		int base;
+		has[op] = grepOpFields(op, &dest, &base);
+	}
+
+	// sizes every list in a first pass so the postings go straight into place
+	uint64_t list_size[INDEX_LIST_COUNT] = { 0 };
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t word = words[i];
+		Op_Type op = wordOp(word);
+		if (op == OP_INVALID) {
+			continue;
+		}
+		list_size[op]++;
+		for (uint32_t f = 0; f < 3; f++) {
+			if ((has[op] >> f) & 1) {
+				list_size[INDEX_REG_LIST(f, (word >> field_shift[f]) & 0x1F)]++;
+			}
+		}
+	}
+
+	Index_Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, 4);
+	header.version = INDEX_VERSION;
+	header.byte_order = INDEX_BYTE_ORDER;
+	header.word_count = count;
+	header.text_addr = text_addr;
+	header.list_count = INDEX_LIST_COUNT;
+	for (uint32_t l = 0; l < INDEX_LIST_COUNT; l++) {
+		header.posting_count += list_size[l];
+	}
+	snprintf(header.source, sizeof(header.source), "%s", source);
+	struct stat info;
+	if (stat(source, &info) == 0) {
+		header.source_size = (uint64_t)info.st_size;
+		header.source_mtime = (int64_t)info.st_mtime;
+	}
+	layoutIndex(&header);
+
+	uint8_t* file = calloc(1, header.file_size);
+	if (file == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	memcpy(file, &header, sizeof(header));
+
+	uint8_t* op_out = file + header.offsets[INDEX_OP];
+	uint8_t* reg_out[3] = { file + header.offsets[INDEX_RS], file + header.offsets[INDEX_RT],
+		file + header.offsets[INDEX_RD] };
+	uint16_t* imm_out = (uint16_t*)(file + header.offsets[INDEX_IMM]);
+	uint64_t* list_start = (uint64_t*)(file + header.offsets[INDEX_LIST_START]);
+	uint32_t* postings = (uint32_t*)(file + header.offsets[INDEX_POSTINGS]);
+	memcpy(file + header.offsets[INDEX_WORDS], words, (size_t)count * 4);
+
+	// list_start ends as the start of each list, next is where its next posting goes
+	uint64_t next[INDEX_LIST_COUNT];
+	list_start[0] = 0;
+	for (uint32_t l = 0; l < INDEX_LIST_COUNT; l++) {
+		next[l] = list_start[l];
+		list_start[l + 1] = list_start[l] + list_size[l];
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t word = words[i];
+		Op_Type op = wordOp(word);
+		op_out[i] = (uint8_t)op;
+		reg_out[0][i] = (uint8_t)WORD_RS(word);
+		reg_out[1][i] = (uint8_t)WORD_RT(word);
+		reg_out[2][i] = (uint8_t)WORD_RD(word);
+		imm_out[i] = (uint16_t)WORD_IMM(word);
+		if (op == OP_INVALID) {
+			continue;
+		}
+
+		postings[next[op]++] = i;
+		for (uint32_t f = 0; f < 3; f++) {
+			if ((has[op] >> f) & 1) {
+				uint32_t list = INDEX_REG_LIST(f, (word >> field_shift[f]) & 0x1F);
+				postings[next[list]++] = i;
+			}
+		}
+	}
+	stats->build_time = getTime() - start;
+
+	start = getTime();
+	FILE* out = fopen(path, "wb");
+	int failed = (out == NULL);
+	if (out != NULL) {
+		failed |= (fwrite(file, 1, header.file_size, out) != header.file_size);
+		failed |= (fclose(out) != 0);
+	}
+	if (failed) {
+		perror(path);
+	}
+	free(file);
+	stats->write_time = getTime() - start;
+
+	stats->words = count;
+	stats->postings = header.posting_count;
+	stats->file_size = header.file_size;
+	return failed;
+}
+
+
+/*----------------------------\
+		   Mapping
+\----------------------------*/
+/*
+	Purpose: maps an index file and checks its header
+	Params: Image_Index* index - the index to fill
+			const char* path - the file
+	Return: int - 0 for no error
+*/
+int indexOpen(Image_Index* index, const char* path) {
+	memset(index, 0, sizeof(*index));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		perror(path);
+		close(fd);
+		return 1;
+	}
+	if ((uint64_t)info.st_size < sizeof(Index_Header)) {
+		printf("ERROR: %s is not an index file\n", path);
+		close(fd);
+		return 1;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	index->size = (size_t)info.st_size;
+	void* map = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return 1;
+	}
+	index->map = map;
+	index->header = (const Index_Header*)map;
+
+	// the layout is recomputed from the counts, so a header that disagrees with itself is caught
+	const Index_Header* h = index->header;
+	Index_Header expect;
+	memcpy(&expect, h, sizeof(expect));
+	if (memcmp(h->magic, INDEX_MAGIC, 4) != 0 || h->version != INDEX_VERSION) {
+		printf("ERROR: %s is not an index file\n", path);
+		indexClose(index);
+		return 1;
+	}
+	if (h->byte_order != INDEX_BYTE_ORDER) {
+		printf("ERROR: %s was written on a host of the other byte order\n", path);
+		indexClose(index);
+		return 1;
+	}
+	layoutIndex(&expect);
+	if (h->list_count != INDEX_LIST_COUNT || h->file_size != index->size ||
+		memcmp(expect.offsets, h->offsets, sizeof(expect.offsets)) != 0 || expect.file_size != h->file_size) {
+		printf("ERROR: %s is damaged\n", path);
+		indexClose(index);
+		return 1;
+	}
+
+	index->count = h->word_count;
+	index->words = (const uint32_t*)(index->map + h->offsets[INDEX_WORDS]);
+	index->op = index->map + h->offsets[INDEX_OP];
+	index->reg[0] = index->map + h->offsets[INDEX_RS];
+	index->reg[1] = index->map + h->offsets[INDEX_RT];
+	index->reg[2] = index->map + h->offsets[INDEX_RD];
+	index->imm = (const uint16_t*)(index->map + h->offsets[INDEX_IMM]);
+	index->list_start = (const uint64_t*)(index->map + h->offsets[INDEX_LIST_START]);
+	index->postings = (const uint32_t*)(index->map + h->offsets[INDEX_POSTINGS]);
+
+	// the lists must stay inside the postings, the postings themselves are checked as queries read them
+	for (uint32_t l = 0; l < INDEX_LIST_COUNT; l++) {
+		if (index->list_start[l] > index->list_start[l + 1]) {
+			printf("ERROR: %s is damaged\n", path);
+			indexClose(index);
+			return 1;
+		}
+	}
+	if (index->list_start[0] != 0 || index->list_start[INDEX_LIST_COUNT] != h->posting_count) {
+		printf("ERROR: %s is damaged\n", path);
+		indexClose(index);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+	Purpose: unmaps an index file
+	Params: Image_Index* index - the index
+	Return: none
+*/
+void indexClose(Image_Index* index) {
+	if (index->map != NULL) {
+		munmap((void*)index->map, index->size);
+	}
+	memset(index, 0, sizeof(*index));
+}
+
+
+/*----------------------------\
+		   Querying
+\----------------------------*/
+/*
+	Purpose: orders hits by word
+	Params: const void* a - the first hit
+			const void* b - the second hit
+	Return: int - <0, 0 or >0 as a is before, at or after b
+*/
+static int compareHits(const void* a, const void* b) {
+	uint32_t x = ((const Index_Hit*)a)->index;
+	uint32_t y = ((const Index_Hit*)b)->index;
+	return (x > y) - (x < y);
+}
+
+/*
+	Purpose: finds the words of an index each pattern of a query matches
+	Params: const Image_Index* index - the index
+			const Grep_Query* q - the compiled patterns
+			uint64_t* counts - each pattern's total to add to
+			Index_Hit** hits - filled with the hits in address order to free, NULL to only count
+			uint32_t* hit_count - filled with the number of hits
+	Return: int - 0 for no error, INDEX_DAMAGED for a posting past the words, 1 when out of memory
+*/
+int indexQuery(const Image_Index* index, const Grep_Query* q, uint64_t* counts, Index_Hit** hits,
+	uint32_t* hit_count) {
+	Index_Hit* found = NULL;
+	uint32_t found_count = 0;
+	uint32_t found_size = 0;
+	uint32_t sorted_terms = 0;
+	*hit_count = 0;
+	if (hits != NULL) {
+		*hits = NULL;
+	}
+
+	for (uint32_t k = 0; k < q->term_count; k++) {
+		const Grep_Term* t = &q->terms[k];
+
+		// the shortest list the term can walk, its op's or a pinned register's, rd overlaps an I-type immediate
+		int dest;
+		int base;
+		uint32_t has = grepOpFields(t->op, &dest, &base);
+		uint32_t pinned[3];
+		uint32_t pinned_count = 0;
+		uint64_t first = index->list_start[t->op];
+		uint64_t last = index->list_start[t->op + 1];
+		for (uint32_t f = 0; f < 3; f++) {
+			if (((has >> f) & 1) && ((t->mask >> field_shift[f]) & 0x1F)) {
+				uint32_t list = INDEX_REG_LIST(f, (t->value >> field_shift[f]) & 0x1F);
+				pinned[pinned_count++] = f;
+				if (index->list_start[list + 1] - index->list_start[list] < last - first) {
+					first = index->list_start[list];
+					last = index->list_start[list + 1];
+				}
+			}
+		}
+
+		uint32_t before = found_count;
+		uint64_t term_hits = 0;
+		for (uint64_t p = first; p < last; p++) {
+			uint32_t i = index->postings[p];
+			if (i >= index->count) {
+				free(found);
+				return INDEX_DAMAGED;
+			}
+			if (index->op[i] != t->op) {
+				continue;
+			}
+
+			int ok = 1;
+			for (uint32_t n = 0; n < pinned_count; n++) {
+				uint32_t f = pinned[n];
+				ok &= (index->reg[f][i] == ((t->value >> field_shift[f]) & 0x1F));
+			}
+			if (!ok || !grepTermRest(t, index->reg[0][i], index->reg[1][i], index->reg[2][i], index->imm[i])) {
+				continue;
+			}
+
+			term_hits++;
+			if (hits == NULL) {
+				continue;
+			}
+			if (found_count == found_size) {
+				found_size = found_size ? found_size * 2 : 1024;
+				Index_Hit* grown = realloc(found, (size_t)found_size * sizeof(Index_Hit));
+				if (grown == NULL) {
+					error("Out of memory");
+					free(found);
+					return 1;
+				}
+				found = grown;
+			}
+			found[found_count].index = i;
+			found[found_count].matched = 1u << t->pattern;
+			found_count++;
+		}
+
+		// each term's hits come out in order, only hits from more than one term need sorting
+		counts[t->pattern] += term_hits;
+		sorted_terms += (found_count > before);
+	}
+
+	if (hits == NULL) {
+		return 0;
+	}
+
+	// a word hit by several patterns becomes one hit with all their bits
+	if (sorted_terms > 1) {
+		qsort(found, found_count, sizeof(Index_Hit), compareHits);
+		uint32_t kept = 0;
+		for (uint32_t h = 0; h < found_count; h++) {
+			if (kept > 0 && found[kept - 1].index == found[h].index) {
+				found[kept - 1].matched |= found[h].matched;
+			}
+			else {
+				found[kept++] = found[h];
+			}
+		}
+		found_count = kept;
+	}
+
+	*hits = found;
+	*hit_count = found_count;
+	return 0;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: opens an ELF or flash image and gets its .text in host order
+	Params: Elf_Image* image - the image to fill
+			const char* path - the file
+			uint32_t raw_base - the address raw images start at
+			int big - the byte order of raw images
+			uint32_t* count - filled with the number of words
+	Return: const uint32_t* - the words, NULL on error
+*/
+static const uint32_t* openText(Elf_Image* image, const char* path, uint32_t raw_base, int big, uint32_t* count) {
+	if (imageOpenAny(image, path, raw_base, big) != 0) {
+		return NULL;
+	}
+
+	const uint32_t* words = imageText(image, count);
+	if (words == NULL) {
+		error("Out of memory");
+		imageClose(image);
+	}
+	return words;
+}
+
+/*
+	Purpose: prints the sizes and build times of an index
+	Params: const Index_Stats* stats - the stats
+			uint32_t text_size - the bytes of .text indexed
+	Return: none
+*/
+static void printIndexStats(const Index_Stats* stats, uint32_t text_size) {
+	printf("Words: %u\tPostings: %llu\tText: %.1f KB\tIndex: %.1f KB\tRatio: %.2fx\n", stats->words,
+		(unsigned long long)stats->postings, text_size / 1e3, stats->file_size / 1e3,
+		text_size > 0 ? (double)stats->file_size / text_size : 0.0);
+	printf("Build: %.6f s\tWrite: %.6f s\t%.1f M words/s\n", stats->build_time, stats->write_time,
+		stats->build_time > 0 ? stats->words / stats->build_time / 1e6 : 0.0);
+}
+
+/*
+	Purpose: --index mode, writes the index of a file's .text
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <file> <out.idx>
+	Return: int - exit code
+*/
+int indexMain(int argc, char** argv) {
+	uint32_t raw_base = TEXT_BASE;
+	int big = 1;
+	imageOptions(&argc, &argv, &raw_base, &big, NULL);
+	if (argc > 0 && argv[0][0] == '-') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 1;
+	}
+	if (argc < 2) {
+		error("--index needs an image and an index file");
+		return 1;
+	}
+
+	Elf_Image image;
+	uint32_t count;
+	const uint32_t* words = openText(&image, argv[0], raw_base, big, &count);
+	if (words == NULL) {
+		return 1;
+	}
+
+	Index_Stats stats;
+	int failed = indexWrite(argv[1], argv[0], words, count, image.text_addr, &stats);
+	if (!failed) {
+		printIndexStats(&stats, image.text_size);
+	}
+	imageClose(&image);
+	return failed;
+}
+
+/*
+	Purpose: --query mode, lists or counts the instructions of an index matching any pattern
+	Params: int argc - number of arguments after the mode
+			char** argv - [-c] -e pattern [-e pattern]... <index>
+	Return: int - exit code, 1 when nothing matched
+*/
+int queryMain(int argc, char** argv) {
+	static Grep_Query q;
+	int count_only = 0;
+	memset(&q, 0, sizeof(q));
+
+	while (argc > 0 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-c") == 0) {
+			count_only = 1;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[0], "-e") == 0 && argc > 1) {
+			if (grepCompile(&q, argv[1]) != 0) {
+				return 2;
+			}
+			argc -= 2;
+			argv += 2;
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 2;
+		}
+	}
+	if (q.pattern_count == 0 || argc < 1) {
+		error("--query needs at least one -e pattern and an index file");
+		return 2;
+	}
+
+	double start = getTime();
+	Image_Index index;
+	if (indexOpen(&index, argv[0]) != 0) {
+		return 2;
+	}
+	double open_time = getTime() - start;
+
+	// an index whose source has since changed would answer for the old file
+	struct stat info;
+	const Index_Header* h = index.header;
+	if (stat(h->source, &info) == 0 &&
+		((uint64_t)info.st_size != h->source_size || (int64_t)info.st_mtime != h->source_mtime)) {
+		printf("ERROR: %.*s changed since %s was built\n", INDEX_PATH_SIZE, h->source, argv[0]);
+		indexClose(&index);
+		return 2;
+	}
+
+	start = getTime();
+	uint64_t counts[GREP_MAX_PATTERNS] = { 0 };
+	Index_Hit* hits = NULL;
+	uint32_t hit_count = 0;
+	int queried = indexQuery(&index, &q, counts, count_only ? NULL : &hits, &hit_count);
+	if (queried != 0) {
+		if (queried == INDEX_DAMAGED) {
+			printf("ERROR: %s is damaged\n", argv[0]);
+		}
+		indexClose(&index);
+		return 2;
+	}
+	double query_time = getTime() - start;
+
+	char* buffer = count_only ? NULL : malloc(IMAGE_OUT_SIZE);
+	int failed = (!count_only && buffer == NULL);
+	if (failed) {
+		error("Out of memory");
+	}
+
+	size_t used = 0;
+	for (uint32_t n = 0; n < hit_count && !failed; n++) {
+		if (IMAGE_OUT_SIZE - used < INDEX_LINE_MAX + 4 * GREP_MAX_PATTERNS) {
+			failed = (fwrite(buffer, 1, used, stdout) != used);
+			used = 0;
+		}
+
+		uint32_t i = hits[n].index;
+		Decoded_Instruct d;
+		char text[ASSM_TEXT_SIZE];
+		decodeWord(index.words[i], &d);
+		formatAssm(text, &d);
+		used += (size_t)snprintf(buffer + used, INDEX_LINE_MAX, "%.64s:%08X:  %08X  %-28s", h->source,
+			h->text_addr + i * 4, index.words[i], text);
+		if (q.pattern_count > 1) {
+			for (uint32_t p = 0; p < q.pattern_count; p++) {
+				if ((hits[n].matched >> p) & 1) {
+					used += (size_t)sprintf(buffer + used, " #%u", p + 1);
+				}
+			}
+		}
+		buffer[used++] = '\n';
+	}
+	if (buffer != NULL && !failed) {
+		failed = (fwrite(buffer, 1, used, stdout) != used);
+	}
+	fflush(stdout);
+
+	uint64_t total = 0;
+	for (uint32_t p = 0; p < q.pattern_count; p++) {
+		fprintf(stderr, "#%u %-32s %llu\n", p + 1, q.patterns[p], (unsigned long long)counts[p]);
+		total += counts[p];
+	}
+	fprintf(stderr, "Words: %u\tTerms: %u\tOpen: %.6f s\tQuery: %.6f s\n", index.count, q.term_count, open_time,
+		query_time);
+
+	free(buffer);
+	free(hits);
+	indexClose(&index);
+	if (failed) {
+		return 2;
+	}
+	return (total == 0) ? 1 : 0;
+}
+
+/*
+	Purpose: --bench-index mode, times building an index and each pattern through it against a scan
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <file> <out.idx> [pattern]...
+	Return: int - exit code
+*/
+int benchIndexMain(int argc, char** argv) {
+	static const char* defaults[] = { "BEQ imm<0", "SW base=$sp", "* dest=$sp", "LW rt=$t0 imm=0", "* rs=$a0",
+		"ADDI imm>1000" };
+	uint32_t raw_base = TEXT_BASE;
+	int big = 1;
+	imageOptions(&argc, &argv, &raw_base, &big, NULL);
+	if (argc > 0 && argv[0][0] == '-') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 1;
+	}
+	if (argc < 2) {
+		error("--bench-index needs an image and an index file");
+		return 1;
+	}
+
+	Elf_Image image;
+	uint32_t count;
+	const uint32_t* words = openText(&image, argv[0], raw_base, big, &count);
+	if (words == NULL) {
+		return 1;
+	}
+
+	Index_Stats stats;
+	if (indexWrite(argv[1], argv[0], words, count, image.text_addr, &stats) != 0) {
+		imageClose(&image);
+		return 1;
+	}
+	printIndexStats(&stats, image.text_size);
+
+	// opening is the whole cost a query pays before it starts, the best of several
+	Image_Index index;
+	double open_time = 0;
+	for (int rep = 0; rep < INDEX_BENCH_REPS; rep++) {
+		double start = getTime();
+		if (indexOpen(&index, argv[1]) != 0) {
+			imageClose(&image);
+			return 1;
+		}
+		double took = getTime() - start;
+		open_time = (rep == 0 || took < open_time) ? took : open_time;
+		if (rep + 1 < INDEX_BENCH_REPS) {
+			indexClose(&index);
+		}
+	}
+	printf("Open: %.6f s\n\n", open_time);
+
+	const char** patterns = (argc > 2) ? (const char**)argv + 2 : defaults;
+	int pattern_count = (argc > 2) ? argc - 2 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+	printf("%-32s %10s %12s %12s %9s\n", "Pattern", "Hits", "Index (s)", "Scan (s)", "Speedup");
+
+	static Grep_Query q;
+	int failed = 0;
+	for (int p = 0; p < pattern_count && !failed; p++) {
+		memset(&q, 0, sizeof(q));
+		if (grepCompile(&q, patterns[p]) != 0) {
+			failed = 1;
+			break;
+		}
+
+		// the best of several of each, both must agree on every count
+		double index_time = 0;
+		double scan_time = 0;
+		uint64_t index_hits = 0;
+		uint64_t scan_hits = 0;
+		for (int rep = 0; rep < INDEX_BENCH_REPS && !failed; rep++) {
+			uint64_t counts[GREP_MAX_PATTERNS] = { 0 };
+			uint32_t unused;
+			double start = getTime();
+			failed = indexQuery(&index, &q, counts, NULL, &unused);
+			if (failed == INDEX_DAMAGED) {
+				printf("ERROR: %s is damaged\n", argv[1]);
+			}
+			double took = getTime() - start;
+			index_time = (rep == 0 || took < index_time) ? took : index_time;
+			index_hits = counts[0];
+
+			counts[0] = 0;
+			start = getTime();
+			grepCount(&q, image.text, count, image.big, counts);
+			took = getTime() - start;
+			scan_time = (rep == 0 || took < scan_time) ? took : scan_time;
+			scan_hits = counts[0];
+		}
+		if (!failed && index_hits != scan_hits) {
+			printf("ERROR: %s hits %llu words through the index but %llu by scanning\n", patterns[p],
+				(unsigned long long)index_hits, (unsigned long long)scan_hits);
+			failed = 1;
+		}
+		if (!failed) {
+			printf("%-32s %10llu %12.6f %12.6f %8.1fx\n", patterns[p], (unsigned long long)index_hits, index_time,
+				scan_time, index_time > 0 ? scan_time / index_time : 0.0);
+		}
+	}
+
+	indexClose(&index);
+	imageClose(&image);
+	return failed;
+}
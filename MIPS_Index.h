@@ -0,0 +1,183 @@
+#ifndef _MIPS_INDEX_H_
+#define _MIPS_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "MIPS_Grep.h"
+
+/*
+	A decoded .text saved to a file that later queries map and use as it
+	is, with nothing to parse. The file is in host byte order and holds,
+	one array per field:
+
+		words       the raw words, for listing
+		op          the decoded op of each word
+		rs rt rd    the register fields
+		imm         the immediate field
+
+	and then posting lists, the ascending indexes of the words with each
+	op and of the words using each register in each of rs, rt and rd. A
+	register is only posted under the fields its op has.
+
+	--query compiles its patterns the way --grep does. Each term walks the
+	shortest list it can use, its op's or that of a register it pins, and
+	checks the words on it against the field arrays. A query touches the
+	words on those lists and nothing else, so a pattern that pins only an
+	immediate still walks every word of its op.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// the first bytes of an index file
+#define INDEX_MAGIC "MIDX"
+
+// bumped whenever the layout changes
+#define INDEX_VERSION 1
+
+// longest source path kept in the header
+#define INDEX_PATH_SIZE 256
+
+// queries --bench-index times each pattern over
+#define INDEX_BENCH_REPS 20
+
+// what indexQuery returns when a posting points past the words
+#define INDEX_DAMAGED 2
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// the arrays of an index file, in the order they are laid out
+typedef enum Index_Section {
+	INDEX_WORDS,
+	INDEX_OP,
+	INDEX_RS,
+	INDEX_RT,
+	INDEX_RD,
+	INDEX_IMM,
+	INDEX_LIST_START,
+	INDEX_POSTINGS,
+	INDEX_SECTION_COUNT
+} Index_Section;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// the start of an index file, offsets are in bytes from the start of the file
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t word_count;
+	uint32_t text_addr;
+	uint32_t list_count;
+	uint64_t posting_count;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint64_t offsets[INDEX_SECTION_COUNT];
+	uint64_t file_size;
+	char source[INDEX_PATH_SIZE];
+} Index_Header;
+
+// a mapped index file, every pointer is into the mapping
+typedef struct {
+	const uint8_t* map;
+	size_t size;
+	const Index_Header* header;
+	uint32_t count;
+	const uint32_t* words;
+	const uint8_t* op;
+	const uint8_t* reg[3];
+	const uint16_t* imm;
+	const uint64_t* list_start;
+	const uint32_t* postings;
+} Image_Index;
+
+// a word some pattern matched
+typedef struct {
+	uint32_t index;
+	uint32_t matched;
+} Index_Hit;
+
+// what building an index took
+typedef struct {
+	uint32_t words;
+	uint64_t postings;
+	uint64_t file_size;
+	double build_time;
+	double write_time;
+} Index_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: builds the index of a .text and writes it to a file
+	Params: const char* path - the index file to write
+			const char* source - the file the words came from, recorded to catch a stale index
+			const uint32_t* words - the words, host order
+			uint32_t count - the number of words
+			uint32_t text_addr - the address of the first word
+			Index_Stats* stats - filled with the sizes and times
+	Return: int - 0 for no error
+*/
+int indexWrite(const char* path, const char* source, const uint32_t* words, uint32_t count, uint32_t text_addr,
+	Index_Stats* stats);
+
+/*
+	Purpose: maps an index file and checks its header
+	Params: Image_Index* index - the index to fill
+			const char* path - the file
+	Return: int - 0 for no error
+*/
+int indexOpen(Image_Index* index, const char* path);
+
+/*
+	Purpose: unmaps an index file
+	Params: Image_Index* index - the index
+	Return: none
+*/
+void indexClose(Image_Index* index);
+
+/*
+	Purpose: finds the words of an index each pattern of a query matches
+	Params: const Image_Index* index - the index
+			const Grep_Query* q - the compiled patterns
+			uint64_t* counts - each pattern's total to add to
+			Index_Hit** hits - filled with the hits in address order to free, NULL to only count
+			uint32_t* hit_count - filled with the number of hits
+	Return: int - 0 for no error, INDEX_DAMAGED for a posting past the words, 1 when out of memory
+*/
+int indexQuery(const Image_Index* index, const Grep_Query* q, uint64_t* counts, Index_Hit** hits,
+	uint32_t* hit_count);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --index mode, writes the index of a file's .text
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <file> <out.idx>
+	Return: int - exit code
+*/
+int indexMain(int argc, char** argv);
+
+/*
+	Purpose: --query mode, lists or counts the instructions of an index matching any pattern
+	Params: int argc - number of arguments after the mode
+			char** argv - [-c] -e pattern [-e pattern]... <index>
+	Return: int - exit code, 1 when nothing matched
+*/
+int queryMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-index mode, times building an index and each pattern through it against a scan
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] [-a addr] <file> <out.idx> [pattern]...
+	Return: int - exit code
+*/
+int benchIndexMain(int argc, char** argv);
+
+#endif
@@ -1,8 +1,9 @@
 #include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
 
-Assm_Instruct assm_instruct;
-uint32_t instruct;
-uint16_t state;
+THREAD_LOCAL Assm_Instruct assm_instruct;
+THREAD_LOCAL uint32_t instruct;
+THREAD_LOCAL uint16_t state;
 
 /*----------------------------\
 	   assembly_instructs
@@ -71,6 +72,51 @@ void (*binary_instructs[])(void) = {
 	end_list
 };
 
+// the one _assm and _bin function for each op, the opcode/funct tables pick it out instead of trying every one
+static void (*op_assm[OP_COUNT])(void) = {
+	[OP_INVALID] = end_list,
+	[OP_ADD] = add_reg_assm,
+	[OP_ADDI] = addi_immd_assm,
+	[OP_AND] = and_reg_assm,
+	[OP_ANDI] = andi_immd_assm,
+	[OP_BEQ] = beq_immd_assm,
+	[OP_BNE] = bne_immd_assm,
+	[OP_DIV] = div_reg_assm,
+	[OP_LUI] = lui_immd_assm,
+	[OP_LW] = lw_immd_assm,
+	[OP_MFHI] = mfhi_reg_assm,
+	[OP_MFLO] = mflo_reg_assm,
+	[OP_MULT] = mult_reg_assm,
+	[OP_OR] = or_reg_assm,
+	[OP_ORI] = ori_immd_assm,
+	[OP_SLT] = slt_reg_assm,
+	[OP_SLTI] = slti_immd_assm,
+	[OP_SUB] = sub_reg_assm,
+	[OP_SW] = sw_immd_assm
+};
+
+static void (*op_bin[OP_COUNT])(void) = {
+	[OP_INVALID] = end_list,
+	[OP_ADD] = add_reg_bin,
+	[OP_ADDI] = addi_immd_bin,
+	[OP_AND] = and_reg_bin,
+	[OP_ANDI] = andi_immd_bin,
+	[OP_BEQ] = beq_immd_bin,
+	[OP_BNE] = bne_immd_bin,
+	[OP_DIV] = div_reg_bin,
+	[OP_LUI] = lui_immd_bin,
+	[OP_LW] = lw_immd_bin,
+	[OP_MFHI] = mfhi_reg_bin,
+	[OP_MFLO] = mflo_reg_bin,
+	[OP_MULT] = mult_reg_bin,
+	[OP_OR] = or_reg_bin,
+	[OP_ORI] = ori_immd_bin,
+	[OP_SLT] = slt_reg_bin,
+	[OP_SLTI] = slti_immd_bin,
+	[OP_SUB] = sub_reg_bin,
+	[OP_SW] = sw_immd_bin
+};
+
 
 /*
 	Purpose: sets the global instrucion variables to the defualt values
@@ -102,7 +148,7 @@ void initInstructs(void) {
 
 
 /*
-	Purpose: runs through each _assm function and tries to encode the parsed instruction
+	Purpose: encodes the parsed instruction with the _assm function its op code names
 	Params: none
 	Return: none
 */
@@ -110,6 +156,46 @@ void encode(void) {
 	// clears any errors
 	state = NO_ERROR;
 
+	// only the named op's function can match, every other one would say WRONG_COMMAND
+	int op = OP_COUNT - 1;
+	while (op > OP_INVALID && strcmp(OP_CODE, opName((Op_Type)op)) != 0) {
+		op--;
+	}
+	(*op_assm[op])();
+
+	// falls back to trying every function should the table and the functions ever disagree
+	if (state == WRONG_COMMAND) {
+		encodeAll();
+	}
+}
+
+/*
+	Purpose: decodes the parsed bits with the _bin function the opcode/funct tables name
+	Params: none
+	Return: none
+*/
+void decode(void) {
+	// clears any errors
+	state = NO_ERROR;
+
+	// only the op the tables name can match, every other function would say WRONG_COMMAND
+	(*op_bin[wordOp(BIN32)])();
+
+	// falls back to trying every function should the table and the functions ever disagree
+	if (state == WRONG_COMMAND) {
+		decodeAll();
+	}
+}
+
+/*
+	Purpose: runs through each _assm function and tries to encode the parsed instruction
+	Params: none
+	Return: none
+*/
+void encodeAll(void) {
+	// clears any errors
+	state = NO_ERROR;
+
 	// loops through all of the instruction functions
 	for (int i = 0; ((state == NO_ERROR) || (state == WRONG_COMMAND)); i++) {
 		(*assembly_instructs[i])();
@@ -121,7 +207,7 @@ void encode(void) {
 	Params: none
 	Return: none
 */
-void decode(void) {
+void decodeAll(void) {
 	// clears any errors
 	state = NO_ERROR;
 
@@ -158,76 +244,110 @@ void error(char* msg) {
 		   Printing
 \----------------------------*/
 /*
-	Purpose: prints a message based on the system status
-	Params: none
-	Return: none
+	Purpose: gets the message for an error state
+	Params: uint16_t code - the state to describe
+	Return: const char* - the message, NULL if the state is not an error
 */
-void printResult(void) {
-	// checks the current state and prints a corresponding message
-	switch (state) {
-	case NO_ERROR: {
-		puts("System is Error Free");
-		break;
-	}
-	case COMPLETE_ENCODE: {
-		printMachine();
-		break;
-	}
-	case COMPLETE_DECODE: {
-		printAssm();
-		break;
+const char* errorMessage(uint16_t code) {
+	// checks the given state and returns a corresponding message
+	switch (code) {
+	case NO_ERROR:
+	case COMPLETE_ENCODE:
+	case COMPLETE_DECODE:
+	case COMPLETE_RUN:
+	case BUDGET_EXHAUSTED:
+	case WATCHPOINT_HIT: {
+		return NULL;
 	}
 	case UNRECOGNIZED_COMMAND: {
-		error("The given instruction was not recognized");
-		break;
+		return "The given instruction was not recognized";
 	}
 	case UNRECOGNIZED_COND: {
-		error("The given conditional is not recognized");
-		break;
+		return "The given conditional is not recognized";
 	}
 	case MISSING_REG: {
-		error("Missing register parameter");
-		break;
+		return "Missing register parameter";
 	}
 	case INVALID_REG: {
-		error("The given register is invalid for the specified command");
-		break;
+		return "The given register is invalid for the specified command";
 	}
 	case MISSING_PARAM: {
-		error("Expected a param, none was found");
-		break;
+		return "Expected a param, none was found";
 	}
 	case INVALID_PARAM: {
-		error("The given parameter is invalid for the specified command");
-		break;
+		return "The given parameter is invalid for the specified command";
 	}
 	case UNEXPECTED_PARAM: {
-		error("Found a parameter when none was expected");
-		break;
+		return "Found a parameter when none was expected";
 	}
 	case INVALID_IMMED: {
-		error("The given immediate value is invalid for the specified command");
-		break;
+		return "The given immediate value is invalid for the specified command";
 	}
 	case MISSING_SPACE: {
-		error("Expected a space, none was found");
-		break;
+		return "Expected a space, none was found";
 	}
 	case MISSING_COMMA: {
-		error("Expected a comma, none was found");
-		break;
+		return "Expected a comma, none was found";
 	}
 	case INVALID_SHIFT: {
-		error("The given shift is invalid");
-		break;
+		return "The given shift is invalid";
 	}
 	case MISSING_SHIFT: {
-		error("Expected a shift value but none was found");
-		break;
+		return "Expected a shift value but none was found";
+	}
+	case INVALID_PC: {
+		return "The program counter left the program text";
+	}
+	case UNALIGNED_ACCESS: {
+		return "A memory access was not word aligned";
+	}
+	case OUT_OF_MEMORY: {
+		return "Out of memory";
+	}
+	case INVALID_DIGITS: {
+		return "The given number has too many digits or a character that is not a digit";
 	}
 	case UNDEF_ERROR:
 	default: {
-		error("An unknown error code has occured");
+		return "An unknown error code has occured";
+	}
+	}
+}
+
+/*
+	Purpose: prints a message based on the system status
+	Params: none
+	Return: none
+*/
+void printResult(void) {
+	// checks the current state and prints a corresponding message
+	switch (state) {
+	case NO_ERROR: {
+		puts("System is Error Free");
+		break;
+	}
+	case COMPLETE_ENCODE: {
+		printMachine();
+		break;
+	}
+	case COMPLETE_DECODE: {
+		printAssm();
+		break;
+	}
+	case COMPLETE_RUN: {
+		puts("Program ran to completion");
+		break;
+	}
+	case BUDGET_EXHAUSTED: {
+		puts("The instruction budget ran out");
+		break;
+	}
+	case WATCHPOINT_HIT: {
+		puts("A watchpoint was hit");
+		break;
+	}
+	default: {
+		error((char*)errorMessage(state));
 		break;
 	}
 	}
@@ -293,12 +413,16 @@ void printParam(struct Param* param) {
 	switch (param->type) {
 	case EMPTY: {
 		printf("<>");
+		break;
 	}
 	case REGISTER: {
 		uint32_t temp = param->value;
 		if (param->value == 0) {
 			printf("$zero");
 		}
+		else if (param->value == 1) {
+			printf("$at");
+		}
 		else if (param->value == 2 || param->value == 3) {
 			temp -= 2;
 			printf("$v%d", temp);
@@ -319,6 +443,10 @@ void printParam(struct Param* param) {
 			temp -= 16;
 			printf("$t%d", temp);
 		}
+		else if (param->value == 26 || param->value == 27) {
+			temp -= 26;
+			printf("$k%d", temp);
+		}
 		else if (param->value == 28) {
 			printf("$gp");
 		}
@@ -501,12 +629,20 @@ char* readParam(char* line, struct Param* param) {
 		int i = 0;
 
 		// Read the register name (up to 4 characters, e.g., "t1")
-		while (isalpha(*line) || isdigit(*line)) {
+		while ((isalpha(*line) || isdigit(*line)) && i < 4) {
 			reg_name[i++] = *line++;
 		}
 		param->type = REGISTER;
-		// Convert register name to the appropriate register number
-		param->value = reg2num(reg_name);
+		// a longer name is not a register, skip the rest of it
+		if (isalpha(*line) || isdigit(*line)) {
+			while (isalpha(*line) || isdigit(*line)) { line++; }
+			state = INVALID_REG;
+			param->value = 32;
+		}
+		else {
+			// Convert register name to the appropriate register number
+			param->value = reg2num(reg_name);
+		}
 	}
 	else if (toupper(*line) == '#') {
 		line++;
@@ -547,6 +683,7 @@ uint32_t reg2num(char* reg) {
 	// Convert register name to the appropriate register number
 	uint32_t num = 32;
 	if (strcmp(reg, "zero") == 0) { num = 0; }  // $zero is register 0 
+	else if (strcmp(reg, "at") == 0) { num = 1; }  // $at is register 1
 	else if (strcmp(reg, "v0") == 0) { num = 2; }  // $v0 is register 2
 	else if (strcmp(reg, "v1") == 0) { num = 3; }  // $v1 is register 3
 	else if (strcmp(reg, "a0") == 0) { num = 4; }  // $a0 is register 4
@@ -571,6 +708,8 @@ uint32_t reg2num(char* reg) {
 	else if (strcmp(reg, "s7") == 0) { num = 23; }  // $s7 is register 23
 	else if (strcmp(reg, "t8") == 0) { num = 24; }  // $t8 is register 24
 	else if (strcmp(reg, "t9") == 0) { num = 25; }  // $t9 is register 25
+	else if (strcmp(reg, "k0") == 0) { num = 26; }  // $k0 is register 26
+	else if (strcmp(reg, "k1") == 0) { num = 27; }  // $k1 is register 27
 	else if (strcmp(reg, "gp") == 0) { num = 28; }  // $gp is register 28
 	else if (strcmp(reg, "sp") == 0) { num = 29; }  // $sp is register 29
 	else if (strcmp(reg, "fp") == 0) { num = 30; }  // $fp is register 30
@@ -621,14 +760,118 @@ char* immd2num(char* line, uint32_t* value) {
 }
 
 
+/*
+	Purpose: converts exactly 8 hex digits with SWAR arithmetic, 8 characters per 64 bit word
+	Params: const char* text - the 8 digits, most significant first
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if any character is not a hex digit
+*/
+static int hex8(const char* text, uint32_t* word) {
+	uint64_t x;
+	memcpy(&x, text, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+
+	// every byte is checked at once, bytes stay below 0x80 so the adds never carry between them
+	const uint64_t ones = 0x0101010101010101ull;
+	const uint64_t high = 0x8080808080808080ull;
+	uint64_t lower = x | (0x20 * ones);
+	uint64_t digit = ((x + 0x50 * ones) & ~(x + 0x46 * ones)) & high;
+	uint64_t alpha = ((lower + 0x1F * ones) & ~(lower + 0x19 * ones)) & high;
+	if ((x & high) != 0 || (digit | alpha) != high) {
+		return 1;
+	}
+
+	// low nibble of the character, plus 9 for a-f
+	uint64_t v = (x & (0x0F * ones)) + (alpha >> 7) * 9;
+
+	// packs nibble pairs, then byte pairs, then the two halves, first character on top
+	v = ((v & 0x0F000F000F000F00ull) >> 8) | ((v & 0x000F000F000F000Full) << 4);
+	v = ((v & 0x00FF000000FF0000ull) >> 16) | ((v & 0x000000FF000000FFull) << 8);
+	*word = (uint32_t)(((v & 0xFFFF) << 16) | ((v >> 32) & 0xFFFF));
+	return 0;
+}
+
+/*
+	Purpose: converts exactly 32 binary digits with SWAR arithmetic, 8 characters per 64 bit word
+	Params: const char* text - the 32 digits, most significant first
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if any character is not 0 or 1
+*/
+static int bin32(const char* text, uint32_t* word) {
+	const uint64_t ones = 0x0101010101010101ull;
+	uint64_t bad = 0;
+	uint32_t num = 0;
+
+	for (int i = 0; i < 4; i++) {
+		uint64_t x;
+		memcpy(&x, text + 8 * i, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		x = __builtin_bswap64(x);
+#endif
+
+		// '0' and '1' differ from 0x30 only in the low bit, checked once after all four loads
+		x ^= 0x30 * ones;
+		bad |= x & ~ones;
+
+		// the multiply gathers the 8 low bits into the top byte, first character highest
+		num = (num << 8) | (uint32_t)((x * 0x8040201008040201ull) >> 56);
+	}
+
+	*word = num;
+	return bad != 0;
+}
+
+/*
+	Purpose: converts up to 8 hex digits to a word, short numbers are zero padded
+	Params: const char* text - the digits, without a prefix
+			size_t len - the number of digits
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if the text is empty, too long or not all hex digits
+*/
+int hexWord(const char* text, size_t len, uint32_t* word) {
+	if (len == 8) {
+		return hex8(text, word);
+	}
+	if (len == 0 || len > 8) {
+		return 1;
+	}
+
+	char padded[8] = { '0', '0', '0', '0', '0', '0', '0', '0' };
+	memcpy(padded + 8 - len, text, len);
+	return hex8(padded, word);
+}
+
+/*
+	Purpose: converts up to 32 binary digits to a word, short numbers are zero padded
+	Params: const char* text - the digits, without a prefix
+			size_t len - the number of digits
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if the text is empty, too long or not all binary digits
+*/
+int binWord(const char* text, size_t len, uint32_t* word) {
+	if (len == 32) {
+		return bin32(text, word);
+	}
+	if (len == 0 || len > 32) {
+		return 1;
+	}
+
+	char padded[32];
+	memset(padded, '0', sizeof(padded));
+	memcpy(padded + 32 - len, text, len);
+	return bin32(padded, word);
+}
+
 /*
 	Purpose: parses the given hex line into into the binary instruction
-	Params: char* line - the line to convert
+	Params: char* line - the line to convert, an optional 0x then 1 to 8 hex digits
 	Return: none
 */
 void parseHex(char* line) {
 	// checks that parameters are valid
-	if (line == NULL || strlen(line) == 0) {
+	if (line == NULL || *line == '\0') {
 		state = UNDEF_ERROR;
 		return;
 	}
@@ -636,23 +879,16 @@ void parseHex(char* line) {
 	// clears instruction values
 	initInstructs();
 
-	uint32_t num = 0;
-
 	// checks if there is a hex prefix
 	if ((*line == '0') && (toupper(*(line + 1)) == 'X')) {
 		line += 2;
 	}
 
-	// as long as there are valid digits, they are added to the running number
-	while (isxdigit(*line)) {
-		if (isdigit(*line)) {
-			num = (num * 16) + (*line - 48);
-		}
-		else {
-			num = (num * 16) + (toupper(*line) - 55);
-		}
-
-		line++;
+	// the whole rest of the line must be digits
+	uint32_t num = 0;
+	if (hexWord(line, strlen(line), &num) != 0) {
+		state = INVALID_DIGITS;
+		return;
 	}
 
 	// sets the binary instruction to the converted number
@@ -662,12 +898,12 @@ void parseHex(char* line) {
 
 /*
 	Purpose: parses the given binary line into into the binary instruction
-	Params: char* line - the line to convert
+	Params: char* line - the line to convert, an optional 0b then 1 to 32 binary digits
 	Return: none
 */
 void parseBin(char* line) {
 	// checks that parameters are valid
-	if (line == NULL || strlen(line) == 0) {
+	if (line == NULL || *line == '\0') {
 		state = UNDEF_ERROR;
 		return;
 	}
@@ -675,19 +911,16 @@ void parseBin(char* line) {
 	// clears instruction values
 	initInstructs();
 
-	uint32_t num = 0;
-
 	// checks if there is a binary prefix
-	if ((*line == '0') && (toupper(*(line + 1)) == 'b')) {
+	if ((*line == '0') && (toupper(*(line + 1)) == 'B')) {
 		line += 2;
 	}
 
-	// as long as there are valid digits, they are added to the running number
-	while (*line != '\0') {
-		if ((*line == '0') || (*line == '1')) {
-			num = (num * 2) + (*line - 48);
-		}
-		line++;
+	// the whole rest of the line must be digits
+	uint32_t num = 0;
+	if (binWord(line, strlen(line), &num) != 0) {
+		state = INVALID_DIGITS;
+		return;
 	}
 
 	// sets the binary instruction to the converted number
@@ -707,6 +940,12 @@ void parseBin(char* line) {
 	Return: none
 */
 void setBits_num(uint32_t start, uint32_t num, uint32_t size) {
+	// a number that fits is shifted straight in, the same bits the string would set
+	if (size > 0 && size < 32 && start + 1 >= size && num < (1u << size)) {
+		BIN32 |= num << (start + 1 - size);
+		return;
+	}
+
 	// temp string for conversion purposes
 	char str[40] = { '\0' };
 
@@ -726,7 +965,7 @@ void setBits_num(uint32_t start, uint32_t num, uint32_t size) {
 */
 void setBits_str(uint32_t start, const char* str) {
 	// loops through the sting ad sets the bits in the binary instruction
-	for (int i = 0; i < strlen(str); i++) {
+	for (int i = 0; str[i] != '\0'; i++) {
 		if ((str[i] == '0') || (str[i] == '1')) {
 			BIN32 |= (str[i] - 48) << (start - i);
 		}
@@ -745,7 +984,7 @@ void setBits_str(uint32_t start, const char* str) {
 */
 int checkBits(uint32_t start, const char* str) {
 	// loops thorugh and checks each bit in the bianry instruction
-	for (int i = 0; i < strlen(str); i++) {
+	for (int i = 0; str[i] != '\0'; i++) {
 		// skips anything that isn't a 1 or 0
 		if ((str[i] != '0') && (str[i] != '1')) {
 			continue;
@@ -771,6 +1010,11 @@ int checkBits(uint32_t start, const char* str) {
 	Return: int - the number represented from the bits
 */
 uint32_t getBits(uint32_t start, uint32_t size) {
+	// a field inside the word is shifted and masked out in one go
+	if (size > 0 && size < 32 && start < 32 && start + 1 >= size) {
+		return (BIN32 >> (start + 1 - size)) & ((1u << size) - 1);
+	}
+
 	uint32_t num = 0;
 
 	// finds the last bit to grab, non-inclusive
@@ -27,19 +27,33 @@ void initInstructs(void);
 
 
 /*
-	Purpose: runs through each _assm function and tries to encode the parsed instruction
+	Purpose: encodes the parsed instruction with the _assm function its op code names
 	Params: none
 	Return: none
 */
 void encode(void);
 
 /*
-	Purpose: runs through each _bin function and tries to decode the parsed bits
+	Purpose: decodes the parsed bits with the _bin function the opcode/funct tables name
 	Params: none
 	Return: none
 */
 void decode(void);
 
+/*
+	Purpose: runs through each _assm function and tries to encode the parsed instruction
+	Params: none
+	Return: none
+*/
+void encodeAll(void);
+
+/*
+	Purpose: runs through each _bin function and tries to decode the parsed bits
+	Params: none
+	Return: none
+*/
+void decodeAll(void);
+
 /*
 	Purpose: serves as an indicator for the end of the instruction list
 	Params: none
@@ -62,6 +76,13 @@ void error(char* msg);
 /*----------------------------\
 		   Printing
 \----------------------------*/
+/*
+	Purpose: gets the message for an error state
+	Params: uint16_t code - the state to describe
+	Return: const char* - the message, NULL if the state is not an error
+*/
+const char* errorMessage(uint16_t code);
+
 /*
 	Purpose: prints a message based on the system status
 	Params: none
@@ -128,9 +149,27 @@ uint32_t reg2num(char *reg);
 char* immd2num(char* line, uint32_t* value);
 
 
+/*
+	Purpose: converts up to 8 hex digits to a word, short numbers are zero padded
+	Params: const char* text - the digits, without a prefix
+			size_t len - the number of digits
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if the text is empty, too long or not all hex digits
+*/
+int hexWord(const char* text, size_t len, uint32_t* word);
+
+/*
+	Purpose: converts up to 32 binary digits to a word, short numbers are zero padded
+	Params: const char* text - the digits, without a prefix
+			size_t len - the number of digits
+			uint32_t* word - filled with the number
+	Return: int - 0 for no error, 1 if the text is empty, too long or not all binary digits
+*/
+int binWord(const char* text, size_t len, uint32_t* word);
+
 /*
 	Purpose: parses the given hex line into into the binary instruction
-	Params: char* line - the line to convert
+	Params: char* line - the line to convert, an optional 0x then 1 to 8 hex digits
 	Return: none
 */
 void parseHex(char* line);
@@ -138,7 +177,7 @@ void parseHex(char* line);
 
 /*
 	Purpose: parses the given binary line into into the binary instruction
-	Params: char* line - the line to convert
+	Params: char* line - the line to convert, an optional 0b then 1 to 32 binary digits
 	Return: none
 */
 void parseBin(char* line);
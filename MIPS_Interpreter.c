@@ -1,9 +1,76 @@
 #include "MIPS_Interpreter.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Trace.h"
+#include "MIPS_AOT.h"
+#include "MIPS_Pipe.h"
+#include "MIPS_Pipeline.h"
+#include "MIPS_Batch.h"
+#include "MIPS_Jobs.h"
+#include "MIPS_Object.h"
+#include "MIPS_Image.h"
+#include "MIPS_Link.h"
+#include "MIPS_Flash.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Live.h"
+#include "MIPS_Dom.h"
+#include "MIPS_Sched.h"
+#include "MIPS_Peep.h"
+#include "MIPS_Grep.h"
+#include "MIPS_Index.h"
+#include "MIPS_Cache.h"
+#include "MIPS_Diff.h"
+#include "MIPS_Stats.h"
+#include "MIPS_Validate.h"
+#include "MIPS_Roundtrip.h"
 
-int main(void) {
+// array containing all of the command line modes
+struct Mode modes[] = {
+	// modes are placed below in a comma seperated list
+	{ "--run", runMain, "[--budget N] [--watch addr[:r|w|rw]]... <prog.s|prog.elf> [a0 [a1 [a2 [a3]]]]" },
+	{ "--bench-fusion", benchFusionMain, "<prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--bench-watch", benchWatchMain, "[--watch addr[:r|w|rw]]... <prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--trace", traceMain, "<out.trace> <prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--replay", replayMain, "<in.trace> <index> [address...]" },
+	{ "--aot", aotMain, "<prog.s> <out.c>" },
+	{ "--aot-verify", aotVerifyMain, "<prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--pipe", pipeMain, "< input > output" },
+	{ "--pipeline", pipelineMain, "[in|- [out|-]]" },
+	{ "--batch", batchMain, "[-f ihex|srec|raw] [-EB|-EL] [-a addr] <in> <out>" },
+	{ "--jobs", jobsMain, "<N> <file>..." },
+	{ "--bench-jobs", benchJobsMain, "<N> <file>..." },
+	{ "--elf", objectMain, "[-EB|-EL] <in.s> <out.o>" },
+	{ "--disasm", disasmMain, "[-l] [-c cache] [-EB|-EL] [-a addr] <file> [out|-]" },
+	{ "--link", linkMain, "[-j N] [-e symbol] <out> <obj>..." },
+	{ "--convert", convertMain, "[-f ihex|srec|raw] [-a addr] <in> <out>" },
+	{ "--cfg", cfgMain, "[-j N] [-EB|-EL] [-a addr] <file> [out|-]" },
+	{ "--live", liveMain, "[-j N] [-x mask] [-EB|-EL] [-a addr] <file> [out|-]" },
+	{ "--loops", domMain, "[-j N] [-EB|-EL] [-a addr] <file> [out|-]" },
+	{ "--schedule", scheduleMain, "[-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--peephole", peepMain, "[-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]" },
+	{ "--grep", grepMain, "[-c] [-EB|-EL] [-a addr] -e pattern [-e pattern]... <file>..." },
+	{ "--index", indexMain, "[-EB|-EL] [-a addr] <file> <out.idx>" },
+	{ "--query", queryMain, "[-c] -e pattern [-e pattern]... <index>" },
+	{ "--diff", diffMain, "[-EB|-EL] [-a addr] <old> <new>" },
+	{ "--stats", statsMain, "[-j N] [-EB|-EL] [-a addr] <file>..." },
+	{ "--validate", validateMain, "[-j N] [-EB|-EL] [-a addr] <file>" },
+	{ "--roundtrip", roundtripMain, "[-j N] [first [last]]" },
+	{ "--bench-dom", benchDomMain, "[blocks]" },
+	{ "--bench-parse", benchParseMain, "[count]" },
+	{ "--bench-index", benchIndexMain, "[-EB|-EL] [-a addr] <file> <out.idx> [pattern]..." },
+	{ "--bench-cache", benchCacheMain, "<cache> [words [changed pages per 1000]]" },
+
+	{ NULL, NULL, NULL }
+};
+
+int main(int argc, char** argv) {
 	// inializes everything
 	initAll();
 
+	// any arguments select a command line mode instead of the menus
+	if (argc > 1) {
+		return runMode(argc, argv);
+	}
+
 	// buffer for reading/writing
 	char buffer[BUFF_SIZE] = { '\0' };
 
@@ -40,6 +107,38 @@ int main(void) {
 	return 0;
 }
 
+/*
+	Purpose: runs the command line mode named by the first argument
+	Params: int argc - number of arguments
+			char** argv - the program arguments
+	Return: int - exit code
+*/
+int runMode(int argc, char** argv) {
+	// looks through the mode list for the flag
+	for (int i = 0; modes[i].flag != NULL; i++) {
+		if (strcmp(argv[1], modes[i].flag) == 0) {
+			return modes[i].run(argc - 2, argv + 2);
+		}
+	}
+
+	printUsage();
+	return (strcmp(argv[1], "--help") == 0) ? 0 : 1;
+}
+
+/*
+	Purpose: prints every command line mode and its arguments
+	Params: none
+	Return: none
+*/
+void printUsage(void) {
+	puts("Usage: MIPS_translatron [mode args...]");
+	puts("With no arguments the interactive menus are used.\n");
+
+	for (int i = 0; modes[i].flag != NULL; i++) {
+		printf("  %s %s\n", modes[i].flag, modes[i].usage);
+	}
+}
+
 /*
 	Purpose: dummy function to test code
 	Params: none
@@ -10,6 +10,28 @@
 // buffer size constant
 #define BUFF_SIZE 100
 
+// a command line mode, selected by its flag
+struct Mode {
+	const char* flag;
+	int (*run)(int argc, char** argv);
+	const char* usage;
+};
+
+/*
+	Purpose: runs the command line mode named by the first argument
+	Params: int argc - number of arguments
+			char** argv - the program arguments
+	Return: int - exit code
+*/
+int runMode(int argc, char** argv);
+
+/*
+	Purpose: prints every command line mode and its arguments
+	Params: none
+	Return: none
+*/
+void printUsage(void);
+
 /*
 	Purpose: dummy function to test code
 	Params: none
@@ -0,0 +1,368 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Jobs.h"
+#include "MIPS_Pipe.h"
+#include "MIPS_Util.h"
+
+// the running binary, so the benchmark can start copies of it
+#define JOBS_SELF "/proc/self/exe"
+
+/*----------------------------\
+		   Output
+\----------------------------*/
+/*
+	Purpose: writes out everything the worker has collected
+	Params: Job_Worker* w - the worker
+	Return: int - 0 for no error
+*/
+static int flushOutput(Job_Worker* w) {
+	size_t done = 0;
+	int failed = 0;
+
+	while (done < w->out_len) {
+		ssize_t wrote = write(w->out_fd, w->out + done, w->out_len - done);
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("write");
+			failed = 1;
+			break;
+		}
+		done += (size_t)wrote;
+	}
+
+	w->stats.bytes_out += done;
+	w->out_len = 0;
+	return failed;
+}
+
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: translates a file small enough to read whole, reusing the worker's buffers
+	Params: Job_Worker* w - the worker
+			int in_fd - the open input
+			const char* out_path - the file to write
+	Return: int - 0 for no error
+*/
+static int translateSmall(Job_Worker* w, int in_fd, const char* out_path) {
+	size_t have = 0;
+
+	while (have < JOBS_SMALL_FILE) {
+		ssize_t got = read(in_fd, w->in + have, JOBS_SMALL_FILE - have);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got < 0) {
+			perror("read");
+			return 1;
+		}
+		if (got == 0) {
+			break;
+		}
+		have += (size_t)got;
+	}
+
+	w->out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (w->out_fd < 0) {
+		perror(out_path);
+		return 1;
+	}
+
+	// the input buffer has a spare byte, so every line can be terminated in place
+	char* line = w->in;
+	char* end = w->in + have;
+	int failed = 0;
+	w->out_len = 0;
+	while (line < end && !failed) {
+		char* newline = memchr(line, '\n', (size_t)(end - line));
+		if (newline == NULL) {
+			newline = end;
+		}
+
+		if (JOBS_OUT_SIZE - w->out_len < PIPE_LINE_MAX) {
+			failed = flushOutput(w);
+		}
+		w->out_len += translateLine(line, (size_t)(newline - line), w->out + w->out_len);
+		w->stats.lines++;
+		line = newline + 1;
+	}
+	failed |= flushOutput(w);
+	w->stats.bytes_in += have;
+
+	if (close(w->out_fd) != 0) {
+		perror(out_path);
+		failed = 1;
+	}
+	return failed;
+}
+
+/*
+	Purpose: translates one file to <file>.out, small files in the worker's buffers and large ones through translateFile
+	Params: Job_Worker* w - the worker
+			const char* in_path - the file to translate
+	Return: int - 0 for no error
+*/
+static int translateJob(Job_Worker* w, const char* in_path) {
+	char out_path[4096];
+	if (snprintf(out_path, sizeof(out_path), "%s%s", in_path, JOBS_OUT_SUFFIX) >= (int)sizeof(out_path)) {
+		fprintf(stderr, "%s: Path too long\n", in_path);
+		return 1;
+	}
+
+	int in_fd = open(in_path, O_RDONLY);
+	if (in_fd < 0) {
+		perror(in_path);
+		return 1;
+	}
+
+	struct stat info;
+	if (fstat(in_fd, &info) != 0) {
+		perror(in_path);
+		close(in_fd);
+		return 1;
+	}
+
+	if (info.st_size <= JOBS_SMALL_FILE) {
+		double start = getTime();
+		int failed = translateSmall(w, in_fd, out_path);
+		w->stats.time += getTime() - start;
+		close(in_fd);
+		return failed;
+	}
+
+	// large files keep the asynchronous read ahead, on the worker's own queue
+	close(in_fd);
+	if (!w->io_ready) {
+		aioInit(&w->io, BATCH_READS + BATCH_WRITES);
+		w->io_ready = 1;
+	}
+	return translateFile(in_path, out_path, NULL, &w->io, &w->stats);
+}
+
+/*
+	Purpose: translates one file of the pool on a worker
+	Params: void* ctx - the Job_Pool
+			int worker - the worker whose buffers and totals are used
+			uint32_t index - the file
+	Return: none
+*/
+static void jobChunk(void* ctx, int worker, uint32_t index) {
+	Job_Pool* pool = ctx;
+	Job_Worker* w = &pool->workers[worker];
+
+	// a file that fails is reported and the rest still go
+	w->failed |= translateJob(w, pool->files[index]);
+	w->files++;
+}
+
+
+/*----------------------------\
+		   Pool
+\----------------------------*/
+/*
+	Purpose: translates every file in the pool on its worker threads
+	Params: Job_Pool* pool - the files and thread count
+	Return: int - 0 for no error
+*/
+static int runPool(Job_Pool* pool) {
+	int failed = 0;
+
+	for (int i = 0; i < pool->threads; i++) {
+		Job_Worker* w = &pool->workers[i];
+		memset(w, 0, sizeof(*w));
+
+		// the input buffer gets a spare byte to terminate the last line
+		w->in = malloc(JOBS_SMALL_FILE + 1);
+		w->out = malloc(JOBS_OUT_SIZE);
+		if (w->in == NULL || w->out == NULL) {
+			error("Out of memory");
+			failed = 1;
+		}
+	}
+
+	if (!failed) {
+		runChunks((uint32_t)pool->count, pool->threads, jobChunk, pool);
+	}
+
+	for (int i = 0; i < pool->threads; i++) {
+		Job_Worker* w = &pool->workers[i];
+		failed |= w->failed;
+		if (w->io_ready) {
+			aioFree(&w->io);
+		}
+		free(w->in);
+		free(w->out);
+		w->in = NULL;
+		w->out = NULL;
+	}
+
+	return failed;
+}
+
+/*
+	Purpose: reads the thread count and file list shared by --jobs and --bench-jobs
+	Params: Job_Pool* pool - the pool to set up
+			int argc - number of arguments after the mode
+			char** argv - <N> <file>...
+			const char* mode - the mode, for the error message
+	Return: int - 0 for no error
+*/
+static int parseJobs(Job_Pool* pool, int argc, char** argv, const char* mode) {
+	if (argc < 2) {
+		fprintf(stderr, "%s needs a thread count and at least one file\n", mode);
+		return 1;
+	}
+
+	char* end;
+	long threads = strtol(argv[0], &end, 10);
+	if (*argv[0] == '\0' || *end != '\0' || threads < 0) {
+		fprintf(stderr, "%s: Invalid thread count \"%s\"\n", mode, argv[0]);
+		return 1;
+	}
+
+	pool->files = argv + 1;
+	pool->count = argc - 1;
+
+	// 0 means one worker per core
+	pool->threads = chunkThreads((uint32_t)pool->count, (threads > CHUNK_MAX_THREADS) ? CHUNK_MAX_THREADS : (int)threads);
+	return 0;
+}
+
+/*
+	Purpose: prints the totals of a pool run
+	Params: const Job_Pool* pool - the pool after runPool
+			double wall - the run time in seconds
+	Return: none
+*/
+static void printPool(const Job_Pool* pool, double wall) {
+	Batch_Stats total;
+	memset(&total, 0, sizeof(total));
+
+	for (int i = 0; i < pool->threads; i++) {
+		const Job_Worker* w = &pool->workers[i];
+		total.bytes_in += w->stats.bytes_in;
+		total.bytes_out += w->stats.bytes_out;
+		total.lines += w->stats.lines;
+		printf("Worker %2d: %llu files\t%llu lines\t%.6f s busy\n", i, (unsigned long long)w->files,
+			(unsigned long long)w->stats.lines, w->stats.time);
+	}
+
+	printf("Files: %d\tThreads: %d\tLines: %llu\tIn: %llu bytes\tOut: %llu bytes\n", pool->count, pool->threads,
+		(unsigned long long)total.lines, (unsigned long long)total.bytes_in, (unsigned long long)total.bytes_out);
+	printf("Time: %.6f s\t%.1f files/s\t%.1f MB/s\n", wall, wall > 0 ? pool->count / wall : 0.0,
+		wall > 0 ? total.bytes_in / wall / 1e6 : 0.0);
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --jobs mode, translates every file to <file>.out on N worker threads
+	Params: int argc - number of arguments after the mode
+			char** argv - <N> <file>..., N of 0 uses every core
+	Return: int - exit code
+*/
+int jobsMain(int argc, char** argv) {
+	Job_Pool* pool = calloc(1, sizeof(Job_Pool));
+	if (pool == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	if (parseJobs(pool, argc, argv, "--jobs") != 0) {
+		free(pool);
+		return 1;
+	}
+
+	double start = getTime();
+	int failed = runPool(pool);
+	double wall = getTime() - start;
+
+	printPool(pool, wall);
+	free(pool);
+	return failed;
+}
+
+/*
+	Purpose: runs this binary's --batch on one file and waits for it, its report is discarded
+	Params: const char* in_path - the file to translate
+	Return: int - 0 for no error
+*/
+static int spawnBatch(const char* in_path) {
+	char out_path[4096];
+	if (snprintf(out_path, sizeof(out_path), "%s%s", in_path, JOBS_OUT_SUFFIX) >= (int)sizeof(out_path)) {
+		fprintf(stderr, "%s: Path too long\n", in_path);
+		return 1;
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+	char* args[] = { JOBS_SELF, "--batch", (char*)in_path, out_path, NULL };
+	extern char** environ;
+	pid_t pid;
+	int ret = posix_spawn(&pid, JOBS_SELF, &actions, NULL, args, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (ret != 0) {
+		errno = ret;
+		perror(JOBS_SELF);
+		return 1;
+	}
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			perror("waitpid");
+			return 1;
+		}
+	}
+	return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+/*
+	Purpose: --bench-jobs mode, times one --batch process per file against --jobs in this process
+	Params: int argc - number of arguments after the mode
+			char** argv - <N> <file>..., N of 0 uses every core
+	Return: int - exit code
+*/
+int benchJobsMain(int argc, char** argv) {
+	Job_Pool* pool = calloc(1, sizeof(Job_Pool));
+	if (pool == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	if (parseJobs(pool, argc, argv, "--bench-jobs") != 0) {
+		free(pool);
+		return 1;
+	}
+
+	// what a build does today, one process per file one after another
+	int failed = 0;
+	double start = getTime();
+	for (int i = 0; i < pool->count; i++) {
+		failed |= spawnBatch(pool->files[i]);
+	}
+	double serial = getTime() - start;
+
+	start = getTime();
+	failed |= runPool(pool);
+	double pooled = getTime() - start;
+
+	printPool(pool, pooled);
+	printf("\nSerial --batch: %.6f s\t%.1f files/s\n", serial, serial > 0 ? pool->count / serial : 0.0);
+	printf("--jobs %d:     %.6f s\t%.1f files/s\n", pool->threads, pooled, pooled > 0 ? pool->count / pooled : 0.0);
+	printf("Speedup: %.2fx\n", pooled > 0 ? serial / pooled : 0.0);
+
+	free(pool);
+	return failed;
+}
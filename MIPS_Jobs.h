@@ -0,0 +1,80 @@
+#ifndef _MIPS_JOBS_H_
+#define _MIPS_JOBS_H_
+
+#include <stdint.h>
+#include "MIPS_Async.h"
+#include "MIPS_Batch.h"
+#include "MIPS_Util.h"
+
+/*
+	Many files translated at once by a pool of worker threads. Workers take
+	the next file off a shared counter until none are left, and each file
+	is written to <file>.out with the --pipe rules. The translation globals
+	are thread local, so each worker has its own translation context. Each
+	worker also keeps its own input and output buffers and its own
+	Async_IO for the whole run. Small files are read whole and written
+	with one write(). Files larger than a batch block go through
+	translateFile().
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// files up to this size are read whole into the worker's input buffer
+#define JOBS_SMALL_FILE BATCH_BLOCK_SIZE
+
+// bytes of output a worker collects before each write
+#define JOBS_OUT_SIZE (256u << 10)
+
+// added to each input path to name its output
+#define JOBS_OUT_SUFFIX ".out"
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// one worker thread and everything it reuses between files
+typedef struct {
+	char* in;
+	char* out;
+	size_t out_len;
+	int out_fd;
+
+	// set up the first time a file is too big for the input buffer
+	Async_IO io;
+	int io_ready;
+
+	Batch_Stats stats;
+	uint64_t files;
+	int failed;
+} Job_Worker;
+
+// the files to translate and the workers sharing them
+typedef struct Job_Pool {
+	char** files;
+	int count;
+
+	int threads;
+	Job_Worker workers[CHUNK_MAX_THREADS];
+} Job_Pool;
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --jobs mode, translates every file to <file>.out on N worker threads
+	Params: int argc - number of arguments after the mode
+			char** argv - <N> <file>..., N of 0 uses every core
+	Return: int - exit code
+*/
+int jobsMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-jobs mode, times one --batch process per file against --jobs in this process
+	Params: int argc - number of arguments after the mode
+			char** argv - <N> <file>..., N of 0 uses every core
+	Return: int - exit code
+*/
+int benchJobsMain(int argc, char** argv);
+
+#endif
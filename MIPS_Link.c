@@ -0,0 +1,847 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Link.h"
+#include "MIPS_Util.h"
+
+// where .text starts in the output, after the file header and two program headers
+#define OUT_TEXT_OFFSET (ELF32_EHDR_SIZE + 2 * ELF32_PHDR_SIZE)
+
+// section index of symbols with a fixed value
+#define SHN_ABS 0xFFF1
+
+// opcodes of the immediate instructions that zero extend
+#define OPCODE_ANDI 0x0C
+#define OPCODE_ORI 0x0D
+
+// names of the output sections, in section header order
+static const char* section_names[LINK_SEC_COUNT] = {
+	"", ".text", ".data", ".symtab", ".strtab", ".shstrtab"
+};
+
+/*----------------------------\
+		   Errors
+\----------------------------*/
+/*
+	Purpose: reports a link error, only the first LINK_MAX_ERRORS are printed
+	Params: Linker* link - the link
+			const char* format - printf format of the message
+			... - its arguments
+	Return: none
+*/
+static void linkError(Linker* link, const char* format, ...) {
+	uint32_t count = __atomic_fetch_add(&link->errors, 1, __ATOMIC_RELAXED);
+	if (count >= LINK_MAX_ERRORS) {
+		return;
+	}
+
+	// one printf per message keeps the lines of different threads apart
+	char msg[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(msg, sizeof(msg), format, args);
+	va_end(args);
+	printf("ERROR: %s\n", msg);
+}
+
+
+/*----------------------------\
+		   Threads
+\----------------------------*/
+/*
+	Purpose: runs the current phase on one input
+	Params: void* ctx - the Linker
+			int worker - unused, each input keeps its own results
+			uint32_t index - the input
+	Return: none
+*/
+static void linkChunk(void* ctx, int worker, uint32_t index) {
+	Linker* link = ctx;
+	(void)worker;
+	link->job(link, &link->inputs[index]);
+}
+
+/*
+	Purpose: runs one phase over every input, the calling thread is one of the workers
+	Params: Linker* link - the link
+			void (*job)(Linker*, Link_Input*) - the work for one input
+	Return: none
+*/
+static void runPhase(Linker* link, void (*job)(Linker*, Link_Input*)) {
+	link->job = job;
+	runChunks(link->count, link->threads, linkChunk, link);
+}
+
+
+/*----------------------------\
+		   Read
+\----------------------------*/
+/*
+	Purpose: reads a whole file into memory
+	Params: Link_Input* in - the input, path set
+	Return: int - 0 for no error
+*/
+static int readWhole(Link_Input* in) {
+	int fd = open(in->path, O_RDONLY);
+	if (fd < 0) {
+		return 1;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return 1;
+	}
+	in->size = (size_t)info.st_size;
+	in->file = malloc(in->size + 1);
+	if (in->file == NULL) {
+		close(fd);
+		return 1;
+	}
+
+	size_t have = 0;
+	while (have < in->size) {
+		ssize_t got = read(fd, in->file + have, in->size - have);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			break;
+		}
+		have += (size_t)got;
+	}
+	close(fd);
+	return have != in->size;
+}
+
+/*
+	Purpose: read phase, loads an object and finds its sections, symbols and relocations
+	Params: Linker* link - the link
+			Link_Input* in - the object
+	Return: none
+*/
+static void readInput(Linker* link, Link_Input* in) {
+	if (readWhole(in) != 0) {
+		linkError(link, "%s: %s", in->path, strerror(errno ? errno : EIO));
+		return;
+	}
+
+	Elf_Header h;
+	if (in->size < ELF32_EHDR_SIZE || elfUnpackHeader(in->file, &h, &in->big) != 0 || h.type != ELF_ET_REL ||
+		(uint64_t)h.shoff + (uint64_t)h.shnum * ELF32_SHDR_SIZE > in->size) {
+		linkError(link, "%s: Not a MIPS relocatable object", in->path);
+		return;
+	}
+
+	// the sections go first, relocation sections name them by number
+	Elf_Section rels[2];
+	uint32_t rel_targets[2] = { 0, 0 };
+	int rel_count = 0;
+	for (uint32_t i = 1; i < h.shnum; i++) {
+		Elf_Section s;
+		elfUnpackSection(in->file + h.shoff + (size_t)i * ELF32_SHDR_SIZE, &s, in->big);
+		if (s.type != ELF_SHT_NOBITS && (uint64_t)s.offset + s.size > in->size) {
+			linkError(link, "%s: Section %u is past the end of the file", in->path, i);
+			return;
+		}
+
+		if (s.type == ELF_SHT_PROGBITS && (s.flags & ELF_SHF_EXECINSTR) && in->text == NULL) {
+			in->text_index = i;
+			in->text = in->file + s.offset;
+			in->text_size = s.size;
+		}
+		else if (s.type == ELF_SHT_PROGBITS && (s.flags & ELF_SHF_WRITE) && in->data == NULL) {
+			in->data_index = i;
+			in->data = in->file + s.offset;
+			in->data_size = s.size;
+		}
+		else if (s.type == ELF_SHT_SYMTAB && in->syms == NULL) {
+			Elf_Section names;
+			if (s.link == 0 || s.link >= h.shnum) {
+				linkError(link, "%s: Symbol table has no string table", in->path);
+				return;
+			}
+			elfUnpackSection(in->file + h.shoff + (size_t)s.link * ELF32_SHDR_SIZE, &names, in->big);
+			if ((uint64_t)names.offset + names.size > in->size || names.size == 0 ||
+				in->file[names.offset + names.size - 1] != '\0') {
+				linkError(link, "%s: Broken string table", in->path);
+				return;
+			}
+			in->syms = in->file + s.offset;
+			in->sym_count = s.size / ELF32_SYM_SIZE;
+			in->strtab = (const char*)in->file + names.offset;
+			in->strtab_size = names.size;
+		}
+		else if (s.type == ELF_SHT_REL && s.size > 0) {
+			if (rel_count == 2) {
+				linkError(link, "%s: Relocations for a section other than .text and .data", in->path);
+				return;
+			}
+			rel_targets[rel_count] = s.info;
+			rels[rel_count++] = s;
+		}
+	}
+
+	for (int i = 0; i < rel_count; i++) {
+		const uint8_t* entries = in->file + rels[i].offset;
+		uint32_t count = rels[i].size / ELF32_REL_SIZE;
+		if (rel_targets[i] == in->text_index && in->text != NULL) {
+			in->rel_text = entries;
+			in->rel_text_count = count;
+		}
+		else if (rel_targets[i] == in->data_index && in->data != NULL) {
+			in->rel_data = entries;
+			in->rel_data_count = count;
+		}
+		else {
+			linkError(link, "%s: Relocations for a section other than .text and .data", in->path);
+			return;
+		}
+	}
+
+	// counts the defined symbols, the output keeps them all
+	for (uint32_t i = 1; i < in->sym_count; i++) {
+		Elf_Symbol sym;
+		elfUnpackSymbol(in->syms + (size_t)i * ELF32_SYM_SIZE, &sym, in->big);
+		if (sym.name >= in->strtab_size) {
+			linkError(link, "%s: Symbol %u has a name past its string table", in->path, i);
+			return;
+		}
+		if ((sym.shndx != in->text_index && sym.shndx != in->data_index) || sym.shndx == 0 ||
+			(sym.info & 0xF) == ELF_STT_SECTION) {
+			continue;
+		}
+
+		if (ELF_ST_BIND(sym.info) == ELF_STB_LOCAL) {
+			in->locals++;
+		}
+		else {
+			in->globals++;
+		}
+		in->name_bytes += (uint32_t)strlen(in->strtab + sym.name) + 1;
+	}
+
+	in->defs = malloc((in->globals + 1) * sizeof(Link_Symbol));
+	if (in->defs == NULL) {
+		linkError(link, "%s: Out of memory", in->path);
+	}
+}
+
+
+/*----------------------------\
+		   Layout
+\----------------------------*/
+/*
+	Purpose: lays the inputs end to end and fixes every place in the output
+	Params: Linker* link - the link, read phase done
+	Return: int - 0 for no error
+*/
+static int layoutInputs(Linker* link) {
+	uint64_t text = 0;
+	uint64_t data = 0;
+	uint32_t locals = 0;
+	uint32_t globals = 0;
+	uint64_t names = 1;
+
+	link->big = link->inputs[0].big;
+	for (uint32_t i = 0; i < link->count; i++) {
+		Link_Input* in = &link->inputs[i];
+		if (in->big != link->big) {
+			linkError(link, "%s: Byte order differs from %s", in->path, link->inputs[0].path);
+			return 1;
+		}
+
+		in->text_addr = TEXT_BASE + (uint32_t)text;
+		in->data_addr = DATA_BASE + (uint32_t)data;
+		text += (in->text_size + 3u) & ~3u;
+		data += (in->data_size + 3u) & ~3u;
+
+		in->first_local = 1 + locals;
+		in->name_offset = (uint32_t)names;
+		locals += in->locals;
+		names += in->name_bytes;
+	}
+
+	// globals follow every local in .symtab
+	for (uint32_t i = 0; i < link->count; i++) {
+		Link_Input* in = &link->inputs[i];
+		in->first_global = 1 + locals + globals;
+		globals += in->globals;
+	}
+
+	if (TEXT_BASE + text > DATA_BASE || DATA_BASE + data > UINT32_MAX) {
+		linkError(link, "The linked program does not fit in the address space");
+		return 1;
+	}
+
+	link->text_size = (uint32_t)text;
+	link->data_size = (uint32_t)data;
+	link->local_count = locals;
+	link->sym_count = 1 + locals + globals;
+	link->name_bytes = (uint32_t)names;
+	link->stats.globals = globals;
+
+	// the hash is kept at most half full
+	link->table_size = 16;
+	while (link->table_size < globals * 2u) {
+		link->table_size *= 2;
+	}
+	link->table = calloc(link->table_size, sizeof(Link_Symbol*));
+	if (link->table == NULL) {
+		linkError(link, "Out of memory");
+		return 1;
+	}
+
+	link->text_offset = OUT_TEXT_OFFSET;
+	link->data_offset = link->text_offset + link->text_size;
+	link->symtab_offset = (link->data_offset + link->data_size + 3u) & ~3u;
+	link->strtab_offset = link->symtab_offset + link->sym_count * ELF32_SYM_SIZE;
+
+	uint64_t shstr = 0;
+	for (int i = 0; i < LINK_SEC_COUNT; i++) {
+		shstr += strlen(section_names[i]) + 1;
+	}
+	link->out_size = (((uint64_t)link->strtab_offset + link->name_bytes + shstr + 3) & ~3ull) +
+		LINK_SEC_COUNT * ELF32_SHDR_SIZE;
+	if (link->out_size > UINT32_MAX) {
+		linkError(link, "The executable would be larger than 4 GB");
+		return 1;
+	}
+	return 0;
+}
+
+
+/*----------------------------\
+		   Resolve
+\----------------------------*/
+/*
+	Purpose: hashes a symbol name, FNV-1a
+	Params: const char* name - the name
+	Return: uint32_t - the hash
+*/
+static uint32_t nameHash(const char* name) {
+	uint32_t hash = 2166136261u;
+	while (*name != '\0') {
+		hash = (hash ^ (uint8_t)*name++) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+	Purpose: resolve phase, adds the input's global definitions to the shared hash
+	Params: Linker* link - the link
+			Link_Input* in - the object
+	Return: none
+*/
+static void resolveInput(Linker* link, Link_Input* in) {
+	uint32_t mask = link->table_size - 1;
+	uint32_t count = 0;
+
+	for (uint32_t i = 1; i < in->sym_count && count < in->globals; i++) {
+		Elf_Symbol sym;
+		elfUnpackSymbol(in->syms + (size_t)i * ELF32_SYM_SIZE, &sym, in->big);
+		if ((sym.shndx != in->text_index && sym.shndx != in->data_index) || sym.shndx == 0 ||
+			(sym.info & 0xF) == ELF_STT_SECTION || ELF_ST_BIND(sym.info) == ELF_STB_LOCAL) {
+			continue;
+		}
+
+		Link_Symbol* def = &in->defs[count++];
+		def->name = in->strtab + sym.name;
+		def->hash = nameHash(def->name);
+		def->addr = sym.value + ((sym.shndx == in->text_index) ? in->text_addr : in->data_addr);
+		def->input = (uint32_t)(in - link->inputs);
+
+		// claims the first empty slot, a slot once claimed only ever holds the same name
+		uint32_t slot = def->hash & mask;
+		while (1) {
+			Link_Symbol* cur = __atomic_load_n(&link->table[slot], __ATOMIC_ACQUIRE);
+			if (cur == NULL &&
+				__atomic_compare_exchange_n(&link->table[slot], &cur, def, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				break;
+			}
+			if (cur->hash == def->hash && strcmp(cur->name, def->name) == 0) {
+				// the first input in command line order keeps the name, whichever thread got here first
+				while (def->input < cur->input && !__atomic_compare_exchange_n(&link->table[slot], &cur, def, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				}
+				__atomic_store_n(&link->duplicates, 1, __ATOMIC_RELAXED);
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+}
+
+/*
+	Purpose: finds a global definition, only after the resolve phase
+	Params: const Linker* link - the link
+			const char* name - the name
+	Return: const Link_Symbol* - the definition, NULL if there is none
+*/
+static const Link_Symbol* findGlobal(const Linker* link, const char* name) {
+	uint32_t hash = nameHash(name);
+	uint32_t mask = link->table_size - 1;
+
+	for (uint32_t slot = hash & mask; link->table[slot] != NULL; slot = (slot + 1) & mask) {
+		const Link_Symbol* def = link->table[slot];
+		if (def->hash == hash && strcmp(def->name, name) == 0) {
+			return def;
+		}
+	}
+	return NULL;
+}
+
+/*
+	Purpose: reports every global defined again after its first definition, in input order
+	Params: Linker* link - the link, after the resolve phase
+	Return: none
+*/
+static void reportDuplicates(Linker* link) {
+	for (uint32_t i = 0; i < link->count; i++) {
+		Link_Input* in = &link->inputs[i];
+		for (uint32_t j = 0; j < in->globals; j++) {
+			const Link_Symbol* def = &in->defs[j];
+			const Link_Symbol* first = findGlobal(link, def->name);
+			if (first != def) {
+				linkError(link, "%s: Multiple definition of `%s', first defined in %s", in->path, def->name,
+					link->inputs[first->input].path);
+			}
+		}
+	}
+}
+
+
+/*----------------------------\
+		   Relocate
+\----------------------------*/
+/*
+	Purpose: gets the final address of a symbol an input refers to
+	Params: Linker* link - the link
+			const Link_Input* in - the object
+			uint32_t index - the symbol's number in the object
+			uint32_t* addr - filled with the address
+	Return: int - 0 for no error
+*/
+static int symbolAddr(Linker* link, const Link_Input* in, uint32_t index, uint32_t* addr) {
+	if (index == 0 || index >= in->sym_count) {
+		linkError(link, "%s: Relocation names symbol %u, which does not exist", in->path, index);
+		return 1;
+	}
+
+	Elf_Symbol sym;
+	elfUnpackSymbol(in->syms + (size_t)index * ELF32_SYM_SIZE, &sym, in->big);
+
+	if (sym.shndx == ELF_SHN_UNDEF) {
+		const Link_Symbol* def = findGlobal(link, in->strtab + sym.name);
+		if (def == NULL) {
+			linkError(link, "%s: Undefined reference to `%s'", in->path, in->strtab + sym.name);
+			return 1;
+		}
+		*addr = def->addr;
+	}
+	else if (sym.shndx == in->text_index) {
+		*addr = in->text_addr + sym.value;
+	}
+	else if (sym.shndx == in->data_index) {
+		*addr = in->data_addr + sym.value;
+	}
+	else if (sym.shndx == SHN_ABS) {
+		*addr = sym.value;
+	}
+	else {
+		linkError(link, "%s: Symbol `%s' is in a section that is not linked", in->path, in->strtab + sym.name);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+	Purpose: applies one section's relocations to its copy in the output
+	Params: Linker* link - the link
+			const Link_Input* in - the object
+			const uint8_t* rels - the relocations
+			uint32_t count - how many
+			const uint8_t* src - the section as the object has it, for paired LO16 addends
+			uint8_t* dst - the section in the output
+			uint32_t size - the section's size
+			uint32_t base - the section's final address
+	Return: none
+*/
+static void relocateSection(Linker* link, const Link_Input* in, const uint8_t* rels, uint32_t count,
+	const uint8_t* src, uint8_t* dst, uint32_t size, uint32_t base) {
+	for (uint32_t i = 0; i < count; i++) {
+		Elf_Rel rel;
+		elfUnpackRel(rels + (size_t)i * ELF32_REL_SIZE, &rel, in->big);
+
+		uint32_t type = ELF_R_TYPE(rel.info);
+		if (type == ELF_R_MIPS_NONE) {
+			continue;
+		}
+		if ((rel.offset & 3) != 0 || (uint64_t)rel.offset + 4 > size) {
+			linkError(link, "%s: Relocation at 0x%X is outside its section", in->path, rel.offset);
+			continue;
+		}
+
+		uint32_t target;
+		if (symbolAddr(link, in, ELF_R_SYM(rel.info), &target) != 0) {
+			continue;
+		}
+
+		uint8_t* place = dst + rel.offset;
+		uint32_t word = elfGet32(place, in->big);
+		uint32_t pc = base + rel.offset;
+
+		switch (type) {
+		case ELF_R_MIPS_32: {
+			word += target;
+			break;
+		}
+		case ELF_R_MIPS_PC16: {
+			// the field counts words from the next instruction, the -4 is in the addend
+			int64_t value = (int64_t)target + ((int64_t)(int16_t)(word & 0xFFFF) * 4) - pc;
+			if (value < -0x20000 || value > 0x1FFFC) {
+				linkError(link, "%s: Branch to `%s' at 0x%08X is out of range", in->path,
+					in->strtab + elfGet32(in->syms + (size_t)ELF_R_SYM(rel.info) * ELF32_SYM_SIZE, in->big), pc);
+				continue;
+			}
+			word = (word & 0xFFFF0000u) | ((uint32_t)(value >> 2) & 0xFFFF);
+			break;
+		}
+		case ELF_R_MIPS_HI16: {
+			// the low half of the addend is in the LO16 that follows
+			uint32_t addend = (word & 0xFFFF) << 16;
+			int carry = 0;
+			for (uint32_t j = i + 1; j < count; j++) {
+				Elf_Rel lo;
+				elfUnpackRel(rels + (size_t)j * ELF32_REL_SIZE, &lo, in->big);
+				if (ELF_R_TYPE(lo.info) == ELF_R_MIPS_LO16 && ELF_R_SYM(lo.info) == ELF_R_SYM(rel.info) &&
+					(uint64_t)lo.offset + 4 <= size) {
+					uint32_t lo_word = elfGet32(src + lo.offset, in->big);
+					addend += SIGN_EXT16(lo_word & 0xFFFF);
+
+					// ORI and ANDI zero extend, everything else adds the low half signed
+					uint32_t opcode = WORD_OPCODE(lo_word);
+					carry = (opcode != OPCODE_ORI && opcode != OPCODE_ANDI);
+					break;
+				}
+			}
+
+			uint32_t value = target + addend;
+			word = (word & 0xFFFF0000u) | (((carry ? value + 0x8000 : value) >> 16) & 0xFFFF);
+			break;
+		}
+		case ELF_R_MIPS_LO16: {
+			word = (word & 0xFFFF0000u) | ((target + SIGN_EXT16(word & 0xFFFF)) & 0xFFFF);
+			break;
+		}
+		default: {
+			linkError(link, "%s: Unsupported relocation type %u", in->path, type);
+			continue;
+		}
+		}
+
+		elfPut32(place, word, in->big);
+	}
+
+	__atomic_fetch_add(&link->stats.relocs, count, __ATOMIC_RELAXED);
+}
+
+/*
+	Purpose: relocate phase, copies the input's sections into the output, relocates them and writes its symbols
+	Params: Linker* link - the link
+			Link_Input* in - the object
+	Return: none
+*/
+static void relocateInput(Linker* link, Link_Input* in) {
+	uint8_t* text = link->out + link->text_offset + (in->text_addr - TEXT_BASE);
+	uint8_t* data = link->out + link->data_offset + (in->data_addr - DATA_BASE);
+
+	if (in->text_size > 0) {
+		memcpy(text, in->text, in->text_size);
+	}
+	if (in->data_size > 0) {
+		memcpy(data, in->data, in->data_size);
+	}
+	relocateSection(link, in, in->rel_text, in->rel_text_count, in->text, text, in->text_size, in->text_addr);
+	relocateSection(link, in, in->rel_data, in->rel_data_count, in->data, data, in->data_size, in->data_addr);
+
+	// symbols go to the slots the layout gave this input, in the order they were counted
+	uint32_t local = in->first_local;
+	uint32_t global = in->first_global;
+	uint32_t name_offset = in->name_offset;
+	for (uint32_t i = 1; i < in->sym_count; i++) {
+		Elf_Symbol sym;
+		elfUnpackSymbol(in->syms + (size_t)i * ELF32_SYM_SIZE, &sym, in->big);
+		if ((sym.shndx != in->text_index && sym.shndx != in->data_index) || sym.shndx == 0 ||
+			(sym.info & 0xF) == ELF_STT_SECTION) {
+			continue;
+		}
+
+		const char* name = in->strtab + sym.name;
+		size_t len = strlen(name) + 1;
+		memcpy(link->out + link->strtab_offset + name_offset, name, len);
+
+		int is_text = (sym.shndx == in->text_index);
+		Elf_Symbol entry = { name_offset, sym.value + (is_text ? in->text_addr : in->data_addr), sym.size,
+			sym.info, sym.other, is_text ? LINK_SEC_TEXT : LINK_SEC_DATA };
+		uint32_t slot = (ELF_ST_BIND(sym.info) == ELF_STB_LOCAL) ? local++ : global++;
+		elfPackSymbol(link->out + link->symtab_offset + (size_t)slot * ELF32_SYM_SIZE, &entry, link->big);
+		name_offset += (uint32_t)len;
+	}
+}
+
+
+/*----------------------------\
+		   Write
+\----------------------------*/
+/*
+	Purpose: writes the headers and the parts of the tables that belong to no input
+	Params: Linker* link - the link, relocate phase done
+			uint32_t entry - the entry address
+	Return: none
+*/
+static void writeHeaders(Linker* link, uint32_t entry) {
+	uint8_t* out = link->out;
+	int big = link->big;
+
+	// the null symbol and the empty name
+	memset(out + link->symtab_offset, 0, ELF32_SYM_SIZE);
+	out[link->strtab_offset] = '\0';
+
+	uint32_t shstr_offset = link->strtab_offset + link->name_bytes;
+	uint32_t shstr_len = 0;
+	Elf_Section sections[LINK_SEC_COUNT];
+	memset(sections, 0, sizeof(sections));
+	for (int i = 0; i < LINK_SEC_COUNT; i++) {
+		size_t len = strlen(section_names[i]) + 1;
+		sections[i].name = shstr_len;
+		memcpy(out + shstr_offset + shstr_len, section_names[i], len);
+		shstr_len += (uint32_t)len;
+	}
+	uint32_t shoff = (shstr_offset + shstr_len + 3u) & ~3u;
+
+	sections[LINK_SEC_TEXT].type = ELF_SHT_PROGBITS;
+	sections[LINK_SEC_TEXT].flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR;
+	sections[LINK_SEC_TEXT].addr = TEXT_BASE;
+	sections[LINK_SEC_TEXT].offset = link->text_offset;
+	sections[LINK_SEC_TEXT].size = link->text_size;
+	sections[LINK_SEC_TEXT].align = 4;
+	sections[LINK_SEC_DATA].type = ELF_SHT_PROGBITS;
+	sections[LINK_SEC_DATA].flags = ELF_SHF_ALLOC | ELF_SHF_WRITE;
+	sections[LINK_SEC_DATA].addr = DATA_BASE;
+	sections[LINK_SEC_DATA].offset = link->data_offset;
+	sections[LINK_SEC_DATA].size = link->data_size;
+	sections[LINK_SEC_DATA].align = 4;
+	sections[LINK_SEC_SYMTAB].type = ELF_SHT_SYMTAB;
+	sections[LINK_SEC_SYMTAB].offset = link->symtab_offset;
+	sections[LINK_SEC_SYMTAB].size = link->sym_count * ELF32_SYM_SIZE;
+	sections[LINK_SEC_SYMTAB].link = LINK_SEC_STRTAB;
+	sections[LINK_SEC_SYMTAB].info = 1 + link->local_count;
+	sections[LINK_SEC_SYMTAB].align = 4;
+	sections[LINK_SEC_SYMTAB].entsize = ELF32_SYM_SIZE;
+	sections[LINK_SEC_STRTAB].type = ELF_SHT_STRTAB;
+	sections[LINK_SEC_STRTAB].offset = link->strtab_offset;
+	sections[LINK_SEC_STRTAB].size = link->name_bytes;
+	sections[LINK_SEC_STRTAB].align = 1;
+	sections[LINK_SEC_SHSTRTAB].type = ELF_SHT_STRTAB;
+	sections[LINK_SEC_SHSTRTAB].offset = shstr_offset;
+	sections[LINK_SEC_SHSTRTAB].size = shstr_len;
+	sections[LINK_SEC_SHSTRTAB].align = 1;
+	for (int i = 0; i < LINK_SEC_COUNT; i++) {
+		elfPackSection(out + shoff + i * ELF32_SHDR_SIZE, &sections[i], big);
+	}
+
+	// one loadable segment each for .text and .data
+	Elf_Segment text = { ELF_PT_LOAD, link->text_offset, TEXT_BASE, link->text_size, link->text_size,
+		ELF_PF_R | ELF_PF_X, 4 };
+	Elf_Segment data = { ELF_PT_LOAD, link->data_offset, DATA_BASE, link->data_size, link->data_size,
+		ELF_PF_R | ELF_PF_W, 4 };
+	elfPackSegment(out + ELF32_EHDR_SIZE, &text, big);
+	elfPackSegment(out + ELF32_EHDR_SIZE + ELF32_PHDR_SIZE, &data, big);
+
+	Elf_Header header;
+	memset(&header, 0, sizeof(header));
+	header.type = ELF_ET_EXEC;
+	header.machine = ELF_EM_MIPS;
+	header.entry = entry;
+	header.phoff = ELF32_EHDR_SIZE;
+	header.shoff = shoff;
+	header.flags = ELF_EF_MIPS_NOREORDER | ELF_EF_MIPS_ABI_O32;
+	header.phnum = 2;
+	header.shnum = LINK_SEC_COUNT;
+	header.shstrndx = LINK_SEC_SHSTRTAB;
+	elfPackHeader(out, &header, big);
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: links objects into an executable
+	Params: char** paths - the objects
+			uint32_t count - how many
+			const char* out_path - the executable to write, removed again on error
+			const char* entry - the symbol to start at, NULL for LINK_DEFAULT_ENTRY or the start of .text
+			int threads - the number of threads, 0 for one per core
+			Link_Stats* stats - filled with the phase times and totals
+	Return: int - 0 for no error
+*/
+int linkObjects(char** paths, uint32_t count, const char* out_path, const char* entry, int threads, Link_Stats* stats) {
+	Linker* link = calloc(1, sizeof(Linker));
+	if (link == NULL || count == 0) {
+		error(link == NULL ? "Out of memory" : "Nothing to link");
+		free(link);
+		return 1;
+	}
+
+	link->threads = chunkThreads(count, threads);
+	link->count = count;
+	link->inputs = calloc(count, sizeof(Link_Input));
+	if (link->inputs == NULL) {
+		error("Out of memory");
+		free(link);
+		return 1;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		link->inputs[i].path = paths[i];
+	}
+
+	double start = getTime();
+	runPhase(link, readInput);
+	link->stats.read_time = getTime() - start;
+
+	// the output is mapped at its final size so every input can write its own part
+	int fd = -1;
+	start = getTime();
+	if (link->errors == 0 && layoutInputs(link) == 0) {
+		fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || ftruncate(fd, (off_t)link->out_size) != 0) {
+			perror(out_path);
+			link->errors++;
+		}
+		else {
+			void* map = mmap(NULL, link->out_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (map == MAP_FAILED) {
+				perror(out_path);
+				link->errors++;
+			}
+			else {
+				link->out = map;
+			}
+		}
+	}
+	link->stats.layout_time = getTime() - start;
+
+	if (link->errors == 0) {
+		start = getTime();
+		runPhase(link, resolveInput);
+		if (link->duplicates) {
+			reportDuplicates(link);
+		}
+		link->stats.resolve_time = getTime() - start;
+	}
+
+	if (link->errors == 0) {
+		start = getTime();
+		runPhase(link, relocateInput);
+		link->stats.relocate_time = getTime() - start;
+	}
+
+	start = getTime();
+	if (link->errors == 0) {
+		// starts at the entry symbol, or the start of .text when the default one is missing
+		uint32_t entry_addr = TEXT_BASE;
+		const Link_Symbol* def = findGlobal(link, (entry != NULL) ? entry : LINK_DEFAULT_ENTRY);
+		if (def != NULL) {
+			entry_addr = def->addr;
+		}
+		else if (entry != NULL) {
+			linkError(link, "Entry symbol `%s' is not defined", entry);
+		}
+		writeHeaders(link, entry_addr);
+		link->stats.bytes = link->out_size;
+	}
+	if (link->out != NULL) {
+		munmap(link->out, link->out_size);
+	}
+	if (fd >= 0) {
+		if (close(fd) != 0) {
+			perror(out_path);
+			link->errors++;
+		}
+		if (link->errors > 0) {
+			unlink(out_path);
+		}
+	}
+	link->stats.write_time = getTime() - start;
+
+	if (link->errors > LINK_MAX_ERRORS) {
+		printf("ERROR: %u more errors\n", link->errors - LINK_MAX_ERRORS);
+	}
+
+	int failed = (link->errors > 0);
+	*stats = link->stats;
+	for (uint32_t i = 0; i < count; i++) {
+		free(link->inputs[i].file);
+		free(link->inputs[i].defs);
+	}
+	free(link->inputs);
+	free(link->table);
+	free(link);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --link mode, links objects into an executable and reports the time of each phase
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-e symbol] <out> <obj>...
+	Return: int - exit code
+*/
+int linkMain(int argc, char** argv) {
+	int threads = 0;
+	const char* entry = NULL;
+
+	while (argc > 1 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-j") == 0) {
+			threads = atoi(argv[1]);
+		}
+		else if (strcmp(argv[0], "-e") == 0) {
+			entry = argv[1];
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 1;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2) {
+		error("--link needs an output file and at least one object");
+		return 1;
+	}
+
+	Link_Stats stats;
+	double start = getTime();
+	int failed = linkObjects(argv + 1, (uint32_t)(argc - 1), argv[0], entry, threads, &stats);
+	double wall = getTime() - start;
+	if (failed) {
+		return 1;
+	}
+
+	printf("Inputs: %d\tGlobals: %llu\tRelocations: %llu\tOut: %llu bytes\n", argc - 1,
+		(unsigned long long)stats.globals, (unsigned long long)stats.relocs, (unsigned long long)stats.bytes);
+	printf("Read: %.6f s\tLayout: %.6f s\tResolve: %.6f s\tRelocate: %.6f s\tWrite: %.6f s\tTotal: %.6f s\n",
+		stats.read_time, stats.layout_time, stats.resolve_time, stats.relocate_time, stats.write_time, wall);
+	return 0;
+}
@@ -0,0 +1,166 @@
+#ifndef _MIPS_LINK_H_
+#define _MIPS_LINK_H_
+
+#include <stdint.h>
+#include "MIPS_Elf.h"
+
+/*
+	Static linker for the objects --elf writes. The inputs' .text sections
+	are laid end to end from TEXT_BASE, and their .data from DATA_BASE. The
+	result is an ELF32 executable that --run and --disasm take. Each phase
+	runs over the inputs on a pool of threads:
+
+		read      every object is read and its sections and symbols found
+		layout    prefix sums give each input its addresses and its slots
+		          in the output's .symtab and .strtab
+		resolve   global definitions go into one lock free hash table
+		relocate  each input copies its sections into the mapped output,
+		          applies its relocations and writes its symbols
+
+	Relocations are R_MIPS_32, R_MIPS_PC16 for branches and R_MIPS_HI16/
+	LO16 for LUI/ORI address pairs. A HI16 takes its low half from the
+	LO16 that follows it. The high half only carries a borrow when that
+	LO16 sits in an instruction that sign extends.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// errors reported before the rest are only counted
+#define LINK_MAX_ERRORS 20
+
+// symbol the executable starts at when no -e is given
+#define LINK_DEFAULT_ENTRY "main"
+
+// output section header indexes
+#define LINK_SEC_TEXT 1
+#define LINK_SEC_DATA 2
+#define LINK_SEC_SYMTAB 3
+#define LINK_SEC_STRTAB 4
+#define LINK_SEC_SHSTRTAB 5
+#define LINK_SEC_COUNT 6
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a global definition, the name points into its input
+typedef struct {
+	const char* name;
+	uint32_t hash;
+	uint32_t addr;
+	uint32_t input;
+} Link_Symbol;
+
+// one object being linked
+typedef struct {
+	const char* path;
+	uint8_t* file;
+	size_t size;
+	int big;
+
+	// sections found by the read phase, NULL or 0 when missing
+	uint32_t text_index;
+	uint32_t data_index;
+	const uint8_t* text;
+	uint32_t text_size;
+	const uint8_t* data;
+	uint32_t data_size;
+	const uint8_t* syms;
+	uint32_t sym_count;
+	const char* strtab;
+	uint32_t strtab_size;
+	const uint8_t* rel_text;
+	uint32_t rel_text_count;
+	const uint8_t* rel_data;
+	uint32_t rel_data_count;
+
+	// defined symbols kept in the output, and the bytes their names take
+	uint32_t locals;
+	uint32_t globals;
+	uint32_t name_bytes;
+
+	// places given by the layout phase
+	uint32_t text_addr;
+	uint32_t data_addr;
+	uint32_t first_local;
+	uint32_t first_global;
+	uint32_t name_offset;
+
+	// the globals this input defines
+	Link_Symbol* defs;
+} Link_Input;
+
+// what each phase took and what was linked
+typedef struct {
+	double read_time;
+	double layout_time;
+	double resolve_time;
+	double relocate_time;
+	double write_time;
+	uint64_t relocs;
+	uint64_t globals;
+	uint64_t bytes;
+} Link_Stats;
+
+// a whole link
+typedef struct Linker {
+	Link_Input* inputs;
+	uint32_t count;
+	int threads;
+	int big;
+
+	// the phase the workers run
+	void (*job)(struct Linker*, Link_Input*);
+
+	// lock free hash of global definitions, a power of 2 slots
+	Link_Symbol** table;
+	uint32_t table_size;
+	// set by the resolve phase when a global is defined more than once
+	int duplicates;
+
+	// sizes and places of the output
+	uint32_t text_size;
+	uint32_t data_size;
+	uint32_t sym_count;
+	uint32_t local_count;
+	uint32_t name_bytes;
+	uint8_t* out;
+	uint64_t out_size;
+	uint32_t text_offset;
+	uint32_t data_offset;
+	uint32_t symtab_offset;
+	uint32_t strtab_offset;
+
+	uint32_t errors;
+	Link_Stats stats;
+} Linker;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: links objects into an executable
+	Params: char** paths - the objects
+			uint32_t count - how many
+			const char* out_path - the executable to write, removed again on error
+			const char* entry - the symbol to start at, NULL for LINK_DEFAULT_ENTRY or the start of .text
+			int threads - the number of threads, 0 for one per core
+			Link_Stats* stats - filled with the phase times and totals
+	Return: int - 0 for no error
+*/
+int linkObjects(char** paths, uint32_t count, const char* out_path, const char* entry, int threads, Link_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --link mode, links objects into an executable and reports the time of each phase
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-e symbol] <out> <obj>...
+	Return: int - exit code
+*/
+int linkMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,478 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Live.h"
+#include "MIPS_Util.h"
+
+// bytes of report collected before each write
+#define LIVE_OUT_SIZE (1u << 20)
+
+// longest line of the report
+#define LIVE_LINE_MAX 128
+
+// column the dead write comment starts at
+#define LIVE_COMMENT_COLUMN 40
+
+/*----------------------------\
+		   Effects
+\----------------------------*/
+/*
+	Purpose: gets the bit of a register in a register set
+	Params: uint32_t reg - the register number
+	Return: uint32_t - the bit, none for $zero
+*/
+static inline uint32_t regBit(uint32_t reg) {
+	return (reg == 0) ? 0 : 1u << reg;
+}
+
+/*
+	Purpose: gets the registers an instruction writes and reads
+	Params: uint32_t word - the instruction word
+			uint32_t* def - filled with the registers written
+			uint32_t* use - filled with the registers read
+	Return: int - the destination register, $zero included, -1 for none
+*/
+int liveEffect(uint32_t word, uint32_t* def, uint32_t* use) {
+	uint32_t rs = regBit(WORD_RS(word));
+	uint32_t rt = regBit(WORD_RT(word));
+	uint32_t rd = regBit(WORD_RD(word));
+
+	switch (wordOp(word)) {
+	case OP_ADD:
+	case OP_SUB:
+	case OP_AND:
+	case OP_OR:
+	case OP_SLT: { *def = rd; *use = rs | rt; return (int)WORD_RD(word); }
+	case OP_ADDI:
+	case OP_ANDI:
+	case OP_ORI:
+	case OP_SLTI:
+	case OP_LW: { *def = rt; *use = rs; return (int)WORD_RT(word); }
+	case OP_LUI: { *def = rt; *use = 0; return (int)WORD_RT(word); }
+	case OP_MFHI:
+	case OP_MFLO: { *def = rd; *use = LIVE_HILO; return (int)WORD_RD(word); }
+	case OP_MULT: { *def = LIVE_HILO; *use = rs | rt; return -1; }
+	// a divide by zero leaves HI/LO alone, so what was in them may still be read
+	case OP_DIV: { *def = LIVE_HILO; *use = rs | rt | LIVE_HILO; return -1; }
+	case OP_SW:
+	case OP_BEQ:
+	case OP_BNE: { *def = 0; *use = rs | rt; return -1; }
+	default: { *def = 0; *use = 0; return -1; }
+	}
+}
+
+/*
+	Purpose: checks whether control can leave the image at the end of a block
+	Params: const Cfg* cfg - the graph
+			uint32_t block - the block
+	Return: int - 1 if it can
+*/
+static int blockLeaves(const Cfg* cfg, uint32_t block) {
+	uint32_t last = cfg->block_start[block + 1] - 1;
+	uint32_t word = cfg->words[last];
+	int falls_out = (last + 1 >= cfg->word_count);
+
+	Op_Type op = wordOp(word);
+	if (op != OP_BEQ && op != OP_BNE) {
+		return falls_out;
+	}
+
+	int same = (WORD_RS(word) == WORD_RT(word));
+	int64_t target = (int64_t)last + 1 + (int16_t)WORD_IMM(word);
+	int taken_out = !(op == OP_BNE && same) && (target < 0 || target >= cfg->word_count);
+	return taken_out || (!(op == OP_BEQ && same) && falls_out);
+}
+
+
+/*----------------------------\
+		   Setup
+\----------------------------*/
+/*
+	Purpose: orders the blocks in postorder from block 0, then from any block not reached yet
+	Params: Live* live - the result, order and position allocated
+	Return: int - 0 for no error
+*/
+static int postorder(Live* live) {
+	const Cfg* cfg = live->cfg;
+	uint32_t count = cfg->block_count;
+
+	// the stack holds a block and the next of its edges to follow
+	uint32_t* stack = malloc((size_t)count * 2 * sizeof(uint32_t));
+	uint8_t* seen = calloc(count, 1);
+	if (stack == NULL || seen == NULL) {
+		free(stack);
+		free(seen);
+		return 1;
+	}
+
+	uint32_t placed = 0;
+	for (uint32_t root = 0; root < count; root++) {
+		if (seen[root]) {
+			continue;
+		}
+
+		uint32_t depth = 0;
+		seen[root] = 1;
+		stack[0] = root;
+		stack[1] = cfg->edge_start[root];
+		depth = 1;
+		while (depth > 0) {
+			uint32_t* top = &stack[(depth - 1) * 2];
+			if (top[1] < cfg->edge_start[top[0] + 1]) {
+				uint32_t next = cfg->edges[top[1]++];
+				if (!seen[next]) {
+					seen[next] = 1;
+					stack[depth * 2] = next;
+					stack[depth * 2 + 1] = cfg->edge_start[next];
+					depth++;
+				}
+				continue;
+			}
+
+			live->position[top[0]] = placed;
+			live->order[placed++] = top[0];
+			depth--;
+		}
+	}
+
+	free(stack);
+	free(seen);
+	return 0;
+}
+
+/*
+	Purpose: builds the predecessor lists by transposing the successor lists
+	Params: Live* live - the result
+	Return: int - 0 for no error
+*/
+static int predecessors(Live* live) {
+	const Cfg* cfg = live->cfg;
+	uint32_t count = cfg->block_count;
+
+	live->pred_start = calloc((size_t)count + 1, sizeof(uint32_t));
+	live->preds = malloc(((size_t)cfg->edge_count + 1) * sizeof(uint32_t));
+	if (live->pred_start == NULL || live->preds == NULL) {
+		return 1;
+	}
+
+	for (uint32_t e = 0; e < cfg->edge_count; e++) {
+		live->pred_start[cfg->edges[e] + 1]++;
+	}
+	for (uint32_t b = 0; b < count; b++) {
+		live->pred_start[b + 1] += live->pred_start[b];
+	}
+
+	// each block's row is filled from its start, using live_in as the cursors until solving
+	uint32_t* fill = live->live_in;
+	memcpy(fill, live->pred_start, (size_t)count * sizeof(uint32_t));
+	for (uint32_t b = 0; b < count; b++) {
+		for (uint32_t e = cfg->edge_start[b]; e < cfg->edge_start[b + 1]; e++) {
+			live->preds[fill[cfg->edges[e]]++] = b;
+		}
+	}
+	return 0;
+}
+
+/*
+	Purpose: sums up each block as the registers it reads first and the registers it writes
+	Params: Live* live - the result
+	Return: none
+*/
+static void summarize(Live* live) {
+	const Cfg* cfg = live->cfg;
+
+	for (uint32_t b = 0; b < cfg->block_count; b++) {
+		uint32_t gen = 0;
+		uint32_t kill = 0;
+
+		for (uint32_t i = cfg->block_start[b + 1]; i-- > cfg->block_start[b];) {
+			uint32_t def;
+			uint32_t use;
+			liveEffect(cfg->words[i], &def, &use);
+			gen = (gen & ~def) | use;
+			kill |= def;
+		}
+
+		live->gen[b] = gen;
+		live->kill[b] = kill;
+		live->leaves[b] = (uint8_t)blockLeaves(cfg, b);
+	}
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: solves liveness for every block of a graph
+	Params: Live* live - the result to fill
+			const Cfg* cfg - the graph, kept by the result
+			uint32_t exit_live - the registers live where control leaves the image
+			Live_Stats* stats - filled with the times and the work done
+	Return: int - 0 for no error
+*/
+int liveSolve(Live* live, const Cfg* cfg, uint32_t exit_live, Live_Stats* stats) {
+	memset(live, 0, sizeof(*live));
+	memset(stats, 0, sizeof(*stats));
+	live->cfg = cfg;
+	live->exit_live = exit_live;
+
+	uint32_t count = cfg->block_count;
+	size_t bytes = ((size_t)count + 1) * sizeof(uint32_t);
+	double start = getTime();
+
+	live->gen = malloc(bytes);
+	live->kill = malloc(bytes);
+	live->live_in = calloc((size_t)count + 1, sizeof(uint32_t));
+	live->live_out = calloc((size_t)count + 1, sizeof(uint32_t));
+	live->leaves = malloc((size_t)count + 1);
+	live->order = malloc(bytes);
+	live->position = malloc(bytes);
+	if (live->gen == NULL || live->kill == NULL || live->live_in == NULL || live->live_out == NULL ||
+		live->leaves == NULL || live->order == NULL || live->position == NULL ||
+		predecessors(live) != 0 || postorder(live) != 0) {
+		error("Out of memory");
+		liveFree(live);
+		return 1;
+	}
+	memset(live->live_in, 0, bytes);
+	summarize(live);
+	stats->setup_time = getTime() - start;
+
+	// every block starts on the worklist, one bit per postorder position
+	start = getTime();
+	uint32_t groups = (count + 63) / 64;
+	uint64_t* dirty = malloc((size_t)groups * sizeof(uint64_t));
+	if (dirty == NULL) {
+		error("Out of memory");
+		liveFree(live);
+		return 1;
+	}
+	memset(dirty, 0xFF, (size_t)groups * sizeof(uint64_t));
+	if (count % 64 != 0) {
+		dirty[groups - 1] = (1ull << (count % 64)) - 1;
+	}
+
+	uint32_t pending = count;
+	while (pending > 0) {
+		stats->passes++;
+		for (uint32_t g = 0; g < groups; g++) {
+			while (dirty[g] != 0) {
+				uint32_t p = (g << 6) + (uint32_t)__builtin_ctzll(dirty[g]);
+				dirty[g] &= dirty[g] - 1;
+				pending--;
+
+				uint32_t b = live->order[p];
+				uint32_t out = live->leaves[b] ? exit_live : 0;
+				for (uint32_t e = cfg->edge_start[b]; e < cfg->edge_start[b + 1]; e++) {
+					out |= live->live_in[cfg->edges[e]];
+				}
+				live->live_out[b] = out;
+				stats->visits++;
+
+				uint32_t in = live->gen[b] | (out & ~live->kill[b]);
+				if (in == live->live_in[b]) {
+					continue;
+				}
+				live->live_in[b] = in;
+
+				// predecessors later in postorder are reached in this pass, earlier ones in the next
+				for (uint32_t e = live->pred_start[b]; e < live->pred_start[b + 1]; e++) {
+					uint32_t q = live->position[live->preds[e]];
+					uint64_t bit = 1ull << (q & 63);
+					if ((dirty[q >> 6] & bit) == 0) {
+						dirty[q >> 6] |= bit;
+						pending++;
+					}
+				}
+			}
+		}
+	}
+
+	free(dirty);
+	stats->solve_time = getTime() - start;
+	return 0;
+}
+
+/*
+	Purpose: releases a result
+	Params: Live* live - the result
+	Return: none
+*/
+void liveFree(Live* live) {
+	free(live->gen);
+	free(live->kill);
+	free(live->live_in);
+	free(live->live_out);
+	free(live->leaves);
+	free(live->order);
+	free(live->position);
+	free(live->pred_start);
+	free(live->preds);
+	memset(live, 0, sizeof(*live));
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --live mode, solves liveness for an image's .text and reports dead writes and register pressure
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-x mask] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int liveMain(int argc, char** argv) {
+	int threads = 0;
+	int big = 1;
+	uint32_t raw_base = TEXT_BASE;
+	uint32_t exit_live = LIVE_ALL;
+
+	while (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		if (imageOptions(&argc, &argv, &raw_base, &big, &threads) > 0) {
+			continue;
+		}
+		if (argc < 2) {
+			break;
+		}
+		if (strcmp(argv[0], "-x") == 0) {
+			exit_live = (uint32_t)strtoul(argv[1], NULL, 0);
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 1;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 1) {
+		error("--live needs an ELF, Intel HEX, S-record or raw file");
+		return 1;
+	}
+
+	Elf_Image image;
+	if (imageOpenAny(&image, argv[0], raw_base, big) != 0) {
+		return 1;
+	}
+
+	uint32_t count;
+	const uint32_t* words = imageText(&image, &count);
+	if (words == NULL) {
+		error("Out of memory");
+		imageClose(&image);
+		return 1;
+	}
+
+	Cfg cfg;
+	Cfg_Stats cfg_stats;
+	if (cfgBuild(&cfg, words, count, image.text_addr, threads, &cfg_stats) != 0) {
+		imageClose(&image);
+		return 1;
+	}
+
+	Live live;
+	Live_Stats stats;
+	if (liveSolve(&live, &cfg, exit_live, &stats) != 0) {
+		cfgFree(&cfg);
+		imageClose(&image);
+		return 1;
+	}
+
+	FILE* out = NULL;
+	char* buffer = NULL;
+	int failed = 0;
+	if (argc > 1) {
+		out = (strcmp(argv[1], "-") == 0) ? stdout : fopen(argv[1], "w");
+		buffer = malloc(LIVE_OUT_SIZE);
+		if (out == NULL || buffer == NULL) {
+			perror(argv[1]);
+			failed = 1;
+		}
+	}
+
+	// each block is walked backwards from its live out set, the report is written forwards
+	double start = getTime();
+	uint64_t dead = 0;
+	uint64_t pressure_sum = 0;
+	uint32_t pressure_max = 0;
+	uint32_t* dead_at = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	size_t used = 0;
+	if (dead_at == NULL) {
+		error("Out of memory");
+		failed = 1;
+	}
+	for (uint32_t b = 0; b < cfg.block_count && !failed; b++) {
+		uint32_t live_now = live.live_out[b];
+		uint32_t block_max = (uint32_t)__builtin_popcount(live_now & ~LIVE_HILO);
+		uint32_t dead_count = 0;
+
+		for (uint32_t i = cfg.block_start[b + 1]; i-- > cfg.block_start[b];) {
+			uint32_t def;
+			uint32_t use;
+			if (liveEffect(cfg.words[i], &def, &use) >= 0 && (def & live_now) == 0) {
+				dead_at[dead_count++] = i;
+			}
+			live_now = (live_now & ~def) | use;
+
+			uint32_t pressure = (uint32_t)__builtin_popcount(live_now & ~LIVE_HILO);
+			if (pressure > block_max) {
+				block_max = pressure;
+			}
+		}
+		dead += dead_count;
+		pressure_sum += block_max;
+		if (block_max > pressure_max) {
+			pressure_max = block_max;
+		}
+
+		if (out == NULL) {
+			continue;
+		}
+		if (LIVE_OUT_SIZE - used < LIVE_LINE_MAX) {
+			failed = (fwrite(buffer, 1, used, out) != used);
+			used = 0;
+		}
+		used += (size_t)sprintf(buffer + used, "%08X..%08X  max live %u\n", cfg.base + cfg.block_start[b] * 4,
+			cfg.base + (cfg.block_start[b + 1] - 1) * 4, block_max);
+		while (dead_count > 0 && !failed) {
+			uint32_t i = dead_at[--dead_count];
+			uint32_t def;
+			uint32_t use;
+			Decoded_Instruct d;
+			char text[ASSM_TEXT_SIZE];
+			int reg = liveEffect(cfg.words[i], &def, &use);
+			decodeWord(cfg.words[i], &d);
+			formatAssm(text, &d);
+
+			if (LIVE_OUT_SIZE - used < LIVE_LINE_MAX) {
+				failed = (fwrite(buffer, 1, used, out) != used);
+				used = 0;
+			}
+			used += (size_t)sprintf(buffer + used, "  %08X:  %-*s; dead write to %s\n", cfg.base + i * 4,
+				LIVE_COMMENT_COLUMN - 13, text, regName((uint32_t)reg));
+		}
+	}
+	if (out != NULL && !failed) {
+		failed = (fwrite(buffer, 1, used, out) != used);
+	}
+	if (out != NULL && out != stdout) {
+		failed |= (fclose(out) != 0);
+	}
+	double report_time = getTime() - start;
+
+	fprintf(stderr, "Words: %u\tBlocks: %u\tEdges: %u\tDead writes: %llu\tMax live: %u\tAverage block max: %.2f\n",
+		count, cfg.block_count, cfg.edge_count, (unsigned long long)dead, pressure_max,
+		cfg.block_count ? (double)pressure_sum / cfg.block_count : 0.0);
+	fprintf(stderr, "Passes: %u\tVisits: %llu (%.2f per block)\n", stats.passes, (unsigned long long)stats.visits,
+		cfg.block_count ? (double)stats.visits / cfg.block_count : 0.0);
+	fprintf(stderr, "CFG: %.6f s\tSetup: %.6f s\tSolve: %.6f s\tReport: %.6f s\n", cfg_stats.time, stats.setup_time,
+		stats.solve_time, report_time);
+
+	free(dead_at);
+	free(buffer);
+	liveFree(&live);
+	cfgFree(&cfg);
+	imageClose(&image);
+	return failed;
+}
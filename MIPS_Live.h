@@ -0,0 +1,108 @@
+#ifndef _MIPS_LIVE_H_
+#define _MIPS_LIVE_H_
+
+#include <stdint.h>
+#include "MIPS_Cfg.h"
+
+/*
+	Register liveness over a control flow graph. A register set is one
+	32 bit word with a bit per register. $zero is never live, so its bit
+	stands for HI/LO, which MULT and DIV write together and MFHI/MFLO
+	read. A DIV by zero leaves HI/LO as they were, so DIV also uses them.
+
+	Each block is summed up once as the registers it reads before writing
+	(gen) and the registers it writes (kill). The solver then visits the
+	blocks in postorder, the reverse postorder of the reversed graph, so
+	most successors are done before their predecessors. A block whose
+	live in set changes puts its predecessors back on the worklist, a
+	bitset over postorder positions.
+
+	Where control leaves the image every register in exit_live is live.
+	A write nothing reads before it is written again, or before it leaves,
+	is a dead write.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// the bit HI/LO use in a register set
+#define LIVE_HILO 0x1u
+
+// every register, the default set live where control leaves the image
+#define LIVE_ALL 0xFFFFFFFFu
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what solving took
+typedef struct {
+	double setup_time;
+	double solve_time;
+	uint64_t visits;
+	uint32_t passes;
+} Live_Stats;
+
+// liveness of every block of a graph
+typedef struct {
+	const Cfg* cfg;
+	uint32_t exit_live;
+
+	// per block
+	uint32_t* gen;
+	uint32_t* kill;
+	uint32_t* live_in;
+	uint32_t* live_out;
+	uint8_t* leaves;
+
+	// blocks in postorder, and each block's place in it
+	uint32_t* order;
+	uint32_t* position;
+
+	// CSR predecessors
+	uint32_t* pred_start;
+	uint32_t* preds;
+} Live;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: gets the registers an instruction writes and reads
+	Params: uint32_t word - the instruction word
+			uint32_t* def - filled with the registers written
+			uint32_t* use - filled with the registers read
+	Return: int - the destination register, $zero included, -1 for none
+*/
+int liveEffect(uint32_t word, uint32_t* def, uint32_t* use);
+
+/*
+	Purpose: solves liveness for every block of a graph
+	Params: Live* live - the result to fill
+			const Cfg* cfg - the graph, kept by the result
+			uint32_t exit_live - the registers live where control leaves the image
+			Live_Stats* stats - filled with the times and the work done
+	Return: int - 0 for no error
+*/
+int liveSolve(Live* live, const Cfg* cfg, uint32_t exit_live, Live_Stats* stats);
+
+/*
+	Purpose: releases a result
+	Params: Live* live - the result
+	Return: none
+*/
+void liveFree(Live* live);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --live mode, solves liveness for an image's .text and reports dead writes and register pressure
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-x mask] [-EB|-EL] [-a addr] <file> [out|-]
+	Return: int - exit code
+*/
+int liveMain(int argc, char** argv);
+
+#endif
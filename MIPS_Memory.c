@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+#include "MIPS_Memory.h"
+
+/*----------------------------\
+		   Tables
+\----------------------------*/
+/*
+	Purpose: finds the entry for a page in a two level table, mapping the leaf if asked
+	Params: uint32_t*** dir - the table
+			uint32_t addr - the guest address
+			int create - maps a missing leaf when set
+	Return: uint32_t** - the page entry, NULL if the leaf is missing
+*/
+static uint32_t** pageEntry(uint32_t*** dir, uint32_t addr, int create) {
+	uint32_t*** leaf = &dir[MEM_DIR_INDEX(addr)];
+
+	if (*leaf == NULL) {
+		if (!create) {
+			return NULL;
+		}
+		*leaf = calloc(MEM_LEAF_SIZE, sizeof(uint32_t*));
+		if (*leaf == NULL) {
+			return NULL;
+		}
+	}
+
+	return &(*leaf)[MEM_LEAF_INDEX(addr)];
+}
+
+/*
+	Purpose: checks if any watchpoint is on the same page as an address
+	Params: Guest_Memory* mem - the memory to check
+			uint32_t addr - the guest address
+	Return: int - 1 if the page is watched
+*/
+static int pageWatched(Guest_Memory* mem, uint32_t addr) {
+	for (uint32_t i = 0; i < mem->watch_count; i++) {
+		if ((mem->watches[i].addr >> MEM_PAGE_BITS) == (addr >> MEM_PAGE_BITS)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+	Purpose: checks an access against the watchpoints and remembers the one it triggers
+	Params: Guest_Memory* mem - the memory accessed
+			uint32_t addr - the word aligned guest address
+			uint32_t kind - WATCH_READ or WATCH_WRITE
+			uint32_t value - the word read or written
+	Return: int - 1 if a watchpoint triggered
+*/
+static int checkWatch(Guest_Memory* mem, uint32_t addr, uint32_t kind, uint32_t value) {
+	for (uint32_t i = 0; i < mem->watch_count; i++) {
+		if (mem->watches[i].addr == addr && (mem->watches[i].kind & kind) != 0) {
+			mem->hit.addr = addr;
+			mem->hit.kind = kind;
+			mem->hit_value = value;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/*----------------------------\
+		   Setup
+\----------------------------*/
+/*
+	Purpose: sets up an empty guest memory, every word reads as zero
+	Params: Guest_Memory* mem - the memory to set up
+	Return: none
+*/
+void memInit(Guest_Memory* mem) {
+	memset(mem, 0, sizeof(*mem));
+}
+
+/*
+	Purpose: releases every page held by a guest memory
+	Params: Guest_Memory* mem - the memory to release
+	Return: none
+*/
+void memFree(Guest_Memory* mem) {
+	for (uint32_t d = 0; d < MEM_DIR_SIZE; d++) {
+		// pages are owned by the full table, the fast table only borrows them
+		if (mem->all[d] != NULL) {
+			for (uint32_t l = 0; l < MEM_LEAF_SIZE; l++) {
+				free(mem->all[d][l]);
+			}
+		}
+		free(mem->all[d]);
+		free(mem->dir[d]);
+	}
+
+	memInit(mem);
+}
+
+/*
+	Purpose: hashes every non-zero word with its address, so equal contents hash equal
+	Params: Guest_Memory* mem - the memory to hash
+	Return: uint64_t - the hash
+*/
+uint64_t memChecksum(Guest_Memory* mem) {
+	// FNV-1a over (address, value) pairs in address order
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (uint32_t d = 0; d < MEM_DIR_SIZE; d++) {
+		if (mem->all[d] == NULL) {
+			continue;
+		}
+
+		for (uint32_t l = 0; l < MEM_LEAF_SIZE; l++) {
+			uint32_t* page = mem->all[d][l];
+			if (page == NULL) {
+				continue;
+			}
+
+			for (uint32_t w = 0; w < MEM_PAGE_WORDS; w++) {
+				if (page[w] == 0) {
+					continue;
+				}
+
+				uint32_t addr = (d << (MEM_PAGE_BITS + MEM_LEAF_BITS)) | (l << MEM_PAGE_BITS) | (w << 2);
+				hash = (hash ^ addr) * 0x100000001B3ull;
+				hash = (hash ^ page[w]) * 0x100000001B3ull;
+			}
+		}
+	}
+
+	return hash;
+}
+
+/*
+	Purpose: sets a watchpoint on a word, taking its page out of the fast table
+	Params: Guest_Memory* mem - the memory to watch
+			uint32_t addr - the word aligned guest address
+			uint32_t kind - WATCH_READ and/or WATCH_WRITE
+	Return: int - 0 for no error, 1 if every watchpoint is in use
+*/
+int memWatch(Guest_Memory* mem, uint32_t addr, uint32_t kind) {
+	if (mem->watch_count == MEM_MAX_WATCHES) {
+		return 1;
+	}
+
+	mem->watches[mem->watch_count].addr = addr & ~3u;
+	mem->watches[mem->watch_count].kind = kind;
+	mem->watch_count++;
+
+	// every access to the page now goes through the slow path
+	uint32_t** fast = pageEntry(mem->dir, addr, 0);
+	if (fast != NULL) {
+		*fast = NULL;
+	}
+
+	return 0;
+}
+
+
+/*----------------------------\
+		  Slow Paths
+\----------------------------*/
+/*
+	Purpose: reads a word whose page is not in the fast table
+	Params: Guest_Memory* mem - the memory to read
+			uint32_t addr - the word aligned guest address
+			uint32_t* value - filled with the word at the address
+	Return: int - 1 if a watchpoint triggered, the read still happens
+*/
+int memReadSlow(Guest_Memory* mem, uint32_t addr, uint32_t* value) {
+	uint32_t** page = pageEntry(mem->all, addr, 0);
+
+	// unmapped pages read as zero and stay unmapped
+	*value = (page != NULL && *page != NULL) ? (*page)[MEM_WORD_INDEX(addr)] : 0;
+
+	return (mem->watch_count != 0) ? checkWatch(mem, addr, WATCH_READ, *value) : 0;
+}
+
+/*
+	Purpose: writes a word whose page is not in the fast table, mapping the page if needed
+	Params: Guest_Memory* mem - the memory to write
+			uint32_t addr - the word aligned guest address
+			uint32_t value - the word to store
+	Return: int - 0, MEM_WATCH_HIT if a watchpoint triggered and the write still happens,
+			MEM_NO_PAGE if the page could not be mapped and the write is lost
+*/
+int memWriteSlow(Guest_Memory* mem, uint32_t addr, uint32_t value) {
+	uint32_t** page = pageEntry(mem->all, addr, 1);
+	if (page == NULL) {
+		return MEM_NO_PAGE;
+	}
+
+	// maps the page on first use, unwatched pages also go in the fast table
+	if (*page == NULL) {
+		*page = calloc(MEM_PAGE_WORDS, sizeof(uint32_t));
+		if (*page == NULL) {
+			return MEM_NO_PAGE;
+		}
+		mem->pages_mapped++;
+
+		if (!pageWatched(mem, addr)) {
+			uint32_t** fast = pageEntry(mem->dir, addr, 1);
+			if (fast != NULL) {
+				*fast = *page;
+			}
+		}
+	}
+
+	(*page)[MEM_WORD_INDEX(addr)] = value;
+
+	return (mem->watch_count != 0 && checkWatch(mem, addr, WATCH_WRITE, value)) ? MEM_WATCH_HIT : 0;
+}
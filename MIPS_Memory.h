@@ -0,0 +1,167 @@
+#ifndef _MIPS_MEMORY_H_
+#define _MIPS_MEMORY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// guest memory is split into 4 KB pages, found through a two level table
+#define MEM_PAGE_BITS 12
+#define MEM_PAGE_SIZE (1u << MEM_PAGE_BITS)
+#define MEM_PAGE_WORDS (MEM_PAGE_SIZE / 4)
+#define MEM_LEAF_BITS 10
+#define MEM_LEAF_SIZE (1u << MEM_LEAF_BITS)
+#define MEM_DIR_SIZE (1u << (32 - MEM_PAGE_BITS - MEM_LEAF_BITS))
+
+// splits a guest address into its table indexes
+#define MEM_DIR_INDEX(a) ((a) >> (MEM_PAGE_BITS + MEM_LEAF_BITS))
+#define MEM_LEAF_INDEX(a) (((a) >> MEM_PAGE_BITS) & (MEM_LEAF_SIZE - 1))
+#define MEM_WORD_INDEX(a) (((a) & (MEM_PAGE_SIZE - 1)) >> 2)
+
+// most watchpoints that can be set at once
+#define MEM_MAX_WATCHES 16
+
+// what a watchpoint triggers on
+#define WATCH_READ 1
+#define WATCH_WRITE 2
+
+// what memWriteSlow reports besides 0 for a plain write
+#define MEM_WATCH_HIT 1
+#define MEM_NO_PAGE 2
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a watched word and what triggers it
+typedef struct {
+	uint32_t addr;
+	uint32_t kind;
+} Mem_Watch;
+
+/*
+	Sparse 32 bit guest address space, words are stored in host order.
+	Every mapped page is in the full table, the fast table holds the same
+	pages except the ones with a watchpoint, so accesses to watched pages
+	(and unmapped ones) are the only ones that take the slow path.
+*/
+typedef struct Guest_Memory {
+	uint32_t** dir[MEM_DIR_SIZE];
+	uint32_t** all[MEM_DIR_SIZE];
+	uint32_t pages_mapped;
+
+	// watchpoints and the last one to trigger
+	Mem_Watch watches[MEM_MAX_WATCHES];
+	uint32_t watch_count;
+	Mem_Watch hit;
+	uint32_t hit_value;
+} Guest_Memory;
+
+
+/*----------------------------\
+		   Setup
+\----------------------------*/
+/*
+	Purpose: sets up an empty guest memory, every word reads as zero
+	Params: Guest_Memory* mem - the memory to set up
+	Return: none
+*/
+void memInit(Guest_Memory* mem);
+
+/*
+	Purpose: releases every page held by a guest memory
+	Params: Guest_Memory* mem - the memory to release
+	Return: none
+*/
+void memFree(Guest_Memory* mem);
+
+/*
+	Purpose: hashes every non-zero word with its address, so equal contents hash equal
+	Params: Guest_Memory* mem - the memory to hash
+	Return: uint64_t - the hash
+*/
+uint64_t memChecksum(Guest_Memory* mem);
+
+/*
+	Purpose: sets a watchpoint on a word, taking its page out of the fast table
+	Params: Guest_Memory* mem - the memory to watch
+			uint32_t addr - the word aligned guest address
+			uint32_t kind - WATCH_READ and/or WATCH_WRITE
+	Return: int - 0 for no error, 1 if every watchpoint is in use
+*/
+int memWatch(Guest_Memory* mem, uint32_t addr, uint32_t kind);
+
+
+/*----------------------------\
+		  Slow Paths
+\----------------------------*/
+/*
+	Purpose: reads a word whose page is not in the fast table
+	Params: Guest_Memory* mem - the memory to read
+			uint32_t addr - the word aligned guest address
+			uint32_t* value - filled with the word at the address
+	Return: int - 1 if a watchpoint triggered, the read still happens
+*/
+int memReadSlow(Guest_Memory* mem, uint32_t addr, uint32_t* value);
+
+/*
+	Purpose: writes a word whose page is not in the fast table, mapping the page if needed
+	Params: Guest_Memory* mem - the memory to write
+			uint32_t addr - the word aligned guest address
+			uint32_t value - the word to store
+	Return: int - 0, MEM_WATCH_HIT if a watchpoint triggered and the write still happens,
+			MEM_NO_PAGE if the page could not be mapped and the write is lost
+*/
+int memWriteSlow(Guest_Memory* mem, uint32_t addr, uint32_t value);
+
+
+/*----------------------------\
+		   Accessors
+\----------------------------*/
+/*
+	Purpose: finds the host page backing a guest address
+	Params: Guest_Memory* mem - the memory to search
+			uint32_t addr - the guest address
+	Return: uint32_t* - the page, NULL if the page must take the slow path
+*/
+static inline uint32_t* memPage(Guest_Memory* mem, uint32_t addr) {
+	uint32_t** leaf = mem->dir[MEM_DIR_INDEX(addr)];
+	return (leaf != NULL) ? leaf[MEM_LEAF_INDEX(addr)] : NULL;
+}
+
+/*
+	Purpose: reads a word from guest memory
+	Params: Guest_Memory* mem - the memory to read
+			uint32_t addr - the word aligned guest address
+	Return: uint32_t - the word at the address
+*/
+static inline uint32_t memRead(Guest_Memory* mem, uint32_t addr) {
+	uint32_t* page = memPage(mem, addr);
+
+	if (page == NULL) {
+		uint32_t value;
+		memReadSlow(mem, addr, &value);
+		return value;
+	}
+	return page[MEM_WORD_INDEX(addr)];
+}
+
+/*
+	Purpose: writes a word to guest memory
+	Params: Guest_Memory* mem - the memory to write
+			uint32_t addr - the word aligned guest address
+			uint32_t value - the word to store
+	Return: int - 0, or what memWriteSlow reports when the page is not in the fast table
+*/
+static inline int memWrite(Guest_Memory* mem, uint32_t addr, uint32_t value) {
+	uint32_t* page = memPage(mem, addr);
+
+	if (page == NULL) {
+		return memWriteSlow(mem, addr, value);
+	}
+	page[MEM_WORD_INDEX(addr)] = value;
+	return 0;
+}
+
+#endif
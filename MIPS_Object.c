@@ -0,0 +1,998 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Object.h"
+#include "MIPS_Util.h"
+
+// line length accepted by the assembler, the same as the program loader
+#define LINE_SIZE 256
+
+// stream indexes, one for each section written while encoding
+#define STREAM_TEXT 0
+#define STREAM_DATA 1
+#define STREAM_REL_TEXT 2
+#define STREAM_REL_DATA 3
+#define STREAM_COUNT 4
+
+// marks an empty slot of the symbol hash
+#define NO_SYMBOL UINT32_MAX
+
+// what an instruction names a symbol for
+typedef enum Ref_Kind {
+	REF_NONE,
+	REF_BRANCH,
+	REF_HI,
+	REF_LO
+} Ref_Kind;
+
+// a label or a name used before or without being defined
+typedef struct {
+	uint32_t name;
+	uint32_t value;
+	uint32_t branches;
+	uint32_t index;
+	uint8_t section;
+	uint8_t global;
+} Object_Symbol;
+
+// a section being written at its fixed offset
+typedef struct {
+	int fd;
+	uint64_t offset;
+	size_t len;
+	uint8_t buf[OBJECT_STREAM_SIZE];
+} Section_Stream;
+
+// a symbol use found in an instruction, the text between start and end is replaced
+typedef struct {
+	Ref_Kind kind;
+	char* start;
+	char* end;
+	char name[OBJECT_NAME_MAX + 1];
+} Symbol_Ref;
+
+// everything one assembly keeps between its passes
+typedef struct {
+	const char* path;
+	int line_num;
+	int big;
+	int pass;
+	int failed;
+
+	// symbols are found through an open addressed hash of their names
+	Object_Symbol* syms;
+	uint32_t sym_count;
+	uint32_t sym_size;
+	uint32_t* hash;
+	uint32_t hash_size;
+
+	// names are stored once, already laid out as .strtab
+	char* strtab;
+	uint32_t str_len;
+	uint32_t str_size;
+
+	// sizes found by the first pass, positions reached by the second
+	uint8_t section;
+	uint32_t words[3];
+	uint32_t relocs[3];
+	uint32_t words_done[3];
+	uint32_t relocs_done[3];
+	uint32_t first_global;
+
+	Section_Stream streams[STREAM_COUNT];
+} Object_Asm;
+
+// names of the sections, in section header order
+static const char* section_names[OBJECT_SEC_COUNT] = {
+	"", ".text", ".data", ".rel.text", ".rel.data", ".symtab", ".strtab", ".shstrtab"
+};
+
+/*----------------------------\
+		   Errors
+\----------------------------*/
+/*
+	Purpose: reports an error at the current source line and fails the assembly
+	Params: Object_Asm* a - the assembly
+			const char* msg - what went wrong
+	Return: none
+*/
+static void sourceError(Object_Asm* a, const char* msg) {
+	printf("%s:%d: ", a->path, a->line_num);
+	error((char*)msg);
+	a->failed = 1;
+}
+
+
+/*----------------------------\
+		   Symbols
+\----------------------------*/
+/*
+	Purpose: hashes a symbol name, FNV-1a
+	Params: const char* name - the name
+	Return: uint32_t - the hash
+*/
+static uint32_t nameHash(const char* name) {
+	uint32_t hash = 2166136261u;
+	while (*name != '\0') {
+		hash = (hash ^ (uint8_t)*name++) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+	Purpose: adds a name to the string table
+	Params: Object_Asm* a - the assembly
+			const char* name - the name
+	Return: uint32_t - its offset in the table, 0 if it could not be added
+*/
+static uint32_t addName(Object_Asm* a, const char* name) {
+	size_t len = strlen(name) + 1;
+
+	if (a->str_len + len > a->str_size) {
+		uint32_t size = a->str_size * 2;
+		while (size < a->str_len + len) {
+			size *= 2;
+		}
+		char* grown = realloc(a->strtab, size);
+		if (grown == NULL) {
+			return 0;
+		}
+		a->strtab = grown;
+		a->str_size = size;
+	}
+
+	uint32_t offset = a->str_len;
+	memcpy(a->strtab + offset, name, len);
+	a->str_len += (uint32_t)len;
+	return offset;
+}
+
+/*
+	Purpose: doubles the symbol hash and puts every symbol back in it
+	Params: Object_Asm* a - the assembly
+	Return: int - 0 for no error
+*/
+static int growHash(Object_Asm* a) {
+	uint32_t size = a->hash_size * 2;
+	uint32_t* hash = malloc(size * sizeof(uint32_t));
+	if (hash == NULL) {
+		return 1;
+	}
+	memset(hash, 0xFF, size * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < a->sym_count; i++) {
+		uint32_t slot = nameHash(a->strtab + a->syms[i].name) & (size - 1);
+		while (hash[slot] != NO_SYMBOL) {
+			slot = (slot + 1) & (size - 1);
+		}
+		hash[slot] = i;
+	}
+
+	free(a->hash);
+	a->hash = hash;
+	a->hash_size = size;
+	return 0;
+}
+
+/*
+	Purpose: finds a symbol by name, adding it undefined if it is new
+	Params: Object_Asm* a - the assembly
+			const char* name - the name
+	Return: Object_Symbol* - the symbol, NULL if out of memory
+*/
+static Object_Symbol* findSymbol(Object_Asm* a, const char* name) {
+	uint32_t slot = nameHash(name) & (a->hash_size - 1);
+
+	while (a->hash[slot] != NO_SYMBOL) {
+		Object_Symbol* sym = &a->syms[a->hash[slot]];
+		if (strcmp(a->strtab + sym->name, name) == 0) {
+			return sym;
+		}
+		slot = (slot + 1) & (a->hash_size - 1);
+	}
+
+	// the hash is kept at most half full
+	if ((a->sym_count + 1) * 2 > a->hash_size) {
+		if (growHash(a) != 0) {
+			return NULL;
+		}
+		return findSymbol(a, name);
+	}
+	if (a->sym_count == a->sym_size) {
+		uint32_t size = a->sym_size * 2;
+		Object_Symbol* grown = realloc(a->syms, size * sizeof(Object_Symbol));
+		if (grown == NULL) {
+			return NULL;
+		}
+		a->syms = grown;
+		a->sym_size = size;
+	}
+
+	Object_Symbol* sym = &a->syms[a->sym_count];
+	memset(sym, 0, sizeof(*sym));
+	sym->name = addName(a, name);
+	if (sym->name == 0) {
+		return NULL;
+	}
+	a->hash[slot] = a->sym_count++;
+	return sym;
+}
+
+/*
+	Purpose: finds a symbol for the current line, reporting running out of memory
+	Params: Object_Asm* a - the assembly
+			const char* name - the name
+	Return: Object_Symbol* - the symbol, NULL on error
+*/
+static Object_Symbol* useSymbol(Object_Asm* a, const char* name) {
+	Object_Symbol* sym = findSymbol(a, name);
+	if (sym == NULL) {
+		sourceError(a, "Out of memory");
+	}
+	return sym;
+}
+
+
+/*----------------------------\
+		   Streams
+\----------------------------*/
+/*
+	Purpose: writes out what a section stream has collected
+	Params: Section_Stream* s - the stream
+	Return: int - 0 for no error
+*/
+static int streamFlush(Section_Stream* s) {
+	size_t done = 0;
+
+	while (done < s->len) {
+		ssize_t wrote = pwrite(s->fd, s->buf + done, s->len - done, (off_t)(s->offset + done));
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("write");
+			return 1;
+		}
+		done += (size_t)wrote;
+	}
+
+	s->offset += done;
+	s->len = 0;
+	return 0;
+}
+
+/*
+	Purpose: adds bytes to a section stream
+	Params: Object_Asm* a - the assembly
+			int stream - which stream
+			const uint8_t* bytes - the bytes, at most a few words
+			size_t len - how many
+	Return: none
+*/
+static void streamPut(Object_Asm* a, int stream, const uint8_t* bytes, size_t len) {
+	Section_Stream* s = &a->streams[stream];
+	if (s->len + len > OBJECT_STREAM_SIZE) {
+		a->failed |= streamFlush(s);
+	}
+	memcpy(s->buf + s->len, bytes, len);
+	s->len += len;
+}
+
+/*
+	Purpose: writes a word into the current section, the second pass only
+	Params: Object_Asm* a - the assembly
+			uint32_t word - the word
+	Return: none
+*/
+static void putWord(Object_Asm* a, uint32_t word) {
+	if (a->pass == 2) {
+		uint8_t bytes[4];
+		elfPut32(bytes, word, a->big);
+		streamPut(a, (a->section == OBJECT_SEC_TEXT) ? STREAM_TEXT : STREAM_DATA, bytes, 4);
+	}
+	a->words_done[a->section]++;
+}
+
+/*
+	Purpose: records a relocation at the current word of the current section
+	Params: Object_Asm* a - the assembly
+			const Object_Symbol* sym - the symbol it refers to
+			uint32_t type - the relocation type
+	Return: none
+*/
+static void putReloc(Object_Asm* a, const Object_Symbol* sym, uint32_t type) {
+	if (a->pass == 2) {
+		Elf_Rel rel = { a->words_done[a->section] * 4, ELF_R_INFO(sym->index, type) };
+		uint8_t bytes[ELF32_REL_SIZE];
+		elfPackRel(bytes, &rel, a->big);
+		streamPut(a, (a->section == OBJECT_SEC_TEXT) ? STREAM_REL_TEXT : STREAM_REL_DATA, bytes, sizeof(bytes));
+	}
+	a->relocs_done[a->section]++;
+}
+
+
+/*----------------------------\
+		   Source
+\----------------------------*/
+/*
+	Purpose: checks for a character that can start a symbol name
+	Params: char c - the character
+	Return: int - 1 if it can
+*/
+static int nameStart(char c) {
+	return isalpha((unsigned char)c) || c == '_' || c == '.';
+}
+
+/*
+	Purpose: checks for a character that can be inside a symbol name
+	Params: char c - the character
+	Return: int - 1 if it can
+*/
+static int nameChar(char c) {
+	return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+/*
+	Purpose: reads a symbol name
+	Params: Object_Asm* a - the assembly, for errors
+			char* text - the name's first character
+			char* name - OBJECT_NAME_MAX + 1 bytes to fill
+	Return: char* - the ptr to after the name, NULL on error
+*/
+static char* readName(Object_Asm* a, char* text, char* name) {
+	if (!nameStart(*text)) {
+		sourceError(a, "Expected a symbol name");
+		return NULL;
+	}
+
+	size_t len = 0;
+	while (nameChar(text[len])) {
+		len++;
+	}
+	if (len > OBJECT_NAME_MAX) {
+		sourceError(a, "Symbol name too long");
+		return NULL;
+	}
+
+	memcpy(name, text, len);
+	name[len] = '\0';
+	return text + len;
+}
+
+/*
+	Purpose: finds the symbol an instruction names, if any
+	Params: char* text - the instruction
+			Symbol_Ref* ref - filled with the use, kind REF_NONE if there is none
+	Return: none
+*/
+static void findRef(char* text, Symbol_Ref* ref) {
+	ref->kind = REF_NONE;
+
+	char* half = strstr(text, "%hi(");
+	if (half != NULL) {
+		ref->kind = REF_HI;
+	}
+	else if ((half = strstr(text, "%lo(")) != NULL) {
+		ref->kind = REF_LO;
+	}
+
+	if (half != NULL) {
+		// the usual # in front of an immediate is replaced along with it
+		ref->start = (half > text && half[-1] == '#') ? half - 1 : half;
+		char* name = half + 4;
+		size_t len = 0;
+		while (nameChar(name[len]) && len < OBJECT_NAME_MAX) {
+			len++;
+		}
+		memcpy(ref->name, name, len);
+		ref->name[len] = '\0';
+		ref->end = (name[len] == ')') ? name + len + 1 : name + len;
+		return;
+	}
+
+	// branches may end in a label where the offset would be
+	if (startswith(text, "BEQ") || startswith(text, "BNE")) {
+		char* last = strrchr(text, ',');
+		if (last == NULL) {
+			return;
+		}
+		last++;
+		while (*last == ' ' || *last == '\t') {
+			last++;
+		}
+		if (!nameStart(*last)) {
+			return;
+		}
+
+		size_t len = 0;
+		while (nameChar(last[len]) && len < OBJECT_NAME_MAX) {
+			len++;
+		}
+		ref->kind = REF_BRANCH;
+		ref->start = last;
+		ref->end = last + len;
+		memcpy(ref->name, last, len);
+		ref->name[len] = '\0';
+	}
+}
+
+/*
+	Purpose: assembles one instruction into the current section
+	Params: Object_Asm* a - the assembly
+			char* text - the instruction
+	Return: none
+*/
+static void assembleInstruct(Object_Asm* a, char* text) {
+	if (a->section != OBJECT_SEC_TEXT) {
+		sourceError(a, "Instructions can only go in .text");
+		return;
+	}
+
+	Symbol_Ref ref;
+	findRef(text, &ref);
+
+	Object_Symbol* sym = NULL;
+	if (ref.kind != REF_NONE) {
+		if (ref.name[0] == '\0') {
+			sourceError(a, "Expected a symbol name");
+			return;
+		}
+		sym = useSymbol(a, ref.name);
+		if (sym == NULL) {
+			return;
+		}
+	}
+
+	// the first pass only counts, the words are encoded by the second
+	if (a->pass == 1) {
+		if (ref.kind == REF_BRANCH) {
+			sym->branches++;
+		}
+		else if (ref.kind != REF_NONE) {
+			a->relocs[a->section]++;
+		}
+		a->words_done[a->section]++;
+		return;
+	}
+
+	uint32_t pc = a->words_done[a->section] * 4;
+	uint32_t field = 0;
+	if (ref.kind == REF_BRANCH) {
+		if (sym->section == OBJECT_SEC_TEXT) {
+			int64_t offset = ((int64_t)sym->value - (int64_t)(pc + 4)) / 4;
+			if (offset < INT16_MIN || offset > INT16_MAX) {
+				sourceError(a, "Branch target out of range");
+				return;
+			}
+			field = (uint32_t)offset & 0xFFFF;
+		}
+		else {
+			// the addend in the field is -4, the branch counts from the next word
+			field = 0xFFFF;
+			putReloc(a, sym, ELF_R_MIPS_PC16);
+		}
+	}
+	else if (ref.kind != REF_NONE) {
+		putReloc(a, sym, (ref.kind == REF_HI) ? ELF_R_MIPS_HI16 : ELF_R_MIPS_LO16);
+	}
+
+	// the symbol is swapped for its field value and the line goes through the usual parser
+	char line[LINE_SIZE + 16];
+	if (ref.kind != REF_NONE) {
+		snprintf(line, sizeof(line), "%.*s#0x%X%s", (int)(ref.start - text), text, field, ref.end);
+		text = line;
+	}
+
+	parseAssem(text);
+	if (state == NO_ERROR) {
+		encode();
+	}
+	if (state != COMPLETE_ENCODE) {
+		printf("%s:%d: ", a->path, a->line_num);
+		printResult();
+		a->failed = 1;
+		return;
+	}
+
+	putWord(a, instruct);
+}
+
+/*
+	Purpose: handles a directive
+	Params: Object_Asm* a - the assembly
+			char* text - the directive, starting at its '.'
+	Return: none
+*/
+static void assembleDirective(Object_Asm* a, char* text) {
+	char word[16];
+	size_t len = 0;
+	while (nameChar(text[len]) && len < sizeof(word) - 1) {
+		word[len] = text[len];
+		len++;
+	}
+	word[len] = '\0';
+	text += len;
+
+	if (strcmp(word, ".text") == 0) {
+		a->section = OBJECT_SEC_TEXT;
+		return;
+	}
+	if (strcmp(word, ".data") == 0) {
+		a->section = OBJECT_SEC_DATA;
+		return;
+	}
+
+	int globl = (strcmp(word, ".globl") == 0 || strcmp(word, ".global") == 0);
+	if (!globl && strcmp(word, ".word") != 0) {
+		sourceError(a, "Unknown directive");
+		return;
+	}
+
+	// both take a comma separated list
+	do {
+		while (*text == ' ' || *text == '\t' || *text == ',') {
+			text++;
+		}
+		if (*text == '\0') {
+			break;
+		}
+
+		char name[OBJECT_NAME_MAX + 1];
+		if (globl) {
+			text = readName(a, text, name);
+			if (text == NULL) {
+				return;
+			}
+			Object_Symbol* sym = useSymbol(a, name);
+			if (sym == NULL) {
+				return;
+			}
+			sym->global = 1;
+			continue;
+		}
+
+		// .word takes numbers, optionally with the usual #, or symbols
+		if (*text == '#') {
+			text++;
+		}
+		int negative = (*text == '-');
+		if (negative) {
+			text++;
+		}
+		if (isdigit((unsigned char)*text)) {
+			uint32_t value;
+			text = immd2num(text, &value);
+			putWord(a, negative ? (uint32_t)-value : value);
+			continue;
+		}
+
+		text = readName(a, text, name);
+		if (text == NULL) {
+			return;
+		}
+		Object_Symbol* sym = useSymbol(a, name);
+		if (sym == NULL) {
+			return;
+		}
+		if (a->pass == 1) {
+			a->relocs[a->section]++;
+		}
+		else {
+			putReloc(a, sym, ELF_R_MIPS_32);
+		}
+		putWord(a, 0);
+	} while (!a->failed && (*text == ',' || *text == ' ' || *text == '\t'));
+
+	if (!a->failed && *text != '\0') {
+		sourceError(a, "Unexpected text after the directive");
+	}
+}
+
+/*
+	Purpose: handles one source line, its labels then its directive or instruction
+	Params: Object_Asm* a - the assembly
+			char* line - the line
+	Return: none
+*/
+static void assembleLine(Object_Asm* a, char* line) {
+	// strips comments and the line ending
+	line[strcspn(line, ";\r\n")] = '\0';
+
+	while (1) {
+		while (*line == ' ' || *line == '\t') {
+			line++;
+		}
+		if (*line == '\0') {
+			return;
+		}
+
+		// a name followed directly by ':' is a label, anything else is the rest of the line
+		size_t len = 0;
+		if (nameStart(*line)) {
+			while (nameChar(line[len])) {
+				len++;
+			}
+		}
+		if (len == 0 || line[len] != ':') {
+			break;
+		}
+
+		if (a->pass == 1) {
+			if (len > OBJECT_NAME_MAX) {
+				sourceError(a, "Symbol name too long");
+				return;
+			}
+			line[len] = '\0';
+			Object_Symbol* sym = useSymbol(a, line);
+			if (sym == NULL) {
+				return;
+			}
+			if (sym->section != 0) {
+				sourceError(a, "Symbol defined twice");
+				return;
+			}
+			sym->section = a->section;
+			sym->value = a->words_done[a->section] * 4;
+		}
+		line += len + 1;
+	}
+
+	if (*line == '.') {
+		assembleDirective(a, line);
+	}
+	else {
+		assembleInstruct(a, line);
+	}
+}
+
+/*
+	Purpose: runs one pass over the source
+	Params: Object_Asm* a - the assembly
+			FILE* file - the source, read from its start
+	Return: none
+*/
+static void assemblePass(Object_Asm* a, FILE* file) {
+	char line[LINE_SIZE];
+
+	a->line_num = 0;
+	a->section = OBJECT_SEC_TEXT;
+	memset(a->words_done, 0, sizeof(a->words_done));
+	memset(a->relocs_done, 0, sizeof(a->relocs_done));
+
+	while (!a->failed && fgets(line, LINE_SIZE, file) != NULL) {
+		a->line_num++;
+		assembleLine(a, line);
+	}
+}
+
+
+/*----------------------------\
+		   Layout
+\----------------------------*/
+/*
+	Purpose: settles what the first pass found, branch relocations and symbol table order
+	Params: Object_Asm* a - the assembly
+	Return: none
+*/
+static void settleSymbols(Object_Asm* a) {
+	memcpy(a->words, a->words_done, sizeof(a->words));
+
+	// branches to labels outside this .text need a relocation each
+	for (uint32_t i = 0; i < a->sym_count; i++) {
+		Object_Symbol* sym = &a->syms[i];
+		if (sym->section != OBJECT_SEC_TEXT) {
+			a->relocs[OBJECT_SEC_TEXT] += sym->branches;
+		}
+
+		// a name used but never defined has to come from another object
+		if (sym->section == 0) {
+			sym->global = 1;
+		}
+	}
+
+	// locals come first in .symtab, after the null symbol
+	uint32_t index = 1;
+	for (uint32_t i = 0; i < a->sym_count; i++) {
+		if (!a->syms[i].global) {
+			a->syms[i].index = index++;
+		}
+	}
+	a->first_global = index;
+	for (uint32_t i = 0; i < a->sym_count; i++) {
+		if (a->syms[i].global) {
+			a->syms[i].index = index++;
+		}
+	}
+}
+
+/*
+	Purpose: writes a block of bytes at a file offset
+	Params: int fd - the file
+			const void* data - the bytes
+			size_t len - how many
+			uint64_t offset - where
+	Return: int - 0 for no error
+*/
+static int writeAt(int fd, const void* data, size_t len, uint64_t offset) {
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t wrote = pwrite(fd, (const char*)data + done, len - done, (off_t)(offset + done));
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("write");
+			return 1;
+		}
+		done += (size_t)wrote;
+	}
+	return 0;
+}
+
+/*
+	Purpose: writes the header, symbol table, string tables and section headers around the streamed sections
+	Params: Object_Asm* a - the assembly
+			int fd - the object
+			const Elf_Section* sections - the section headers
+			uint32_t shoff - where the section headers go
+			const char* shstrtab - the section name table
+	Return: int - 0 for no error
+*/
+static int writeTables(Object_Asm* a, int fd, const Elf_Section* sections, uint32_t shoff, const char* shstrtab) {
+	uint8_t bytes[ELF32_SHDR_SIZE * OBJECT_SEC_COUNT];
+
+	Elf_Header header;
+	memset(&header, 0, sizeof(header));
+	header.type = ELF_ET_REL;
+	header.machine = ELF_EM_MIPS;
+	header.shoff = shoff;
+	header.flags = ELF_EF_MIPS_NOREORDER | ELF_EF_MIPS_ABI_O32;
+	header.shnum = OBJECT_SEC_COUNT;
+	header.shstrndx = OBJECT_SEC_SHSTRTAB;
+	elfPackHeader(bytes, &header, a->big);
+	int failed = writeAt(fd, bytes, ELF32_EHDR_SIZE, 0);
+
+	// the text stream is done with, the symbol table goes through it in index order
+	Section_Stream* s = &a->streams[STREAM_TEXT];
+	const Elf_Section* symtab = &sections[OBJECT_SEC_SYMTAB];
+	s->fd = fd;
+	s->offset = symtab->offset;
+	s->len = 0;
+
+	memset(bytes, 0, ELF32_SYM_SIZE);
+	streamPut(a, STREAM_TEXT, bytes, ELF32_SYM_SIZE);
+	for (int global = 0; global <= 1; global++) {
+		for (uint32_t i = 0; i < a->sym_count; i++) {
+			const Object_Symbol* sym = &a->syms[i];
+			if (sym->global != global) {
+				continue;
+			}
+
+			Elf_Symbol entry = { sym->name, sym->value, 0,
+				ELF_ST_INFO(global ? ELF_STB_GLOBAL : ELF_STB_LOCAL, ELF_STT_NOTYPE), 0, sym->section };
+			elfPackSymbol(bytes, &entry, a->big);
+			streamPut(a, STREAM_TEXT, bytes, ELF32_SYM_SIZE);
+		}
+	}
+	failed |= streamFlush(s);
+
+	failed |= writeAt(fd, a->strtab, a->str_len, sections[OBJECT_SEC_STRTAB].offset);
+	failed |= writeAt(fd, shstrtab, sections[OBJECT_SEC_SHSTRTAB].size, sections[OBJECT_SEC_SHSTRTAB].offset);
+
+	for (int i = 0; i < OBJECT_SEC_COUNT; i++) {
+		elfPackSection(bytes + i * ELF32_SHDR_SIZE, &sections[i], a->big);
+	}
+	failed |= writeAt(fd, bytes, sizeof(bytes), shoff);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: assembles a source file into a relocatable object
+	Params: const char* in_path - the source to assemble
+			const char* out_path - the object to write, removed again on error
+			int big - writes a big endian object when set
+			Object_Stats* stats - filled with what was written
+	Return: int - 0 for no error
+*/
+int assembleObject(const char* in_path, const char* out_path, int big, Object_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+
+	FILE* file = fopen(in_path, "r");
+	if (file == NULL) {
+		perror(in_path);
+		return 1;
+	}
+
+	Object_Asm* a = calloc(1, sizeof(Object_Asm));
+	if (a == NULL) {
+		error("Out of memory");
+		fclose(file);
+		return 1;
+	}
+	a->path = in_path;
+	a->big = big;
+	a->sym_size = 64;
+	a->hash_size = 128;
+	a->str_size = 1024;
+	a->syms = malloc(a->sym_size * sizeof(Object_Symbol));
+	a->hash = malloc(a->hash_size * sizeof(uint32_t));
+	a->strtab = malloc(a->str_size);
+	if (a->syms == NULL || a->hash == NULL || a->strtab == NULL) {
+		error("Out of memory");
+		a->failed = 1;
+	}
+	else {
+		memset(a->hash, 0xFF, a->hash_size * sizeof(uint32_t));
+		a->strtab[0] = '\0';
+		a->str_len = 1;
+	}
+
+	double start = getTime();
+	a->pass = 1;
+	assemblePass(a, file);
+	settleSymbols(a);
+	stats->scan_time = getTime() - start;
+
+	// every section's offset is fixed before anything is written
+	Elf_Section sections[OBJECT_SEC_COUNT];
+	char shstrtab[64];
+	uint32_t shstr_len = 0;
+	memset(sections, 0, sizeof(sections));
+	for (int i = 0; i < OBJECT_SEC_COUNT; i++) {
+		size_t len = strlen(section_names[i]) + 1;
+		sections[i].name = shstr_len;
+		memcpy(shstrtab + shstr_len, section_names[i], len);
+		shstr_len += (uint32_t)len;
+	}
+
+	uint32_t sym_entries = a->sym_count + 1;
+	uint64_t sizes[OBJECT_SEC_COUNT] = { 0,
+		(uint64_t)a->words[OBJECT_SEC_TEXT] * 4, (uint64_t)a->words[OBJECT_SEC_DATA] * 4,
+		(uint64_t)a->relocs[OBJECT_SEC_TEXT] * ELF32_REL_SIZE, (uint64_t)a->relocs[OBJECT_SEC_DATA] * ELF32_REL_SIZE,
+		(uint64_t)sym_entries * ELF32_SYM_SIZE, a->str_len, shstr_len };
+	uint64_t offset = ELF32_EHDR_SIZE;
+	for (int i = 1; i < OBJECT_SEC_COUNT; i++) {
+		sections[i].offset = (uint32_t)offset;
+		sections[i].size = (uint32_t)sizes[i];
+		offset += sizes[i];
+	}
+	offset = (offset + 3) & ~3ull;
+	uint32_t shoff = (uint32_t)offset;
+	offset += ELF32_SHDR_SIZE * OBJECT_SEC_COUNT;
+
+	if (!a->failed && offset > UINT32_MAX) {
+		error("The object would be larger than 4 GB");
+		a->failed = 1;
+	}
+
+	sections[OBJECT_SEC_TEXT].type = ELF_SHT_PROGBITS;
+	sections[OBJECT_SEC_TEXT].flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR;
+	sections[OBJECT_SEC_TEXT].align = 4;
+	sections[OBJECT_SEC_DATA].type = ELF_SHT_PROGBITS;
+	sections[OBJECT_SEC_DATA].flags = ELF_SHF_ALLOC | ELF_SHF_WRITE;
+	sections[OBJECT_SEC_DATA].align = 4;
+	for (int i = OBJECT_SEC_REL_TEXT; i <= OBJECT_SEC_REL_DATA; i++) {
+		sections[i].type = ELF_SHT_REL;
+		sections[i].flags = ELF_SHF_INFO_LINK;
+		sections[i].link = OBJECT_SEC_SYMTAB;
+		sections[i].info = (i == OBJECT_SEC_REL_TEXT) ? OBJECT_SEC_TEXT : OBJECT_SEC_DATA;
+		sections[i].align = 4;
+		sections[i].entsize = ELF32_REL_SIZE;
+	}
+	sections[OBJECT_SEC_SYMTAB].type = ELF_SHT_SYMTAB;
+	sections[OBJECT_SEC_SYMTAB].link = OBJECT_SEC_STRTAB;
+	sections[OBJECT_SEC_SYMTAB].info = a->first_global;
+	sections[OBJECT_SEC_SYMTAB].align = 4;
+	sections[OBJECT_SEC_SYMTAB].entsize = ELF32_SYM_SIZE;
+	sections[OBJECT_SEC_STRTAB].type = ELF_SHT_STRTAB;
+	sections[OBJECT_SEC_STRTAB].align = 1;
+	sections[OBJECT_SEC_SHSTRTAB].type = ELF_SHT_STRTAB;
+	sections[OBJECT_SEC_SHSTRTAB].align = 1;
+
+	int fd = -1;
+	if (!a->failed) {
+		fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			perror(out_path);
+			a->failed = 1;
+		}
+	}
+
+	// the second pass streams each section to its place
+	start = getTime();
+	if (!a->failed) {
+		static const int stream_sections[STREAM_COUNT] = {
+			OBJECT_SEC_TEXT, OBJECT_SEC_DATA, OBJECT_SEC_REL_TEXT, OBJECT_SEC_REL_DATA
+		};
+		for (int i = 0; i < STREAM_COUNT; i++) {
+			a->streams[i].fd = fd;
+			a->streams[i].offset = sections[stream_sections[i]].offset;
+			a->streams[i].len = 0;
+		}
+
+		rewind(file);
+		a->pass = 2;
+		assemblePass(a, file);
+		for (int i = 0; i < STREAM_COUNT; i++) {
+			a->failed |= streamFlush(&a->streams[i]);
+		}
+
+		// the source has to say the same thing twice
+		if (!a->failed && (memcmp(a->words, a->words_done, sizeof(a->words)) != 0 ||
+			memcmp(a->relocs, a->relocs_done, sizeof(a->relocs)) != 0)) {
+			error("The source changed while it was being assembled");
+			a->failed = 1;
+		}
+	}
+	if (!a->failed) {
+		a->failed |= writeTables(a, fd, sections, shoff, shstrtab);
+	}
+	stats->write_time = getTime() - start;
+
+	if (fd >= 0 && close(fd) != 0) {
+		perror(out_path);
+		a->failed = 1;
+	}
+	if (fd >= 0 && a->failed) {
+		unlink(out_path);
+	}
+
+	stats->text_words = a->words[OBJECT_SEC_TEXT];
+	stats->data_words = a->words[OBJECT_SEC_DATA];
+	stats->symbols = a->sym_count;
+	stats->relocs = (uint64_t)a->relocs[OBJECT_SEC_TEXT] + a->relocs[OBJECT_SEC_DATA];
+	stats->bytes = a->failed ? 0 : offset;
+
+	int failed = a->failed;
+	free(a->syms);
+	free(a->hash);
+	free(a->strtab);
+	free(a);
+	fclose(file);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --elf mode, assembles a source file into a relocatable object and reports its sections
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] <in.s> <out.o>
+	Return: int - exit code
+*/
+int objectMain(int argc, char** argv) {
+	// big endian unless asked otherwise, the usual default for MIPS
+	int big = 1;
+	if (argc > 0 && (strcmp(argv[0], "-EB") == 0 || strcmp(argv[0], "-EL") == 0)) {
+		big = (strcmp(argv[0], "-EB") == 0);
+		argc--;
+		argv++;
+	}
+	if (argc < 2) {
+		error("--elf needs a source and an object file");
+		return 1;
+	}
+
+	Object_Stats stats;
+	if (assembleObject(argv[0], argv[1], big, &stats) != 0) {
+		return 1;
+	}
+
+	double total = stats.scan_time + stats.write_time;
+	printf("Text: %llu words\tData: %llu words\tSymbols: %llu\tRelocations: %llu\n",
+		(unsigned long long)stats.text_words, (unsigned long long)stats.data_words,
+		(unsigned long long)stats.symbols, (unsigned long long)stats.relocs);
+	printf("Object: %llu bytes, %s endian\tScan: %.6f s\tWrite: %.6f s\t%.1f MB/s\n",
+		(unsigned long long)stats.bytes, big ? "big" : "little", stats.scan_time, stats.write_time,
+		total > 0 ? stats.bytes / total / 1e6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef _MIPS_OBJECT_H_
+#define _MIPS_OBJECT_H_
+
+#include <stdint.h>
+#include "MIPS_Elf.h"
+
+/*
+	Assembles a source file into an ELF32 MIPS relocatable object with
+	.text, .data, .rel.text, .rel.data, .symtab and .strtab sections. On
+	top of the loader's one instruction per line and ';' comments, the
+	source may use:
+
+		name:               a label, the line may go on with an instruction
+		.text / .data       picks the section the following lines go to
+		.globl name, ...    makes labels visible to other objects
+		.word item, ...     32 bit words, each a number or a symbol
+		BEQ $a, $b, name    branches may name a label in place of #offset
+		%hi(name) %lo(name) the halves of a symbol's address, for LUI/ORI
+
+	A branch to a label in the same .text is resolved here. Every other
+	symbol use becomes a relocation: R_MIPS_PC16 for branches, HI16 and
+	LO16 for %hi and %lo, and R_MIPS_32 for .word. Symbols that are used
+	but never defined are left undefined and global.
+
+	The first pass only sizes the sections and collects the symbols. That
+	fixes every section's file offset. The second pass encodes the source
+	again and streams each section to its place through its own small
+	buffer, so the object is never held in memory.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// bytes each section collects before it is written out
+#define OBJECT_STREAM_SIZE (64u << 10)
+
+// longest symbol name
+#define OBJECT_NAME_MAX 127
+
+// section header indexes, fixed for every object written
+#define OBJECT_SEC_TEXT 1
+#define OBJECT_SEC_DATA 2
+#define OBJECT_SEC_REL_TEXT 3
+#define OBJECT_SEC_REL_DATA 4
+#define OBJECT_SEC_SYMTAB 5
+#define OBJECT_SEC_STRTAB 6
+#define OBJECT_SEC_SHSTRTAB 7
+#define OBJECT_SEC_COUNT 8
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what an object holds and how long each pass took
+typedef struct {
+	uint64_t text_words;
+	uint64_t data_words;
+	uint64_t symbols;
+	uint64_t relocs;
+	uint64_t bytes;
+	double scan_time;
+	double write_time;
+} Object_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: assembles a source file into a relocatable object
+	Params: const char* in_path - the source to assemble
+			const char* out_path - the object to write, removed again on error
+			int big - writes a big endian object when set
+			Object_Stats* stats - filled with what was written
+	Return: int - 0 for no error
+*/
+int assembleObject(const char* in_path, const char* out_path, int big, Object_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --elf mode, assembles a source file into a relocatable object and reports its sections
+	Params: int argc - number of arguments after the mode
+			char** argv - [-EB|-EL] <in.s> <out.o>
+	Return: int - exit code
+*/
+int objectMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,436 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Live.h"
+#include "MIPS_Peep.h"
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// the output list and where rules may look back to
+typedef struct {
+	uint32_t* words;
+	Decoded_Instruct* code;
+	uint32_t len;
+	uint32_t barrier;
+} Peep_State;
+
+// a rule, tried when the op of the newest instruction is one of its heads
+typedef struct {
+	const char* name;
+	uint32_t heads;
+	int (*match)(Peep_State* s);
+} Peep_Rule;
+
+
+/*----------------------------\
+		   Helpers
+\----------------------------*/
+/*
+	Purpose: drops the newest instruction
+	Params: Peep_State* s - the state
+	Return: int - always 1, so rules can return it
+*/
+static inline int dropTop(Peep_State* s) {
+	s->len--;
+	return 1;
+}
+
+/*
+	Purpose: checks whether an instruction copies one register to another, ADD/OR with $zero or ADDI/ORI of 0
+	Params: const Decoded_Instruct* d - the instruction
+			uint32_t* dst - filled with the register written
+			uint32_t* src - filled with the register read
+	Return: int - 1 if it is a copy
+*/
+static int isMove(const Decoded_Instruct* d, uint32_t* dst, uint32_t* src) {
+	switch (d->op) {
+	case OP_ADD:
+	case OP_OR: {
+		if (d->rt != 0 && d->rs != 0) {
+			return 0;
+		}
+		*dst = d->rd;
+		*src = (d->rt == 0) ? d->rs : d->rt;
+		return 1;
+	}
+	case OP_ADDI:
+	case OP_ORI: {
+		*dst = d->rt;
+		*src = d->rs;
+		return d->imm == 0;
+	}
+	default: { return 0; }
+	}
+}
+
+
+/*----------------------------\
+		   Rules
+\----------------------------*/
+/*
+	Purpose: ADDI/ORI $x, $x, #0 does nothing
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleAddZero(Peep_State* s) {
+	const Decoded_Instruct* top = &s->code[s->len - 1];
+	return (top->rt == top->rs && top->imm == 0) ? dropTop(s) : 0;
+}
+
+/*
+	Purpose: ADD/SUB/OR $x, $x, $zero, ADD/OR $x, $zero, $x and AND/OR $x, $x, $x do nothing
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleMoveSelf(Peep_State* s) {
+	const Decoded_Instruct* top = &s->code[s->len - 1];
+	int same = 0;
+
+	switch (top->op) {
+	case OP_ADD:
+	case OP_OR: {
+		same = (top->rd == top->rs && top->rt == 0) || (top->rd == top->rt && top->rs == 0) ||
+			(top->op == OP_OR && top->rd == top->rs && top->rs == top->rt);
+		break;
+	}
+	case OP_SUB: { same = (top->rd == top->rs && top->rt == 0); break; }
+	case OP_AND: { same = (top->rd == top->rs && top->rs == top->rt); break; }
+	default: { break; }
+	}
+	return same ? dropTop(s) : 0;
+}
+
+/*
+	Purpose: an ALU result written to $zero is thrown away
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleWriteZero(Peep_State* s) {
+	uint32_t def;
+	uint32_t use;
+	return (liveEffect(s->words[s->len - 1], &def, &use) == 0) ? dropTop(s) : 0;
+}
+
+/*
+	Purpose: a copy straight back after a copy, $y = $x then $x = $y
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleMoveBack(Peep_State* s) {
+	uint32_t dst;
+	uint32_t src;
+	uint32_t prev_dst;
+	uint32_t prev_src;
+	if (s->len - 1 <= s->barrier || !isMove(&s->code[s->len - 1], &dst, &src) ||
+		!isMove(&s->code[s->len - 2], &prev_dst, &prev_src)) {
+		return 0;
+	}
+	return (dst == prev_src && src == prev_dst) ? dropTop(s) : 0;
+}
+
+/*
+	Purpose: the same instruction twice in a row, when it does not read what it writes
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleRepeat(Peep_State* s) {
+	if (s->len - 1 <= s->barrier || s->words[s->len - 1] != s->words[s->len - 2]) {
+		return 0;
+	}
+
+	uint32_t def;
+	uint32_t use;
+	liveEffect(s->words[s->len - 1], &def, &use);
+	return ((def & use) == 0) ? dropTop(s) : 0;
+}
+
+/*
+	Purpose: ADDI $x, $y, #a then ADDI $x, $x, #b becomes ADDI $x, $y, #a+b when the sum fits
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleAddiFold(Peep_State* s) {
+	if (s->len - 1 <= s->barrier) {
+		return 0;
+	}
+
+	const Decoded_Instruct* top = &s->code[s->len - 1];
+	Decoded_Instruct* prev = &s->code[s->len - 2];
+	if (prev->op != OP_ADDI || top->rs != top->rt || prev->rt != top->rt) {
+		return 0;
+	}
+
+	int32_t sum = (int32_t)(int16_t)prev->imm + (int32_t)(int16_t)top->imm;
+	if (sum < INT16_MIN || sum > INT16_MAX) {
+		return 0;
+	}
+	prev->imm = (uint16_t)sum;
+	s->words[s->len - 2] = (s->words[s->len - 2] & 0xFFFF0000u) | prev->imm;
+	return dropTop(s);
+}
+
+/*
+	Purpose: LUI of a register that already holds the same upper half from an earlier LUI in the window
+	Params: Peep_State* s - the state
+	Return: int - 1 if the rule applied
+*/
+static int ruleLuiAgain(Peep_State* s) {
+	uint32_t word = s->words[s->len - 1];
+	uint32_t reg_bit = 1u << s->code[s->len - 1].rt;
+	uint32_t low = (s->len - 1 - s->barrier > PEEP_WINDOW) ? s->len - 1 - PEEP_WINDOW : s->barrier;
+
+	for (uint32_t i = s->len - 1; i-- > low;) {
+		if (s->words[i] == word) {
+			return dropTop(s);
+		}
+
+		uint32_t def;
+		uint32_t use;
+		liveEffect(s->words[i], &def, &use);
+		if (def & reg_bit) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+// the rules, in the order they are tried and reported
+#define HEAD(op) (1u << (op))
+#define ALU_HEADS (HEAD(OP_ADD) | HEAD(OP_ADDI) | HEAD(OP_AND) | HEAD(OP_ANDI) | HEAD(OP_LUI) | HEAD(OP_MFHI) | \
+	HEAD(OP_MFLO) | HEAD(OP_OR) | HEAD(OP_ORI) | HEAD(OP_SLT) | HEAD(OP_SLTI) | HEAD(OP_SUB))
+static const Peep_Rule rules[PEEP_RULE_COUNT] = {
+	[PEEP_ADD_ZERO] = { "addi-zero", HEAD(OP_ADDI) | HEAD(OP_ORI), ruleAddZero },
+	[PEEP_MOVE_SELF] = { "move-self", HEAD(OP_ADD) | HEAD(OP_SUB) | HEAD(OP_OR) | HEAD(OP_AND), ruleMoveSelf },
+	[PEEP_WRITE_ZERO] = { "write-zero", ALU_HEADS, ruleWriteZero },
+	[PEEP_MOVE_BACK] = { "move-back", HEAD(OP_ADD) | HEAD(OP_OR) | HEAD(OP_ADDI) | HEAD(OP_ORI), ruleMoveBack },
+	[PEEP_REPEAT] = { "repeat", ALU_HEADS | HEAD(OP_MULT) | HEAD(OP_LW), ruleRepeat },
+	[PEEP_ADDI_FOLD] = { "addi-fold", HEAD(OP_ADDI), ruleAddiFold },
+	[PEEP_LUI_AGAIN] = { "lui-again", HEAD(OP_LUI), ruleLuiAgain },
+};
+
+// the rules to try for each op, ended by PEEP_RULE_COUNT
+static uint8_t rules_by_head[OP_COUNT][PEEP_RULE_COUNT + 1];
+static int rules_indexed = 0;
+
+/*
+	Purpose: fills the table of rules by the op of their newest instruction
+	Params: none
+	Return: none
+*/
+static void indexRules(void) {
+	for (int op = 0; op < OP_COUNT; op++) {
+		int n = 0;
+		for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+			if (rules[r].heads & HEAD(op)) {
+				rules_by_head[op][n++] = (uint8_t)r;
+			}
+		}
+		rules_by_head[op][n] = PEEP_RULE_COUNT;
+	}
+	rules_indexed = 1;
+}
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: gets the name of a rule
+	Params: Peep_Rule_Id rule - the rule
+	Return: const char* - its name
+*/
+const char* peepRuleName(Peep_Rule_Id rule) {
+	return (rule < PEEP_RULE_COUNT) ? rules[rule].name : "?";
+}
+
+/*
+	Purpose: runs the peephole rules over a program in place
+	Params: uint32_t* words - the program words, host order
+			uint32_t* count - the number of words, updated to the number left
+			Peep_Stats* stats - filled with what each rule did
+	Return: int - 0 for no error
+*/
+int peepProgram(uint32_t* words, uint32_t* count, Peep_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	double start = getTime();
+	if (!rules_indexed) {
+		indexRules();
+	}
+
+	uint32_t n = *count;
+	stats->words_before = n;
+
+	// the graph is only used for its leaders, where rules must not look back past
+	Cfg cfg;
+	Cfg_Stats cfg_stats;
+	if (cfgBuild(&cfg, words, n, TEXT_BASE, 1, &cfg_stats) != 0) {
+		return 1;
+	}
+
+	// new_index is where each old word went, or the word after it if it went away
+	Peep_State s = { words, malloc(((size_t)n + 1) * sizeof(Decoded_Instruct)), 0, 0 };
+	uint32_t* new_index = malloc(((size_t)n + 1) * sizeof(uint32_t));
+	uint32_t* old_index = malloc(((size_t)n + 1) * sizeof(uint32_t));
+	if (s.code == NULL || new_index == NULL || old_index == NULL) {
+		error("Out of memory");
+		free(s.code);
+		free(new_index);
+		free(old_index);
+		cfgFree(&cfg);
+		return 1;
+	}
+
+	// the output never gets ahead of the input, so it is written over the same words
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t word = words[i];
+		if ((cfg.leaders[i >> 6] >> (i & 63)) & 1) {
+			s.barrier = s.len;
+		}
+
+		new_index[i] = s.len;
+		old_index[s.len] = i;
+		s.words[s.len] = word;
+		decodeWord(word, &s.code[s.len]);
+		s.len++;
+
+		// a rule can leave something new on top, so the top is tried again until nothing applies
+		int applied = 1;
+		while (applied && s.len > s.barrier) {
+			applied = 0;
+			const uint8_t* tries = rules_by_head[s.code[s.len - 1].op];
+			for (int r = 0; tries[r] != PEEP_RULE_COUNT; r++) {
+				if (rules[tries[r]].match(&s)) {
+					stats->applied[tries[r]]++;
+					applied = 1;
+					break;
+				}
+			}
+		}
+	}
+	new_index[n] = s.len;
+	cfgFree(&cfg);
+
+	// branches move to the new place of their target, targets past the end keep their distance from it
+	int failed = 0;
+	for (uint32_t p = 0; p < s.len && !failed; p++) {
+		if (s.code[p].op != OP_BEQ && s.code[p].op != OP_BNE) {
+			continue;
+		}
+
+		int64_t target = (int64_t)old_index[p] + 1 + (int16_t)s.code[p].imm;
+		int64_t moved = target;
+		if (target >= 0 && target <= n) {
+			moved = new_index[target];
+		}
+		else if (target > n) {
+			moved = target - n + s.len;
+		}
+
+		int64_t offset = moved - (int64_t)p - 1;
+		if (offset < INT16_MIN || offset > INT16_MAX) {
+			error("Branch offset out of range after the peephole pass");
+			failed = 1;
+		}
+		else if ((uint16_t)offset != s.code[p].imm) {
+			s.words[p] = (s.words[p] & 0xFFFF0000u) | (uint16_t)offset;
+			stats->branches_moved++;
+		}
+	}
+
+	*count = s.len;
+	stats->words_after = s.len;
+	stats->time = getTime() - start;
+	free(s.code);
+	free(new_index);
+	free(old_index);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --peephole mode, optimizes a program, reports each rule and checks both run the same
+	Params: int argc - number of arguments after the mode
+			char** argv - [-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int peepMain(int argc, char** argv) {
+	const char* out_path = NULL;
+	if (argc > 1 && strcmp(argv[0], "-o") == 0) {
+		out_path = argv[1];
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 1) {
+		error("--peephole needs a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* original = loadProgram(argv[0], &count);
+	if (original == NULL) {
+		return 1;
+	}
+	uint32_t kept = count;
+	uint32_t* optimized = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (optimized == NULL) {
+		error("Out of memory");
+		free(original);
+		return 1;
+	}
+	memcpy(optimized, original, (size_t)count * sizeof(uint32_t));
+
+	Peep_Stats stats;
+	if (peepProgram(optimized, &kept, &stats) != 0) {
+		free(original);
+		free(optimized);
+		return 1;
+	}
+
+	printf("%-12s %10s\n", "Rule", "Applied");
+	for (int r = 0; r < PEEP_RULE_COUNT; r++) {
+		printf("%-12s %10u\n", peepRuleName((Peep_Rule_Id)r), stats.applied[r]);
+	}
+	printf("Words: %u -> %u (%u removed)\tBranches moved: %u\tTime: %.6f s\n", count, kept, count - kept,
+		stats.branches_moved, stats.time);
+
+	// both versions run to the end and must leave the same registers and memory, the pc differs by the words removed
+	Machine before;
+	Machine after;
+	int failed = 1;
+	if (runProgram(&before, original, count, argc - 1, argv + 1) == 0) {
+		if (runProgram(&after, optimized, kept, argc - 1, argv + 1) == 0) {
+			int same = before.status == after.status && before.arch.hi == after.arch.hi &&
+				before.arch.lo == after.arch.lo && memcmp(before.arch.reg, after.arch.reg, sizeof(before.arch.reg)) == 0 &&
+				before.arch.pc - before.text_base - count * 4 == after.arch.pc - after.text_base - kept * 4 &&
+				memChecksum(&before.mem) == memChecksum(&after.mem);
+			if (same) {
+				printf("Optimized program matches the original, retired %llu -> %llu\n",
+					(unsigned long long)before.retired, (unsigned long long)after.retired);
+				failed = 0;
+			}
+			else {
+				error("Optimized program does not match the original");
+				puts("Original:");
+				printArchState(&before.arch, before.retired);
+				puts("Optimized:");
+				printArchState(&after.arch, after.retired);
+			}
+			machineFree(&after);
+		}
+		machineFree(&before);
+	}
+
+	if (!failed && out_path != NULL) {
+		failed = saveProgram(out_path, optimized, kept);
+	}
+
+	free(original);
+	free(optimized);
+	return failed;
+}
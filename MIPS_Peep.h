@@ -0,0 +1,85 @@
+#ifndef _MIPS_PEEP_H_
+#define _MIPS_PEEP_H_
+
+#include <stdint.h>
+
+/*
+	Peephole optimizer over decoded instructions. The program is streamed
+	into an output list one instruction at a time. After each one goes on,
+	only the rules whose last instruction has its op are tried, found
+	through a table indexed by op, and each looks back at most PEEP_WINDOW
+	instructions. Every rule removes an instruction, so the whole pass is
+	linear in the size of the program.
+
+	Rules never look back past a branch target or across a branch, so
+	entering a block part way through still runs the same code. When the
+	instructions are gone, every BEQ/BNE is moved to the new place of its
+	target. A removed target stands for the instruction after it.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// instructions a rule may look back over
+#define PEEP_WINDOW 8
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// every rule, in the order they are reported
+typedef enum Peep_Rule_Id {
+	PEEP_ADD_ZERO,
+	PEEP_MOVE_SELF,
+	PEEP_WRITE_ZERO,
+	PEEP_MOVE_BACK,
+	PEEP_REPEAT,
+	PEEP_ADDI_FOLD,
+	PEEP_LUI_AGAIN,
+	PEEP_RULE_COUNT
+} Peep_Rule_Id;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what a pass removed
+typedef struct {
+	uint32_t words_before;
+	uint32_t words_after;
+	uint32_t branches_moved;
+	uint32_t applied[PEEP_RULE_COUNT];
+	double time;
+} Peep_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: runs the peephole rules over a program in place
+	Params: uint32_t* words - the program words, host order
+			uint32_t* count - the number of words, updated to the number left
+			Peep_Stats* stats - filled with what each rule did
+	Return: int - 0 for no error
+*/
+int peepProgram(uint32_t* words, uint32_t* count, Peep_Stats* stats);
+
+/*
+	Purpose: gets the name of a rule
+	Params: Peep_Rule_Id rule - the rule
+	Return: const char* - its name
+*/
+const char* peepRuleName(Peep_Rule_Id rule);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --peephole mode, optimizes a program, reports each rule and checks both run the same
+	Params: int argc - number of arguments after the mode
+			char** argv - [-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int peepMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,474 @@
+#include <errno.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Pipe.h"
+#include "MIPS_Util.h"
+
+// random lines parsed by --bench-parse, small enough to stay in cache
+#define BENCH_PARSE_LINES 4096
+
+// output buffer flushed with write() once full
+typedef struct {
+	int fd;
+	char* data;
+	size_t used;
+	int failed;
+} Out_Buffer;
+
+/*----------------------------\
+		   Output
+\----------------------------*/
+/*
+	Purpose: writes everything collected so far, retrying short writes
+	Params: Out_Buffer* out - the buffer to flush
+	Return: none
+*/
+static void outFlush(Out_Buffer* out) {
+	size_t done = 0;
+
+	while (done < out->used && !out->failed) {
+		ssize_t wrote = write(out->fd, out->data + done, out->used - done);
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("write");
+			out->failed = 1;
+			break;
+		}
+		done += (size_t)wrote;
+	}
+
+	out->used = 0;
+}
+
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: writes an error line for a state
+	Params: char* out - where to write
+			uint16_t code - the error state
+	Return: size_t - the number of bytes written
+*/
+static size_t errorLine(char* out, uint16_t code) {
+	return (size_t)snprintf(out, PIPE_LINE_MAX, "ERROR: %s\n", errorMessage(code));
+}
+
+/*
+	Purpose: decides what a line holds, 0x/0b prefixed or bare 8 digit hex and 32 digit binary are words
+	Params: const char* line - the line, without surrounding whitespace
+			size_t len - the length of the line
+	Return: Line_Kind - what the line holds
+*/
+Line_Kind lineKind(const char* line, size_t len) {
+	if (len == 0) {
+		return LINE_BLANK;
+	}
+
+	// a prefix decides it, even when the digits after it are bad
+	if (len >= 2 && line[0] == '0' && (line[1] | 0x20) == 'x') {
+		return LINE_HEX;
+	}
+	if (len >= 2 && line[0] == '0' && (line[1] | 0x20) == 'b') {
+		return LINE_BINARY;
+	}
+
+	// bare words must be full width, so short mnemonics made of hex letters stay assembly
+	uint32_t word;
+	if (len == 32 && binWord(line, len, &word) == 0) {
+		return LINE_BINARY;
+	}
+	if (len == 8 && hexWord(line, len, &word) == 0) {
+		return LINE_HEX;
+	}
+
+	return LINE_ASSEMBLY;
+}
+
+/*
+	Purpose: trims and parses one line of input, assembly through parseAssem and words through hexWord/binWord
+	Params: char* line - the line, terminated where its line ending was
+			size_t len - the length of the line
+			Line_Record* rec - the parsed line to fill
+	Return: none
+*/
+void parseLine(char* line, size_t len, Line_Record* rec) {
+	// trims surrounding whitespace in place, the line ending may be \r\n
+	while (len > 0 && (*line == ' ' || *line == '\t')) {
+		line++;
+		len--;
+	}
+	while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t' || line[len - 1] == '\r')) {
+		len--;
+	}
+	line[len] = '\0';
+
+	rec->kind = (uint8_t)lineKind(line, len);
+	rec->status = NO_ERROR;
+
+	switch (rec->kind) {
+	case LINE_BLANK: {
+		break;
+	}
+	case LINE_ASSEMBLY: {
+		// the menus' parser, so the pipe accepts exactly what they do
+		parseAssem(line);
+		rec->status = state;
+		rec->assm = assm_instruct;
+		break;
+	}
+	case LINE_HEX:
+	case LINE_BINARY:
+	default: {
+		int binary = (rec->kind == LINE_BINARY);
+		int prefixed = (len >= 2 && line[0] == '0' && (line[1] | 0x20) == (binary ? 'b' : 'x'));
+		const char* digits = line + 2 * prefixed;
+		size_t count = len - 2 * prefixed;
+
+		if ((binary ? binWord(digits, count, &rec->word) : hexWord(digits, count, &rec->word)) != 0) {
+			rec->status = INVALID_DIGITS;
+		}
+		break;
+	}
+	}
+}
+
+/*
+	Purpose: encodes or decodes a parsed line and writes its translation
+	Params: const Line_Record* rec - the parsed line
+			char* out - PIPE_LINE_MAX bytes to fill with the translation and a line ending
+	Return: size_t - the number of bytes written to out
+*/
+size_t encodeRecord(const Line_Record* rec, char* out) {
+	static const char hex_digits[] = "0123456789ABCDEF";
+
+	if (rec->status != NO_ERROR) {
+		return errorLine(out, rec->status);
+	}
+
+	switch (rec->kind) {
+	case LINE_BLANK: {
+		out[0] = '\n';
+		return 1;
+	}
+	case LINE_ASSEMBLY: {
+		// the menus' encoder, run on this thread's copy of the parsed instruction
+		assm_instruct = rec->assm;
+		BIN32 = 0;
+		encode();
+		if (state != COMPLETE_ENCODE) {
+			return errorLine(out, state);
+		}
+
+		out[0] = '0';
+		out[1] = 'x';
+		for (int i = 0; i < 8; i++) {
+			out[2 + i] = hex_digits[(instruct >> (28 - 4 * i)) & 0xF];
+		}
+		out[10] = '\n';
+		return 11;
+	}
+	case LINE_HEX:
+	case LINE_BINARY:
+	default: {
+		Decoded_Instruct d;
+		if (decodeWord(rec->word, &d) == OP_INVALID) {
+			return errorLine(out, UNRECOGNIZED_COMMAND);
+		}
+
+		size_t size = (size_t)formatAssm(out, &d);
+		out[size] = '\n';
+		return size + 1;
+	}
+	}
+}
+
+/*
+	Purpose: gets the machine word a parsed line stands for, encoding assembly and passing words through
+	Params: const Line_Record* rec - the parsed line, not blank
+			uint32_t* word - filled with the word
+	Return: uint16_t - NO_ERROR, or the error state
+*/
+uint16_t recordWord(const Line_Record* rec, uint32_t* word) {
+	if (rec->status != NO_ERROR) {
+		return rec->status;
+	}
+	if (rec->kind != LINE_ASSEMBLY) {
+		*word = rec->word;
+		return NO_ERROR;
+	}
+
+	assm_instruct = rec->assm;
+	BIN32 = 0;
+	encode();
+	if (state != COMPLETE_ENCODE) {
+		return state;
+	}
+	*word = instruct;
+	return NO_ERROR;
+}
+
+/*
+	Purpose: translates one line of input, parseLine then encodeRecord
+	Params: char* line - the line, terminated where its line ending was
+			size_t len - the length of the line
+			char* out - PIPE_LINE_MAX bytes to fill with the translation and a line ending
+	Return: size_t - the number of bytes written to out
+*/
+size_t translateLine(char* line, size_t len, char* out) {
+	Line_Record rec;
+	parseLine(line, len, &rec);
+	return encodeRecord(&rec, out);
+}
+
+/*
+	Purpose: sends the translation of a line to the output buffer
+	Params: char* line - the line, terminated where its line ending was
+			size_t len - the length of the line
+			Out_Buffer* out - where the translation goes
+	Return: none
+*/
+static void pipeLine(char* line, size_t len, Out_Buffer* out) {
+	if (PIPE_WRITE_SIZE - out->used < PIPE_LINE_MAX) {
+		outFlush(out);
+	}
+	out->used += translateLine(line, len, out->data + out->used);
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --pipe mode, translates stdin to stdout one line at a time with no prompts
+	Params: int argc - number of arguments after the mode
+			char** argv - none
+	Return: int - exit code
+*/
+int pipeMain(int argc, char** argv) {
+	(void)argv;
+	if (argc != 0) {
+		error("--pipe takes no arguments, it reads stdin");
+		return 1;
+	}
+
+	// one spare byte so the last line can always be terminated
+	size_t size = PIPE_READ_SIZE;
+	char* in = malloc(size + 1);
+	Out_Buffer out = { STDOUT_FILENO, malloc(PIPE_WRITE_SIZE), 0, 0 };
+	if (in == NULL || out.data == NULL) {
+		error("Out of memory");
+		free(in);
+		free(out.data);
+		return 1;
+	}
+
+	size_t have = 0;
+	int failed = 0;
+
+	while (!out.failed) {
+		ssize_t got = read(STDIN_FILENO, in + have, size - have);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("read");
+			failed = 1;
+			break;
+		}
+		have += (size_t)got;
+
+		// splits every complete line where it lies, no copies
+		char* line = in;
+		char* end = in + have;
+		char* newline;
+		while ((newline = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+			*newline = '\0';
+			pipeLine(line, (size_t)(newline - line), &out);
+			line = newline + 1;
+		}
+
+		// an unterminated last line is still translated
+		if (got == 0) {
+			if (line < end) {
+				*end = '\0';
+				pipeLine(line, (size_t)(end - line), &out);
+			}
+			break;
+		}
+
+		// keeps the partial line for the next read, growing when it fills the buffer
+		have = (size_t)(end - line);
+		memmove(in, line, have);
+		if (have == size) {
+			char* grown = realloc(in, size * 2 + 1);
+			if (grown == NULL) {
+				error("Out of memory");
+				failed = 1;
+				break;
+			}
+			in = grown;
+			size *= 2;
+		}
+	}
+
+	outFlush(&out);
+	free(in);
+	free(out.data);
+	return failed || out.failed;
+}
+
+
+/*----------------------------\
+		  Benchmark
+\----------------------------*/
+/*
+	Purpose: the character at a time parseHex this tool used before hexWord, kept to benchmark against
+	Params: char* line - the line to convert
+	Return: none
+*/
+static void scalarParseHex(char* line) {
+	initInstructs();
+
+	uint32_t num = 0;
+	if ((*line == '0') && (toupper(*(line + 1)) == 'X')) {
+		line += 2;
+	}
+	while (isxdigit(*line)) {
+		if (isdigit(*line)) {
+			num = (num * 16) + (*line - 48);
+		}
+		else {
+			num = (num * 16) + (toupper(*line) - 55);
+		}
+		line++;
+	}
+
+	BIN32 = num;
+}
+
+/*
+	Purpose: the character at a time parseBin this tool used before binWord, kept to benchmark against
+	Params: char* line - the line to convert
+	Return: none
+*/
+static void scalarParseBin(char* line) {
+	initInstructs();
+
+	uint32_t num = 0;
+	while (*line != '\0') {
+		if ((*line == '0') || (*line == '1')) {
+			num = (num * 2) + (*line - 48);
+		}
+		line++;
+	}
+
+	BIN32 = num;
+}
+
+/*
+	Purpose: times one parser over a table of lines and sums the words it produced
+	Params: void (*parse)(char*) - the parser, leaves its word in BIN32
+			char* lines - BENCH_PARSE_LINES lines, each stride bytes apart
+			size_t stride - the distance between lines
+			uint32_t count - the number of lines to parse, the table is reused
+			uint64_t* sum - filled with the sum of the words, to compare parsers
+	Return: double - the fastest of three passes in seconds
+*/
+static double benchParser(void (*parse)(char*), char* lines, size_t stride, uint32_t count, uint64_t* sum) {
+	double best = 0;
+
+	for (int rep = 0; rep < 3; rep++) {
+		uint64_t total = 0;
+		double start = getTime();
+		for (uint32_t done = 0; done < count; done += BENCH_PARSE_LINES) {
+			for (uint32_t i = 0; i < BENCH_PARSE_LINES; i++) {
+				parse(lines + i * stride);
+				total += BIN32;
+			}
+		}
+		double time = getTime() - start;
+
+		if (rep == 0 || time < best) {
+			best = time;
+		}
+		*sum = total;
+	}
+
+	return best;
+}
+
+/*
+	Purpose: --bench-parse mode, times the old and new parseHex/parseBin on random words
+	Params: int argc - number of arguments after the mode
+			char** argv - [count]
+	Return: int - exit code
+*/
+int benchParseMain(int argc, char** argv) {
+	uint32_t count = (argc > 0) ? (uint32_t)strtoul(argv[0], NULL, 0) : 10000000;
+	if (count == 0) {
+		error("--bench-parse needs a positive count");
+		return 1;
+	}
+
+	// rounds up to whole passes over the table, which stays in cache so parsing is what gets timed
+	count = (count + BENCH_PARSE_LINES - 1) / BENCH_PARSE_LINES * BENCH_PARSE_LINES;
+
+	// fixed width lines, hex gets a prefix and mixed case like hand written dumps
+	const size_t hex_stride = 12;
+	const size_t bin_stride = 36;
+	char* hex = malloc(BENCH_PARSE_LINES * hex_stride);
+	char* bin = malloc(BENCH_PARSE_LINES * bin_stride);
+	if (hex == NULL || bin == NULL) {
+		error("Out of memory");
+		free(hex);
+		free(bin);
+		return 1;
+	}
+
+	uint32_t seed = 0x2545F491;
+	for (uint32_t i = 0; i < BENCH_PARSE_LINES; i++) {
+		// xorshift32
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		snprintf(hex + i * hex_stride, hex_stride, (i & 1) ? "0x%08X" : "0x%08x", seed);
+		for (int b = 0; b < 32; b++) {
+			bin[i * bin_stride + b] = (char)('0' + ((seed >> (31 - b)) & 1));
+		}
+		bin[i * bin_stride + 32] = '\0';
+	}
+
+	static const char* names[4] = { "parseHex (scalar)", "parseHex (SWAR)", "parseBin (scalar)", "parseBin (SWAR)" };
+	uint64_t sums[4];
+	double times[4];
+	times[0] = benchParser(scalarParseHex, hex, hex_stride, count, &sums[0]);
+	times[1] = benchParser(parseHex, hex, hex_stride, count, &sums[1]);
+	times[2] = benchParser(scalarParseBin, bin, bin_stride, count, &sums[2]);
+	times[3] = benchParser(parseBin, bin, bin_stride, count, &sums[3]);
+
+	printf("Words: %u\n\n", count);
+	printf("%-20s %12s %10s %10s\n", "Parser", "Time (s)", "ns/word", "MB/s");
+	for (int i = 0; i < 4; i++) {
+		size_t stride = (i < 2) ? hex_stride - 1 : bin_stride - 4;
+		printf("%-20s %12.6f %10.2f %10.1f\n", names[i], times[i], times[i] * 1e9 / count,
+			times[i] > 0 ? (double)count * stride / times[i] / 1e6 : 0.0);
+	}
+	printf("\nSpeedup: hex %.2fx\tbinary %.2fx\n", times[1] > 0 ? times[0] / times[1] : 0.0,
+		times[3] > 0 ? times[2] / times[3] : 0.0);
+
+	// the parsers must agree on every word
+	int failed = 0;
+	if (sums[0] != sums[1] || sums[2] != sums[3] || sums[0] != sums[2]) {
+		error("The SWAR parsers disagree with the scalar ones");
+		failed = 1;
+	}
+
+	free(hex);
+	free(bin);
+	return failed;
+}
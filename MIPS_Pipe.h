@@ -0,0 +1,120 @@
+#ifndef _MIPS_PIPE_H_
+#define _MIPS_PIPE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "global_data.h"
+
+/*
+	Streaming translation for use in Unix pipelines. stdin is read in large
+	blocks and split into lines in place, each line is translated on its own
+	and the results go out through one large buffer, one line out per line in:
+
+		assembly           ->  0x<8 hex digits>
+		hex or binary      ->  assembly text
+		blank              ->  blank
+		anything invalid   ->  ERROR: <message>
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// bytes asked for per read, a longer line grows the input buffer
+#define PIPE_READ_SIZE (1u << 20)
+
+// bytes collected before each write
+#define PIPE_WRITE_SIZE (1u << 20)
+
+// longest translation of one line, including the line ending
+#define PIPE_LINE_MAX 128
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// what a line of input holds, decided from its text alone
+typedef enum Line_Kind {
+	LINE_BLANK,
+	LINE_ASSEMBLY,
+	LINE_HEX,
+	LINE_BINARY
+} Line_Kind;
+
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// one parsed line, holds no pointers into the input so the line can be released once parsed
+typedef struct {
+	uint8_t kind;
+	uint16_t status;
+	uint32_t word;
+	Assm_Instruct assm;
+} Line_Record;
+
+
+/*----------------------------\
+		  Translation
+\----------------------------*/
+/*
+	Purpose: decides what a line holds, 0x/0b prefixed or bare 8 digit hex and 32 digit binary are words
+	Params: const char* line - the line, without surrounding whitespace
+			size_t len - the length of the line
+	Return: Line_Kind - what the line holds
+*/
+Line_Kind lineKind(const char* line, size_t len);
+
+/*
+	Purpose: trims and parses one line of input, assembly through parseAssem and words through hexWord/binWord
+	Params: char* line - the line, terminated where its line ending was
+			size_t len - the length of the line
+			Line_Record* rec - the parsed line to fill
+	Return: none
+*/
+void parseLine(char* line, size_t len, Line_Record* rec);
+
+/*
+	Purpose: encodes or decodes a parsed line and writes its translation
+	Params: const Line_Record* rec - the parsed line
+			char* out - PIPE_LINE_MAX bytes to fill with the translation and a line ending
+	Return: size_t - the number of bytes written to out
+*/
+size_t encodeRecord(const Line_Record* rec, char* out);
+
+/*
+	Purpose: gets the machine word a parsed line stands for, encoding assembly and passing words through
+	Params: const Line_Record* rec - the parsed line, not blank
+			uint32_t* word - filled with the word
+	Return: uint16_t - NO_ERROR, or the error state
+*/
+uint16_t recordWord(const Line_Record* rec, uint32_t* word);
+
+/*
+	Purpose: translates one line of input, parseLine then encodeRecord
+	Params: char* line - the line, terminated where its line ending was
+			size_t len - the length of the line
+			char* out - PIPE_LINE_MAX bytes to fill with the translation and a line ending
+	Return: size_t - the number of bytes written to out
+*/
+size_t translateLine(char* line, size_t len, char* out);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --pipe mode, translates stdin to stdout one line at a time with no prompts
+	Params: int argc - number of arguments after the mode
+			char** argv - none
+	Return: int - exit code
+*/
+int pipeMain(int argc, char** argv);
+
+/*
+	Purpose: --bench-parse mode, times the old and new parseHex/parseBin on random words
+	Params: int argc - number of arguments after the mode
+			char** argv - [count]
+	Return: int - exit code
+*/
+int benchParseMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,393 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "MIPS_Instruction.h"
+#include "MIPS_Pipeline.h"
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		   Links
+\----------------------------*/
+/*
+	Purpose: sets up a link with every pooled buffer on its free ring
+	Params: Stage_Link* link - the link to set up
+			size_t size - the size of each buffer
+	Return: int - 0 for no error
+*/
+static int linkInit(Stage_Link* link, size_t size) {
+	ringInit(&link->ready);
+	ringInit(&link->free);
+
+	for (int i = 0; i < PIPELINE_BUFFERS; i++) {
+		link->pool[i] = calloc(1, size);
+		if (link->pool[i] == NULL) {
+			return 1;
+		}
+		ringPush(&link->free, link->pool[i]);
+	}
+
+	// the setup pushes are not part of the run
+	link->free.pushes = 0;
+	return 0;
+}
+
+/*
+	Purpose: releases a link's buffers
+	Params: Stage_Link* link - the link to release
+	Return: none
+*/
+static void linkFree(Stage_Link* link) {
+	for (int i = 0; i < PIPELINE_BUFFERS; i++) {
+		free(link->pool[i]);
+		link->pool[i] = NULL;
+	}
+}
+
+
+/*----------------------------\
+		   Stages
+\----------------------------*/
+/*
+	Purpose: reader stage, fills blocks from the input and cuts them after their last line ending
+	Params: void* arg - the Pipeline
+	Return: void* - NULL
+*/
+static void* readerStage(void* arg) {
+	Pipeline* p = arg;
+	double start = getTime();
+	Input_Block* block = ringPop(&p->blocks.free);
+	size_t have = 0;
+
+	while (1) {
+		// a line longer than the block grows it, the spare byte terminates the last line
+		if (have == block->size) {
+			char* grown = realloc(block->data, block->size * 2 + 1);
+			if (grown == NULL) {
+				p->read_failed = 1;
+				break;
+			}
+			block->data = grown;
+			block->size *= 2;
+		}
+
+		ssize_t got = read(p->in_fd, block->data + have, block->size - have);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got < 0) {
+			perror("read");
+			p->read_failed = 1;
+			break;
+		}
+		if (got == 0) {
+			break;
+		}
+		p->bytes_in += (size_t)got;
+		have += (size_t)got;
+
+		// finds the last line ending, a block with none keeps reading
+		size_t cut = have;
+		while (cut > 0 && block->data[cut - 1] != '\n') {
+			cut--;
+		}
+		if (cut == 0) {
+			continue;
+		}
+
+		// the partial line after it starts the next block
+		Input_Block* next = ringPop(&p->blocks.free);
+		if (next->size < have - cut) {
+			char* grown = realloc(next->data, block->size + 1);
+			if (grown == NULL) {
+				p->read_failed = 1;
+				break;
+			}
+			next->data = grown;
+			next->size = block->size;
+		}
+		memcpy(next->data, block->data + cut, have - cut);
+
+		block->len = cut;
+		ringPush(&p->blocks.ready, block);
+		block = next;
+		have -= cut;
+	}
+
+	// whatever is left is the unterminated last line
+	if (have > 0) {
+		block->len = have;
+		ringPush(&p->blocks.ready, block);
+	}
+	else {
+		// the parser hands blocks back, so an unused one still goes through it
+		block->len = 0;
+		ringPush(&p->blocks.ready, block);
+	}
+	ringPush(&p->blocks.ready, NULL);
+	p->stage_time[0] = getTime() - start;
+	return NULL;
+}
+
+/*
+	Purpose: parser stage, splits blocks into lines in place and parses each into a record
+	Params: void* arg - the Pipeline
+	Return: void* - NULL
+*/
+static void* parserStage(void* arg) {
+	Pipeline* p = arg;
+	double start = getTime();
+	Record_Batch* batch = ringPop(&p->batches.free);
+	Input_Block* block;
+
+	batch->count = 0;
+	while ((block = ringPop(&p->blocks.ready)) != NULL) {
+		char* line = block->data;
+		char* end = block->data + block->len;
+
+		while (line < end) {
+			char* newline = memchr(line, '\n', (size_t)(end - line));
+			if (newline == NULL) {
+				newline = end;
+			}
+			*newline = '\0';
+
+			parseLine(line, (size_t)(newline - line), &batch->recs[batch->count++]);
+			p->lines++;
+			line = newline + 1;
+
+			if (batch->count == RECORD_BATCH) {
+				ringPush(&p->batches.ready, batch);
+				batch = ringPop(&p->batches.free);
+				batch->count = 0;
+			}
+		}
+
+		// records hold no pointers into the block, so it can go back right away
+		ringPush(&p->blocks.free, block);
+	}
+
+	ringPush(&p->batches.ready, batch);
+	ringPush(&p->batches.ready, NULL);
+	p->stage_time[1] = getTime() - start;
+	return NULL;
+}
+
+/*
+	Purpose: encoder stage, turns each record into its output line
+	Params: void* arg - the Pipeline
+	Return: void* - NULL
+*/
+static void* encoderStage(void* arg) {
+	Pipeline* p = arg;
+	double start = getTime();
+	Output_Chunk* chunk = ringPop(&p->chunks.free);
+	Record_Batch* batch;
+
+	chunk->used = 0;
+	while ((batch = ringPop(&p->batches.ready)) != NULL) {
+		for (uint32_t i = 0; i < batch->count; i++) {
+			if (PIPE_WRITE_SIZE - chunk->used < PIPE_LINE_MAX) {
+				ringPush(&p->chunks.ready, chunk);
+				chunk = ringPop(&p->chunks.free);
+				chunk->used = 0;
+			}
+			chunk->used += encodeRecord(&batch->recs[i], chunk->data + chunk->used);
+		}
+
+		ringPush(&p->batches.free, batch);
+	}
+
+	ringPush(&p->chunks.ready, chunk);
+	ringPush(&p->chunks.ready, NULL);
+	p->stage_time[2] = getTime() - start;
+	return NULL;
+}
+
+/*
+	Purpose: writer stage, writes each chunk out, runs on the calling thread
+	Params: Pipeline* p - the pipeline
+	Return: none
+*/
+static void writerStage(Pipeline* p) {
+	double start = getTime();
+	Output_Chunk* chunk;
+
+	while ((chunk = ringPop(&p->chunks.ready)) != NULL) {
+		size_t done = 0;
+
+		// after a failed write the chunks are still drained so the other stages can finish
+		while (done < chunk->used && !p->write_failed) {
+			ssize_t wrote = write(p->out_fd, chunk->data + done, chunk->used - done);
+			if (wrote < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				perror("write");
+				p->write_failed = 1;
+				break;
+			}
+			done += (size_t)wrote;
+		}
+		p->bytes_out += done;
+
+		ringPush(&p->chunks.free, chunk);
+	}
+	p->stage_time[3] = getTime() - start;
+}
+
+
+/*----------------------------\
+		   Report
+\----------------------------*/
+/*
+	Purpose: prints one stage's row of the report
+	Params: const char* name - the stage
+			const Spsc_Ring* in - the ring it takes work from, NULL for the reader
+			const Spsc_Ring* out_free - the ring it takes empty buffers from, NULL for the writer
+			double run - the stage's own time from its start to its finish in seconds
+	Return: double - the seconds the stage spent working
+*/
+static double printStage(const char* name, const Spsc_Ring* in, const Spsc_Ring* out_free, double run) {
+	uint64_t in_waits = in ? in->empty_waits : 0;
+	double in_time = in ? in->empty_time : 0;
+	uint64_t out_waits = out_free ? out_free->empty_waits : 0;
+	double out_time = out_free ? out_free->empty_time : 0;
+	double work = run - in_time - out_time;
+
+	if (in != NULL) {
+		fprintf(stderr, "%-8s %9llu %8.2f %4zu", name, (unsigned long long)in->pops,
+			in->pops ? (double)in->occupancy_sum / in->pops : 0.0, in->occupancy_max);
+	}
+	else {
+		fprintf(stderr, "%-8s %9s %8s %4s", name, "-", "-", "-");
+	}
+	fprintf(stderr, " %9llu %9.4f %9llu %9.4f %6.1f%%\n", (unsigned long long)in_waits, in_time,
+		(unsigned long long)out_waits, out_time, run > 0 ? 100.0 * work / run : 0.0);
+
+	return work;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --pipeline mode, --pipe run as reader, parser, encoder and writer threads
+	Params: int argc - number of arguments after the mode
+			char** argv - [in|- [out|-]]
+	Return: int - exit code
+*/
+int pipelineMain(int argc, char** argv) {
+	Pipeline* p = calloc(1, sizeof(Pipeline));
+	if (p == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+
+	// "-" or nothing means stdin/stdout
+	p->in_fd = STDIN_FILENO;
+	p->out_fd = STDOUT_FILENO;
+	if (argc > 0 && strcmp(argv[0], "-") != 0) {
+		p->in_fd = open(argv[0], O_RDONLY);
+		if (p->in_fd < 0) {
+			perror(argv[0]);
+			free(p);
+			return 1;
+		}
+	}
+	if (argc > 1 && strcmp(argv[1], "-") != 0) {
+		p->out_fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (p->out_fd < 0) {
+			perror(argv[1]);
+			free(p);
+			return 1;
+		}
+	}
+
+	int failed = linkInit(&p->blocks, sizeof(Input_Block)) || linkInit(&p->batches, sizeof(Record_Batch)) ||
+		linkInit(&p->chunks, sizeof(Output_Chunk));
+	for (int i = 0; i < PIPELINE_BUFFERS && !failed; i++) {
+		Input_Block* block = p->blocks.pool[i];
+		block->size = PIPE_READ_SIZE;
+		block->data = malloc(block->size + 1);
+		failed = (block->data == NULL);
+	}
+
+	double wall = 0;
+	if (failed) {
+		error("Out of memory");
+	}
+	else {
+		static void* (*const stages[3])(void*) = { readerStage, parserStage, encoderStage };
+		Spsc_Ring* const outputs[3] = { &p->blocks.ready, &p->batches.ready, &p->chunks.ready };
+		pthread_t threads[3];
+		int started = 3;
+		double start = getTime();
+
+		// started from the writer's end, so a stage that fails to start only has stages after it running
+		for (int i = 2; i >= 0; i--) {
+			if (pthread_create(&threads[i], NULL, stages[i], p) != 0) {
+				// ends its output so the stages after it finish
+				ringPush(outputs[i], NULL);
+				started = 2 - i;
+				break;
+			}
+		}
+		writerStage(p);
+		for (int i = 3 - started; i < 3; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		wall = getTime() - start;
+
+		if (started < 3) {
+			error("Could not start the pipeline threads");
+			failed = 1;
+		}
+	}
+
+	if (!failed) {
+		// the stage that works longest is the one the others wait on
+		fprintf(stderr, "Lines: %llu\tIn: %llu bytes\tOut: %llu bytes\tTime: %.6f s\t%.1f MB/s\n\n",
+			(unsigned long long)p->lines, (unsigned long long)p->bytes_in, (unsigned long long)p->bytes_out, wall,
+			wall > 0 ? p->bytes_in / wall / 1e6 : 0.0);
+		fprintf(stderr, "%-8s %9s %8s %4s %9s %9s %9s %9s %7s\n", "Stage", "Batches", "Queue", "Max",
+			"In waits", "In (s)", "Out waits", "Out (s)", "Busy");
+
+		static const char* names[4] = { "reader", "parser", "encoder", "writer" };
+		double work[4];
+		work[0] = printStage(names[0], NULL, &p->blocks.free, p->stage_time[0]);
+		work[1] = printStage(names[1], &p->blocks.ready, &p->batches.free, p->stage_time[1]);
+		work[2] = printStage(names[2], &p->batches.ready, &p->chunks.free, p->stage_time[2]);
+		work[3] = printStage(names[3], &p->chunks.ready, NULL, p->stage_time[3]);
+
+		int limit = 0;
+		for (int i = 1; i < 4; i++) {
+			if (work[i] > work[limit]) {
+				limit = i;
+			}
+		}
+		fprintf(stderr, "\nLimiting stage: %s\n", names[limit]);
+
+		failed = p->read_failed || p->write_failed;
+	}
+
+	for (int i = 0; i < PIPELINE_BUFFERS; i++) {
+		Input_Block* block = p->blocks.pool[i];
+		if (block != NULL) {
+			free(block->data);
+		}
+	}
+	linkFree(&p->blocks);
+	linkFree(&p->batches);
+	linkFree(&p->chunks);
+
+	if (p->in_fd != STDIN_FILENO) {
+		close(p->in_fd);
+	}
+	if (p->out_fd != STDOUT_FILENO) {
+		close(p->out_fd);
+	}
+	free(p);
+	return failed;
+}
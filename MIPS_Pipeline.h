@@ -0,0 +1,91 @@
+#ifndef _MIPS_PIPELINE_H_
+#define _MIPS_PIPELINE_H_
+
+#include "MIPS_Pipe.h"
+#include "MIPS_Ring.h"
+
+/*
+	--pipe split into four threads so the stages overlap:
+
+		reader  -> blocks of whole lines   -> parser
+		parser  -> batches of Line_Records -> encoder
+		encoder -> chunks of output text   -> writer
+
+	Each link is a pair of SPSC rings, "ready" carries filled buffers
+	downstream and "free" hands them back, so every buffer comes from a
+	fixed pool and nothing is allocated per line. The output is byte for
+	byte what --pipe writes. A table of queue depths and waits goes to
+	stderr at the end: the stage that waits least is the one that limits
+	throughput.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// buffers in each link's pool, less than RING_SIZE so "ready" never fills
+#define PIPELINE_BUFFERS 8
+
+// lines per parsed batch
+#define RECORD_BATCH 4096
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// input handed from reader to parser, always ends at a line ending except the last block
+typedef struct {
+	size_t size;
+	size_t len;
+	char* data;
+} Input_Block;
+
+// parsed lines handed from parser to encoder
+typedef struct {
+	uint32_t count;
+	Line_Record recs[RECORD_BATCH];
+} Record_Batch;
+
+// output text handed from encoder to writer
+typedef struct {
+	size_t used;
+	char data[PIPE_WRITE_SIZE];
+} Output_Chunk;
+
+// the two rings between a pair of stages and the buffers they pass
+typedef struct {
+	Spsc_Ring ready;
+	Spsc_Ring free;
+	void* pool[PIPELINE_BUFFERS];
+} Stage_Link;
+
+// everything the stage threads share
+typedef struct {
+	int in_fd;
+	int out_fd;
+	Stage_Link blocks;
+	Stage_Link batches;
+	Stage_Link chunks;
+
+	// set once by the stage that owns it, read after the threads are joined
+	uint64_t bytes_in;
+	uint64_t lines;
+	uint64_t bytes_out;
+	int read_failed;
+	int write_failed;
+
+	// each stage's time from its own start to its own finish, reader, parser, encoder, writer
+	double stage_time[4];
+} Pipeline;
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --pipeline mode, --pipe run as reader, parser, encoder and writer threads
+	Params: int argc - number of arguments after the mode
+			char** argv - [in|- [out|-]]
+	Return: int - exit code
+*/
+int pipelineMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,88 @@
+#include <sched.h>
+#include <string.h>
+#include "MIPS_Ring.h"
+#include "MIPS_Util.h"
+
+// busy polls before a waiting side starts yielding its core
+#define RING_SPINS 64
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: sets up an empty ring
+	Params: Spsc_Ring* ring - the ring to set up
+	Return: none
+*/
+void ringInit(Spsc_Ring* ring) {
+	memset(ring, 0, sizeof(*ring));
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->head, 0);
+}
+
+/*
+	Purpose: waits for the other side, spinning first then yielding
+	Params: int spins - how many times this wait has polled so far
+	Return: none
+*/
+static void ringWait(int spins) {
+	if (spins >= RING_SPINS) {
+		sched_yield();
+	}
+}
+
+/*
+	Purpose: adds an item, waiting while the ring is full, only the producer thread may call this
+	Params: Spsc_Ring* ring - the ring to add to
+			void* item - the item, NULL is passed through like any other
+	Return: none
+*/
+void ringPush(Spsc_Ring* ring, void* item) {
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	// a full ring means the consumer is behind, the wait is counted against it
+	if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == RING_SIZE) {
+		double start = getTime();
+		for (int spins = 0; tail - atomic_load_explicit(&ring->head, memory_order_acquire) == RING_SIZE; spins++) {
+			ringWait(spins);
+		}
+		ring->full_waits++;
+		ring->full_time += getTime() - start;
+	}
+
+	ring->slots[tail & (RING_SIZE - 1)] = item;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	ring->pushes++;
+}
+
+/*
+	Purpose: takes the oldest item, waiting while the ring is empty, only the consumer thread may call this
+	Params: Spsc_Ring* ring - the ring to take from
+	Return: void* - the item
+*/
+void* ringPop(Spsc_Ring* ring) {
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	// an empty ring means the producer is behind
+	if (tail == head) {
+		double start = getTime();
+		for (int spins = 0; (tail = atomic_load_explicit(&ring->tail, memory_order_acquire)) == head; spins++) {
+			ringWait(spins);
+		}
+		ring->empty_waits++;
+		ring->empty_time += getTime() - start;
+	}
+
+	// how many items were queued when this one was taken
+	size_t occupancy = tail - head;
+	ring->occupancy_sum += occupancy;
+	if (occupancy > ring->occupancy_max) {
+		ring->occupancy_max = occupancy;
+	}
+
+	void* item = ring->slots[head & (RING_SIZE - 1)];
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	ring->pops++;
+	return item;
+}
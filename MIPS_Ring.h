@@ -0,0 +1,72 @@
+#ifndef _MIPS_RING_H_
+#define _MIPS_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+	Lock-free single producer, single consumer ring of pointers. Each side
+	owns one index and only reads the other's, so a push or pop is one
+	acquire load and one release store. Items are whole batches, so a
+	handoff is paid once per batch rather than once per line. A side that
+	finds the ring full or empty spins, then yields, and counts the wait.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// slots in a ring, must be a power of two
+#define RING_SIZE 64
+
+// cache line size, keeps the two sides' fields from sharing a line
+#define RING_ALIGN 64
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+typedef struct Spsc_Ring {
+	// written by the producer
+	_Alignas(RING_ALIGN) atomic_size_t tail;
+	uint64_t pushes;
+	uint64_t full_waits;
+	double full_time;
+
+	// written by the consumer
+	_Alignas(RING_ALIGN) atomic_size_t head;
+	uint64_t pops;
+	uint64_t empty_waits;
+	double empty_time;
+	uint64_t occupancy_sum;
+	size_t occupancy_max;
+
+	_Alignas(RING_ALIGN) void* slots[RING_SIZE];
+} Spsc_Ring;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: sets up an empty ring
+	Params: Spsc_Ring* ring - the ring to set up
+	Return: none
+*/
+void ringInit(Spsc_Ring* ring);
+
+/*
+	Purpose: adds an item, waiting while the ring is full, only the producer thread may call this
+	Params: Spsc_Ring* ring - the ring to add to
+			void* item - the item, NULL is passed through like any other
+	Return: none
+*/
+void ringPush(Spsc_Ring* ring, void* item);
+
+/*
+	Purpose: takes the oldest item, waiting while the ring is empty, only the consumer thread may call this
+	Params: Spsc_Ring* ring - the ring to take from
+	Return: void* - the item
+*/
+void* ringPop(Spsc_Ring* ring);
+
+#endif
@@ -0,0 +1,342 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Roundtrip.h"
+#include "MIPS_Util.h"
+
+static const char* check_names[ROUNDTRIP_CHECK_COUNT] = {
+	"dispatch", "decode", "encode", "redecode", "fast", "text"
+};
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// one thread's counts, the failing words kept are the thread's lowest
+typedef struct {
+	uint64_t decoded;
+	uint64_t fails[OP_COUNT][ROUNDTRIP_CHECK_COUNT];
+	Roundtrip_Miss first[OP_COUNT][ROUNDTRIP_CHECK_COUNT][ROUNDTRIP_FIRST];
+} Roundtrip_Counts;
+
+// a sweep in progress, shared by its threads
+typedef struct {
+	uint32_t first;
+	uint64_t count;
+	uint32_t chunk_count;
+	Roundtrip_Counts* counts;
+} Roundtrip_Sweep;
+
+
+/*----------------------------\
+		   Checking
+\----------------------------*/
+/*
+	Purpose: records a word that failed a check, keeping it while the thread has few enough
+	Params: Roundtrip_Counts* c - the thread's counts
+			uint32_t op - the op the tables name for the word
+			uint32_t check - the ROUNDTRIP_ check
+			uint32_t word - the word
+			uint32_t got - the word made from it
+	Return: none
+*/
+static void addMiss(Roundtrip_Counts* c, uint32_t op, uint32_t check, uint32_t word, uint32_t got) {
+	uint64_t n = c->fails[op][check]++;
+	if (n < ROUNDTRIP_FIRST) {
+		c->first[op][check][n].word = word;
+		c->first[op][check][n].got = got;
+		c->first[op][check][n].state = state;
+	}
+}
+
+/*
+	Purpose: checks two decoded instructions are the same
+	Params: const Assm_Instruct* a - the first
+			const Assm_Instruct* b - the second
+	Return: int - 1 if they are
+*/
+static int sameAssm(const Assm_Instruct* a, const Assm_Instruct* b) {
+	const struct Param* pa[4] = { &a->param1, &a->param2, &a->param3, &a->param4 };
+	const struct Param* pb[4] = { &b->param1, &b->param2, &b->param3, &b->param4 };
+	if (strcmp(a->op, b->op) != 0) {
+		return 0;
+	}
+	for (int p = 0; p < 4; p++) {
+		if (pa[p]->type != pb[p]->type || (pa[p]->type != EMPTY && pa[p]->value != pb[p]->value)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+	Purpose: checks one word through every round trip, in the calling thread's instruction context
+	Params: uint32_t word - the word
+			Roundtrip_Counts* c - the thread's counts
+	Return: none
+*/
+static void checkWord(uint32_t word, Roundtrip_Counts* c) {
+	Op_Type op = wordOp(word);
+
+	initInstructs();
+	BIN32 = word;
+	decode();
+	int decoded = (state == COMPLETE_DECODE);
+	if (decoded != (op != OP_INVALID) || (decoded && strcmp(OP_CODE, opName(op)) != 0)) {
+		addMiss(c, op, ROUNDTRIP_DECODE, word, 0);
+		return;
+	}
+	if (!decoded) {
+		return;
+	}
+	c->decoded++;
+
+	// encode() only sets bits, so it starts from a clear word the way parsing leaves it
+	uint32_t canonical = word & ~opUnusedBits(op);
+	Assm_Instruct decoded_assm = assm_instruct;
+	BIN32 = 0;
+	encode();
+	if (state != COMPLETE_ENCODE || BIN32 != canonical) {
+		addMiss(c, op, ROUNDTRIP_ENCODE, word, BIN32);
+	}
+	else {
+		uint32_t encoded = BIN32;
+		initInstructs();
+		BIN32 = encoded;
+		decode();
+		if (state != COMPLETE_DECODE || !sameAssm(&assm_instruct, &decoded_assm)) {
+			addMiss(c, op, ROUNDTRIP_REDECODE, word, encoded);
+		}
+	}
+
+	Decoded_Instruct d;
+	decodeWord(word, &d);
+	uint32_t fast = encodeWord(&d);
+	if (fast != canonical) {
+		state = NO_ERROR;
+		addMiss(c, op, ROUNDTRIP_FAST, word, fast);
+	}
+
+	// the text is the same for every word an instruction has, so only the one with no ignored bits is parsed
+	if (word == canonical) {
+		char text[ASSM_TEXT_SIZE];
+		formatAssm(text, &d);
+		parseAssem(text);
+		if (state == NO_ERROR) {
+			encode();
+		}
+		if (state != COMPLETE_ENCODE || BIN32 != canonical) {
+			addMiss(c, op, ROUNDTRIP_TEXT, word, BIN32);
+		}
+	}
+}
+
+/*
+	Purpose: decodes a word through the tables and by trying every function, and encodes the result both ways
+	Params: uint32_t word - the word
+			Roundtrip_Counts* c - the thread's counts
+	Return: none
+*/
+static void checkDispatch(uint32_t word, Roundtrip_Counts* c) {
+	initInstructs();
+	BIN32 = word;
+	decodeAll();
+	Assm_Instruct walked = assm_instruct;
+	uint16_t walked_state = state;
+
+	initInstructs();
+	BIN32 = word;
+	decode();
+	if (state != walked_state || !sameAssm(&assm_instruct, &walked)) {
+		addMiss(c, wordOp(word), ROUNDTRIP_DISPATCH, word, 0);
+		return;
+	}
+	if (state != COMPLETE_DECODE) {
+		return;
+	}
+
+	BIN32 = 0;
+	encodeAll();
+	uint32_t walked_word = BIN32;
+	walked_state = state;
+	assm_instruct = walked;
+	BIN32 = 0;
+	encode();
+	if (state != walked_state || BIN32 != walked_word) {
+		addMiss(c, wordOp(word), ROUNDTRIP_DISPATCH, word, BIN32);
+	}
+}
+
+/*
+	Purpose: checks every word of one chunk into the worker's counts
+	Params: void* ctx - the Roundtrip_Sweep
+			int worker - which thread's counts to add to
+			uint32_t index - the chunk
+	Return: none
+*/
+static void checkChunk(void* ctx, int worker, uint32_t index) {
+	Roundtrip_Sweep* s = ctx;
+	uint64_t from = (uint64_t)index * ROUNDTRIP_CHUNK_WORDS;
+	uint64_t to = (s->count - from < ROUNDTRIP_CHUNK_WORDS) ? s->count : from + ROUNDTRIP_CHUNK_WORDS;
+	for (uint64_t i = from; i < to; i++) {
+		checkWord(s->first + (uint32_t)i, &s->counts[worker]);
+	}
+}
+
+/*
+	Purpose: adds a thread's counts to the totals, keeping the lowest failing words of both
+	Params: Roundtrip_Stats* stats - the totals
+			const Roundtrip_Counts* c - the thread's counts
+	Return: none
+*/
+static void mergeCounts(Roundtrip_Stats* stats, const Roundtrip_Counts* c) {
+	stats->decoded += c->decoded;
+	for (uint32_t op = 0; op < OP_COUNT; op++) {
+		for (uint32_t check = 0; check < ROUNDTRIP_CHECK_COUNT; check++) {
+			uint64_t have = (stats->fails[op][check] < ROUNDTRIP_FIRST) ? stats->fails[op][check] : ROUNDTRIP_FIRST;
+			uint64_t adding = (c->fails[op][check] < ROUNDTRIP_FIRST) ? c->fails[op][check] : ROUNDTRIP_FIRST;
+			Roundtrip_Miss* kept = stats->first[op][check];
+			for (uint64_t a = 0; a < adding; a++) {
+				// insertion into the sorted kept words, dropping the highest once full
+				Roundtrip_Miss miss = c->first[op][check][a];
+				uint64_t at = have;
+				while (at > 0 && kept[at - 1].word > miss.word) {
+					if (at < ROUNDTRIP_FIRST) {
+						kept[at] = kept[at - 1];
+					}
+					at--;
+				}
+				if (at < ROUNDTRIP_FIRST) {
+					kept[at] = miss;
+					have += (have < ROUNDTRIP_FIRST);
+				}
+			}
+			stats->fails[op][check] += c->fails[op][check];
+		}
+	}
+}
+
+/*
+	Purpose: checks the table dispatch, then every word of a range through each round trip
+	Params: uint32_t first - the first word
+			uint32_t last - the last word, included
+			int threads - the number of threads, 0 for one per core
+			Roundtrip_Stats* stats - filled with the counts, failing words and times
+	Return: int - 0 for no error
+*/
+int roundtripSweep(uint32_t first, uint32_t last, int threads, Roundtrip_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	if (last < first) {
+		return 0;
+	}
+
+	Roundtrip_Sweep s;
+	s.first = first;
+	s.count = (uint64_t)last - first + 1;
+	s.chunk_count = (uint32_t)((s.count + ROUNDTRIP_CHUNK_WORDS - 1) / ROUNDTRIP_CHUNK_WORDS);
+	threads = chunkThreads(s.chunk_count, threads);
+
+	Roundtrip_Counts* counts = calloc((size_t)threads, sizeof(Roundtrip_Counts));
+	s.counts = counts;
+	if (counts == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+
+	// every opcode/funct key with the bits between clear, set and random, in the calling thread
+	double start = getTime();
+	uint64_t seed = 0x9E3779B97F4A7C15ull;
+	for (uint32_t key = 0; key < 4096; key++) {
+		uint32_t fixed = ((key >> 6) << 26) | (key & 63);
+		for (uint32_t f = 0; f < ROUNDTRIP_FILLERS + 2; f++) {
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			uint32_t filler = (f == 0) ? 0 : (f == 1) ? 0x03FFFFC0 : (uint32_t)(seed >> 32) & 0x03FFFFC0;
+			checkDispatch(fixed | filler, &counts[0]);
+			stats->keys++;
+		}
+	}
+	stats->dispatch_time = getTime() - start;
+
+	start = getTime();
+	runChunks(s.chunk_count, threads, checkChunk, &s);
+	stats->time = getTime() - start;
+	stats->words = s.count;
+
+	// a thread that never started left its counts at zero
+	for (int t = 0; t < threads; t++) {
+		mergeCounts(stats, &counts[t]);
+	}
+	free(counts);
+	return 0;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --roundtrip mode, checks that the decoders and encoders agree on every word of a range
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [first [last]]
+	Return: int - exit code, 0 when every word round trips and 1 when some do not
+*/
+int roundtripMain(int argc, char** argv) {
+	int threads = 0;
+	while (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		if (strcmp(argv[0], "-j") == 0 && argc > 1) {
+			threads = atoi(argv[1]);
+			argc -= 2;
+			argv += 2;
+		}
+		else {
+			printf("ERROR: Unknown option %s\n", argv[0]);
+			return 2;
+		}
+	}
+	uint32_t first = (argc > 0) ? (uint32_t)strtoul(argv[0], NULL, 0) : 0;
+	uint32_t last = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : UINT32_MAX;
+	if (last < first) {
+		error("--roundtrip needs the first word at or below the last");
+		return 2;
+	}
+
+	static Roundtrip_Stats stats;
+	if (roundtripSweep(first, last, threads, &stats) != 0) {
+		return 2;
+	}
+
+	// every op and check that failed, with how often and the lowest words
+	uint64_t total = 0;
+	for (uint32_t op = 0; op < OP_COUNT; op++) {
+		for (uint32_t check = 0; check < ROUNDTRIP_CHECK_COUNT; check++) {
+			uint64_t fails = stats.fails[op][check];
+			if (fails == 0) {
+				continue;
+			}
+			total += fails;
+			printf("%-4s  %-8s  %12llu", opName((Op_Type)op), check_names[check], (unsigned long long)fails);
+			for (uint64_t k = 0; k < fails && k < ROUNDTRIP_FIRST; k++) {
+				const Roundtrip_Miss* miss = &stats.first[op][check][k];
+				if (check == ROUNDTRIP_DECODE) {
+					printf("  %08X", miss->word);
+				}
+				else {
+					printf("  %08X->%08X", miss->word, miss->got);
+				}
+				const char* message = errorMessage(miss->state);
+				if (message != NULL) {
+					printf(" (%s)", message);
+				}
+			}
+			printf("\n");
+		}
+	}
+	fflush(stdout);
+
+	fprintf(stderr, "Keys: %llu in %.3f s\tWords: %llu\tDecoded: %llu\tMismatches: %llu\tTime: %.3f s\t%.1f M words/s\n",
+		(unsigned long long)stats.keys, stats.dispatch_time, (unsigned long long)stats.words,
+		(unsigned long long)stats.decoded, (unsigned long long)total, stats.time,
+		stats.time > 0 ? stats.words / stats.time / 1e6 : 0.0);
+	return (total == 0) ? 0 : 1;
+}
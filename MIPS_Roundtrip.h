@@ -0,0 +1,109 @@
+#ifndef _MIPS_ROUNDTRIP_H_
+#define _MIPS_ROUNDTRIP_H_
+
+#include <stdint.h>
+#include "MIPS_Decode.h"
+
+/*
+	Exhaustive check that the decoders and encoders agree, over every 32
+	bit word or any range of them. For each word:
+
+		decode      decode() takes the word exactly when the opcode/funct
+		            tables name an op, and names the same op
+		encode      encode() of what decode() made gives the word back,
+		            less the bits its op does not read
+		redecode    decode() of that word gives the same instruction, so
+		            every instruction decode() can make survives encode()
+		            and decode() in turn
+		fast        encodeWord() of decodeWord() gives the word back, less
+		            the same bits
+		text        the text formatAssm() writes for the word parses and
+		            encode()s back to it, checked once per instruction on
+		            the words with no ignored bits set
+
+	Before the sweep every opcode/funct key, with the other bits clear,
+	set and random, is decoded both through the tables and by trying
+	every _bin function in turn, and each instruction that decodes is
+	encoded both ways, so the sweep can rely on the tables.
+
+	The words are split into chunks that threads take in turn. The
+	instruction globals are thread local, so each thread translates in
+	its own context, counting mismatches per op and check and keeping the
+	lowest words that failed. The counts are added and the lowest words
+	kept when every chunk is done.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// words a thread takes at once
+#define ROUNDTRIP_CHUNK_WORDS (1u << 20)
+
+// failing words kept per op and check
+#define ROUNDTRIP_FIRST 3
+
+// random fillers each opcode/funct key is decoded with before the sweep
+#define ROUNDTRIP_FILLERS 64
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// what a word is checked for, in the order they are run
+typedef enum Roundtrip_Check {
+	ROUNDTRIP_DISPATCH,
+	ROUNDTRIP_DECODE,
+	ROUNDTRIP_ENCODE,
+	ROUNDTRIP_REDECODE,
+	ROUNDTRIP_FAST,
+	ROUNDTRIP_TEXT,
+	ROUNDTRIP_CHECK_COUNT
+} Roundtrip_Check;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a word that failed a check, with the word made from it or the state it ended in
+typedef struct {
+	uint32_t word;
+	uint32_t got;
+	uint16_t state;
+} Roundtrip_Miss;
+
+// what a sweep found
+typedef struct {
+	uint64_t words;
+	uint64_t decoded;
+	uint64_t keys;
+	uint64_t fails[OP_COUNT][ROUNDTRIP_CHECK_COUNT];
+	Roundtrip_Miss first[OP_COUNT][ROUNDTRIP_CHECK_COUNT][ROUNDTRIP_FIRST];
+	double dispatch_time;
+	double time;
+} Roundtrip_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: checks the table dispatch, then every word of a range through each round trip
+	Params: uint32_t first - the first word
+			uint32_t last - the last word, included
+			int threads - the number of threads, 0 for one per core
+			Roundtrip_Stats* stats - filled with the counts, failing words and times
+	Return: int - 0 for no error
+*/
+int roundtripSweep(uint32_t first, uint32_t last, int threads, Roundtrip_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --roundtrip mode, checks that the decoders and encoders agree on every word of a range
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [first [last]]
+	Return: int - exit code, 0 when every word round trips and 1 when some do not
+*/
+int roundtripMain(int argc, char** argv);
+
+#endif
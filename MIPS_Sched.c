@@ -0,0 +1,334 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Cfg.h"
+#include "MIPS_Live.h"
+#include "MIPS_Sched.h"
+#include "MIPS_Util.h"
+
+// what an instruction does beyond its registers
+#define SCHED_ALU 0
+#define SCHED_LOAD 1
+#define SCHED_STORE 2
+#define SCHED_BRANCH 3
+#define SCHED_BARRIER 4
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// the pipeline model, when each register is ready and the next free issue slot
+typedef struct {
+	uint64_t ready[32];
+	uint64_t next;
+	uint64_t stalls;
+} Sched_Pipe;
+
+// one instruction of a window
+typedef struct {
+	uint32_t def;
+	uint32_t use;
+	uint32_t latency;
+	uint32_t kind;
+} Sched_Node;
+
+
+/*----------------------------\
+		   Model
+\----------------------------*/
+/*
+	Purpose: gets the registers, latency and kind of an instruction
+	Params: uint32_t word - the instruction word
+			Sched_Node* node - the node to fill
+	Return: none
+*/
+static void nodeOf(uint32_t word, Sched_Node* node) {
+	liveEffect(word, &node->def, &node->use);
+	node->latency = 1;
+	node->kind = SCHED_ALU;
+
+	switch (wordOp(word)) {
+	case OP_LW: { node->latency = SCHED_LOAD_LATENCY; node->kind = SCHED_LOAD; break; }
+	case OP_SW: { node->kind = SCHED_STORE; break; }
+	case OP_MULT: { node->latency = SCHED_MULT_LATENCY; break; }
+	case OP_DIV: { node->latency = SCHED_DIV_LATENCY; break; }
+	case OP_BEQ:
+	case OP_BNE: { node->kind = SCHED_BRANCH; break; }
+	case OP_INVALID: { node->kind = SCHED_BARRIER; break; }
+	default: { break; }
+	}
+}
+
+/*
+	Purpose: finds the first cycle an instruction can issue in
+	Params: const Sched_Pipe* pipe - the pipeline
+			uint32_t use - the registers it reads
+	Return: uint64_t - the cycle
+*/
+static inline uint64_t issueCycle(const Sched_Pipe* pipe, uint32_t use) {
+	uint64_t cycle = pipe->next;
+	while (use != 0) {
+		uint32_t reg = (uint32_t)__builtin_ctz(use);
+		use &= use - 1;
+		if (pipe->ready[reg] > cycle) {
+			cycle = pipe->ready[reg];
+		}
+	}
+	return cycle;
+}
+
+/*
+	Purpose: issues an instruction, counting the cycles it waited
+	Params: Sched_Pipe* pipe - the pipeline
+			const Sched_Node* node - the instruction
+			uint64_t cycle - the cycle it issues in, from issueCycle
+	Return: none
+*/
+static inline void issue(Sched_Pipe* pipe, const Sched_Node* node, uint64_t cycle) {
+	pipe->stalls += cycle - pipe->next;
+	pipe->next = cycle + 1;
+
+	uint32_t def = node->def;
+	while (def != 0) {
+		uint32_t reg = (uint32_t)__builtin_ctz(def);
+		def &= def - 1;
+		pipe->ready[reg] = cycle + node->latency;
+	}
+}
+
+/*
+	Purpose: checks whether an instruction has to stay after an earlier one
+	Params: const Sched_Node* early - the earlier instruction
+			const Sched_Node* late - the later instruction
+	Return: int - 1 if it does
+*/
+static inline int dependsOn(const Sched_Node* early, const Sched_Node* late) {
+	if (early->kind == SCHED_BARRIER || late->kind == SCHED_BARRIER || late->kind == SCHED_BRANCH) {
+		return 1;
+	}
+
+	// RAW, WAW, then WAR
+	if ((early->def & (late->use | late->def)) != 0 || (early->use & late->def) != 0) {
+		return 1;
+	}
+
+	// loads may pass each other, nothing else that touches memory may
+	int early_mem = (early->kind == SCHED_LOAD || early->kind == SCHED_STORE);
+	int late_mem = (late->kind == SCHED_LOAD || late->kind == SCHED_STORE);
+	return early_mem && late_mem && (early->kind == SCHED_STORE || late->kind == SCHED_STORE);
+}
+
+
+/*----------------------------\
+		   Scheduling
+\----------------------------*/
+/*
+	Purpose: list schedules one window, issuing it on the pipeline as it goes
+	Params: const uint32_t* in - the window's words in their old order
+			uint32_t* out - filled with the words in the new order
+			uint32_t count - how many, at most SCHED_WINDOW
+			Sched_Pipe* pipe - the pipeline, left as the last word issued it
+	Return: none
+*/
+static void scheduleWindow(const uint32_t* in, uint32_t* out, uint32_t count, Sched_Pipe* pipe) {
+	Sched_Node nodes[SCHED_WINDOW];
+	uint64_t preds[SCHED_WINDOW];
+	uint32_t height[SCHED_WINDOW];
+
+	for (uint32_t i = 0; i < count; i++) {
+		nodeOf(in[i], &nodes[i]);
+		preds[i] = 0;
+		for (uint32_t j = 0; j < i; j++) {
+			if (dependsOn(&nodes[j], &nodes[i])) {
+				preds[i] |= 1ull << j;
+			}
+		}
+	}
+
+	// the longest latency path from each instruction to the end of the window
+	for (uint32_t i = count; i-- > 0;) {
+		height[i] = nodes[i].latency;
+		for (uint32_t k = i + 1; k < count; k++) {
+			if (((preds[k] >> i) & 1) && nodes[i].latency + height[k] > height[i]) {
+				height[i] = nodes[i].latency + height[k];
+			}
+		}
+	}
+
+	uint64_t done = 0;
+	for (uint32_t step = 0; step < count; step++) {
+		uint32_t best = count;
+		uint64_t best_cycle = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (((done >> i) & 1) || (preds[i] & ~done) != 0) {
+				continue;
+			}
+
+			uint64_t cycle = issueCycle(pipe, nodes[i].use);
+			if (best == count || cycle < best_cycle || (cycle == best_cycle && height[i] > height[best])) {
+				best = i;
+				best_cycle = cycle;
+			}
+		}
+
+		done |= 1ull << best;
+		out[step] = in[best];
+		issue(pipe, &nodes[best], best_cycle);
+	}
+}
+
+/*
+	Purpose: counts the stall cycles of a straight line run of words issued from an empty pipeline
+	Params: const uint32_t* words - the words
+			uint32_t count - how many
+	Return: uint64_t - the stall cycles
+*/
+uint64_t schedStalls(const uint32_t* words, uint32_t count) {
+	Sched_Pipe pipe;
+	memset(&pipe, 0, sizeof(pipe));
+
+	for (uint32_t i = 0; i < count; i++) {
+		Sched_Node node;
+		nodeOf(words[i], &node);
+		issue(&pipe, &node, issueCycle(&pipe, node.use));
+	}
+	return pipe.stalls;
+}
+
+/*
+	Purpose: schedules every basic block of a program in place
+	Params: uint32_t* words - the program words, host order
+			uint32_t count - how many
+			Sched_Stats* stats - filled with what changed
+	Return: int - 0 for no error
+*/
+int schedProgram(uint32_t* words, uint32_t count, Sched_Stats* stats) {
+	memset(stats, 0, sizeof(*stats));
+	double start = getTime();
+
+	// the graph is only used for where blocks start, which scheduling never changes
+	Cfg cfg;
+	Cfg_Stats cfg_stats;
+	if (cfgBuild(&cfg, words, count, TEXT_BASE, 1, &cfg_stats) != 0) {
+		return 1;
+	}
+	uint32_t* copy = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (copy == NULL) {
+		error("Out of memory");
+		cfgFree(&cfg);
+		return 1;
+	}
+
+	for (uint32_t b = 0; b < cfg.block_count; b++) {
+		uint32_t first = cfg.block_start[b];
+		uint32_t size = cfg.block_start[b + 1] - first;
+		uint64_t before = schedStalls(words + first, size);
+
+		Sched_Pipe pipe;
+		memset(&pipe, 0, sizeof(pipe));
+		for (uint32_t off = 0; off < size; off += SCHED_WINDOW) {
+			uint32_t len = (size - off < SCHED_WINDOW) ? size - off : SCHED_WINDOW;
+			scheduleWindow(words + first + off, copy + off, len, &pipe);
+		}
+
+		stats->blocks++;
+		stats->stalls_before += before;
+		if (pipe.stalls >= before) {
+			stats->stalls_after += before;
+			continue;
+		}
+
+		stats->stalls_after += pipe.stalls;
+		stats->changed++;
+		for (uint32_t i = 0; i < size; i++) {
+			stats->moved += (words[first + i] != copy[i]);
+		}
+		memcpy(words + first, copy, (size_t)size * sizeof(uint32_t));
+	}
+
+	free(copy);
+	cfgFree(&cfg);
+	stats->time = getTime() - start;
+	return 0;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --schedule mode, schedules a program, reports the stalls removed and checks both run the same
+	Params: int argc - number of arguments after the mode
+			char** argv - [-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int scheduleMain(int argc, char** argv) {
+	const char* out_path = NULL;
+	if (argc > 1 && strcmp(argv[0], "-o") == 0) {
+		out_path = argv[1];
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 1) {
+		error("--schedule needs a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* original = loadProgram(argv[0], &count);
+	if (original == NULL) {
+		return 1;
+	}
+	uint32_t* scheduled = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (scheduled == NULL) {
+		error("Out of memory");
+		free(original);
+		return 1;
+	}
+	memcpy(scheduled, original, (size_t)count * sizeof(uint32_t));
+
+	Sched_Stats stats;
+	if (schedProgram(scheduled, count, &stats) != 0) {
+		free(original);
+		free(scheduled);
+		return 1;
+	}
+
+	printf("Words: %u\tBlocks: %u\tChanged: %u\tMoved: %u\tTime: %.6f s\n", count, stats.blocks, stats.changed,
+		stats.moved, stats.time);
+	printf("Static stalls: %llu -> %llu (%llu removed)\n", (unsigned long long)stats.stalls_before,
+		(unsigned long long)stats.stalls_after, (unsigned long long)(stats.stalls_before - stats.stalls_after));
+
+	// both versions run to the end and must leave the same registers and memory
+	Machine before;
+	Machine after;
+	int failed = 1;
+	if (runProgram(&before, original, count, argc - 1, argv + 1) == 0) {
+		if (runProgram(&after, scheduled, count, argc - 1, argv + 1) == 0) {
+			int same = before.status == after.status && before.retired == after.retired &&
+				memcmp(&before.arch, &after.arch, sizeof(Arch_State)) == 0 &&
+				memChecksum(&before.mem) == memChecksum(&after.mem);
+			if (same) {
+				printf("Scheduled program matches the original, %llu instructions retired\n",
+					(unsigned long long)after.retired);
+				failed = 0;
+			}
+			else {
+				error("Scheduled program does not match the original");
+				puts("Original:");
+				printArchState(&before.arch, before.retired);
+				puts("Scheduled:");
+				printArchState(&after.arch, after.retired);
+			}
+			machineFree(&after);
+		}
+		machineFree(&before);
+	}
+
+	if (!failed && out_path != NULL) {
+		failed = saveProgram(out_path, scheduled, count);
+	}
+
+	free(original);
+	free(scheduled);
+	return failed;
+}
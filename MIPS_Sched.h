@@ -0,0 +1,89 @@
+#ifndef _MIPS_SCHED_H_
+#define _MIPS_SCHED_H_
+
+#include <stdint.h>
+
+/*
+	List scheduler for assembled code, run one basic block at a time so
+	every branch and branch target stays where it was.
+
+	Stalls are counted on a single issue in order pipeline with full
+	forwarding, where a result is ready SCHED_LOAD_LATENCY cycles after a
+	LW issues and HI/LO SCHED_MULT_LATENCY or SCHED_DIV_LATENCY cycles
+	after a MULT or DIV, and everything else the next cycle. An instruction
+	issues once every register it reads is ready. Each block is counted
+	from an empty pipeline.
+
+	A block is cut into windows of up to SCHED_WINDOW instructions. Each
+	window gets a dependency DAG of 64 bit masks: register RAW, WAR and WAW
+	through the liveness register sets, with HI/LO as one register, and LW
+	kept after SW and SW after any LW or SW. A branch ending the block
+	depends on everything before it, so it stays last, and a word that
+	does not decode is a barrier. The ready instruction that can issue
+	soonest goes next, with the longest latency path to the end of the
+	window breaking ties. A block keeps its old order unless the new one
+	stalls less.
+
+	The machine this translator runs has no branch delay slots, so there
+	are no slots to fill. Moving work between loads and their uses and
+	between MULT/DIV and MFHI/MFLO is what the scheduler can do.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// instructions scheduled together, one bit each in a dependency mask
+#define SCHED_WINDOW 64
+
+// cycles from issue until a result can be used
+#define SCHED_LOAD_LATENCY 2
+#define SCHED_MULT_LATENCY 12
+#define SCHED_DIV_LATENCY 35
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// what a pass changed
+typedef struct {
+	uint32_t blocks;
+	uint32_t changed;
+	uint32_t moved;
+	uint64_t stalls_before;
+	uint64_t stalls_after;
+	double time;
+} Sched_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: counts the stall cycles of a straight line run of words issued from an empty pipeline
+	Params: const uint32_t* words - the words
+			uint32_t count - how many
+	Return: uint64_t - the stall cycles
+*/
+uint64_t schedStalls(const uint32_t* words, uint32_t count);
+
+/*
+	Purpose: schedules every basic block of a program in place
+	Params: uint32_t* words - the program words, host order
+			uint32_t count - how many
+			Sched_Stats* stats - filled with what changed
+	Return: int - 0 for no error
+*/
+int schedProgram(uint32_t* words, uint32_t count, Sched_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --schedule mode, schedules a program, reports the stalls removed and checks both run the same
+	Params: int argc - number of arguments after the mode
+			char** argv - [-o out.s] <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int scheduleMain(int argc, char** argv);
+
+#endif
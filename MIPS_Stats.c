@@ -0,0 +1,360 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Grep.h"
+#include "MIPS_Stats.h"
+#include "MIPS_Util.h"
+
+// signed and float lanes to go with Word_Vec, for the bit length of the immediate
+typedef int32_t Stats_Int_Vec __attribute__((vector_size(16)));
+typedef float Stats_Float_Vec __attribute__((vector_size(16)));
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// one thread's histograms, a thread never counts more than the 2^30 words of one .text
+// the key is only counted with rs, and R-type words count rd where I-type words count the immediate
+typedef struct {
+	uint32_t key_rs[32][STATS_KEYS];
+	uint32_t rt[STATS_KEYS][32];
+	uint32_t rd_imm[STATS_KEYS][32 + STATS_IMM_BUCKETS];
+} Stats_Counts;
+
+// a scan in progress, shared by its threads
+typedef struct {
+	const uint8_t* text;
+	uint32_t count;
+	int swap;
+	uint8_t key_op[STATS_KEYS];
+	Stats_Counts* counts;
+} Stats_Scan;
+
+
+/*----------------------------\
+		   Counting
+\----------------------------*/
+/*
+	Purpose: pulls the fields of four words out and packs the ones counted into one word each
+	Params: Word_Vec w - the words, host order
+	Return: Word_Vec - the key in bits 0-6, rs in 7-11, rt in 12-16 and from 17 rd for R-type words
+			or 32 + the immediate bucket for the rest
+*/
+static inline Word_Vec packFields(Word_Vec w) {
+	Word_Vec opcode = w >> 26;
+	Word_Vec rtype = (Word_Vec)(opcode == 0);
+	Word_Vec key = opcode | (rtype & ((w & 63) | 64));
+
+	// the bit length of the magnitude, ones' complement for a set sign bit, from the float exponent
+	Word_Vec imm = w & 0xFFFF;
+	Word_Vec sign = imm >> 15;
+	Word_Vec mag = imm ^ ((0 - sign) & 0xFFFF);
+	Stats_Float_Vec f = __builtin_convertvector((Stats_Int_Vec)mag, Stats_Float_Vec);
+	Word_Vec length = (((Word_Vec)f >> 23) - 126) & (Word_Vec)(mag != 0);
+
+	Word_Vec rd_imm = (rtype & ((w >> 11) & 31)) | (~rtype & (32 | length | (sign << 4)));
+	return key | (((w >> 21) & 31) << 7) | (((w >> 16) & 31) << 12) | (rd_imm << 17);
+}
+
+/*
+	Purpose: counts the words of one step
+	Params: const Stats_Scan* s - the scan
+			Word_Vec* w - the step's words, file order, swapped in place
+			uint32_t n - how many of them to count
+			Stats_Counts* c - the histograms to count into
+	Return: none
+*/
+static inline void countStep(const Stats_Scan* s, Word_Vec* w, uint32_t n, Stats_Counts* c) {
+	uint32_t at[3][STATS_STEP_WORDS];
+	for (int v = 0; v < STATS_STEP_WORDS / 4; v++) {
+		if (s->swap) {
+			w[v] = (w[v] >> 24) | (w[v] << 24) | ((w[v] >> 8) & 0xFF00) | ((w[v] << 8) & 0xFF0000);
+		}
+		Word_Vec p = packFields(w[v]);
+		Word_Vec key = p & 127;
+		Word_Vec key_rs = p & 4095;
+		Word_Vec rt = (key << 5) | ((p >> 12) & 31);
+		Word_Vec rd_imm = (key << 6) | (p >> 17);
+		memcpy(at[0] + v * 4, &key_rs, 16);
+		memcpy(at[1] + v * 4, &rt, 16);
+		memcpy(at[2] + v * 4, &rd_imm, 16);
+	}
+
+	uint32_t* key_rs = &c->key_rs[0][0];
+	uint32_t* rt = &c->rt[0][0];
+	uint32_t* rd_imm = &c->rd_imm[0][0];
+	for (uint32_t k = 0; k < n; k++) {
+		key_rs[at[0][k]]++;
+		rt[at[1][k]]++;
+		rd_imm[at[2][k]]++;
+	}
+}
+
+/*
+	Purpose: counts a run of words
+	Params: const Stats_Scan* s - the scan
+			uint32_t from - the first word
+			uint32_t to - the word past the last
+			Stats_Counts* c - the histograms to count into
+	Return: none
+*/
+static void countRun(const Stats_Scan* s, uint32_t from, uint32_t to, Stats_Counts* c) {
+	Word_Vec w[STATS_STEP_WORDS / 4];
+	uint32_t i = from;
+	for (; i + STATS_STEP_WORDS <= to; i += STATS_STEP_WORDS) {
+		memcpy(w, s->text + (size_t)i * 4, STATS_STEP_WORDS * 4);
+		countStep(s, w, STATS_STEP_WORDS, c);
+	}
+
+	// the last words of the run are padded out to a whole step
+	if (i < to) {
+		memset(w, 0, sizeof(w));
+		memcpy(w, s->text + (size_t)i * 4, (size_t)(to - i) * 4);
+		countStep(s, w, to - i, c);
+	}
+}
+
+/*
+	Purpose: counts one chunk into the worker's histograms
+	Params: void* ctx - the Stats_Scan
+			int worker - which thread's histograms to count into
+			uint32_t index - the chunk
+	Return: none
+*/
+static void countChunk(void* ctx, int worker, uint32_t index) {
+	Stats_Scan* s = ctx;
+	uint32_t from = index * STATS_CHUNK_WORDS;
+	uint32_t to = (s->count - from < STATS_CHUNK_WORDS) ? s->count : from + STATS_CHUNK_WORDS;
+	countRun(s, from, to, &s->counts[worker]);
+}
+
+/*
+	Purpose: adds the histograms of a .text to the totals
+	Params: const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			int threads - the number of threads, 0 for one per core
+			Image_Stats* stats - the totals to add to
+	Return: int - 0 for no error
+*/
+int statsScan(const uint8_t* text, uint32_t count, int big, int threads, Image_Stats* stats) {
+	Stats_Scan s;
+	s.text = text;
+	s.count = count;
+	s.swap = (big != hostIsBig());
+
+	// key 0 never comes up, opcode 0 is counted by its funct
+	for (uint32_t key = 0; key < STATS_KEYS; key++) {
+		s.key_op[key] = (uint8_t)((key < 64) ? wordOp(key << 26) : wordOp(key - 64));
+	}
+
+	uint32_t chunk_count = (count + STATS_CHUNK_WORDS - 1) / STATS_CHUNK_WORDS;
+	threads = chunkThreads(chunk_count, threads);
+
+	s.counts = calloc((size_t)threads, sizeof(Stats_Counts));
+	if (s.counts == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+
+	double start = getTime();
+	runChunks(chunk_count, threads, countChunk, &s);
+
+	// histograms of threads that never started are still zero
+	for (int t = 0; t < threads; t++) {
+		const Stats_Counts* c = &s.counts[t];
+		for (uint32_t key = 0; key < STATS_KEYS; key++) {
+			uint32_t op = s.key_op[key];
+			for (uint32_t r = 0; r < 32; r++) {
+				stats->keys[key] += c->key_rs[r][key];
+				stats->regs[op][0][r] += c->key_rs[r][key];
+				stats->regs[op][1][r] += c->rt[key][r];
+				stats->regs[op][2][r] += c->rd_imm[key][r];
+			}
+			for (uint32_t b = 0; b < STATS_IMM_BUCKETS; b++) {
+				stats->imms[op][b] += c->rd_imm[key][32 + b];
+			}
+		}
+	}
+	stats->time += getTime() - start;
+	stats->words += count;
+	stats->bytes += (uint64_t)count * 4;
+
+	free(s.counts);
+	return 0;
+}
+
+
+/*----------------------------\
+		   Printing
+\----------------------------*/
+/*
+	Purpose: prints a count and its share of the words
+	Params: const char* label - the row's label
+			uint64_t count - the count
+			uint64_t words - the words counted
+	Return: none
+*/
+static void printRow(const char* label, uint64_t count, uint64_t words) {
+	printf("  %-18s %12llu  %6.2f%%\n", label, (unsigned long long)count, words ? 100.0 * count / words : 0.0);
+}
+
+/*
+	Purpose: prints the histograms
+	Params: const Image_Stats* stats - the totals
+	Return: none
+*/
+static void printStats(const Image_Stats* stats) {
+	char label[32];
+	uint64_t ops[OP_COUNT] = { 0 };
+	uint64_t opcodes[64] = { 0 };
+	for (uint32_t key = 0; key < STATS_KEYS; key++) {
+		Op_Type op = (key < 64) ? wordOp(key << 26) : wordOp(key - 64);
+		ops[op] += stats->keys[key];
+		opcodes[(key < 64) ? key : 0] += stats->keys[key];
+	}
+
+	// ops from most to least common
+	printf("Words: %llu\n\nOps:\n", (unsigned long long)stats->words);
+	uint8_t order[OP_COUNT];
+	for (uint32_t i = 0; i < OP_COUNT; i++) {
+		uint32_t at = i;
+		while (at > 0 && ops[order[at - 1]] < ops[i]) {
+			order[at] = order[at - 1];
+			at--;
+		}
+		order[at] = (uint8_t)i;
+	}
+	for (uint32_t i = 0; i < OP_COUNT; i++) {
+		if (ops[order[i]] > 0) {
+			printRow(opName((Op_Type)order[i]), ops[order[i]], stats->words);
+		}
+	}
+
+	printf("\nOpcodes:\n");
+	for (uint32_t opcode = 0; opcode < 64; opcode++) {
+		if (opcodes[opcode] > 0) {
+			snprintf(label, sizeof(label), "0x%02X %s", opcode, (opcode == 0) ? "R-type" : opName(wordOp(opcode << 26)));
+			printRow(label, opcodes[opcode], stats->words);
+		}
+	}
+
+	printf("\nFuncts:\n");
+	for (uint32_t funct = 0; funct < 64; funct++) {
+		if (stats->keys[64 + funct] > 0) {
+			snprintf(label, sizeof(label), "0x%02X %s", funct, opName(wordOp(funct)));
+			printRow(label, stats->keys[64 + funct], stats->words);
+		}
+	}
+
+	// only the fields each op has
+	uint64_t regs[32][3] = { { 0 } };
+	uint64_t signed_imms[STATS_IMM_BUCKETS] = { 0 };
+	uint64_t unsigned_imms[STATS_IMM_BUCKETS] = { 0 };
+	for (uint32_t op = 0; op < OP_COUNT; op++) {
+		int dest, base;
+		uint32_t has = grepOpFields(op, &dest, &base);
+		for (uint32_t field = 0; field < 3; field++) {
+			for (uint32_t r = 0; r < 32 && ((has >> field) & 1); r++) {
+				regs[r][field] += stats->regs[op][field][r];
+			}
+		}
+
+		int is_signed = (op == OP_ADDI || op == OP_SLTI || op == OP_LW || op == OP_SW || op == OP_BEQ || op == OP_BNE);
+		for (uint32_t b = 0; b < STATS_IMM_BUCKETS && (has & (1u << GREP_FIELD_IMM)); b++) {
+			if (is_signed) {
+				signed_imms[b] += stats->imms[op][b];
+			}
+			else {
+				unsigned_imms[b] += stats->imms[op][b];
+			}
+		}
+	}
+
+	printf("\nRegisters:           rs           rt           rd\n");
+	for (uint32_t r = 0; r < 32; r++) {
+		if (regs[r][0] + regs[r][1] + regs[r][2] > 0) {
+			printf("  %-6s %14llu %12llu %12llu\n", regName(r), (unsigned long long)regs[r][0],
+				(unsigned long long)regs[r][1], (unsigned long long)regs[r][2]);
+		}
+	}
+
+	// a bucket of bit length b holds 2^(b-1) up to 2^b - 1, or with the sign bit -2^b up to -2^(b-1) - 1
+	printf("\nImmediates:                  signed     unsigned\n");
+	for (int b = STATS_IMM_BUCKETS / 2 - 1; b >= 0; b--) {
+		uint64_t count = signed_imms[STATS_IMM_BUCKETS / 2 + b];
+		if (count > 0) {
+			if (b == 0) {
+				snprintf(label, sizeof(label), "-1");
+			}
+			else {
+				snprintf(label, sizeof(label), "%d..%d", -(1 << b), -(1 << (b - 1)) - 1);
+			}
+			printf("  %-20s %12llu %12llu\n", label, (unsigned long long)count, 0ull);
+		}
+	}
+	uint64_t high = 0;
+	for (int b = 0; b < STATS_IMM_BUCKETS / 2; b++) {
+		high += unsigned_imms[STATS_IMM_BUCKETS / 2 + b];
+		if (signed_imms[b] + unsigned_imms[b] > 0) {
+			if (b <= 1) {
+				snprintf(label, sizeof(label), "%d", b);
+			}
+			else {
+				snprintf(label, sizeof(label), "%d..%d", 1 << (b - 1), (1 << b) - 1);
+			}
+			printf("  %-20s %12llu %12llu\n", label, (unsigned long long)signed_imms[b],
+				(unsigned long long)unsigned_imms[b]);
+		}
+	}
+	if (high > 0) {
+		printf("  %-20s %12llu %12llu\n", "32768..65535", 0ull, (unsigned long long)high);
+	}
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --stats mode, prints the instruction mix of one or more images
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file>...
+	Return: int - exit code
+*/
+int statsMain(int argc, char** argv) {
+	int big = 1;
+	int threads = 0;
+	uint32_t raw_base = TEXT_BASE;
+	imageOptions(&argc, &argv, &raw_base, &big, &threads);
+	if (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 2;
+	}
+	if (argc < 1) {
+		error("--stats needs at least one file");
+		return 2;
+	}
+
+	static Image_Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	int failed = 0;
+	for (int f = 0; f < argc && !failed; f++) {
+		Elf_Image image;
+		if (imageOpenAny(&image, argv[f], raw_base, big) != 0) {
+			failed = 1;
+			break;
+		}
+		failed = statsScan(image.text, image.text_size / 4, image.big, threads, &stats);
+		imageClose(&image);
+	}
+	if (failed) {
+		return 2;
+	}
+
+	printStats(&stats);
+	fflush(stdout);
+	fprintf(stderr, "Files: %d\tScanned: %.1f MB\tTime: %.6f s\t%.1f MB/s\n", argc, stats.bytes / 1e6, stats.time,
+		stats.time > 0 ? stats.bytes / stats.time / 1e6 : 0.0);
+	return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef _MIPS_STATS_H_
+#define _MIPS_STATS_H_
+
+#include <stdint.h>
+#include "MIPS_Decode.h"
+
+/*
+	Instruction mix of images: how often each opcode and R-type funct
+	comes up, which registers each field uses and how large the
+	immediates are. The mapped .text is read as it is, 16 words at a
+	time. Vector shifts and masks pull every field out of the words at
+	once, byte swapped first when the file's order is not the host's, and
+	the bit length of each immediate comes from the exponent of it
+	converted to float. Only the counting is done a word at a time.
+
+	Each word is counted with three increments and no branches: its
+	opcode/funct key together with rs, rt under its key, and rd for R-type
+	words or the immediate bucket for the rest under its key. The joint
+	tables stay small enough for the L1 cache, and the per key rows are
+	added into per op rows and the key and rs histograms at the end. The
+	report only reads the rows that mean something, the registers an op
+	has and the immediates of I-type ops. Each immediate goes in a bucket
+	by its sign bit and the bit length of its magnitude, which is enough
+	to report it sign extended for the ops that sign extend and zero
+	extended for the rest.
+
+	The words are split into chunks that threads take in turn, each
+	counting into its own histograms, and the histograms are added
+	together when every chunk is done.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// opcode/funct keys, an opcode on its own or 64 + the funct of an R-type word
+#define STATS_KEYS 128
+
+// immediate buckets, the bit length 0-15 of the magnitude, then again with the sign bit set
+#define STATS_IMM_BUCKETS 32
+
+// words a thread takes at once
+#define STATS_CHUNK_WORDS (1u << 20)
+
+// words scanned per step, four vectors of four
+#define STATS_STEP_WORDS 16
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// the histograms of one or more images
+typedef struct {
+	uint64_t words;
+	uint64_t bytes;
+	uint64_t keys[STATS_KEYS];
+	uint64_t regs[OP_COUNT][3][32];
+	uint64_t imms[OP_COUNT][STATS_IMM_BUCKETS];
+	double time;
+} Image_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: adds the histograms of a .text to the totals
+	Params: const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			int threads - the number of threads, 0 for one per core
+			Image_Stats* stats - the totals to add to
+	Return: int - 0 for no error
+*/
+int statsScan(const uint8_t* text, uint32_t count, int big, int threads, Image_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --stats mode, prints the instruction mix of one or more images
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file>...
+	Return: int - exit code
+*/
+int statsMain(int argc, char** argv);
+
+#endif
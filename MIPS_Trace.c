@@ -0,0 +1,616 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Trace.h"
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		   Encoding
+\----------------------------*/
+/*
+	Purpose: maps a signed delta to an unsigned value with small magnitudes near zero
+	Params: int32_t v - the delta
+	Return: uint32_t - the zigzag value
+*/
+static uint32_t zigzag(int32_t v) {
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/*
+	Purpose: undoes zigzag()
+	Params: uint32_t v - the zigzag value
+	Return: int32_t - the delta
+*/
+static int32_t unzigzag(uint32_t v) {
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/*
+	Purpose: writes a LEB128 varint
+	Params: uint8_t* p - where to write
+			uint32_t v - the value
+	Return: uint8_t* - the ptr to after the varint
+*/
+static uint8_t* putVarint(uint8_t* p, uint32_t v) {
+	while (v >= 0x80) {
+		*p++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+/*
+	Purpose: reads a LEB128 varint
+	Params: const uint8_t** p - the read position, moved past the varint
+	Return: uint32_t - the value
+*/
+static uint32_t getVarint(const uint8_t** p) {
+	uint32_t v = 0;
+	int shift = 0;
+
+	while (**p & 0x80) {
+		v |= (uint32_t)(*(*p)++ & 0x7F) << shift;
+		shift += 7;
+	}
+	v |= (uint32_t)(*(*p)++) << shift;
+	return v;
+}
+
+// effect of each op, which register field holds the destination
+static const struct {
+	uint8_t kind;
+	uint8_t dest_rd;
+} effect_table[OP_COUNT] = {
+	[OP_ADD] = { EFFECT_REG, 1 },
+	[OP_SUB] = { EFFECT_REG, 1 },
+	[OP_AND] = { EFFECT_REG, 1 },
+	[OP_OR] = { EFFECT_REG, 1 },
+	[OP_SLT] = { EFFECT_REG, 1 },
+	[OP_MFHI] = { EFFECT_REG, 1 },
+	[OP_MFLO] = { EFFECT_REG, 1 },
+	[OP_ADDI] = { EFFECT_REG, 0 },
+	[OP_ANDI] = { EFFECT_REG, 0 },
+	[OP_ORI] = { EFFECT_REG, 0 },
+	[OP_SLTI] = { EFFECT_REG, 0 },
+	[OP_LUI] = { EFFECT_REG, 0 },
+	[OP_LW] = { EFFECT_REG, 0 },
+	[OP_MULT] = { EFFECT_HILO, 0 },
+	[OP_DIV] = { EFFECT_HILO, 0 },
+	[OP_SW] = { EFFECT_STORE, 0 }
+};
+
+
+/*----------------------------\
+		 Writer Thread
+\----------------------------*/
+/*
+	Purpose: writes finished chunks to the file in order until the recorder is done
+	Params: void* arg - the Trace_Writer
+	Return: void* - unused
+*/
+static void* writerThread(void* arg) {
+	Trace_Writer* tw = arg;
+
+	pthread_mutex_lock(&tw->lock);
+	while (1) {
+		while (tw->queued == 0 && !tw->done) {
+			pthread_cond_wait(&tw->ready, &tw->lock);
+		}
+		if (tw->queued == 0) {
+			break;
+		}
+		pthread_mutex_unlock(&tw->lock);
+
+		// the buffer is not touched by the recorder until it is released below
+		if (fwrite(tw->buffers[tw->write], TRACE_CHUNK_SIZE, 1, tw->file) != 1) {
+			tw->failed = 1;
+		}
+
+		pthread_mutex_lock(&tw->lock);
+		tw->write = (tw->write + 1) % TRACE_BUFFERS;
+		tw->queued--;
+		pthread_cond_signal(&tw->space);
+	}
+	pthread_mutex_unlock(&tw->lock);
+
+	return NULL;
+}
+
+/*
+	Purpose: starts a new chunk in the current buffer with a checkpoint of the shadow state
+	Params: Trace_Writer* tw - the writer
+	Return: none
+*/
+static void beginChunk(Trace_Writer* tw) {
+	uint8_t* buffer = tw->buffers[tw->fill];
+	Trace_Chunk_Header* chunk = (Trace_Chunk_Header*)buffer;
+
+	chunk->magic = CHUNK_MAGIC;
+	chunk->count = 0;
+	chunk->first = tw->header.instructions;
+	chunk->bytes = 0;
+	chunk->reserved = 0;
+	chunk->start = tw->shadow;
+
+	// store addresses restart so each chunk decodes on its own
+	tw->last_store = 0;
+
+	tw->cur = buffer + sizeof(Trace_Chunk_Header);
+	tw->end = buffer + TRACE_CHUNK_SIZE;
+}
+
+/*
+	Purpose: hands the current chunk to the writer thread, waiting if every buffer is queued
+	Params: Trace_Writer* tw - the writer
+	Return: none
+*/
+static void submitChunk(Trace_Writer* tw) {
+	uint8_t* buffer = tw->buffers[tw->fill];
+	Trace_Chunk_Header* chunk = (Trace_Chunk_Header*)buffer;
+
+	// finishes the chunk and zeros the unused tail
+	chunk->bytes = (uint32_t)(tw->cur - buffer - sizeof(Trace_Chunk_Header));
+	memset(tw->cur, 0, tw->end - tw->cur);
+	tw->payload += chunk->bytes;
+	tw->header.chunks++;
+
+	pthread_mutex_lock(&tw->lock);
+	tw->queued++;
+	pthread_cond_signal(&tw->ready);
+
+	// the next buffer is free once fewer than all of them are queued
+	if (tw->queued == TRACE_BUFFERS) {
+		tw->stalls++;
+	}
+	while (tw->queued == TRACE_BUFFERS) {
+		pthread_cond_wait(&tw->space, &tw->lock);
+	}
+	pthread_mutex_unlock(&tw->lock);
+
+	tw->fill = (tw->fill + 1) % TRACE_BUFFERS;
+}
+
+
+/*----------------------------\
+		  Recording
+\----------------------------*/
+/*
+	Purpose: creates a trace file and starts its writer thread
+	Params: const char* path - the file to create
+			const Machine* m - the machine about to run, its state is the first checkpoint
+	Return: Trace_Writer* - the writer, NULL on error
+*/
+Trace_Writer* traceOpen(const char* path, const Machine* m) {
+	Trace_Writer* tw = calloc(1, sizeof(Trace_Writer));
+	if (tw == NULL) {
+		return NULL;
+	}
+
+	tw->file = fopen(path, "wb");
+	if (tw->file == NULL) {
+		perror(path);
+		free(tw);
+		return NULL;
+	}
+
+	for (int i = 0; i < TRACE_BUFFERS; i++) {
+		tw->buffers[i] = malloc(TRACE_CHUNK_SIZE);
+		if (tw->buffers[i] == NULL) {
+			traceClose(tw, NULL);
+			return NULL;
+		}
+	}
+
+	tw->header.magic = TRACE_MAGIC;
+	tw->header.version = TRACE_VERSION;
+	tw->header.chunk_size = TRACE_CHUNK_SIZE;
+	tw->header.text_base = m->text_base;
+	tw->shadow = m->arch;
+
+	// reserves the header, it is rewritten with the totals on close
+	uint8_t header[TRACE_HEADER_SIZE] = { 0 };
+	fwrite(header, TRACE_HEADER_SIZE, 1, tw->file);
+
+	pthread_mutex_init(&tw->lock, NULL);
+	pthread_cond_init(&tw->ready, NULL);
+	pthread_cond_init(&tw->space, NULL);
+	if (pthread_create(&tw->thread, NULL, writerThread, tw) != 0) {
+		// no thread would drain the chunks, so nothing can be recorded
+		error("Could not start the trace writer thread");
+		pthread_mutex_destroy(&tw->lock);
+		pthread_cond_destroy(&tw->ready);
+		pthread_cond_destroy(&tw->space);
+		traceClose(tw, NULL);
+		return NULL;
+	}
+
+	beginChunk(tw);
+	return tw;
+}
+
+/*
+	Purpose: appends the record for one retired instruction
+	Params: Trace_Writer* tw - the writer
+			const Decoded_Instruct* d - the instruction that retired
+			const Arch_State* after - the state after the instruction
+	Return: none
+*/
+void traceRecord(Trace_Writer* tw, const Decoded_Instruct* d, const Arch_State* after) {
+	// closes the chunk when the worst case record no longer fits
+	if (tw->end - tw->cur < TRACE_RECORD_MAX) {
+		submitChunk(tw);
+		beginChunk(tw);
+	}
+
+	uint8_t* p = tw->cur + 1;
+	Effect_Kind kind = (Effect_Kind)effect_table[d->op].kind;
+	uint32_t dest = effect_table[d->op].dest_rd ? d->rd : d->rt;
+
+	// writes to $zero change nothing
+	if (kind == EFFECT_REG && dest == 0) {
+		kind = EFFECT_NONE;
+	}
+	uint8_t tag = (uint8_t)(kind << TAG_KIND_SHIFT);
+
+	// pc delta, only for taken branches
+	uint32_t expected = tw->shadow.pc + 4;
+	if (after->pc != expected) {
+		tag |= TAG_JUMP;
+		p = putVarint(p, zigzag((int32_t)(after->pc - expected) >> 2));
+	}
+	tw->shadow.pc = after->pc;
+
+	switch (kind) {
+	case EFFECT_REG: {
+		tag |= (uint8_t)dest;
+		p = putVarint(p, zigzag((int32_t)(after->reg[dest] - tw->shadow.reg[dest])));
+		tw->shadow.reg[dest] = after->reg[dest];
+		break;
+	}
+	case EFFECT_HILO: {
+		p = putVarint(p, zigzag((int32_t)(after->hi - tw->shadow.hi)));
+		p = putVarint(p, zigzag((int32_t)(after->lo - tw->shadow.lo)));
+		tw->shadow.hi = after->hi;
+		tw->shadow.lo = after->lo;
+		break;
+	}
+	case EFFECT_STORE: {
+		// the stored value is always a register the replayer already has
+		uint32_t addr = after->reg[d->rs] + SIGN_EXT16(d->imm);
+		tag |= d->rt;
+		p = putVarint(p, zigzag((int32_t)(addr - tw->last_store)));
+		tw->last_store = addr;
+		break;
+	}
+	default: {
+		break;
+	}
+	}
+
+	*tw->cur = tag;
+	tw->cur = p;
+	((Trace_Chunk_Header*)tw->buffers[tw->fill])->count++;
+	tw->header.instructions++;
+}
+
+/*
+	Purpose: flushes the last chunk, stops the writer thread and finishes the file
+	Params: Trace_Writer* tw - the writer, freed by this call
+			Trace_Stats* stats - filled with the size of the recording, may be NULL
+	Return: int - 0 for no error
+*/
+int traceClose(Trace_Writer* tw, Trace_Stats* stats) {
+	int failed = tw->failed;
+
+	if (tw->cur != NULL) {
+		// the last chunk is always written so even an empty run has a checkpoint
+		submitChunk(tw);
+
+		pthread_mutex_lock(&tw->lock);
+		tw->done = 1;
+		pthread_cond_signal(&tw->ready);
+		pthread_mutex_unlock(&tw->lock);
+		pthread_join(tw->thread, NULL);
+
+		pthread_mutex_destroy(&tw->lock);
+		pthread_cond_destroy(&tw->ready);
+		pthread_cond_destroy(&tw->space);
+
+		// fills in the totals now that they are known
+		uint8_t header[TRACE_HEADER_SIZE] = { 0 };
+		memcpy(header, &tw->header, sizeof(Trace_File_Header));
+		fseek(tw->file, 0, SEEK_SET);
+		fwrite(header, TRACE_HEADER_SIZE, 1, tw->file);
+		failed |= tw->failed;
+	}
+
+	if (stats != NULL) {
+		stats->instructions = tw->header.instructions;
+		stats->chunks = tw->header.chunks;
+		stats->file_bytes = TRACE_HEADER_SIZE + tw->header.chunks * TRACE_CHUNK_SIZE;
+		stats->payload_bytes = tw->payload;
+		stats->stalls = tw->stalls;
+	}
+
+	if (fclose(tw->file) != 0) {
+		failed = 1;
+	}
+	for (int i = 0; i < TRACE_BUFFERS; i++) {
+		free(tw->buffers[i]);
+	}
+	free(tw);
+
+	return failed;
+}
+
+
+/*----------------------------\
+		   Replay
+\----------------------------*/
+/*
+	Purpose: applies one record to a state
+	Params: const uint8_t* p - the record
+			Arch_State* s - the state to update
+			uint32_t* last_store - the previous store address in the chunk
+			Guest_Memory* mem - memory to apply stores to, may be NULL
+	Return: const uint8_t* - the ptr to after the record, NULL when a store could not be applied
+*/
+static const uint8_t* replayRecord(const uint8_t* p, Arch_State* s, uint32_t* last_store, Guest_Memory* mem) {
+	uint8_t tag = *p++;
+
+	s->pc += 4;
+	if (tag & TAG_JUMP) {
+		s->pc += (uint32_t)unzigzag(getVarint(&p)) << 2;
+	}
+
+	switch ((tag >> TAG_KIND_SHIFT) & 0x3) {
+	case EFFECT_REG: {
+		s->reg[tag & TAG_REG_MASK] += (uint32_t)unzigzag(getVarint(&p));
+		break;
+	}
+	case EFFECT_HILO: {
+		s->hi += (uint32_t)unzigzag(getVarint(&p));
+		s->lo += (uint32_t)unzigzag(getVarint(&p));
+		break;
+	}
+	case EFFECT_STORE: {
+		*last_store += (uint32_t)unzigzag(getVarint(&p));
+		if (mem != NULL && memWrite(mem, *last_store, s->reg[tag & TAG_REG_MASK]) == MEM_NO_PAGE) {
+			return NULL;
+		}
+		break;
+	}
+	default: {
+		break;
+	}
+	}
+
+	return p;
+}
+
+/*
+	Purpose: reads one whole chunk
+	Params: FILE* file - the trace
+			uint64_t chunk - the chunk number
+			uint8_t* buffer - TRACE_CHUNK_SIZE bytes to fill
+	Return: int - 0 for no error
+*/
+static int readChunk(FILE* file, uint64_t chunk, uint8_t* buffer) {
+	if (fseek(file, (long)(TRACE_HEADER_SIZE + chunk * TRACE_CHUNK_SIZE), SEEK_SET) != 0) {
+		return 1;
+	}
+	if (fread(buffer, TRACE_CHUNK_SIZE, 1, file) != 1) {
+		return 1;
+	}
+	return ((Trace_Chunk_Header*)buffer)->magic != CHUNK_MAGIC;
+}
+
+/*
+	Purpose: rebuilds the state after a given number of retired instructions
+	Params: const char* path - the trace to read
+			uint64_t index - the number of instructions to replay
+			Arch_State* arch - filled with the registers and pc
+			Guest_Memory* mem - an empty memory filled with every store before the index, may be NULL
+	Return: int - 0 for no error
+*/
+int traceSeek(const char* path, uint64_t index, Arch_State* arch, Guest_Memory* mem) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	Trace_File_Header header;
+	uint8_t* buffer = malloc(TRACE_CHUNK_SIZE);
+	int failed = 1;
+
+	if (buffer == NULL || fread(&header, sizeof(header), 1, file) != 1) {
+		goto done;
+	}
+	if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+		header.chunk_size != TRACE_CHUNK_SIZE || header.chunks == 0 || index > header.instructions) {
+		goto done;
+	}
+
+	// binary searches the chunk headers for the last checkpoint at or before the index
+	uint64_t lo = 0;
+	uint64_t hi = header.chunks - 1;
+	while (lo < hi) {
+		uint64_t mid = (lo + hi + 1) / 2;
+		Trace_Chunk_Header chunk;
+
+		if (fseek(file, (long)(TRACE_HEADER_SIZE + mid * TRACE_CHUNK_SIZE), SEEK_SET) != 0 ||
+			fread(&chunk, sizeof(chunk), 1, file) != 1) {
+			goto done;
+		}
+
+		if (chunk.first <= index) {
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+
+	// memory is not checkpointed, so earlier chunks are scanned for their stores
+	if (mem != NULL) {
+		for (uint64_t c = 0; c < lo; c++) {
+			if (readChunk(file, c, buffer) != 0) {
+				goto done;
+			}
+
+			Trace_Chunk_Header* chunk = (Trace_Chunk_Header*)buffer;
+			const uint8_t* p = buffer + sizeof(Trace_Chunk_Header);
+			Arch_State scratch = chunk->start;
+			uint32_t last_store = 0;
+
+			for (uint32_t i = 0; i < chunk->count && p != NULL; i++) {
+				p = replayRecord(p, &scratch, &last_store, mem);
+			}
+			if (p == NULL) {
+				error("Out of memory");
+				goto done;
+			}
+		}
+	}
+
+	// replays forward from the checkpoint to the index
+	if (readChunk(file, lo, buffer) != 0) {
+		goto done;
+	}
+
+	Trace_Chunk_Header* chunk = (Trace_Chunk_Header*)buffer;
+	const uint8_t* p = buffer + sizeof(Trace_Chunk_Header);
+	uint32_t last_store = 0;
+
+	*arch = chunk->start;
+	for (uint64_t i = chunk->first; i < index && p != NULL; i++) {
+		p = replayRecord(p, arch, &last_store, mem);
+	}
+	if (p == NULL) {
+		error("Out of memory");
+		goto done;
+	}
+	failed = 0;
+
+done:
+	free(buffer);
+	fclose(file);
+	return failed;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --trace mode, runs a program while recording it and reports the cost
+	Params: int argc - number of arguments after the mode
+			char** argv - <out.trace> <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int traceMain(int argc, char** argv) {
+	if (argc < 2) {
+		error("--trace needs an output file and a program file");
+		return 1;
+	}
+
+	uint32_t count;
+	uint32_t* text = loadProgram(argv[1], &count);
+	if (text == NULL) {
+		return 1;
+	}
+
+	// runs once untraced as the baseline for the overhead
+	Machine m;
+	if (machineInit(&m, text, count) != 0) {
+		free(text);
+		return 1;
+	}
+	machineArgs(&m, argc - 2, argv + 2);
+
+	// traced runs step one word at a time, so the baseline does too and only the recording is measured
+	m.use_blocks = 0;
+
+	double start = getTime();
+	machineRun(&m);
+	double plain = getTime() - start;
+	machineFree(&m);
+
+	// runs again while recording, closing the trace counts towards the cost
+	if (machineInit(&m, text, count) != 0) {
+		free(text);
+		return 1;
+	}
+	machineArgs(&m, argc - 2, argv + 2);
+
+	m.trace = traceOpen(argv[0], &m);
+	if (m.trace == NULL) {
+		machineFree(&m);
+		free(text);
+		return 1;
+	}
+
+	Trace_Stats stats;
+	start = getTime();
+	machineRun(&m);
+	int failed = traceClose(m.trace, &stats);
+	double traced = getTime() - start;
+
+	state = m.status;
+	printResult();
+	printf("Retired: %llu\n", (unsigned long long)stats.instructions);
+	printf("Trace: %llu bytes in %llu chunks (%llu payload bytes)\n",
+		(unsigned long long)stats.file_bytes, (unsigned long long)stats.chunks,
+		(unsigned long long)stats.payload_bytes);
+	if (stats.instructions > 0) {
+		printf("Bytes per instruction: %.3f (%.3f payload)\n",
+			(double)stats.file_bytes / stats.instructions, (double)stats.payload_bytes / stats.instructions);
+	}
+	printf("Writer stalls: %llu\n", (unsigned long long)stats.stalls);
+	printf("Untraced: %.6f s\tTraced: %.6f s", plain, traced);
+	if (plain > 0) {
+		printf("\tOverhead: %.1f%%", (traced - plain) / plain * 100.0);
+	}
+	printf("\n");
+
+	if (failed) {
+		error("Writing the trace failed");
+	}
+
+	machineFree(&m);
+	free(text);
+	return failed;
+}
+
+/*
+	Purpose: --replay mode, prints the state at an instruction index of a trace
+	Params: int argc - number of arguments after the mode
+			char** argv - <in.trace> <index> [address...]
+	Return: int - exit code
+*/
+int replayMain(int argc, char** argv) {
+	if (argc < 2) {
+		error("--replay needs a trace file and an instruction index");
+		return 1;
+	}
+
+	uint64_t index = strtoull(argv[1], NULL, 0);
+	Arch_State arch;
+	Guest_Memory mem;
+
+	// memory is only rebuilt when an address was asked for
+	memInit(&mem);
+	if (traceSeek(argv[0], index, &arch, (argc > 2) ? &mem : NULL) != 0) {
+		error("The trace could not be read up to the given index");
+		return 1;
+	}
+
+	printArchState(&arch, index);
+	for (int i = 2; i < argc; i++) {
+		uint32_t addr = (uint32_t)strtoul(argv[i], NULL, 0) & ~3u;
+		printf("MEM[0x%08X] = 0x%08X\n", addr, memRead(&mem, addr));
+	}
+
+	memFree(&mem);
+	return 0;
+}
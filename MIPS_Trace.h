@@ -0,0 +1,184 @@
+#ifndef _MIPS_TRACE_H_
+#define _MIPS_TRACE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "MIPS_Execute.h"
+
+/*
+	Trace file layout, all fields in host byte order:
+
+	[file header, TRACE_HEADER_SIZE bytes]
+	[chunk 0, TRACE_CHUNK_SIZE bytes]
+	[chunk 1, TRACE_CHUNK_SIZE bytes]
+	...
+
+	Every chunk starts with a checkpoint of the architectural state before its
+	first instruction, then one record per retired instruction:
+
+	tag byte: bit 7 - the pc did not advance by 4, a pc delta follows
+			  bits 6-5 - effect kind, bits 4-0 - written or stored register
+	pc delta: zigzag varint of (pc - (last pc + 4)) / 4
+	register: zigzag varint of (new value - old value)
+	HI/LO: two zigzag varints of (new - old), HI first
+	store: zigzag varint of (address - last store address), the value is the tagged register
+
+	Memory is not checkpointed, replay rebuilds it by scanning the stores of
+	every earlier chunk, each chunk decodes on its own from its checkpoint.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+#define TRACE_MAGIC 0x4352544D
+#define CHUNK_MAGIC 0x4B4E4843
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 64
+#define TRACE_CHUNK_SIZE (64 * 1024)
+
+// chunk buffers shared between the recorder and the writer thread
+#define TRACE_BUFFERS 8
+
+// largest possible record: tag and up to three 5 byte varints
+#define TRACE_RECORD_MAX 16
+
+// tag byte fields
+#define TAG_JUMP 0x80
+#define TAG_KIND_SHIFT 5
+#define TAG_REG_MASK 0x1F
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// the one architectural effect an instruction can have
+typedef enum Effect_Kind {
+	EFFECT_NONE,
+	EFFECT_REG,
+	EFFECT_HILO,
+	EFFECT_STORE
+} Effect_Kind;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t chunk_size;
+	uint32_t text_base;
+	uint64_t instructions;
+	uint64_t chunks;
+} Trace_File_Header;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t count;
+	uint64_t first;
+	uint32_t bytes;
+	uint32_t reserved;
+	Arch_State start;
+} Trace_Chunk_Header;
+
+typedef struct Trace_Writer {
+	FILE* file;
+	Trace_File_Header header;
+
+	// chunk being filled by the recorder
+	uint8_t* buffers[TRACE_BUFFERS];
+	uint32_t fill;
+	uint8_t* cur;
+	uint8_t* end;
+
+	// state as of the last record, the base for every delta
+	Arch_State shadow;
+	uint32_t last_store;
+
+	// handoff to the writer thread
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	pthread_cond_t space;
+	uint32_t write;
+	uint32_t queued;
+	int done;
+	int failed;
+
+	// statistics
+	uint64_t payload;
+	uint64_t stalls;
+} Trace_Writer;
+
+// what a finished recording cost
+typedef struct {
+	uint64_t instructions;
+	uint64_t chunks;
+	uint64_t file_bytes;
+	uint64_t payload_bytes;
+	uint64_t stalls;
+} Trace_Stats;
+
+
+/*----------------------------\
+		  Recording
+\----------------------------*/
+/*
+	Purpose: creates a trace file and starts its writer thread
+	Params: const char* path - the file to create
+			const Machine* m - the machine about to run, its state is the first checkpoint
+	Return: Trace_Writer* - the writer, NULL on error
+*/
+Trace_Writer* traceOpen(const char* path, const Machine* m);
+
+/*
+	Purpose: appends the record for one retired instruction
+	Params: Trace_Writer* tw - the writer
+			const Decoded_Instruct* d - the instruction that retired
+			const Arch_State* after - the state after the instruction
+	Return: none
+*/
+void traceRecord(Trace_Writer* tw, const Decoded_Instruct* d, const Arch_State* after);
+
+/*
+	Purpose: flushes the last chunk, stops the writer thread and finishes the file
+	Params: Trace_Writer* tw - the writer, freed by this call
+			Trace_Stats* stats - filled with the size of the recording, may be NULL
+	Return: int - 0 for no error
+*/
+int traceClose(Trace_Writer* tw, Trace_Stats* stats);
+
+
+/*----------------------------\
+		   Replay
+\----------------------------*/
+/*
+	Purpose: rebuilds the state after a given number of retired instructions
+	Params: const char* path - the trace to read
+			uint64_t index - the number of instructions to replay
+			Arch_State* arch - filled with the registers and pc
+			Guest_Memory* mem - an empty memory filled with every store before the index, may be NULL
+	Return: int - 0 for no error
+*/
+int traceSeek(const char* path, uint64_t index, Arch_State* arch, Guest_Memory* mem);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --trace mode, runs a program while recording it and reports the cost
+	Params: int argc - number of arguments after the mode
+			char** argv - <out.trace> <prog.s> [a0 [a1 [a2 [a3]]]]
+	Return: int - exit code
+*/
+int traceMain(int argc, char** argv);
+
+/*
+	Purpose: --replay mode, prints the state at an instruction index of a trace
+	Params: int argc - number of arguments after the mode
+			char** argv - <in.trace> <index> [address...]
+	Return: int - exit code
+*/
+int replayMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,232 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "MIPS_Util.h"
+
+/*----------------------------\
+		   Timing
+\----------------------------*/
+/*
+	Purpose: reads a monotonic clock for timing runs
+	Params: none
+	Return: double - the current time in seconds
+*/
+double getTime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*----------------------------\
+		   Host
+\----------------------------*/
+/*
+	Purpose: finds the byte order of the host
+	Params: none
+	Return: int - 1 when the host is big endian
+*/
+int hostIsBig(void) {
+	const uint16_t probe = 1;
+	return (*(const uint8_t*)&probe == 0);
+}
+
+
+/*----------------------------\
+		   Hashing
+\----------------------------*/
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+/*
+	Purpose: rotates a 64 bit value left
+	Params: uint64_t x - the value
+			int r - the bits to rotate by, 1 to 63
+	Return: uint64_t - the rotated value
+*/
+static inline uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+/*
+	Purpose: mixes 8 bytes into one of the four accumulators
+	Params: uint64_t acc - the accumulator
+			uint64_t input - the bytes
+	Return: uint64_t - the new accumulator
+*/
+static inline uint64_t hashRound(uint64_t acc, uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+/*
+	Purpose: folds an accumulator into the hash once all 32 byte stripes are done
+	Params: uint64_t hash - the hash so far
+			uint64_t acc - the accumulator
+	Return: uint64_t - the new hash
+*/
+static inline uint64_t hashMerge(uint64_t hash, uint64_t acc) {
+	hash ^= hashRound(0, acc);
+	return hash * PRIME64_1 + PRIME64_4;
+}
+
+/*
+	Purpose: hashes bytes with the xxHash64 algorithm, values depend on the host byte order
+	Params: const void* data - the bytes
+			size_t size - how many
+			uint64_t seed - the seed, chaining a previous hash in lets several runs of bytes make one hash
+	Return: uint64_t - the hash
+*/
+uint64_t hash64(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* p = data;
+	const uint8_t* end = p + size;
+	uint64_t hash;
+
+	// 32 byte stripes go through four independent accumulators
+	if (size >= 32) {
+		uint64_t acc[4] = { seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1 };
+		do {
+			for (int lane = 0; lane < 4; lane++) {
+				uint64_t input;
+				memcpy(&input, p + lane * 8, 8);
+				acc[lane] = hashRound(acc[lane], input);
+			}
+			p += 32;
+		} while (end - p >= 32);
+
+		hash = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+		for (int lane = 0; lane < 4; lane++) {
+			hash = hashMerge(hash, acc[lane]);
+		}
+	}
+	else {
+		hash = seed + PRIME64_5;
+	}
+	hash += (uint64_t)size;
+
+	// the tail 8, then 4, then 1 byte at a time
+	for (; end - p >= 8; p += 8) {
+		uint64_t input;
+		memcpy(&input, p, 8);
+		hash ^= hashRound(0, input);
+		hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (end - p >= 4) {
+		uint32_t input;
+		memcpy(&input, p, 4);
+		hash ^= (uint64_t)input * PRIME64_1;
+		hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		hash ^= (uint64_t)*p * PRIME64_5;
+		hash = rotl64(hash, 11) * PRIME64_1;
+	}
+
+	// the final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+/*----------------------------\
+		   Threads
+\----------------------------*/
+// what every thread of one runChunks call shares
+typedef struct Chunk_Pool Chunk_Pool;
+
+// one thread and the pool it takes chunks from
+typedef struct {
+	Chunk_Pool* pool;
+	pthread_t thread;
+	int worker;
+} Chunk_Worker;
+
+struct Chunk_Pool {
+	Chunk_Func fn;
+	void* ctx;
+	uint32_t count;
+	uint32_t next;
+	Chunk_Worker workers[CHUNK_MAX_THREADS];
+};
+
+/*
+	Purpose: picks how many threads runChunks should use
+	Params: uint32_t count - how many chunks there are
+			int threads - the threads asked for, 0 or less for one per core
+	Return: int - the thread count, 1 to CHUNK_MAX_THREADS and no more than count
+*/
+int chunkThreads(uint32_t count, int threads) {
+	if (threads <= 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cores > CHUNK_MAX_THREADS) ? CHUNK_MAX_THREADS : (int)cores;
+	}
+	if (threads > CHUNK_MAX_THREADS) {
+		threads = CHUNK_MAX_THREADS;
+	}
+	if ((uint32_t)threads > count) {
+		threads = (int)count;
+	}
+	return (threads < 1) ? 1 : threads;
+}
+
+/*
+	Purpose: worker thread, runs chunks off the shared counter until none are left
+	Params: void* arg - the Chunk_Worker
+	Return: void* - NULL
+*/
+static void* chunkWorker(void* arg) {
+	Chunk_Worker* w = arg;
+	Chunk_Pool* pool = w->pool;
+	uint32_t chunk;
+
+	while ((chunk = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->count) {
+		pool->fn(pool->ctx, w->worker, chunk);
+	}
+
+	return NULL;
+}
+
+/*
+	Purpose: runs fn on every chunk, threads take the next chunk off a shared counter until none are left
+	Params: uint32_t count - how many chunks there are
+			int threads - the thread count from chunkThreads, the calling thread is worker 0
+			Chunk_Func fn - the work for one chunk
+			void* ctx - passed to fn
+	Return: none, if a thread can't be started the ones that did start do its share
+*/
+void runChunks(uint32_t count, int threads, Chunk_Func fn, void* ctx) {
+	Chunk_Pool pool = { .fn = fn, .ctx = ctx, .count = count, .next = 0 };
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads > CHUNK_MAX_THREADS) {
+		threads = CHUNK_MAX_THREADS;
+	}
+	for (int i = 0; i < threads; i++) {
+		pool.workers[i].pool = &pool;
+		pool.workers[i].worker = i;
+	}
+
+	int started;
+	for (started = 1; started < threads; started++) {
+		if (pthread_create(&pool.workers[started].thread, NULL, chunkWorker, &pool.workers[started]) != 0) {
+			break;
+		}
+	}
+	chunkWorker(&pool.workers[0]);
+	for (int i = 1; i < started; i++) {
+		pthread_join(pool.workers[i].thread, NULL);
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef _MIPS_UTIL_H_
+#define _MIPS_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// most threads runChunks starts
+#define CHUNK_MAX_THREADS 64
+
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// four words compared at once, the compiler picks the host's vector instructions
+typedef uint32_t Word_Vec __attribute__((vector_size(16)));
+
+// the work done on one chunk, worker is below the thread count given to runChunks
+typedef void (*Chunk_Func)(void* ctx, int worker, uint32_t chunk);
+
+
+/*----------------------------\
+		   Timing
+\----------------------------*/
+/*
+	Purpose: reads a monotonic clock for timing runs
+	Params: none
+	Return: double - the current time in seconds
+*/
+double getTime(void);
+
+
+/*----------------------------\
+		   Host
+\----------------------------*/
+/*
+	Purpose: finds the byte order of the host
+	Params: none
+	Return: int - 1 when the host is big endian
+*/
+int hostIsBig(void);
+
+
+/*----------------------------\
+		   Hashing
+\----------------------------*/
+/*
+	Purpose: hashes bytes with the xxHash64 algorithm, values depend on the host byte order
+	Params: const void* data - the bytes
+			size_t size - how many
+			uint64_t seed - the seed, chaining a previous hash in lets several runs of bytes make one hash
+	Return: uint64_t - the hash
+*/
+uint64_t hash64(const void* data, size_t size, uint64_t seed);
+
+
+/*----------------------------\
+		   Threads
+\----------------------------*/
+/*
+	Purpose: picks how many threads runChunks should use
+	Params: uint32_t count - how many chunks there are
+			int threads - the threads asked for, 0 or less for one per core
+	Return: int - the thread count, 1 to CHUNK_MAX_THREADS and no more than count
+*/
+int chunkThreads(uint32_t count, int threads);
+
+/*
+	Purpose: runs fn on every chunk, threads take the next chunk off a shared counter until none are left
+	Params: uint32_t count - how many chunks there are
+			int threads - the thread count from chunkThreads, the calling thread is worker 0
+			Chunk_Func fn - the work for one chunk
+			void* ctx - passed to fn
+	Return: none, if a thread can't be started the ones that did start do its share
+*/
+void runChunks(uint32_t count, int threads, Chunk_Func fn, void* ctx);
+
+#endif
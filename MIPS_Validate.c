@@ -0,0 +1,311 @@
+#include "MIPS_Instruction.h"
+#include "MIPS_Decode.h"
+#include "MIPS_Execute.h"
+#include "MIPS_Image.h"
+#include "MIPS_Validate.h"
+#include "MIPS_Util.h"
+
+// opcode/funct keys, an opcode on its own or 64 + the funct of an R-type word
+#define VALIDATE_KEYS 128
+
+// longest listed line
+#define VALIDATE_LINE_MAX 64
+
+// the fields a word can set that its op ignores, with their names
+static const uint32_t field_masks[4] = { 0x03E00000, 0x001F0000, 0x0000F800, 0x000007C0 };
+static const char* field_names[4] = { "rs", "rt", "rd", "shamt" };
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a run of words one thread checks and what it found
+typedef struct {
+	Validate_Finding* findings;
+	uint32_t count;
+	uint32_t capacity;
+	int failed;
+} Validate_Chunk;
+
+// a check in progress, shared by its threads
+typedef struct {
+	const uint8_t* text;
+	uint32_t count;
+	int swap;
+
+	// the bits that must be clear for each key, and a high word that is set when the key is no op
+	uint64_t checks[VALIDATE_KEYS];
+	Validate_Chunk* chunks;
+	uint32_t chunk_count;
+} Validate_Check;
+
+
+/*----------------------------\
+		   Checking
+\----------------------------*/
+/*
+	Purpose: records a finding, joining an unrecognized word to the run before it
+	Params: Validate_Chunk* chunk - the chunk
+			uint32_t index - the word's index
+			uint32_t kind - the VALIDATE_ kind
+	Return: none
+*/
+static void addFinding(Validate_Chunk* chunk, uint32_t index, uint32_t kind) {
+	if (chunk->count > 0) {
+		Validate_Finding* last = &chunk->findings[chunk->count - 1];
+		if (kind == VALIDATE_UNRECOGNIZED && last->kind == VALIDATE_UNRECOGNIZED &&
+			last->start + last->count == index) {
+			last->count++;
+			return;
+		}
+	}
+
+	if (chunk->count == chunk->capacity) {
+		uint32_t capacity = (chunk->capacity == 0) ? 64 : chunk->capacity * 2;
+		Validate_Finding* findings = realloc(chunk->findings, capacity * sizeof(Validate_Finding));
+		if (findings == NULL) {
+			chunk->failed = 1;
+			return;
+		}
+		chunk->findings = findings;
+		chunk->capacity = capacity;
+	}
+	chunk->findings[chunk->count].start = index;
+	chunk->findings[chunk->count].count = 1;
+	chunk->findings[chunk->count].kind = kind;
+	chunk->count++;
+}
+
+/*
+	Purpose: checks a chunk of words, going over a step word by word only when something in it is wrong
+	Params: Validate_Check* v - the check
+			uint32_t index - the chunk's number
+	Return: none
+*/
+static void checkChunk(Validate_Check* v, uint32_t index) {
+	Validate_Chunk* chunk = &v->chunks[index];
+	uint32_t from = index * VALIDATE_CHUNK_WORDS;
+	uint32_t to = (v->count - from < VALIDATE_CHUNK_WORDS) ? v->count : from + VALIDATE_CHUNK_WORDS;
+
+	for (uint32_t i = from; i < to && !chunk->failed; i += VALIDATE_STEP_WORDS) {
+		uint32_t n = (to - i < VALIDATE_STEP_WORDS) ? to - i : VALIDATE_STEP_WORDS;
+		uint32_t words[VALIDATE_STEP_WORDS];
+		uint32_t keys[VALIDATE_STEP_WORDS];
+		Word_Vec w[VALIDATE_STEP_WORDS / 4];
+		if (n == VALIDATE_STEP_WORDS) {
+			memcpy(w, v->text + (size_t)i * 4, sizeof(w));
+		}
+		else {
+			memset(w, 0, sizeof(w));
+			memcpy(w, v->text + (size_t)i * 4, (size_t)n * 4);
+		}
+
+		for (int k = 0; k < VALIDATE_STEP_WORDS / 4; k++) {
+			if (v->swap) {
+				w[k] = (w[k] >> 24) | (w[k] << 24) | ((w[k] >> 8) & 0xFF00) | ((w[k] << 8) & 0xFF0000);
+			}
+			memcpy(words + k * 4, &w[k], 16);
+		}
+
+		uint32_t bad = 0;
+		for (uint32_t k = 0; k < VALIDATE_STEP_WORDS; k++) {
+			uint32_t opcode = words[k] >> 26;
+			keys[k] = opcode ? opcode : (words[k] & 63) | 64;
+			uint64_t check = v->checks[keys[k]];
+			bad |= (words[k] & (uint32_t)check) | (uint32_t)(check >> 32);
+		}
+		if (bad == 0) {
+			continue;
+		}
+
+		for (uint32_t k = 0; k < n; k++) {
+			uint64_t check = v->checks[keys[k]];
+			if ((check >> 32) != 0) {
+				addFinding(chunk, i + k, VALIDATE_UNRECOGNIZED);
+			}
+			else if ((words[k] & (uint32_t)check) != 0) {
+				addFinding(chunk, i + k, VALIDATE_UNUSED_BITS);
+			}
+		}
+	}
+}
+
+/*
+	Purpose: checks one chunk, the findings go to the chunk's own list
+	Params: void* ctx - the Validate_Check
+			int worker - unused, the chunk has its own list
+			uint32_t index - the chunk
+	Return: none
+*/
+static void validateChunk(void* ctx, int worker, uint32_t index) {
+	(void)worker;
+	checkChunk(ctx, index);
+}
+
+/*
+	Purpose: finds the words of a .text decode() would not recognize or would read past set bits of
+	Params: const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			int threads - the number of threads, 0 for one per core
+			Validate_Finding** findings - filled with the findings in address order, to free
+			uint32_t* finding_count - filled with the number of findings
+			Validate_Stats* stats - filled with the counts and time
+	Return: int - 0 for no error
+*/
+int validateWords(const uint8_t* text, uint32_t count, int big, int threads, Validate_Finding** findings,
+	uint32_t* finding_count, Validate_Stats* stats) {
+	Validate_Check v;
+	memset(stats, 0, sizeof(*stats));
+	*findings = NULL;
+	*finding_count = 0;
+	v.text = text;
+	v.count = count;
+	v.swap = (big != hostIsBig());
+
+	// key 0 never comes up, opcode 0 is checked by its funct
+	for (uint32_t key = 0; key < VALIDATE_KEYS; key++) {
+		Op_Type op = (key < 64) ? wordOp(key << 26) : wordOp(key - 64);
+		v.checks[key] = (op == OP_INVALID) ? (1ull << 32) : opUnusedBits(op);
+	}
+
+	v.chunk_count = (count + VALIDATE_CHUNK_WORDS - 1) / VALIDATE_CHUNK_WORDS;
+	v.chunks = calloc(v.chunk_count + 1, sizeof(Validate_Chunk));
+	if (v.chunks == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	threads = chunkThreads(v.chunk_count, threads);
+
+	double start = getTime();
+	runChunks(v.chunk_count, threads, validateChunk, &v);
+
+	// chunks are joined in order, a run of unrecognized words can carry on from one chunk into the next
+	uint32_t total = 0;
+	int failed = 0;
+	for (uint32_t c = 0; c < v.chunk_count; c++) {
+		total += v.chunks[c].count;
+		failed |= v.chunks[c].failed;
+	}
+	Validate_Finding* all = failed ? NULL : malloc(((size_t)total + 1) * sizeof(Validate_Finding));
+	uint32_t used = 0;
+	for (uint32_t c = 0; c < v.chunk_count && all != NULL; c++) {
+		for (uint32_t f = 0; f < v.chunks[c].count; f++) {
+			const Validate_Finding* found = &v.chunks[c].findings[f];
+			if (found->kind == VALIDATE_UNRECOGNIZED) {
+				stats->unrecognized += found->count;
+			}
+			else {
+				stats->unused_bits++;
+			}
+
+			Validate_Finding* last = (used > 0) ? &all[used - 1] : NULL;
+			if (last != NULL && found->kind == VALIDATE_UNRECOGNIZED && last->kind == VALIDATE_UNRECOGNIZED &&
+				last->start + last->count == found->start) {
+				last->count += found->count;
+			}
+			else {
+				all[used++] = *found;
+			}
+		}
+	}
+	for (uint32_t c = 0; c < v.chunk_count; c++) {
+		free(v.chunks[c].findings);
+	}
+	free(v.chunks);
+	stats->time = getTime() - start;
+	stats->words = count;
+
+	if (all == NULL) {
+		error("Out of memory");
+		return 1;
+	}
+	*findings = all;
+	*finding_count = used;
+	return 0;
+}
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --validate mode, lists the words of an image that are unrecognized or set bits their op ignores
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file>
+	Return: int - exit code, 0 when every word is good and 1 when some are not
+*/
+int validateMain(int argc, char** argv) {
+	int big = 1;
+	int threads = 0;
+	uint32_t raw_base = TEXT_BASE;
+	imageOptions(&argc, &argv, &raw_base, &big, &threads);
+	if (argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0') {
+		printf("ERROR: Unknown option %s\n", argv[0]);
+		return 2;
+	}
+	if (argc < 1) {
+		error("--validate needs a file");
+		return 2;
+	}
+
+	Elf_Image image;
+	if (imageOpenAny(&image, argv[0], raw_base, big) != 0) {
+		return 2;
+	}
+
+	Validate_Finding* findings;
+	uint32_t finding_count;
+	Validate_Stats stats;
+	if (validateWords(image.text, image.text_size / 4, image.big, threads, &findings, &finding_count, &stats) != 0) {
+		imageClose(&image);
+		return 2;
+	}
+
+	// address, op, the word and the run length or the fields set that the op ignores
+	char* buffer = malloc(IMAGE_OUT_SIZE);
+	int failed = (buffer == NULL);
+	size_t used = 0;
+	fflush(stdout);
+	for (uint32_t f = 0; f < finding_count && !failed; f++) {
+		if (IMAGE_OUT_SIZE - used < VALIDATE_LINE_MAX) {
+			failed = (fwrite(buffer, 1, used, stdout) != used);
+			used = 0;
+		}
+
+		const Validate_Finding* found = &findings[f];
+		uint32_t word = elfGet32(image.text + (size_t)found->start * 4, image.big);
+		Op_Type op = wordOp(word);
+		used += (size_t)sprintf(buffer + used, "%08X  %-4s  %08X", image.text_addr + found->start * 4, opName(op),
+			word);
+		if (found->kind == VALIDATE_UNRECOGNIZED && found->count > 1) {
+			used += (size_t)sprintf(buffer + used, "  x%u", found->count);
+		}
+		else if (found->kind == VALIDATE_UNUSED_BITS) {
+			for (int field = 0; field < 4; field++) {
+				if (word & opUnusedBits(op) & field_masks[field]) {
+					used += (size_t)sprintf(buffer + used, "  %s", field_names[field]);
+				}
+			}
+		}
+		buffer[used++] = '\n';
+	}
+	if (buffer == NULL) {
+		error("Out of memory");
+	}
+	else {
+		failed |= (fwrite(buffer, 1, used, stdout) != used);
+	}
+	fflush(stdout);
+
+	fprintf(stderr, "Words: %llu\tUnrecognized: %llu\tUnused bits: %llu\tTime: %.6f s\t%.1f MB/s\n",
+		(unsigned long long)stats.words, (unsigned long long)stats.unrecognized,
+		(unsigned long long)stats.unused_bits, stats.time, stats.time > 0 ? stats.words * 4 / stats.time / 1e6 : 0.0);
+
+	free(buffer);
+	free(findings);
+	imageClose(&image);
+	if (failed) {
+		return 2;
+	}
+	return (finding_count == 0) ? 0 : 1;
+}
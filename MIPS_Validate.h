@@ -0,0 +1,93 @@
+#ifndef _MIPS_VALIDATE_H_
+#define _MIPS_VALIDATE_H_
+
+#include <stdint.h>
+
+/*
+	Checks every word of an image's .text against the opcode/funct tables
+	without decoding any of them. A word is reported when its opcode, or
+	funct for opcode 0, names no op decode() knows, or when it sets bits
+	its op never reads, the shamt of R-type ops, rd of MULT/DIV, rs and rt
+	of MFHI/MFLO and rs of LUI. decode() accepts those words and drops the
+	bits, so they were most likely meant as something it does not know.
+
+	The mapped .text is read as it is, 16 words at a time, byte swapped
+	with vector shifts first when the file's order is not the host's. One
+	table entry per opcode/funct key holds the bits that must be clear and
+	whether the key is an op at all, so a good word costs one load, an and
+	and an or with no branch. Only steps with something wrong are gone
+	over again to record what it was.
+
+	The words are split into chunks that threads take in turn, each
+	keeping its own findings, and the findings are joined in address
+	order at the end, runs of unrecognized words across chunks becoming
+	one.
+*/
+
+/*----------------------------\
+		   Defines
+\----------------------------*/
+// words a thread takes at once
+#define VALIDATE_CHUNK_WORDS (1u << 20)
+
+// words checked per step, four vectors of four
+#define VALIDATE_STEP_WORDS 16
+
+/*----------------------------\
+		   Enums
+\----------------------------*/
+// what is wrong with a word
+typedef enum Validate_Kind {
+	VALIDATE_UNRECOGNIZED,
+	VALIDATE_UNUSED_BITS
+} Validate_Kind;
+
+/*----------------------------\
+		   Data Types
+\----------------------------*/
+// a run of unrecognized words, or one word with bits its op does not read
+typedef struct {
+	uint32_t start;
+	uint32_t count;
+	uint32_t kind;
+} Validate_Finding;
+
+// what a check found
+typedef struct {
+	uint64_t words;
+	uint64_t unrecognized;
+	uint64_t unused_bits;
+	double time;
+} Validate_Stats;
+
+
+/*----------------------------\
+		   Functions
+\----------------------------*/
+/*
+	Purpose: finds the words of a .text decode() would not recognize or would read past set bits of
+	Params: const uint8_t* text - the words in file byte order
+			uint32_t count - the number of words
+			int big - 1 for big endian words
+			int threads - the number of threads, 0 for one per core
+			Validate_Finding** findings - filled with the findings in address order, to free
+			uint32_t* finding_count - filled with the number of findings
+			Validate_Stats* stats - filled with the counts and time
+	Return: int - 0 for no error
+*/
+int validateWords(const uint8_t* text, uint32_t count, int big, int threads, Validate_Finding** findings,
+	uint32_t* finding_count, Validate_Stats* stats);
+
+
+/*----------------------------\
+		   Modes
+\----------------------------*/
+/*
+	Purpose: --validate mode, lists the words of an image that are unrecognized or set bits their op ignores
+	Params: int argc - number of arguments after the mode
+			char** argv - [-j N] [-EB|-EL] [-a addr] <file>
+	Return: int - exit code, 0 when every word is good and 1 when some are not
+*/
+int validateMain(int argc, char** argv);
+
+#endif
@@ -29,15 +29,21 @@ void or_reg_assm(void) {
         return;
     }
 
+    // Verify that all registers are in range.
+    if (PARAM1.value > 31 || PARAM2.value > 31 || PARAM3.value > 31) {
+        state = INVALID_REG; // Set state to INVALID_REG if any register is out of range.
+        return;
+    }
+
     // Set the opcode for R-type instruction (OR).
     setBits_str(31, "000000");
 
     // Set the destination register (Rd) bits.
-    setBits_num(20, PARAM1.value, 5);
+    setBits_num(15, PARAM1.value, 5);
 
     // Set the source registers (Rs and Rt) bits.
     setBits_num(25, PARAM2.value, 5);
-    setBits_num(15, PARAM3.value, 5);
+    setBits_num(20, PARAM3.value, 5);
 
     // Set the shift amount (shamt) to 0.
     setBits_str(10, "00000");
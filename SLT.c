@@ -43,8 +43,8 @@
  
 	 // Set the source register (Rs), destination register (Rd), and second operand register (Rt)
 	 setBits_num(25, PARAM2.value, 5); // Rs (source register 1)
-	 setBits_num(20, PARAM1.value, 5); // Rd (destination register)
-	 setBits_num(15, PARAM3.value, 5); // Rt (source register 2)
+	 setBits_num(15, PARAM1.value, 5); // Rd (destination register)
+	 setBits_num(20, PARAM3.value, 5); // Rt (source register 2)
  
 	 // Set the shift amount (shamt) to 0 for SLT (not used in this case)
 	 setBits_str(10, "00000");
@@ -24,6 +24,16 @@ void slti_immd_assm(void) {
         return;
     }
 
+    // Check that the registers are in range and the immediate fits in 16 bits
+    if (PARAM1.value > 31 || PARAM2.value > 31) {
+        state = INVALID_REG;  // Set state to INVALID_REG if a register is out of range
+        return;
+    }
+    if (PARAM3.value > 0xFFFF) {
+        state = INVALID_IMMED;  // Set state to INVALID_IMMED if the immediate does not fit
+        return;
+    }
+
     // Set the opcode for SLTI (immediate comparison)
     setBits_str(31, "001010");
 
@@ -42,6 +42,13 @@ enum code {
 	MISSING_COMMA,
 	INVALID_SHIFT,
 	MISSING_SHIFT,
+	COMPLETE_RUN,
+	INVALID_PC,
+	UNALIGNED_ACCESS,
+	OUT_OF_MEMORY,
+	BUDGET_EXHAUSTED,
+	WATCHPOINT_HIT,
+	INVALID_DIGITS,
 	UNDEF_ERROR
 };
 
@@ -86,9 +93,15 @@ typedef struct {
 /*----------------------------\
 		 Global Variables
 \----------------------------*/
+// every thread gets its own instruction context, so threads can parse and encode at the same time
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
 
-extern Assm_Instruct assm_instruct;
-extern uint32_t instruct;
-extern uint16_t state;
+extern THREAD_LOCAL Assm_Instruct assm_instruct;
+extern THREAD_LOCAL uint32_t instruct;
+extern THREAD_LOCAL uint16_t state;
 
 #endif
\ No newline at end of file